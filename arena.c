@@ -0,0 +1,66 @@
+#include <stdlib.h>	//malloc, free
+#include <string.h>	//memset
+
+#include "arena.h"
+
+
+#define ARENA_ALIGN 16
+
+
+struct ArenaBlock {
+	ArenaBlock *next;
+	size_t size;
+	//Keeps the data after the header aligned.
+	_Alignas(ARENA_ALIGN) unsigned char data[];
+};
+
+
+void ArenaInit(Arena *arena, size_t blockSize){
+	memset(arena, 0, sizeof(*arena));
+	arena->blockSize = blockSize;
+}
+
+
+void *ArenaAlloc(Arena *arena, size_t size){
+
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	if (size > arena->left){
+		size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+		ArenaBlock *block = malloc(sizeof(ArenaBlock) + blockSize);
+		if (!block){
+			return NULL;
+		}
+		block->size = blockSize;
+		block->next = arena->blocks;
+		arena->blocks = block;
+		arena->reserved += blockSize;
+
+		//An oversized block is used up at once, the current block keeps serving small requests.
+		if (blockSize > arena->blockSize){
+			arena->used += size;
+			memset(block->data, 0, size);
+			return block->data;
+		}
+		arena->next = block->data;
+		arena->left = blockSize;
+	}
+
+	void *p = arena->next;
+	arena->next += size;
+	arena->left -= size;
+	arena->used += size;
+	memset(p, 0, size);
+	return p;
+}
+
+
+void ArenaFree(Arena *arena){
+	ArenaBlock *block = arena->blocks;
+	while (block){
+		ArenaBlock *next = block->next;
+		free(block);
+		block = next;
+	}
+	ArenaInit(arena, arena->blockSize);
+}
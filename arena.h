@@ -0,0 +1,36 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator for data that is built up piece by piece and freed all at once (parse trees). Memory comes
+ * from the heap in blocks of blockSize bytes; a request bigger than a block gets a block of its own.
+ *
+ * used : bytes handed out
+ * reserved : bytes taken from the heap
+ */
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct Arena {
+	ArenaBlock *blocks;
+	unsigned char *next;
+	size_t left;
+	size_t blockSize;
+	size_t used;
+	size_t reserved;
+} Arena;
+
+
+void ArenaInit(Arena *arena, size_t blockSize);
+
+
+/* Returns size bytes aligned for any type, zeroed, or NULL if the heap is exhausted.
+ */
+void *ArenaAlloc(Arena *arena, size_t size);
+
+
+/* Frees every block. The arena can be used again afterwards.
+ */
+void ArenaFree(Arena *arena);
+
+#endif
@@ -0,0 +1,399 @@
+#include <stdlib.h>	//strtod
+#include <string.h>	//memchr, memcmp, memset
+
+#include "assets_import.h"
+#include "mapped_file.h"
+
+
+/* Which list the current <Item> elements belong to.
+ */
+typedef enum ItemSection {
+	SECTION_None,
+	SECTION_Inputs,
+	SECTION_Outputs
+} ItemSection;
+
+
+/* Everything the scanner remembers while it is inside an <Asset>. Reset at every <Asset>.
+ *
+ * inStandard / inResidence / inFactoryBase : inside <Standard>, <Residence7> or <FactoryBase>
+ * haveGuid / haveName : the first GUID/Name inside <Standard> was taken, later ones are ignored
+ * hasFactoryBase : the asset has a <FactoryBase>, which makes it a production building
+ * section / item : the item list being filled and the item that Product/Amount are written to
+ */
+typedef struct ScanState {
+	int inAsset;
+	int inStandard;
+	int inResidence;
+	int inFactoryBase;
+	int haveGuid;
+	int haveName;
+	int hasFactoryBase;
+	ItemSection section;
+	AssetItem *item;
+	AssetRecord record;
+} ScanState;
+
+
+static const char *g_kindNames[ASSET_KIND_COUNT] = {
+	[ASSET_Product]		= "Product",
+	[ASSET_Residence]	= "Residence",
+	[ASSET_PopulationLevel]	= "PopulationLevel",
+	[ASSET_Production]	= "Production"
+};
+
+
+const char *AssetKindName(AssetKind kind){
+	if ((int)kind < 0 || kind >= ASSET_KIND_COUNT){
+		return "(unknown)";
+	}
+	return g_kindNames[kind];
+}
+
+
+//Compares a view with a null terminated string literal.
+#define VIEW_IS(ptr, len, literal) ((len) == sizeof(literal) - 1 && memcmp((ptr), (literal), sizeof(literal) - 1) == 0)
+
+
+static long ParseLong(const char *p, size_t len){
+	long value = 0;
+	int negative = 0;
+	size_t i = 0;
+
+	while (i < len && (p[i] == ' ' || p[i] == '\t' || p[i] == '\r' || p[i] == '\n')){
+		i++;
+	}
+	if (i < len && p[i] == '-'){
+		negative = 1;
+		i++;
+	}
+	for (; i < len && p[i] >= '0' && p[i] <= '9'; i++){
+		value = value * 10 + (p[i] - '0');
+	}
+	return negative ? -value : value;
+}
+
+
+//strtod needs a terminated string, numbers in assets.xml are short so they are copied to the stack first.
+static double ParseDouble(const char *p, size_t len){
+	char buffer[64];
+	if (len >= sizeof(buffer)){
+		len = sizeof(buffer) - 1;
+	}
+	memcpy(buffer, p, len);
+	buffer[len] = '\0';
+	return strtod(buffer, NULL);
+}
+
+
+//Finds literal in [p, end). memmem is not available everywhere, so this is a memchr on the first byte.
+static const char *FindText(const char *p, const char *end, const char *literal, size_t len){
+	while (p + len <= end){
+		p = memchr(p, literal[0], (size_t)(end - p) - len + 1);
+		if (!p){
+			return NULL;
+		}
+		if (memcmp(p, literal, len) == 0){
+			return p;
+		}
+		p++;
+	}
+	return NULL;
+}
+
+
+static void BeginAsset(ScanState *st){
+	memset(st, 0, sizeof(*st));
+	st->inAsset = 1;
+}
+
+
+static AssetItem *NewItem(ScanState *st){
+	AssetRecord *r = &st->record;
+	if (st->section == SECTION_Inputs){
+		if (r->inputCount < ASSET_MAX_INPUTS){
+			AssetItem *item = &r->inputs[r->inputCount++];
+			memset(item, 0, sizeof(*item));
+			return item;
+		}
+	}
+	else if (st->section == SECTION_Outputs){
+		if (r->outputCount < ASSET_MAX_OUTPUTS){
+			AssetItem *item = &r->outputs[r->outputCount++];
+			memset(item, 0, sizeof(*item));
+			return item;
+		}
+	}
+	r->truncated = 1;
+	return NULL;
+}
+
+
+/* Decides what a finished asset is and hands it to the callback. Returns 0 if the callback wants to stop.
+ */
+static int EndAsset(ScanState *st, AssetRecordFn fn, void *user, AssetImportStats *stats){
+
+	AssetRecord *r = &st->record;
+	const char *t = r->templateName.ptr;
+	size_t tl = r->templateName.len;
+	int emit = 1;
+
+	st->inAsset = 0;
+
+	if (VIEW_IS(t, tl, "ResidenceBuilding7") || r->populationLevel != 0){
+		r->kind = ASSET_Residence;
+	}
+	else if (VIEW_IS(t, tl, "PopulationLevel7")){
+		r->kind = ASSET_PopulationLevel;
+	}
+	else if (st->hasFactoryBase){
+		r->kind = ASSET_Production;
+	}
+	else if (VIEW_IS(t, tl, "Product")){
+		r->kind = ASSET_Product;
+	}
+	else{
+		emit = 0;
+	}
+
+	if (!emit){
+		return 1;
+	}
+
+	if (stats){
+		stats->records[r->kind]++;
+		if (r->truncated){
+			stats->truncatedRecords++;
+		}
+	}
+	return fn ? fn(r, user) : 1;
+}
+
+
+/* Handles an opening tag inside an asset. text/textLen is the character data that follows the tag up to
+ * the next '<' (only meaningful for leaf elements).
+ */
+static void OpenTag(ScanState *st, const char *name, size_t len, const char *text, size_t textLen){
+
+	AssetRecord *r = &st->record;
+
+	switch (name[0]){
+		case 'A':
+			if (VIEW_IS(name, len, "Amount") && st->item){
+				st->item->amount = ParseDouble(text, textLen);
+			}
+			break;
+		case 'C':
+			if (VIEW_IS(name, len, "CycleTime") && st->inFactoryBase){
+				r->cycleTime = ParseDouble(text, textLen);
+			}
+			break;
+		case 'F':
+			if (VIEW_IS(name, len, "FactoryBase")){
+				st->inFactoryBase = 1;
+				st->hasFactoryBase = 1;
+			}
+			else if (VIEW_IS(name, len, "FactoryInputs")){
+				st->section = SECTION_Inputs;
+			}
+			else if (VIEW_IS(name, len, "FactoryOutputs")){
+				st->section = SECTION_Outputs;
+			}
+			break;
+		case 'G':
+			if (VIEW_IS(name, len, "GUID") && st->inStandard && !st->haveGuid){
+				r->guid = ParseLong(text, textLen);
+				st->haveGuid = 1;
+			}
+			break;
+		case 'I':
+			if (VIEW_IS(name, len, "Item") && st->section != SECTION_None){
+				st->item = NewItem(st);
+			}
+			break;
+		case 'N':
+			if (VIEW_IS(name, len, "Name") && st->inStandard && !st->haveName){
+				r->name.ptr = text;
+				r->name.len = textLen;
+				st->haveName = 1;
+			}
+			break;
+		case 'P':
+			if (VIEW_IS(name, len, "Product") && st->item){
+				st->item->product = ParseLong(text, textLen);
+			}
+			else if (VIEW_IS(name, len, "PopulationInputs")){
+				st->section = SECTION_Inputs;
+			}
+			else if (VIEW_IS(name, len, "PopulationLevel7") && st->inResidence){
+				r->populationLevel = ParseLong(text, textLen);
+			}
+			break;
+		case 'R':
+			if (VIEW_IS(name, len, "Residence7")){
+				st->inResidence = 1;
+			}
+			else if (VIEW_IS(name, len, "ResidentMax") && st->inResidence){
+				r->residentMax = (int)ParseLong(text, textLen);
+			}
+			break;
+		case 'S':
+			if (VIEW_IS(name, len, "Standard")){
+				st->inStandard = 1;
+			}
+			break;
+		case 'T':
+			if (VIEW_IS(name, len, "Template") && r->templateName.ptr == NULL){
+				r->templateName.ptr = text;
+				r->templateName.len = textLen;
+			}
+			break;
+	}
+}
+
+
+static void CloseTag(ScanState *st, const char *name, size_t len){
+	switch (name[0]){
+		case 'F':
+			if (VIEW_IS(name, len, "FactoryBase")){
+				st->inFactoryBase = 0;
+			}
+			else if (VIEW_IS(name, len, "FactoryInputs") || VIEW_IS(name, len, "FactoryOutputs")){
+				st->section = SECTION_None;
+				st->item = NULL;
+			}
+			break;
+		case 'I':
+			if (VIEW_IS(name, len, "Item")){
+				st->item = NULL;
+			}
+			break;
+		case 'P':
+			if (VIEW_IS(name, len, "PopulationInputs")){
+				st->section = SECTION_None;
+				st->item = NULL;
+			}
+			break;
+		case 'R':
+			if (VIEW_IS(name, len, "Residence7")){
+				st->inResidence = 0;
+			}
+			break;
+		case 'S':
+			if (VIEW_IS(name, len, "Standard")){
+				st->inStandard = 0;
+			}
+			break;
+	}
+}
+
+
+int AssetsScan(const char *text, size_t size, AssetRecordFn fn, void *user, AssetImportStats *stats){
+
+	/* The scan state holds one AssetRecord, which is the only per-asset memory the scan needs. It is
+	 * a few kilobytes, so it is allocated instead of put on the stack.
+	 */
+	ScanState *st = calloc(1, sizeof(*st));
+	if (!st){
+		return 0;
+	}
+
+	if (stats){
+		memset(stats, 0, sizeof(*stats));
+		stats->bytes = size;
+	}
+
+	const char *p = text;
+	const char *end = text + size;
+	int completed = 1;
+
+	while (p < end && (p = memchr(p, '<', (size_t)(end - p))) != NULL){
+
+		p++;
+		if (p >= end){
+			break;
+		}
+
+		//Comments can contain '<', so they are skipped as a whole. Declarations and <?xml ?> just to '>'.
+		if (*p == '!' || *p == '?'){
+			if (end - p >= 3 && p[0] == '!' && p[1] == '-' && p[2] == '-'){
+				const char *close = FindText(p + 3, end, "-->", 3);
+				p = close ? close + 3 : end;
+			}
+			else{
+				const char *close = memchr(p, '>', (size_t)(end - p));
+				p = close ? close + 1 : end;
+			}
+			continue;
+		}
+
+		int closing = 0;
+		if (*p == '/'){
+			closing = 1;
+			p++;
+		}
+
+		const char *name = p;
+		while (p < end && *p != '>' && *p != '/' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n'){
+			p++;
+		}
+		size_t nameLen = (size_t)(p - name);
+
+		const char *gt = memchr(p, '>', (size_t)(end - p));
+		if (!gt || nameLen == 0){
+			break;
+		}
+		int selfClosing = (gt[-1] == '/');
+		p = gt + 1;
+
+		if (closing){
+			if (VIEW_IS(name, nameLen, "Asset")){
+				if (st->inAsset && !EndAsset(st, fn, user, stats)){
+					completed = 0;
+					break;
+				}
+			}
+			else if (st->inAsset){
+				CloseTag(st, name, nameLen);
+			}
+			continue;
+		}
+
+		if (VIEW_IS(name, nameLen, "Asset")){
+			BeginAsset(st);
+			if (stats){
+				stats->assets++;
+			}
+			continue;
+		}
+
+		if (!st->inAsset || selfClosing){
+			continue;
+		}
+
+		//The character data of a leaf element runs up to the next '<', which is where the scan continues.
+		const char *textEnd = memchr(p, '<', (size_t)(end - p));
+		if (!textEnd){
+			textEnd = end;
+		}
+		OpenTag(st, name, nameLen, p, (size_t)(textEnd - p));
+		p = textEnd;
+	}
+
+	free(st);
+	return completed;
+}
+
+
+int AssetsImportFile(const char *path, AssetRecordFn fn, void *user, AssetImportStats *stats){
+
+	MappedFile mf;
+	if (!MappedFileOpen(&mf, path, 1)){
+		return 0;
+	}
+
+	int ok = AssetsScan((const char *)mf.data, mf.size, fn, user, stats);
+
+	MappedFileClose(&mf);
+	return ok;
+}
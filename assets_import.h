@@ -0,0 +1,116 @@
+#ifndef ASSETS_IMPORT_H
+#define ASSETS_IMPORT_H
+
+#include <stddef.h>
+
+/* Streaming importer for the game's assets.xml.
+ *
+ * The file is memory mapped (mapped_file.c) and scanned once from front to back. Only the parts needed by
+ * the calculator are looked at: products, residences, population levels (needs) and production buildings
+ * with their inputs, outputs and cycle times. Each <Asset> is handed to a callback as soon as its closing
+ * tag is reached and is then forgotten, so memory use does not grow with the file. Text fields are views
+ * into the mapped file, nothing is copied.
+ *
+ * Values that an asset inherits from its template (and does not repeat itself) are reported as 0.
+ */
+
+
+//Most inputs (factory inputs or population needs) and outputs kept per asset. Extra items set truncated.
+#define ASSET_MAX_INPUTS 48
+#define ASSET_MAX_OUTPUTS 4
+
+
+typedef enum AssetKind {
+	ASSET_Product,
+	ASSET_Residence,
+	ASSET_PopulationLevel,
+	ASSET_Production,
+	ASSET_KIND_COUNT
+} AssetKind;
+
+
+/* A piece of text inside the mapped file. Not null terminated.
+ */
+typedef struct AssetView {
+	const char *ptr;
+	size_t len;
+} AssetView;
+
+
+/* One <Item> of a FactoryInputs/FactoryOutputs/PopulationInputs list.
+ *
+ * product : GUID of the product
+ * amount : the <Amount> value as written in the file (0 if missing)
+ */
+typedef struct AssetItem {
+	long product;
+	double amount;
+} AssetItem;
+
+
+/* One asset as handed to the callback. Only valid during the callback.
+ *
+ * kind : what the asset is
+ * templateName / name : <Template> and the <Name> from <Standard>
+ * guid : <GUID> from <Standard>
+ * cycleTime : production cycle in seconds (production buildings)
+ * populationLevel / residentMax : the population level GUID and resident limit (residences)
+ * inputs : factory inputs (production) or needs (population levels)
+ * outputs : factory outputs (production)
+ * truncated : non zero if more than ASSET_MAX_INPUTS/OUTPUTS items were found
+ */
+typedef struct AssetRecord {
+	AssetKind kind;
+	AssetView templateName;
+	AssetView name;
+	long guid;
+
+	double cycleTime;
+	long populationLevel;
+	int residentMax;
+
+	AssetItem inputs[ASSET_MAX_INPUTS];
+	int inputCount;
+	AssetItem outputs[ASSET_MAX_OUTPUTS];
+	int outputCount;
+	int truncated;
+} AssetRecord;
+
+
+/* Return 0 from the callback to stop the scan early.
+ */
+typedef int (*AssetRecordFn)(const AssetRecord *record, void *user);
+
+
+/* Totals of a scan.
+ *
+ * bytes : size of the scanned text
+ * assets : number of <Asset> elements seen
+ * records : number of records passed to the callback, by kind
+ * truncatedRecords : records that had more items than fit
+ */
+typedef struct AssetImportStats {
+	size_t bytes;
+	long assets;
+	long records[ASSET_KIND_COUNT];
+	long truncatedRecords;
+} AssetImportStats;
+
+
+/* Scans text that is already in memory. Returns 1 if the whole text was scanned, 0 if the callback stopped
+ * it. stats may be NULL.
+ */
+int AssetsScan(const char *text, size_t size, AssetRecordFn fn, void *user, AssetImportStats *stats);
+
+
+/* Maps the file at path and scans it. Returns 1 on success, 0 if the file could not be mapped or the
+ * callback stopped the scan.
+ */
+int AssetsImportFile(const char *path, AssetRecordFn fn, void *user, AssetImportStats *stats);
+
+
+/* Returns the readable name of a kind ("Product", "Residence", ...).
+ */
+const char *AssetKindName(AssetKind kind);
+
+#endif
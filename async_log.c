@@ -0,0 +1,446 @@
+#include <stdlib.h>	//malloc, free
+#include <string.h>	//memset, memcpy, strlen
+
+#include "async_log.h"
+
+
+/* A line in the ring: this header, then either the characters and a terminating 0 (format LOG_FORMAT_TEXT,
+ * count characters) or count 64 bit arguments of format, padded so the next header is aligned. A header
+ * with format ASYNC_LOG_PAD only fills up the end of the ring; the line that did not fit there starts again
+ * at offset 0.
+ */
+typedef struct LogRecord {
+	uint32_t bytes;
+	uint16_t format;
+	uint16_t count;
+	uint64_t timeNs;
+} LogRecord;
+
+#define ASYNC_LOG_PAD 0xFFFDu
+#define ASYNC_LOG_ALIGN sizeof(LogRecord)
+
+//Rotated file names are "<path>.<n>".
+#define ASYNC_LOG_PATH_MAX 512
+
+//Schema of a binary log that only holds text lines.
+static const LogSchema g_emptySchema = {NULL, 0, NULL, 0};
+
+
+static size_t RecordBytes(size_t payload){
+	size_t bytes = sizeof(LogRecord) + payload;
+	return (bytes + ASYNC_LOG_ALIGN - 1) & ~(ASYNC_LOG_ALIGN - 1);
+}
+
+
+void AsyncLogDefaultConfig(AsyncLogConfig *config, const char *path){
+	memset(config, 0, sizeof(*config));
+	config->path = path;
+	config->ringBytes = 1024 * 1024;
+	config->maxFileBytes = 4 * 1024 * 1024;
+	config->keepFiles = 3;
+}
+
+
+/* Encodes text as UTF-8 into out, which has room for 4 bytes per character. wchar_t is UTF-16 on Windows,
+ * so surrogate pairs are joined; an unpaired surrogate becomes U+FFFD.
+ */
+static size_t EncodeUtf8(const wchar_t *text, size_t chars, char *out){
+	size_t n = 0;
+	for (size_t i = 0; i < chars; i++){
+		uint32_t c = (uint32_t)text[i];
+		if (c >= 0xD800 && c <= 0xDBFF && i + 1 < chars && (uint32_t)text[i + 1] >= 0xDC00 && (uint32_t)text[i + 1] <= 0xDFFF){
+			c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)text[i + 1] - 0xDC00);
+			i++;
+		}
+		else if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF){
+			c = 0xFFFD;
+		}
+
+		if (c < 0x80){
+			out[n++] = (char)c;
+		}
+		else if (c < 0x800){
+			out[n++] = (char)(0xC0 | c >> 6);
+			out[n++] = (char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000){
+			out[n++] = (char)(0xE0 | c >> 12);
+			out[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+			out[n++] = (char)(0x80 | (c & 0x3F));
+		}
+		else{
+			out[n++] = (char)(0xF0 | c >> 18);
+			out[n++] = (char)(0x80 | ((c >> 12) & 0x3F));
+			out[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+			out[n++] = (char)(0x80 | (c & 0x3F));
+		}
+	}
+	return n;
+}
+
+
+/* Decodes UTF-8 (as made by EncodeUtf8 or LogFormatRender) into out, which has room for bytes + 1
+ * characters, and terminates it. Characters above U+FFFF become surrogate pairs where wchar_t is 16 bits.
+ */
+static size_t DecodeUtf8(const char *text, size_t bytes, wchar_t *out){
+	size_t n = 0;
+	for (size_t i = 0; i < bytes; ){
+		uint32_t c = (unsigned char)text[i];
+		int more = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+		c &= more == 3 ? 0x07 : more == 2 ? 0x0F : more == 1 ? 0x1F : 0x7F;
+		i++;
+		for (; more > 0 && i < bytes; more--, i++){
+			c = c << 6 | ((unsigned char)text[i] & 0x3F);
+		}
+		if (sizeof(wchar_t) == 2 && c >= 0x10000){
+			out[n++] = (wchar_t)(0xD800 + ((c - 0x10000) >> 10));
+			out[n++] = (wchar_t)(0xDC00 + ((c - 0x10000) & 0x3FF));
+		}
+		else{
+			out[n++] = (wchar_t)c;
+		}
+	}
+	out[n] = 0;
+	return n;
+}
+
+
+//Starts a binary file with the schema its records refer to.
+static void WriteHeader(AsyncLog *log){
+	size_t bytes = LogWriteHeader(log->file, log->config.schema, log->startNs);
+	log->fileSize += bytes;
+	atomic_fetch_add_explicit(&log->fileBytes, bytes, memory_order_relaxed);
+}
+
+
+//Moves <path> to <path>.1, <path>.1 to <path>.2 and so on, dropping the oldest, and starts a new file.
+static void Rotate(AsyncLog *log){
+
+	char from[ASYNC_LOG_PATH_MAX];
+	char to[ASYNC_LOG_PATH_MAX];
+	const char *path = log->config.path;
+
+	fclose(log->file);
+	log->file = NULL;
+
+	if (log->config.keepFiles <= 0){
+		remove(path);
+	}
+	else{
+		snprintf(to, sizeof(to), "%s.%d", path, log->config.keepFiles);
+		remove(to);
+		for (int i = log->config.keepFiles - 1; i >= 1; i--){
+			snprintf(from, sizeof(from), "%s.%d", path, i);
+			snprintf(to, sizeof(to), "%s.%d", path, i + 1);
+			rename(from, to);
+		}
+		snprintf(to, sizeof(to), "%s.1", path);
+		rename(path, to);
+	}
+
+	log->file = fopen(path, "ab");
+	log->fileSize = 0;
+	if (log->file && log->config.binary){
+		WriteHeader(log);
+	}
+	atomic_fetch_add_explicit(&log->rotations, 1, memory_order_relaxed);
+}
+
+
+/* Writes one line: a text line (text / chars) or a record of the schema (format / args). In a text file
+ * the line is rendered here; in a binary file it is stored as it is and only rendered for the echo.
+ */
+static void WriteLine(AsyncLog *log, uint64_t timeNs, int format, const uint64_t *args, int argCount, const wchar_t *text, size_t chars){
+
+	if (log->config.maxFileBytes > 0 && log->fileSize >= log->config.maxFileBytes){
+		Rotate(log);
+	}
+
+	const LogSchema *schema = log->config.schema;
+	size_t n = 0;
+
+	if (log->config.binary){
+		if (format == LOG_FORMAT_TEXT){
+			size_t bytes = EncodeUtf8(text, chars, log->text);
+			n = log->file ? LogWriteRecord(log->file, format, timeNs, NULL, 0, log->text, bytes) : 0;
+		}
+		else{
+			n = log->file ? LogWriteRecord(log->file, format, timeNs, args, argCount, NULL, 0) : 0;
+		}
+	}
+	else{
+		uint64_t sinceStart = timeNs > log->startNs ? timeNs - log->startNs : 0;
+		int prefix = snprintf(log->text, 32, "[%10.6f] ", (double)sinceStart / 1e9);
+		if (format == LOG_FORMAT_TEXT){
+			n = (size_t)prefix + EncodeUtf8(text, chars, log->text + prefix);
+		}
+		else{
+			n = (size_t)prefix + LogRenderRecord(schema, format, args, argCount, NULL, 0, log->text + prefix, ASYNC_LOG_MAX_CHARS * 4);
+		}
+		log->text[n++] = '\n';
+		if (!log->file || fwrite(log->text, 1, n, log->file) != n){
+			n = 0;
+		}
+	}
+	log->fileSize += n;
+	atomic_fetch_add_explicit(&log->fileBytes, n, memory_order_relaxed);
+
+	if (log->config.echo){
+		if (format != LOG_FORMAT_TEXT){
+			size_t bytes = LogRenderRecord(schema, format, args, argCount, NULL, 0, log->text, ASYNC_LOG_MAX_CHARS * 4);
+			DecodeUtf8(log->text, bytes, log->wide);
+			text = log->wide;
+		}
+		log->config.echo(log->config.echoUser, text);
+	}
+}
+
+
+//Notes lines lost since the last note, in the file itself so a reader sees where the gap is.
+static void ReportDrops(AsyncLog *log){
+	uint64_t dropped = atomic_load_explicit(&log->dropped, memory_order_relaxed);
+	if (dropped != log->reportedDrops){
+		uint64_t lost = dropped - log->reportedDrops;
+		log->reportedDrops = dropped;
+		WriteLine(log, SysNowNs(), LOG_FORMAT_DROPPED, &lost, 1, NULL, 0);
+	}
+}
+
+
+//Writes every line in the ring. Returns the number of lines written.
+static long Drain(AsyncLog *log){
+
+	uint64_t tail = atomic_load_explicit(&log->tail, memory_order_relaxed);
+	uint64_t head = atomic_load_explicit(&log->head, memory_order_acquire);
+	long lines = 0;
+
+	while (tail != head){
+		const LogRecord *record = (const LogRecord *)(log->ring + (tail & log->mask));
+		if (record->format == LOG_FORMAT_TEXT){
+			WriteLine(log, record->timeNs, LOG_FORMAT_TEXT, NULL, 0, (const wchar_t *)(record + 1), record->count);
+			atomic_fetch_add_explicit(&log->written, 1, memory_order_relaxed);
+			lines++;
+		}
+		else if (record->format != ASYNC_LOG_PAD){
+			WriteLine(log, record->timeNs, record->format, (const uint64_t *)(record + 1), record->count, NULL, 0);
+			atomic_fetch_add_explicit(&log->written, 1, memory_order_relaxed);
+			lines++;
+		}
+		tail += record->bytes;
+		//Hand the space back at once, so a burst that outruns the file does not have to wait for the batch.
+		atomic_store_explicit(&log->tail, tail, memory_order_release);
+		if (tail == head){
+			head = atomic_load_explicit(&log->head, memory_order_acquire);
+		}
+	}
+	ReportDrops(log);
+	return lines;
+}
+
+
+static void WriterMain(void *arg){
+
+	AsyncLog *log = arg;
+
+	for (;;){
+		if (Drain(log) > 0 && log->file){
+			fflush(log->file);
+		}
+
+		SysMutexLock(&log->mutex);
+		atomic_store_explicit(&log->sleeping, 1, memory_order_seq_cst);
+		//Lines queued after Drain but before sleeping was set did not wake anybody, so look once more.
+		while (!log->quit && atomic_load_explicit(&log->head, memory_order_seq_cst) == atomic_load_explicit(&log->tail, memory_order_relaxed)){
+			SysCondWait(&log->wake, &log->mutex);
+		}
+		atomic_store_explicit(&log->sleeping, 0, memory_order_relaxed);
+		int quit = log->quit;
+		SysMutexUnlock(&log->mutex);
+
+		if (quit){
+			Drain(log);
+			return;
+		}
+	}
+}
+
+
+int AsyncLogOpen(AsyncLog *log, const AsyncLogConfig *config){
+
+	memset(log, 0, sizeof(*log));
+
+	size_t size = 64 * 1024;
+	while (size < config->ringBytes){
+		size *= 2;
+	}
+
+	log->ring = malloc(size);
+	log->text = malloc(32 + ASYNC_LOG_MAX_CHARS * 4 + 2);
+	log->wide = malloc((ASYNC_LOG_MAX_CHARS * 4 + 1) * sizeof(wchar_t));
+	log->file = fopen(config->path, "ab");
+	if (!log->ring || !log->text || !log->wide || !log->file){
+		if (log->file){
+			fclose(log->file);
+		}
+		free(log->ring);
+		free(log->text);
+		free(log->wide);
+		memset(log, 0, sizeof(*log));
+		return 0;
+	}
+
+	log->config = *config;
+	if (!log->config.schema && log->config.binary){
+		log->config.schema = &g_emptySchema;
+	}
+	log->mask = size - 1;
+	fseek(log->file, 0, SEEK_END);
+	long existing = ftell(log->file);
+	log->fileSize = existing > 0 ? (uint64_t)existing : 0;
+	log->startNs = SysNowNs();
+	if (log->config.binary){
+		WriteHeader(log);
+	}
+
+	SysMutexInit(&log->mutex);
+	SysCondInit(&log->wake);
+	if (!SysThreadStart(&log->thread, WriterMain, log)){
+		SysCondDestroy(&log->wake);
+		SysMutexDestroy(&log->mutex);
+		fclose(log->file);
+		free(log->ring);
+		free(log->text);
+		free(log->wide);
+		memset(log, 0, sizeof(*log));
+		return 0;
+	}
+	return 1;
+}
+
+
+/* Makes room for a record of payload bytes at the head and fills in its header. Returns NULL (and counts
+ * the line as dropped) if the ring is full. The record is queued by Publish.
+ */
+static LogRecord *Reserve(AsyncLog *log, size_t payload, int format, int count, uint64_t *newHead){
+
+	size_t size = log->mask + 1;
+	size_t need = RecordBytes(payload);
+	uint64_t head = atomic_load_explicit(&log->head, memory_order_relaxed);
+	uint64_t tail = atomic_load_explicit(&log->tail, memory_order_acquire);
+	size_t offset = (size_t)(head & log->mask);
+	size_t toEnd = size - offset;
+	size_t total = need + (toEnd < need ? toEnd : 0);
+
+	if (total > size - (size_t)(head - tail)){
+		atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+		return NULL;
+	}
+
+	if (toEnd < need){
+		LogRecord *pad = (LogRecord *)(log->ring + offset);
+		pad->bytes = (uint32_t)toEnd;
+		pad->format = ASYNC_LOG_PAD;
+		head += toEnd;
+		offset = 0;
+	}
+
+	LogRecord *record = (LogRecord *)(log->ring + offset);
+	record->bytes = (uint32_t)need;
+	record->format = (uint16_t)format;
+	record->count = (uint16_t)count;
+	record->timeNs = SysNowNs();
+	*newHead = head + need;
+	return record;
+}
+
+
+static void Publish(AsyncLog *log, uint64_t newHead){
+
+	atomic_store_explicit(&log->head, newHead, memory_order_seq_cst);
+
+	//Only a writer that went to sleep needs the mutex and a signal; while it is draining it sees the new head.
+	if (atomic_load_explicit(&log->sleeping, memory_order_seq_cst)){
+		SysMutexLock(&log->mutex);
+		SysCondSignal(&log->wake);
+		SysMutexUnlock(&log->mutex);
+	}
+}
+
+
+int AsyncLogWrite(AsyncLog *log, const wchar_t *text, size_t chars){
+
+	if (!log->ring){
+		return 0;
+	}
+	if (chars > ASYNC_LOG_MAX_CHARS){
+		chars = ASYNC_LOG_MAX_CHARS;
+	}
+
+	uint64_t newHead;
+	LogRecord *record = Reserve(log, (chars + 1) * sizeof(wchar_t), LOG_FORMAT_TEXT, (int)chars, &newHead);
+	if (!record){
+		return 0;
+	}
+	wchar_t *dest = (wchar_t *)(record + 1);
+	memcpy(dest, text, chars * sizeof(wchar_t));
+	dest[chars] = 0;
+
+	Publish(log, newHead);
+	return 1;
+}
+
+
+int AsyncLogWriteArgs(AsyncLog *log, int format, const uint64_t *args, int argCount){
+
+	if (!log->ring || !log->config.schema || format < 0 || format >= log->config.schema->formatCount){
+		return 0;
+	}
+	if (argCount > LOG_MAX_ARGS){
+		argCount = LOG_MAX_ARGS;
+	}
+
+	uint64_t newHead;
+	LogRecord *record = Reserve(log, (size_t)argCount * sizeof(uint64_t), format, argCount, &newHead);
+	if (!record){
+		return 0;
+	}
+	memcpy(record + 1, args, (size_t)argCount * sizeof(uint64_t));
+
+	Publish(log, newHead);
+	return 1;
+}
+
+
+void AsyncLogClose(AsyncLog *log){
+
+	if (!log->ring){
+		return;
+	}
+
+	SysMutexLock(&log->mutex);
+	log->quit = 1;
+	SysCondSignal(&log->wake);
+	SysMutexUnlock(&log->mutex);
+	SysThreadJoin(&log->thread);
+
+	if (log->file){
+		fclose(log->file);
+	}
+	SysCondDestroy(&log->wake);
+	SysMutexDestroy(&log->mutex);
+	free(log->ring);
+	free(log->text);
+	free(log->wide);
+	log->ring = NULL;
+	log->text = NULL;
+	log->wide = NULL;
+	log->file = NULL;
+}
+
+
+void AsyncLogGetStats(AsyncLog *log, AsyncLogStats *stats){
+	stats->written = atomic_load_explicit(&log->written, memory_order_relaxed);
+	stats->dropped = atomic_load_explicit(&log->dropped, memory_order_relaxed);
+	stats->fileBytes = atomic_load_explicit(&log->fileBytes, memory_order_relaxed);
+	stats->rotations = atomic_load_explicit(&log->rotations, memory_order_relaxed);
+}
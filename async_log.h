@@ -0,0 +1,141 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <wchar.h>
+
+#include "log_format.h"
+#include "sys_thread.h"
+
+/* Log lines written to a file by a background thread, so the thread that logs (the UI thread) never waits
+ * for a file, the debugger or the console.
+ *
+ * Lines go into a ring buffer with exactly one writing thread and one reading thread. The logging thread
+ * copies the line and a time stamp into the ring and moves the head; the writer thread reads from the tail,
+ * turns the lines into UTF-8 and appends them to the log file. Neither side takes a lock while lines are
+ * flowing. The logging thread only takes the mutex to wake the writer when the writer has gone to sleep on
+ * an empty ring.
+ *
+ * AsyncLogWriteArgs queues a format id and its arguments instead of a finished line (see log_format.h), so
+ * the logging thread does not format at all: the writer renders the line, or with config.binary stores the
+ * record as it is in a binary log file for log_decode.
+ *
+ * If the ring is full the line is dropped and counted instead of waiting; the writer notes in the file how
+ * many lines were lost. When the file passes maxFileBytes it is renamed to "<path>.1" (older files move up
+ * to "<path>.<keepFiles>", the oldest is deleted) and a new file is started.
+ */
+
+
+//Longest line kept, longer lines are cut off (the size of the Logfw buffer in main.c).
+#define ASYNC_LOG_MAX_CHARS 1024
+
+
+/* Called on the writer thread with every line after it was written to the file, e.g. to also show it in
+ * the debugger. line is null terminated and has no line break.
+ */
+typedef void (*AsyncLogEchoFn)(void *user, const wchar_t *line);
+
+
+/* path : the log file, appended to
+ * ringBytes : size of the ring, rounded up to a power of two of at least 64 KB
+ * maxFileBytes : size at which the file is rotated (0: never)
+ * keepFiles : rotated files kept next to the current one
+ * echo / echoUser : optional, see AsyncLogEchoFn
+ * schema : formats and names of AsyncLogWriteArgs, must outlive the log (NULL: only text lines)
+ * binary : write a binary log file (every file starts with the schema) instead of text
+ */
+typedef struct AsyncLogConfig {
+	const char *path;
+	size_t ringBytes;
+	uint64_t maxFileBytes;
+	int keepFiles;
+	AsyncLogEchoFn echo;
+	void *echoUser;
+	const LogSchema *schema;
+	int binary;
+} AsyncLogConfig;
+
+
+/* Counters, safe to read while the log is running.
+ *
+ * written : queued lines written to the file (the notes about dropped lines not counted)
+ * dropped : lines lost because the ring was full (or too long for it)
+ * fileBytes : bytes written over all files
+ * rotations : files started after the first one
+ */
+typedef struct AsyncLogStats {
+	uint64_t written;
+	uint64_t dropped;
+	uint64_t fileBytes;
+	uint64_t rotations;
+} AsyncLogStats;
+
+
+/* ring / mask : the ring buffer and its size - 1
+ * head : bytes ever written into the ring, only changed by the logging thread
+ * tail : bytes ever read from the ring, only changed by the writer thread
+ * sleeping : the writer is waiting for lines (under mutex)
+ * file / fileSize / startNs : the current file, its size and the time stamp lines are relative to
+ * text / wide : UTF-8 and wide line buffers of the writer thread
+ */
+typedef struct AsyncLog {
+	AsyncLogConfig config;
+	unsigned char *ring;
+	size_t mask;
+	_Atomic uint64_t head;
+	_Atomic uint64_t tail;
+	_Atomic int sleeping;
+	int quit;
+
+	SysThread thread;
+	SysMutex mutex;
+	SysCond wake;
+
+	FILE *file;
+	uint64_t fileSize;
+	uint64_t startNs;
+	char *text;
+	wchar_t *wide;
+	uint64_t reportedDrops;
+
+	_Atomic uint64_t written;
+	_Atomic uint64_t dropped;
+	_Atomic uint64_t fileBytes;
+	_Atomic uint64_t rotations;
+} AsyncLog;
+
+
+/* Fills config with the defaults for path: 1 MB ring, 4 MB files, 3 old files kept, no echo, text file.
+ */
+void AsyncLogDefaultConfig(AsyncLogConfig *config, const char *path);
+
+
+/* Opens the log file and starts the writer thread. Returns 0 if the file cannot be opened, memory ran out
+ * or the thread cannot be started; the log then stays closed and AsyncLogWrite drops everything.
+ */
+int AsyncLogOpen(AsyncLog *log, const AsyncLogConfig *config);
+
+
+/* Queues one line (chars characters of text, no line break) without waiting. Only one thread may call this.
+ * Returns 0 if the line was dropped.
+ */
+int AsyncLogWrite(AsyncLog *log, const wchar_t *text, size_t chars);
+
+
+/* Queues format (an id of config.schema) with argCount arguments (at most LOG_MAX_ARGS) without waiting or
+ * formatting. Same thread as AsyncLogWrite. Returns 0 if the line was dropped.
+ */
+int AsyncLogWriteArgs(AsyncLog *log, int format, const uint64_t *args, int argCount);
+
+
+/* Writes what is still queued, stops the writer thread and closes the file.
+ */
+void AsyncLogClose(AsyncLog *log);
+
+
+void AsyncLogGetStats(AsyncLog *log, AsyncLogStats *stats);
+
+#endif
@@ -0,0 +1,96 @@
+#include <string.h>	//memset
+
+#include "calc.h"
+
+
+#define X_GOOD_INFO(good, name, buildingName, consumption, production) [good] = { name, buildingName, consumption, production },
+static const GoodInfo g_goodInfo[GOOD_COUNT] = {
+	GOOD_TABLE(X_GOOD_INFO)
+};
+#undef X_GOOD_INFO
+
+
+const GoodInfo *CalcGoodInfo(Good good){
+	if ((int)good < 0 || good >= GOOD_COUNT){
+		return NULL;
+	}
+	return &g_goodInfo[good];
+}
+
+
+int CalcHousesPerBlock(const HousingBlock *block){
+	if (block->width < 0 || block->length < 0){
+		return 0;
+	}
+	return block->width * block->length;
+}
+
+
+/* Turns a resident count into the per-good totals. Both CalcDemand and CalcDemandUniform end up here so
+ * that the rounding behaviour is identical no matter how the residents were counted.
+ */
+static void FillDemand(long residents, Demand *out){
+	out->residents = residents;
+	for (int g = 0; g < GOOD_COUNT; g++){
+		out->tonsPerMinute[g] = (double)residents * g_goodInfo[g].consumptionPerResident;
+		out->buildings[g] = out->tonsPerMinute[g] / g_goodInfo[g].productionPerBuilding;
+	}
+}
+
+
+int CalcDemand(const HousingBlock *blocks, int blockCount, Demand *out){
+
+	memset(out, 0, sizeof(*out));
+
+	long houses = 0;
+	for (int i = 0; i < blockCount; i++){
+		if (blocks[i].width < 0 || blocks[i].length < 0){
+			return 0;
+		}
+		houses += (long)blocks[i].width * blocks[i].length;
+	}
+
+	FillDemand(houses * CALC_RESIDENTS_PER_HOUSE, out);
+	return 1;
+}
+
+
+int CalcDemandUniform(const HousingBlock *block, int blockCount, Demand *out){
+
+	memset(out, 0, sizeof(*out));
+
+	if (blockCount < 0 || block->width < 0 || block->length < 0){
+		return 0;
+	}
+
+	long houses = (long)block->width * block->length * blockCount;
+	FillDemand(houses * CALC_RESIDENTS_PER_HOUSE, out);
+	return 1;
+}
+
+
+int CalcDemandResidents(long residents, Demand *out){
+
+	memset(out, 0, sizeof(*out));
+
+	if (residents < 0){
+		return 0;
+	}
+
+	FillDemand(residents, out);
+	return 1;
+}
+
+
+int CalcBlockDemand(const HousingBlock *block, double tonsPerMinute[GOOD_COUNT]){
+
+	if (block->width < 0 || block->length < 0){
+		return 0;
+	}
+
+	long residents = (long)block->width * block->length * CALC_RESIDENTS_PER_HOUSE;
+	for (int g = 0; g < GOOD_COUNT; g++){
+		tonsPerMinute[g] = (double)residents * g_goodInfo[g].consumptionPerResident;
+	}
+	return 1;
+}
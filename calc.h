@@ -0,0 +1,118 @@
+#ifndef CALC_H
+#define CALC_H
+
+/* Platform-free consumption math for the overlay. Nothing in here touches Win32 so that the same code can be
+ * driven by MainWndProc on Windows and by the anno_calc command line tool on Linux.
+ */
+
+
+//Number of residents living in a fully upgraded farmer residence.
+#define CALC_RESIDENTS_PER_HOUSE 10
+
+
+/* The goods that the "Resource Requirements" frame shows (one ID_DSP_* display per good). The Good enum
+ * and the GoodInfo table in calc.c are both generated from this list.
+ *
+ * X(good, name, buildingName, consumptionPerResident, productionPerBuilding)
+ *
+ * Consumption values are for farmers, production values are for a single building without items or
+ * electricity. A building with a 30 second cycle makes 2 tons per minute.
+ * 	Fishery : supplies 800 farmers
+ * 	Framework Knitters : supplies 650 farmers
+ * 	Schnapps Distillery : supplies 600 farmers
+ */
+#define GOOD_TABLE(X) \
+	X(GOOD_Fish,		"Fish",		"Fishery",		2.0 / 800.0,	2.0) \
+	X(GOOD_WorkClothes,	"Work Clothes",	"Framework Knitters",	2.0 / 650.0,	2.0) \
+	X(GOOD_Schnapps,	"Schnapps",	"Schnapps Distillery",	2.0 / 600.0,	2.0)
+
+
+/* GOOD_COUNT is not a good, it is the number of entries and is used to size arrays.
+ */
+#define X_GOOD_ENUM(good, name, buildingName, consumption, production) good,
+typedef enum Good {
+	GOOD_TABLE(X_GOOD_ENUM)
+	GOOD_COUNT
+} Good;
+#undef X_GOOD_ENUM
+
+
+/* Static information about a good.
+ *
+ * name : readable name of the good
+ * buildingName : name of the building that produces the good
+ * consumptionPerResident : tons per minute a single resident consumes
+ * productionPerBuilding : tons per minute a single production building makes at 100% productivity
+ */
+typedef struct GoodInfo {
+	const char *name;
+	const char *buildingName;
+	double consumptionPerResident;
+	double productionPerBuilding;
+} GoodInfo;
+
+
+/* A rectangular block of residences, as set with the ID_SPN_HousingWidth and ID_SPN_HousingLength spinners.
+ *
+ * width : number of houses across the block
+ * length : number of houses along the block
+ */
+typedef struct HousingBlock {
+	int width;
+	int length;
+} HousingBlock;
+
+
+/* The result of a demand calculation, indexed by Good.
+ *
+ * residents : total number of residents in all blocks
+ * tonsPerMinute : how much of each good the residents consume
+ * buildings : how many production buildings are needed to cover the consumption (fractional)
+ */
+typedef struct Demand {
+	long residents;
+	double tonsPerMinute[GOOD_COUNT];
+	double buildings[GOOD_COUNT];
+} Demand;
+
+
+/* Returns the static information for a good, or NULL if the good is out of range.
+ */
+const GoodInfo *CalcGoodInfo(Good good);
+
+
+/* Returns the number of houses in a single block, or 0 if the block has a negative size.
+ */
+int CalcHousesPerBlock(const HousingBlock *block);
+
+
+/* Calculates the demand of every good for a list of blocks. Returns 1 on success and 0 if a block has
+ * a negative size (out is zeroed in that case).
+ *
+ * const HousingBlock *blocks : the blocks to add up (may be NULL when blockCount is 0)
+ * int blockCount : number of entries in blocks
+ * Demand *out : receives the totals
+ */
+int CalcDemand(const HousingBlock *blocks, int blockCount, Demand *out);
+
+
+/* Convenience wrapper for the common case of blockCount identical blocks.
+ */
+int CalcDemandUniform(const HousingBlock *block, int blockCount, Demand *out);
+
+
+/* Calculates the demand of a resident count that is already known, e.g. read from a savegame.
+ * Returns 0 if residents is negative (out is zeroed in that case).
+ */
+int CalcDemandResidents(long residents, Demand *out);
+
+
+/* Calculates the tons per minute of every good that a single block consumes. This is the per-block vector
+ * that the incremental totals in demand_agg.c add and subtract. Returns 0 if the block has a negative size.
+ *
+ * const HousingBlock *block : the block
+ * double tonsPerMinute[GOOD_COUNT] : receives the consumption, indexed by Good
+ */
+int CalcBlockDemand(const HousingBlock *block, double tonsPerMinute[GOOD_COUNT]);
+
+#endif
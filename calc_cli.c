@@ -0,0 +1,4252 @@
+/* anno_calc : command line front end for the calculation code so it can be run, checked and timed on
+ * Linux without a Windows message pump.
+ *
+ * Usage:
+ * 	anno_calc demand <width> <length> <blocks>
+ * 	anno_calc bench <width> <length> <blocks> <iterations>
+ * 	anno_calc bench-clicks <width> <length> <blocks> <clicks> [verify]
+ * 	anno_calc verify-agg <operations>
+ * 	anno_calc chain <tier>=<residents> ...
+ * 	anno_calc bench-chain <residents per tier> <iterations>
+ * 	anno_calc controls
+ * 	anno_calc import <assets.xml> [dump]
+ * 	anno_calc gen-assets <out.xml> <megabytes>
+ * 	anno_calc cache <assets.xml> <cache file>
+ * 	anno_calc bench-startup <assets.xml> <cache file>
+ * 	anno_calc save <file.a7s> [threads]
+ * 	anno_calc gen-save <out.a7s> <islands> <houses per island> [single]
+ * 	anno_calc bench-save <file.a7s> <runs>
+ * 	anno_calc save-extract <file.a7s> <out.filedb>
+ * 	anno_calc filedb <data.filedb> <island>
+ * 	anno_calc empire <islands> [threads]
+ * 	anno_calc bench-empire <islands> <iterations>
+ * 	anno_calc modifiers [<tier>=<residents> ...] [buff=<name> ...]
+ * 	anno_calc bench-modifiers <islands> <iterations>
+ * 	anno_calc optimize <tier>=<residents> | blocks=<width>x<length>x<count> | <building>=<most> ...
+ * 	anno_calc bench-optimize <residents per tier> <iterations> [<building>=<most> ...]
+ * 	anno_calc bench-log <lines> <log file> [ring KB] [max file KB]
+ * 	anno_calc bench-blog <lines> <log file>
+ * 	anno_calc gen-session <out.amsg> <commands> [seed]
+ * 	anno_calc replay <session.amsg> [iterations] [latency]
+ * 	anno_calc ui-flow <commands> [seed] [frame ms]
+ * 	anno_calc raster-check <golden.txt> [write] [image dir]
+ * 	anno_calc bench-raster <frames>
+ * 	anno_calc bench-text <frames>
+ * 	anno_calc hud-fixtures <dir>
+ * 	anno_calc hud-check [--digits <strip.png>] <frame.png> ...
+ * 	anno_calc bench-hud <reads>
+ * 	anno_calc bench-tiles <frames>
+ * 	anno_calc game-standin [seconds]
+ * 	anno_calc game-read <pid> [ticks]
+ * 	anno_calc bench-game <ticks>
+ * 	anno_calc bench-sampler <seconds> [budget %]
+ * 	anno_calc bench-loop <operations> [seconds]
+ * 	anno_calc formula <file> [residents]
+ * 	anno_calc bench-formula <formulas> <evaluations>
+ */
+#define _POSIX_C_SOURCE 199309L	//clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <wchar.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "calc.h"
+#include "controls.h"
+#include "demand_agg.h"
+#include "chain.h"
+#include "assets_import.h"
+#include "game_cache.h"
+#include "savegame.h"
+#include "empire.h"
+#include "modifier.h"
+#include "optimizer.h"
+#include "async_log.h"
+#include "log_format.h"
+#include "msg_record.h"
+#include "overlay.h"
+#include "overlay_ui.h"
+#include "ui_headless.h"
+#include "raster.h"
+#include "glyph_cache.h"
+#include "hud_read.h"
+#include "tile_hash.h"
+#include "game_memory.h"
+#include "game_standin.h"
+#include "sampler.h"
+#include "timer_wheel.h"
+#include "event_loop.h"
+#include "formula.h"
+#include "demand_formula.h"
+#include "png_file.h"
+#include "overlay_render.h"
+#include "latency.h"
+#include "sys_thread.h"
+
+
+//Monotonic time in nanoseconds, used for the benchmark timings.
+static double NowNs(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+static void PrintUsage(void){
+	fprintf(stderr,
+		"usage:\n"
+		"  anno_calc demand <width> <length> <blocks>\n"
+		"  anno_calc bench <width> <length> <blocks> <iterations>\n"
+		"  anno_calc bench-clicks <width> <length> <blocks> <clicks> [verify]\n"
+		"  anno_calc verify-agg <operations>\n"
+		"  anno_calc chain <tier>=<residents> ...\n"
+		"  anno_calc bench-chain <residents per tier> <iterations>\n"
+		"  anno_calc controls\n"
+		"  anno_calc import <assets.xml> [dump]\n"
+		"  anno_calc gen-assets <out.xml> <megabytes>\n"
+		"  anno_calc cache <assets.xml> <cache file>\n"
+		"  anno_calc bench-startup <assets.xml> <cache file>\n"
+		"  anno_calc save <file.a7s> [threads]\n"
+		"  anno_calc gen-save <out.a7s> <islands> <houses per island> [single]\n"
+		"  anno_calc bench-save <file.a7s> <runs>\n"
+		"  anno_calc save-extract <file.a7s> <out.filedb>\n"
+		"  anno_calc filedb <data.filedb> <island>\n"
+		"  anno_calc empire <islands> [threads]\n"
+		"  anno_calc bench-empire <islands> <iterations>\n"
+		"  anno_calc modifiers [<tier>=<residents> ...] [buff=<name> ...]\n"
+		"  anno_calc bench-modifiers <islands> <iterations>\n"
+		"  anno_calc optimize <tier>=<residents> | blocks=<width>x<length>x<count> | <building>=<most> ...\n"
+		"  anno_calc bench-optimize <residents per tier> <iterations> [<building>=<most> ...]\n"
+		"  anno_calc bench-log <lines> <log file> [ring KB] [max file KB]\n"
+		"  anno_calc bench-blog <lines> <log file>\n"
+		"  anno_calc gen-session <out.amsg> <commands> [seed]\n"
+		"  anno_calc replay <session.amsg> [iterations] [latency]\n"
+		"  anno_calc ui-flow <commands> [seed] [frame ms]\n"
+		"  anno_calc raster-check <golden.txt> [write] [image dir]\n"
+		"  anno_calc bench-raster <frames>\n"
+		"  anno_calc bench-text <frames>\n"
+		"  anno_calc hud-fixtures <dir>\n"
+		"  anno_calc hud-check [--digits <strip.png>] <frame.png> ...\n"
+		"  anno_calc bench-hud <reads>\n"
+		"  anno_calc bench-tiles <frames>\n"
+		"  anno_calc game-standin [seconds]\n"
+		"  anno_calc game-read <pid> [ticks]\n"
+		"  anno_calc bench-game <ticks>\n"
+		"  anno_calc bench-sampler <seconds> [budget %%]\n"
+		"  anno_calc bench-loop <operations> [seconds]\n"
+		"  anno_calc formula <file> [residents]\n"
+		"  anno_calc bench-formula <formulas> <evaluations>\n");
+}
+
+
+static void PrintDemand(const Demand *d){
+	printf("residents %ld\n", d->residents);
+	for (int g = 0; g < GOOD_COUNT; g++){
+		const GoodInfo *info = CalcGoodInfo((Good)g);
+		printf("%-14s %8.3f t/min %8.3f x %s\n", info->name, d->tonsPerMinute[g], d->buildings[g], info->buildingName);
+	}
+}
+
+
+static int CmdDemand(int argc, char **argv){
+	if (argc != 5){
+		PrintUsage();
+		return 2;
+	}
+
+	HousingBlock block = { atoi(argv[2]), atoi(argv[3]) };
+	int blocks = atoi(argv[4]);
+	Demand d;
+
+	if (!CalcDemandUniform(&block, blocks, &d)){
+		fprintf(stderr, "invalid layout\n");
+		return 1;
+	}
+	PrintDemand(&d);
+	return 0;
+}
+
+
+/* Times a full recompute of the block list. Every block is stored separately (like blocks spread over
+ * islands would be) so the cost grows with the number of blocks.
+ */
+static int CmdBench(int argc, char **argv){
+	if (argc != 6){
+		PrintUsage();
+		return 2;
+	}
+
+	HousingBlock block = { atoi(argv[2]), atoi(argv[3]) };
+	int blockCount = atoi(argv[4]);
+	long iterations = atol(argv[5]);
+
+	if (blockCount < 0 || iterations <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	HousingBlock *blocks = malloc(sizeof(*blocks) * (size_t)(blockCount > 0 ? blockCount : 1));
+	if (!blocks){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int i = 0; i < blockCount; i++){
+		blocks[i] = block;
+	}
+
+	Demand d;
+	double checksum = 0.0;
+	double start = NowNs();
+	for (long i = 0; i < iterations; i++){
+		CalcDemand(blocks, blockCount, &d);
+		checksum += d.tonsPerMinute[GOOD_Fish];
+	}
+	double elapsed = NowNs() - start;
+
+	printf("full recompute: %d blocks, %ld iterations, %.1f ns/recompute (checksum %.3f)\n",
+		blockCount, iterations, elapsed / (double)iterations, checksum);
+
+	free(blocks);
+	return 0;
+}
+
+
+/* Times Farmer Block +1/-1 clicks against the running totals in demand_agg.c, with <blocks> blocks already
+ * tracked. The clicks alternate between adding and removing so the block count stays the same.
+ */
+static int CmdBenchClicks(int argc, char **argv){
+	if (argc != 6 && argc != 7){
+		PrintUsage();
+		return 2;
+	}
+
+	HousingBlock block = { atoi(argv[2]), atoi(argv[3]) };
+	int blockCount = atoi(argv[4]);
+	long clicks = atol(argv[5]);
+
+	if (blockCount < 0 || clicks <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	DemandAggregate agg;
+	DemandAggInit(&agg);
+	for (int i = 0; i < blockCount; i++){
+		if (DemandAggAdd(&agg, &block) < 0){
+			fprintf(stderr, "invalid layout\n");
+			DemandAggFree(&agg);
+			return 1;
+		}
+	}
+	agg.verify = (argc == 7 && strcmp(argv[6], "verify") == 0);
+
+	Demand d;
+	double checksum = 0.0;
+	double start = NowNs();
+	for (long i = 0; i < clicks; i++){
+		if (i & 1){
+			DemandAggRemoveLast(&agg);
+		}
+		else{
+			DemandAggAdd(&agg, &block);
+		}
+		DemandAggResult(&agg, &d);
+		checksum += d.tonsPerMinute[GOOD_Fish];
+	}
+	double elapsed = NowNs() - start;
+
+	printf("incremental: %d blocks, %ld clicks, %.1f ns/click (checksum %.3f)\n",
+		blockCount, clicks, elapsed / (double)clicks, checksum);
+	if (agg.verify){
+		printf("verify: %ld checks, %ld failures\n", agg.verifyChecks, agg.verifyFailures);
+	}
+
+	int failed = agg.verifyFailures != 0;
+	DemandAggFree(&agg);
+	return failed;
+}
+
+
+/* Runs a pseudo random sequence of add/remove/resize operations with verification switched on and reports
+ * whether the running totals ever disagreed with a full recompute.
+ */
+static int CmdVerifyAgg(int argc, char **argv){
+	if (argc != 3){
+		PrintUsage();
+		return 2;
+	}
+
+	long operations = atol(argv[2]);
+	unsigned int seed = 12345;
+
+	DemandAggregate agg;
+	DemandAggInit(&agg);
+	agg.verify = 1;
+
+	for (long i = 0; i < operations; i++){
+		seed = seed * 1103515245u + 12345u;
+		unsigned int r = seed >> 8;
+		HousingBlock block = { 1 + (int)(r % 2), 1 + (int)((r >> 4) % 12) };
+
+		switch (r % 3){
+			case 0:
+				DemandAggAdd(&agg, &block);
+				break;
+			case 1:
+				if (agg.blockCount > 0){
+					DemandAggRemove(&agg, (int)((r >> 8) % (unsigned int)agg.blockCount));
+				}
+				break;
+			case 2:
+				if (agg.blockCount > 0){
+					DemandAggResize(&agg, (int)((r >> 8) % (unsigned int)agg.blockCount), &block);
+				}
+				break;
+		}
+	}
+
+	printf("verify: %ld operations, %d blocks left, %ld checks, %ld failures\n",
+		operations, agg.blockCount, agg.verifyChecks, agg.verifyFailures);
+
+	int failed = agg.verifyFailures != 0;
+	DemandAggFree(&agg);
+	return failed;
+}
+
+
+/* Solves the full production chain for the given residents, e.g. "anno_calc chain Farmers=800 Investors=5000",
+ * and prints every good that is needed.
+ */
+static int CmdChain(int argc, char **argv){
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	ChainPlan plan;
+	ChainResult result;
+
+	if (!ChainPlanBuild(&plan, def)){
+		fprintf(stderr, "could not build the chain plan\n");
+		return 1;
+	}
+
+	double *residents = calloc((size_t)def->tierCount, sizeof(double));
+	double *scratch = malloc(sizeof(double) * (size_t)plan.goodCount);
+	if (!residents || !scratch || !ChainResultInit(&result, &plan)){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	for (int i = 2; i < argc; i++){
+		char name[64];
+		double count;
+		if (sscanf(argv[i], "%63[^=]=%lf", name, &count) != 2 || ChainFindTier(def, name) < 0){
+			fprintf(stderr, "bad tier argument '%s'\n", argv[i]);
+			return 2;
+		}
+		residents[ChainFindTier(def, name)] = count;
+	}
+
+	ChainSolve(&plan, residents, &result, scratch);
+
+	for (int g = 0; g < def->goodCount; g++){
+		if (result.tonsPerMinute[g] > 0.0){
+			printf("%-16s %9.3f t/min %8.3f x %s\n", def->goods[g].name, result.tonsPerMinute[g], result.buildings[g], def->goods[g].buildingName);
+		}
+	}
+
+	ChainResultFree(&result);
+	ChainPlanFree(&plan);
+	free(residents);
+	free(scratch);
+	return 0;
+}
+
+
+//Times full chain solves with every tier set to the same number of residents.
+static int CmdBenchChain(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	double perTier = atof(argv[2]);
+	long iterations = atol(argv[3]);
+	ChainPlan plan;
+	ChainResult result;
+
+	if (iterations <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	double start = NowNs();
+	if (!ChainPlanBuild(&plan, def)){
+		fprintf(stderr, "could not build the chain plan\n");
+		return 1;
+	}
+	double buildNs = NowNs() - start;
+
+	double *residents = malloc(sizeof(double) * (size_t)def->tierCount);
+	double *scratch = malloc(sizeof(double) * (size_t)plan.goodCount);
+	if (!residents || !scratch || !ChainResultInit(&result, &plan)){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int t = 0; t < def->tierCount; t++){
+		residents[t] = perTier;
+	}
+
+	double checksum = 0.0;
+	start = NowNs();
+	for (long i = 0; i < iterations; i++){
+		residents[0] = perTier + (double)(i & 7);
+		ChainSolve(&plan, residents, &result, scratch);
+		checksum += result.buildings[0];
+	}
+	double elapsed = NowNs() - start;
+
+	printf("chain plan: %d goods, %d tiers, built in %.1f us\n", plan.goodCount, plan.tierCount, buildNs / 1000.0);
+	printf("full chain solve: %ld iterations, %.3f us/solve (checksum %.3f)\n",
+		iterations, elapsed / (double)iterations / 1000.0, checksum);
+
+	ChainResultFree(&result);
+	ChainPlanFree(&plan);
+	free(residents);
+	free(scratch);
+	return 0;
+}
+
+
+//Lists the generated control table (controls.h) so it can be checked without building the Win32 program.
+static int CmdControls(void){
+	for (int kind = 1; kind < CONTROL_KIND_COUNT; kind++){
+		for (int slot = 0; slot < CONTROL_SLOTS; slot++){
+			int id = kind * 1000 + slot;
+			if (ControlIndexFromId(id) < 0){
+				continue;
+			}
+			int good = ControlDisplayGood(id);
+			printf("%5d  kind %d  index %2d  %ls", id, (int)ControlKindFromId(id), ControlIndexFromId(id), ControlIdName(id));
+			if (good >= 0){
+				printf("  -> %s \"%ls\"", CalcGoodInfo((Good)good)->name, ControlDisplayLabel((Good)good));
+			}
+			printf("\n");
+		}
+	}
+	return 0;
+}
+
+
+static int PrintAssetRecord(const AssetRecord *r, void *user){
+	(void)user;
+	printf("%-15s %9ld %-32.*s", AssetKindName(r->kind), r->guid, (int)r->name.len, r->name.ptr);
+	if (r->kind == ASSET_Production){
+		printf(" cycle %.0fs in", r->cycleTime);
+		for (int i = 0; i < r->inputCount; i++){
+			printf(" %ld", r->inputs[i].product);
+		}
+		printf(" out");
+		for (int i = 0; i < r->outputCount; i++){
+			printf(" %ld", r->outputs[i].product);
+		}
+	}
+	else if (r->kind == ASSET_Residence){
+		printf(" level %ld max %d", r->populationLevel, r->residentMax);
+	}
+	else if (r->kind == ASSET_PopulationLevel){
+		printf(" needs %d", r->inputCount);
+	}
+	printf("\n");
+	return 1;
+}
+
+
+//Scans an assets.xml and reports what was found and how fast.
+static int CmdImport(int argc, char **argv){
+	if (argc != 3 && argc != 4){
+		PrintUsage();
+		return 2;
+	}
+	int dump = (argc == 4 && strcmp(argv[3], "dump") == 0);
+
+	AssetImportStats stats;
+	double start = NowNs();
+	if (!AssetsImportFile(argv[2], dump ? PrintAssetRecord : NULL, NULL, &stats)){
+		fprintf(stderr, "could not import %s\n", argv[2]);
+		return 1;
+	}
+	double elapsed = NowNs() - start;
+
+	printf("%zu bytes, %ld assets\n", stats.bytes, stats.assets);
+	for (int k = 0; k < ASSET_KIND_COUNT; k++){
+		printf("  %-15s %ld\n", AssetKindName((AssetKind)k), stats.records[k]);
+	}
+	printf("  truncated       %ld\n", stats.truncatedRecords);
+	printf("%.1f ms, %.0f MB/s\n", elapsed / 1e6, (double)stats.bytes / (elapsed / 1e9) / 1e6);
+	return 0;
+}
+
+
+/* Writes a synthetic assets.xml of roughly the given size for throughput runs. Like the real file most of
+ * the assets are of no interest to the importer and only every few assets is a product, residence,
+ * population level or production building.
+ */
+static int CmdGenAssets(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	FILE *f = fopen(argv[2], "wb");
+	if (!f){
+		fprintf(stderr, "could not create %s\n", argv[2]);
+		return 1;
+	}
+
+	long target = atol(argv[3]) * 1000000L;
+	long guid = 1000000;
+
+	fprintf(f, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<AssetList>\n<Groups>\n<Group>\n<Assets>\n");
+	while (ftell(f) < target){
+		guid++;
+		switch (guid % 8){
+			case 0:
+				fprintf(f, "<Asset>\n  <Template>Product</Template>\n  <Values>\n    <Standard>\n      <GUID>%ld</GUID>\n"
+					"      <Name>product_%ld</Name>\n    </Standard>\n    <Product>\n      <StorageLevel>Building</StorageLevel>\n"
+					"    </Product>\n  </Values>\n</Asset>\n", guid, guid);
+				break;
+			case 1:
+				fprintf(f, "<Asset>\n  <Template>FactoryBuilding7</Template>\n  <Values>\n    <Standard>\n      <GUID>%ld</GUID>\n"
+					"      <Name>factory_%ld</Name>\n    </Standard>\n    <FactoryBase>\n      <FactoryInputs>\n"
+					"        <Item>\n          <Product>%ld</Product>\n          <Amount>1</Amount>\n          <StorageAmount>6</StorageAmount>\n        </Item>\n"
+					"      </FactoryInputs>\n      <FactoryOutputs>\n        <Item>\n          <Product>%ld</Product>\n          <Amount>1</Amount>\n"
+					"        </Item>\n      </FactoryOutputs>\n      <CycleTime>%d</CycleTime>\n    </FactoryBase>\n  </Values>\n</Asset>\n",
+					guid, guid, guid - 9, guid - 1, 30 + (int)(guid % 4) * 30);
+				break;
+			case 2:
+				fprintf(f, "<Asset>\n  <Template>ResidenceBuilding7</Template>\n  <Values>\n    <Standard>\n      <GUID>%ld</GUID>\n"
+					"      <Name>residence_%ld</Name>\n    </Standard>\n    <Residence7>\n      <PopulationLevel7>%ld</PopulationLevel7>\n"
+					"      <ResidentMax>%d</ResidentMax>\n    </Residence7>\n  </Values>\n</Asset>\n", guid, guid, guid + 1, 10 * (1 + (int)(guid % 5)));
+				break;
+			case 3:
+				fprintf(f, "<Asset>\n  <Template>PopulationLevel7</Template>\n  <Values>\n    <Standard>\n      <GUID>%ld</GUID>\n"
+					"      <Name>population_%ld</Name>\n    </Standard>\n    <PopulationLevel7>\n      <PopulationInputs>\n", guid, guid);
+				for (int i = 0; i < 6; i++){
+					fprintf(f, "        <Item>\n          <Product>%ld</Product>\n          <Amount>0.00%d</Amount>\n"
+						"          <SupplyWeight>%d</SupplyWeight>\n        </Item>\n", guid - 3 - 8 * i, 1 + i, 2 + i);
+				}
+				fprintf(f, "      </PopulationInputs>\n    </PopulationLevel7>\n  </Values>\n</Asset>\n");
+				break;
+			default:
+				fprintf(f, "<Asset>\n  <Template>Decoration</Template>\n  <Values>\n    <Standard>\n      <GUID>%ld</GUID>\n"
+					"      <Name>ornament_%ld</Name>\n      <IconFilename>data/ui/2kimages/main/3dicons/icon_%ld.png</IconFilename>\n"
+					"    </Standard>\n    <Building>\n      <BuildModeRandomRotation>90</BuildModeRandomRotation>\n"
+					"      <TerrainType>Coast</TerrainType>\n    </Building>\n    <Cost>\n      <Costs>\n"
+					"        <Item>\n          <Ingredient>1010017</Ingredient>\n          <Amount>%d</Amount>\n        </Item>\n"
+					"      </Costs>\n    </Cost>\n    <!-- <Text><LocaText>unused</LocaText></Text> -->\n  </Values>\n</Asset>\n",
+					guid, guid, guid, (int)(guid % 5000));
+				break;
+		}
+	}
+	fprintf(f, "</Assets>\n</Group>\n</Groups>\n</AssetList>\n");
+
+	long size = ftell(f);
+	fclose(f);
+	printf("wrote %ld bytes to %s\n", size, argv[2]);
+	return 0;
+}
+
+
+//Opens (and if needed rebuilds) the game data cache and prints what it holds.
+static int CmdCache(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	GameCache cache;
+	GameCacheStatus why;
+	double start = NowNs();
+	GameCacheStatus status = GameCacheLoad(&cache, argv[3], argv[2], &why);
+	double elapsed = NowNs() - start;
+
+	printf("existing cache: %s\n", GameCacheStatusName(why));
+	if (status != GAMECACHE_Ok){
+		fprintf(stderr, "could not load the cache: %s\n", GameCacheStatusName(status));
+		return 1;
+	}
+	printf("products %d, residences %d, population levels %d, production buildings %d, items %d, %llu string bytes\n",
+		cache.productCount, cache.residenceCount, cache.populationCount, cache.productionCount, cache.itemCount,
+		(unsigned long long)cache.stringBytes);
+	printf("%s in %.3f ms\n", why == GAMECACHE_Ok ? "opened" : "rebuilt and opened", elapsed / 1e6);
+
+	GameCacheClose(&cache);
+	return 0;
+}
+
+
+/* Compares startup costs: parsing assets.xml directly, a cold start that has to build the cache, and warm
+ * starts that only map and check the existing cache.
+ */
+static int CmdBenchStartup(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	const char *source = argv[2];
+	const char *cachePath = argv[3];
+	GameCache cache;
+
+	double start = NowNs();
+	if (!AssetsImportFile(source, NULL, NULL, NULL)){
+		fprintf(stderr, "could not import %s\n", source);
+		return 1;
+	}
+	double parseNs = NowNs() - start;
+
+	remove(cachePath);
+	start = NowNs();
+	if (GameCacheLoad(&cache, cachePath, source, NULL) != GAMECACHE_Ok){
+		fprintf(stderr, "could not build the cache\n");
+		return 1;
+	}
+	double coldNs = NowNs() - start;
+	GameCacheClose(&cache);
+
+	const int runs = 20;
+	double warmNs = 0.0;
+	for (int i = 0; i < runs; i++){
+		GameCacheStatus why;
+		start = NowNs();
+		GameCacheStatus status = GameCacheLoad(&cache, cachePath, source, &why);
+		warmNs += NowNs() - start;
+		if (status != GAMECACHE_Ok || why != GAMECACHE_Ok){
+			fprintf(stderr, "warm start rebuilt the cache (%s)\n", GameCacheStatusName(why));
+			return 1;
+		}
+		GameCacheClose(&cache);
+	}
+
+	printf("parse assets.xml:        %9.3f ms\n", parseNs / 1e6);
+	printf("cold start (build cache): %9.3f ms\n", coldNs / 1e6);
+	printf("warm start (map + check): %9.3f ms (average of %d)\n", warmNs / runs / 1e6, runs);
+	return 0;
+}
+
+//Adds up the residences of all islands and prints the first few islands.
+typedef struct SaveTotals {
+	const SaveQuery *query;
+	long residences[SAVE_MAX_TIERS];
+	long objects;
+	int print;
+} SaveTotals;
+
+
+static int AddIsland(const SaveIsland *island, void *user){
+	SaveTotals *totals = user;
+	totals->objects += island->objects;
+	for (int i = 0; i < totals->query->residenceCount; i++){
+		totals->residences[i] += island->residences[i];
+	}
+	if (island->index < totals->print){
+		printf("island %ld: %ld objects, %llu bytes,", island->index, island->objects, (unsigned long long)island->bytes);
+		for (int i = 0; i < totals->query->residenceCount; i++){
+			if (island->residences[i] > 0){
+				printf(" %s %ld", totals->query->residences[i].tier, island->residences[i]);
+			}
+		}
+		printf("\n");
+	}
+	return 1;
+}
+
+
+static void PrintResidences(const SaveQuery *query, const long *residences){
+	for (int i = 0; i < query->residenceCount; i++){
+		printf("  %-12s %ld\n", query->residences[i].tier, residences[i]);
+	}
+}
+
+
+static void PrintSaveStats(const SaveStats *stats){
+	printf("file %llu bytes, data.a7s %llu bytes compressed, %llu bytes decompressed (%d zlib layers)\n",
+		(unsigned long long)stats->fileBytes, (unsigned long long)stats->compressedBytes,
+		(unsigned long long)stats->dataBytes, stats->layers);
+	printf("%llu nodes, %ld islands, %d threads, at most %llu island bytes buffered\n",
+		(unsigned long long)stats->nodes, stats->islands, stats->threads, (unsigned long long)stats->peakBufferedBytes);
+}
+
+
+static int CmdSave(int argc, char **argv){
+	if (argc != 3 && argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	SaveQuery query;
+	SaveDefaultQuery(&query);
+	if (argc == 4){
+		query.threads = atoi(argv[3]);
+	}
+
+	SaveTotals totals = {&query, {0}, 0, 20};
+	SaveStats stats;
+	double start = NowNs();
+	SaveStatus status = SaveReadIslands(argv[2], &query, AddIsland, &totals, &stats);
+	double elapsed = NowNs() - start;
+
+	if (status != SAVE_Ok){
+		fprintf(stderr, "could not read %s: %s\n", argv[2], SaveStatusName(status));
+		return 1;
+	}
+	printf("residences on all islands (%ld objects):\n", totals.objects);
+	PrintResidences(&query, totals.residences);
+	PrintSaveStats(&stats);
+	printf("read in %.3f ms\n", elapsed / 1e6);
+	return 0;
+}
+
+
+//Writes a synthetic savegame and prints the residence totals it holds, to compare with "save".
+static int CmdGenSave(int argc, char **argv){
+	if (argc != 5 && !(argc == 6 && strcmp(argv[5], "single") == 0)){
+		PrintUsage();
+		return 2;
+	}
+
+	SaveQuery query;
+	SaveDefaultQuery(&query);
+	long expected[SAVE_MAX_TIERS];
+	if (!SaveWriteSynthetic(argv[2], &query, atol(argv[3]), atol(argv[4]), argc == 5, expected)){
+		fprintf(stderr, "could not write %s\n", argv[2]);
+		return 1;
+	}
+	printf("wrote %s with residences:\n", argv[2]);
+	PrintResidences(&query, expected);
+	return 0;
+}
+
+
+/* Times reading a savegame on one thread and on more workers. The decompressed size is the work done,
+ * the islands are counted the same way every time and have to give the same totals.
+ */
+static int CmdBenchSave(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	int runs = atoi(argv[3]);
+	if (runs < 1){
+		runs = 1;
+	}
+
+	SaveQuery query;
+	SaveDefaultQuery(&query);
+	long reference[SAVE_MAX_TIERS] = {0};
+	SaveStats stats;
+
+	static const int threadCounts[] = {1, 2, 4, 8};
+	for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++){
+		query.threads = threadCounts[t];
+		double best = 0.0;
+		for (int run = 0; run < runs; run++){
+			SaveTotals totals = {&query, {0}, 0, 0};
+			double start = NowNs();
+			SaveStatus status = SaveReadIslands(argv[2], &query, AddIsland, &totals, &stats);
+			double elapsed = NowNs() - start;
+			if (status != SAVE_Ok){
+				fprintf(stderr, "could not read %s: %s\n", argv[2], SaveStatusName(status));
+				return 1;
+			}
+			if (t == 0 && run == 0){
+				memcpy(reference, totals.residences, sizeof(reference));
+			}
+			else if (memcmp(reference, totals.residences, sizeof(reference)) != 0){
+				fprintf(stderr, "%d threads counted different residences\n", query.threads);
+				return 1;
+			}
+			if (run == 0 || elapsed < best){
+				best = elapsed;
+			}
+		}
+		printf("%d threads: %9.3f ms, %7.1f MB/s decompressed, %llu island bytes buffered\n", query.threads,
+			best / 1e6, (double)stats.dataBytes / (best / 1e9) / 1e6, (unsigned long long)stats.peakBufferedBytes);
+	}
+	PrintSaveStats(&stats);
+	return 0;
+}
+
+static int CmdSaveExtract(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	SaveStats stats;
+	SaveStatus status = SaveExtractData(argv[2], argv[3], &stats);
+	if (status != SAVE_Ok){
+		fprintf(stderr, "could not extract %s: %s\n", argv[2], SaveStatusName(status));
+		return 1;
+	}
+	printf("wrote %llu bytes of FileDB data to %s (%d zlib layers)\n", (unsigned long long)stats.dataBytes, argv[3], stats.layers);
+	return 0;
+}
+
+
+/* Maps an extracted data.a7s, descends only into the requested island and prints its residences and the
+ * values the ID_DSP_* displays would show for its farmers.
+ */
+static int CmdFileDb(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	SaveQuery query;
+	SaveDefaultQuery(&query);
+	FileDb db;
+
+	double start = NowNs();
+	FileDbStatus dbStatus = FileDbOpenFile(&db, argv[2]);
+	double openNs = NowNs() - start;
+	if (dbStatus != FILEDB_Ok){
+		fprintf(stderr, "could not open %s: %s\n", argv[2], FileDbStatusName(dbStatus));
+		return 1;
+	}
+
+	SaveIsland island;
+	start = NowNs();
+	SaveStatus status = SaveTreeIsland(&db, &query, atol(argv[3]), &island);
+	double queryNs = NowNs() - start;
+	if (status != SAVE_Ok){
+		fprintf(stderr, "island %s: %s\n", argv[3], SaveStatusName(status));
+		FileDbClose(&db);
+		return 1;
+	}
+
+	long farmers = 0;
+	printf("island %ld: %ld objects, %llu bytes\n", island.index, island.objects, (unsigned long long)island.bytes);
+	for (int i = 0; i < query.residenceCount; i++){
+		if (island.residences[i] > 0){
+			printf("  %-12s %ld residences\n", query.residences[i].tier, island.residences[i]);
+		}
+		if (strcmp(query.residences[i].tier, "Farmers") == 0){
+			farmers = island.residences[i];
+		}
+	}
+
+	Demand demand;
+	CalcDemandResidents(farmers * CALC_RESIDENTS_PER_HOUSE, &demand);
+	printf("farmer displays:\n");
+	for (int g = 0; g < GOOD_COUNT; g++){
+		printf("  %ls %.2f buildings\n", ControlDisplayLabel((Good)g), demand.buildings[g]);
+	}
+
+	printf("open %.3f ms, island query %.3f ms, %llu of the tree's nodes created, %zu arena bytes\n",
+		openNs / 1e6, queryNs / 1e6, (unsigned long long)db.nodes, db.arena.used);
+	FileDbClose(&db);
+	return 0;
+}
+
+/* A made up empire for the empire commands: the islands go round the four sessions, each has residents of
+ * its session's tiers and production buildings for about every third good. Always the same for a count.
+ */
+typedef struct TestEmpire {
+	EmpireIsland *islands;
+	double *residents;
+	double *buildings;
+} TestEmpire;
+
+
+static int TestEmpireInit(TestEmpire *t, const ChainDefinition *def, long count){
+	t->islands = calloc((size_t)count, sizeof(*t->islands));
+	t->residents = calloc((size_t)count * (size_t)def->tierCount, sizeof(double));
+	t->buildings = calloc((size_t)count * (size_t)def->goodCount, sizeof(double));
+	if (!t->islands || !t->residents || !t->buildings){
+		return 0;
+	}
+
+	unsigned long seed = 12345;
+	for (long i = 0; i < count; i++){
+		Session session = (Session)(i % SESSION_COUNT);
+		double *residents = t->residents + (size_t)i * def->tierCount;
+		double *buildings = t->buildings + (size_t)i * def->goodCount;
+		for (int k = 0; k < def->tierCount; k++){
+			seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+			if (def->tiers[k].session == session){
+				residents[k] = (double)((seed >> 33) % 20000);
+			}
+		}
+		for (int g = 0; g < def->goodCount; g++){
+			seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+			if ((seed >> 40) % 3 == 0){
+				buildings[g] = (double)((seed >> 20) % 12);
+			}
+		}
+		t->islands[i].session = session;
+		t->islands[i].residents = residents;
+		t->islands[i].buildings = buildings;
+	}
+	return 1;
+}
+
+
+static void TestEmpireFree(TestEmpire *t){
+	free(t->islands);
+	free(t->residents);
+	free(t->buildings);
+}
+
+
+//Prints the biggest shortages of every session.
+static int CmdEmpire(int argc, char **argv){
+	if (argc != 3 && argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	long count = atol(argv[2]);
+	ChainPlan plan;
+	ThreadPool pool;
+	Empire empire;
+	TestEmpire t;
+
+	if (!ChainPlanBuild(&plan, def) || !PoolInit(&pool, argc == 4 ? atoi(argv[3]) : 0) || !EmpireInit(&empire, &plan, &pool)
+		|| !TestEmpireInit(&t, def, count) || !EmpireEvaluate(&empire, t.islands, count)){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	static const char *sessionNames[SESSION_COUNT] = {"Old World", "New World", "Arctic", "Enbesa"};
+	for (int s = 0; s < SESSION_COUNT; s++){
+		const double *balance = EmpireSessionRow(&empire, empire.sessionBalance, (Session)s);
+		printf("%s:\n", sessionNames[s]);
+		//Five lines do not need a sort, the most negative balances are picked one after the other.
+		int printed[5];
+		for (int shown = 0; shown < 5; shown++){
+			int worst = -1;
+			for (int g = 0; g < def->goodCount; g++){
+				int used = 0;
+				for (int k = 0; k < shown; k++){
+					used |= (printed[k] == g);
+				}
+				if (!used && (worst < 0 || balance[g] < balance[worst])){
+					worst = g;
+				}
+			}
+			printed[shown] = worst;
+			if (balance[worst] < 0.0){
+				printf("  %-16s %10.2f t/min\n", def->goods[worst].name, balance[worst]);
+			}
+		}
+	}
+	printf("%ld islands on %d workers\n", count, PoolWorkers(&pool));
+
+	TestEmpireFree(&t);
+	EmpireFree(&empire);
+	PoolFree(&pool);
+	ChainPlanFree(&plan);
+	return 0;
+}
+
+
+/* Times EmpireEvaluate with 1, 2, 4 and 8 workers and checks that the session balances are bit for bit
+ * the same every time.
+ */
+static int CmdBenchEmpire(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	long count = atol(argv[2]);
+	int iterations = atoi(argv[3]);
+	ChainPlan plan;
+	TestEmpire t;
+	size_t balanceBytes = SESSION_COUNT * (size_t)def->goodCount * sizeof(double);
+	double *reference = malloc(balanceBytes);
+
+	if (iterations < 1 || !reference || !ChainPlanBuild(&plan, def) || !TestEmpireInit(&t, def, count)){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	static const int workerCounts[] = {1, 2, 4, 8};
+	double single = 0.0;
+	for (size_t w = 0; w < sizeof(workerCounts) / sizeof(workerCounts[0]); w++){
+		ThreadPool pool;
+		Empire empire;
+		if (!PoolInit(&pool, workerCounts[w] - 1) || !EmpireInit(&empire, &plan, &pool)){
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+
+		double start = NowNs();
+		for (int i = 0; i < iterations; i++){
+			EmpireEvaluate(&empire, t.islands, count);
+		}
+		double perRun = (NowNs() - start) / iterations;
+
+		if (w == 0){
+			memcpy(reference, empire.sessionBalance, balanceBytes);
+			single = perRun;
+		}
+		int same = memcmp(reference, empire.sessionBalance, balanceBytes) == 0;
+
+		uint64_t steals = 0;
+		for (int k = 0; k < PoolWorkers(&pool); k++){
+			steals += pool.steals[k];
+		}
+		printf("%d workers: %10.3f us per evaluation, speedup %.2f, %llu steals, balances %s\n", PoolWorkers(&pool),
+			perRun / 1e3, single / perRun, (unsigned long long)steals, same ? "identical" : "DIFFERENT");
+
+		EmpireFree(&empire);
+		PoolFree(&pool);
+		if (!same){
+			return 1;
+		}
+	}
+
+	TestEmpireFree(&t);
+	ChainPlanFree(&plan);
+	free(reference);
+	return 0;
+}
+
+
+static const char *g_modifierKindNames[] = {"consumption", "productivity", "supply"};
+
+
+/* Solves the chain for the given residents without and with buffs, e.g.
+ * anno_calc modifiers Farmers=5000 "buff=Fish Market" "buff=Fishing Nets", and prints every good needed.
+ * Without buffs it lists the buffs there are.
+ */
+static int CmdModifiers(int argc, char **argv){
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	const ModifierDefinition *buffs = ModifierBuiltinDefinition();
+	ChainPlan plan;
+	ModifierLibrary library;
+	ModifierSet set;
+	ChainResult before;
+	ChainResult after;
+
+	if (!ChainPlanBuild(&plan, def) || !ModifierLibraryBuild(&library, buffs, def, &plan)){
+		fprintf(stderr, "could not build the chain plan and the buffs\n");
+		return 1;
+	}
+
+	double *residents = calloc((size_t)def->tierCount, sizeof(double));
+	double *scratch = malloc(sizeof(double) * (size_t)plan.goodCount);
+	if (!residents || !scratch || !ChainResultInit(&before, &plan) || !ChainResultInit(&after, &plan)
+		|| !ModifierSetInit(&set, &library)){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	int buffCount = 0;
+	for (int i = 2; i < argc; i++){
+		if (strncmp(argv[i], "buff=", 5) == 0){
+			int b = ModifierFindBuff(buffs, argv[i] + 5);
+			if (b < 0){
+				fprintf(stderr, "unknown buff '%s'\n", argv[i] + 5);
+				return 2;
+			}
+			ModifierSetEnable(&set, b, 1);
+			buffCount++;
+			continue;
+		}
+		char name[64];
+		double count;
+		if (sscanf(argv[i], "%63[^=]=%lf", name, &count) != 2 || ChainFindTier(def, name) < 0){
+			fprintf(stderr, "bad tier argument '%s'\n", argv[i]);
+			return 2;
+		}
+		residents[ChainFindTier(def, name)] = count;
+	}
+
+	if (buffCount == 0){
+		for (int b = 0; b < buffs->buffCount; b++){
+			const ModifierBuffDef *buff = &buffs->buffs[b];
+			printf("%-20s %-12s", buff->name, ModifierSourceName(buff->source));
+			for (int k = 0; k < buff->effectCount; k++){
+				const ModifierEffectDef *effect = &buff->effects[k];
+				printf("  %s %s %+g%s", effect->good, g_modifierKindNames[effect->kind], effect->amount,
+					effect->kind == MODIFIER_Supply ? " t/min" : " %");
+			}
+			printf("\n");
+		}
+	}
+	else{
+		ChainSolve(&plan, residents, &before, scratch);
+		ChainSolveModified(&plan, residents, ModifierSetCompile(&set), &after, scratch);
+		for (int g = 0; g < def->goodCount; g++){
+			if (before.tonsPerMinute[g] > 0.0 || after.tonsPerMinute[g] > 0.0){
+				printf("%-16s %9.3f -> %9.3f t/min %8.3f -> %8.3f x %s\n", def->goods[g].name, before.tonsPerMinute[g],
+					after.tonsPerMinute[g], before.buildings[g], after.buildings[g], def->goods[g].buildingName);
+			}
+		}
+	}
+
+	ModifierSetFree(&set);
+	ChainResultFree(&before);
+	ChainResultFree(&after);
+	ModifierLibraryFree(&library);
+	ChainPlanFree(&plan);
+	free(residents);
+	free(scratch);
+	return 0;
+}
+
+
+/* Sums the buffs of a set straight from the definition, looking every good up by name, into needScale,
+ * supply and output (plan->goodCount each), the way ModifierSetCompile does with the library.
+ */
+static void ReferenceModifiers(const ModifierSet *set, const ModifierDefinition *buffs, const ChainDefinition *def,
+	const ChainPlan *plan, double *needScale, double *supply, double *output){
+
+	int n = plan->goodCount;
+	memset(needScale, 0, sizeof(double) * (size_t)n);
+	memset(supply, 0, sizeof(double) * (size_t)n);
+	memset(output, 0, sizeof(double) * (size_t)n);
+	for (int b = 0; b < buffs->buffCount; b++){
+		if (!ModifierSetActive(set, b)){
+			continue;
+		}
+		for (int k = 0; k < buffs->buffs[b].effectCount; k++){
+			const ModifierEffectDef *effect = &buffs->buffs[b].effects[k];
+			int s = plan->goodSlot[ChainFindGood(def, effect->good)];
+			double *sum = effect->kind == MODIFIER_Consumption ? needScale : effect->kind == MODIFIER_Productivity ? output : supply;
+			sum[s] += effect->amount;
+		}
+	}
+	for (int s = 0; s < n; s++){
+		double scale = 1.0 + needScale[s] / 100.0;
+		double productivity = 100.0 + output[s];
+		needScale[s] = scale > 0.0 ? scale : 0.0;
+		supply[s] = supply[s] > 0.0 ? supply[s] : 0.0;
+		output[s] = plan->slotOutputPerMinute[s]
+			* ((productivity > MODIFIER_MIN_PRODUCTIVITY ? productivity : MODIFIER_MIN_PRODUCTIVITY) / 100.0);
+	}
+}
+
+
+/* Checks buffs against worked out values on 800 farmers: modifiers without vectors change nothing, the two
+ * fish consumption buffs add up to -25 %, the fishing nets make a fishery 25 % faster, and setting a buff
+ * that is already set compiles nothing.
+ * Returns the number of errors.
+ */
+static int CheckModifiers(const ChainPlan *plan, const ChainDefinition *def, const ModifierLibrary *library){
+
+	const ModifierDefinition *buffs = ModifierBuiltinDefinition();
+	int fish = ChainFindGood(def, "Fish");
+	int farmers = ChainFindTier(def, "Farmers");
+	int fishMarket = ModifierFindBuff(buffs, "Fish Market");
+	int fountain = ModifierFindBuff(buffs, "Town Fountain");
+	int nets = ModifierFindBuff(buffs, "Fishing Nets");
+	if (fish < 0 || farmers < 0 || fishMarket < 0 || fountain < 0 || nets < 0){
+		printf("check: the fish buffs are missing\n");
+		return 1;
+	}
+
+	double *residents = calloc((size_t)def->tierCount, sizeof(double));
+	double *scratch = malloc(sizeof(double) * (size_t)plan->goodCount);
+	ChainResult before;
+	ChainResult after;
+	ModifierSet set;
+	if (!residents || !scratch || !ChainResultInit(&before, plan) || !ChainResultInit(&after, plan)
+		|| !ModifierSetInit(&set, library)){
+		printf("check: out of memory\n");
+		return 1;
+	}
+	residents[farmers] = 800.0;
+	ChainSolve(plan, residents, &before, scratch);
+
+	int errors = 0;
+	ChainModifiers none = {NULL, NULL, NULL};
+	ChainSolveModified(plan, residents, &none, &after, scratch);
+	if (memcmp(before.tonsPerMinute, after.tonsPerMinute, sizeof(double) * (size_t)plan->goodCount) != 0
+		|| memcmp(before.buildings, after.buildings, sizeof(double) * (size_t)plan->goodCount) != 0){
+		printf("check: modifiers without vectors changed the solve\n");
+		errors++;
+	}
+
+	ModifierSetEnable(&set, fishMarket, 1);
+	ModifierSetEnable(&set, fountain, 1);
+	ChainSolveModified(plan, residents, ModifierSetCompile(&set), &after, scratch);
+	if (fabs(after.tonsPerMinute[fish] - 0.75 * before.tonsPerMinute[fish]) > 1e-12){
+		printf("check: fish with -20 %% and -5 %% is %.6f t/min, expected %.6f\n", after.tonsPerMinute[fish],
+			0.75 * before.tonsPerMinute[fish]);
+		errors++;
+	}
+
+	ModifierSetEnable(&set, nets, 1);
+	ChainSolveModified(plan, residents, ModifierSetCompile(&set), &after, scratch);
+	double fishery = 0.75 * before.buildings[fish] / 1.25;
+	if (fabs(after.buildings[fish] - fishery) > 1e-12){
+		printf("check: fisheries with fishing nets are %.6f, expected %.6f\n", after.buildings[fish], fishery);
+		errors++;
+	}
+
+	uint64_t compiles = set.compiles;
+	if (ModifierSetEnable(&set, nets, 1) || ModifierSetCompile(&set) != &set.modifiers || set.compiles != compiles){
+		printf("check: setting an active buff again compiled the set\n");
+		errors++;
+	}
+	if (!ModifierSetEnable(&set, nets, 0) || (ModifierSetCompile(&set), set.compiles != compiles + 1)){
+		printf("check: clearing a buff did not compile the set\n");
+		errors++;
+	}
+
+	ModifierSetFree(&set);
+	ChainResultFree(&before);
+	ChainResultFree(&after);
+	free(residents);
+	free(scratch);
+	return errors;
+}
+
+
+//Points every island at its compiled set, compiling the sets whose buffs changed (or all of them if forced).
+static void CompileIslands(TestEmpire *t, ModifierSet *sets, long count, int force){
+	for (long i = 0; i < count; i++){
+		sets[i].dirty |= force;
+		t->islands[i].modifiers = ModifierSetCompile(&sets[i]);
+	}
+}
+
+
+/* Gives every island of the made up empire one to three buffs, then times evaluations while buffs come and
+ * go on 1 % of the islands between them: without buffs, with the sets compiled only when they changed and
+ * with every set compiled every time. Checks CheckModifiers, that sets without buffs leave the balances bit
+ * for bit as they are, that only changed sets compile, and that every compiled set matches its buffs summed
+ * up from the definition.
+ */
+static int CmdBenchModifiers(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	const ModifierDefinition *buffs = ModifierBuiltinDefinition();
+	long count = atol(argv[2]);
+	int iterations = atoi(argv[3]);
+	ChainPlan plan;
+	ModifierLibrary library;
+	Empire empire;
+	TestEmpire t;
+
+	if (count < 1 || iterations < 1){
+		PrintUsage();
+		return 2;
+	}
+	size_t balanceBytes = SESSION_COUNT * (size_t)def->goodCount * sizeof(double);
+	double *reference = malloc(balanceBytes);
+	double *vectors = malloc(3 * sizeof(double) * (size_t)def->goodCount);
+	ModifierSet *sets = calloc((size_t)count, sizeof(ModifierSet));
+	if (!reference || !vectors || !sets || !ChainPlanBuild(&plan, def) || !ModifierLibraryBuild(&library, buffs, def, &plan)
+		|| !EmpireInit(&empire, &plan, NULL) || !TestEmpireInit(&t, def, count)){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (long i = 0; i < count; i++){
+		if (!ModifierSetInit(&sets[i], &library)){
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+	}
+
+	int errors = CheckModifiers(&plan, def, &library);
+
+	EmpireEvaluate(&empire, t.islands, count);
+	memcpy(reference, empire.sessionBalance, balanceBytes);
+	CompileIslands(&t, sets, count, 0);
+	EmpireEvaluate(&empire, t.islands, count);
+	if (memcmp(reference, empire.sessionBalance, balanceBytes) != 0){
+		printf("sets without buffs changed the balances\n");
+		errors++;
+	}
+
+	unsigned long seed = 4242;
+	#define NEXT_RANDOM() (seed = seed * 6364136223846793005UL + 1442695040888963407UL, (long)(seed >> 33))
+	for (long i = 0; i < count; i++){
+		for (long k = 1 + NEXT_RANDOM() % 3; k > 0; k--){
+			ModifierSetEnable(&sets[i], (int)(NEXT_RANDOM() % buffs->buffCount), 1);
+		}
+	}
+	CompileIslands(&t, sets, count, 0);
+	long changesPerEvaluation = count / 100 > 0 ? count / 100 : 1;
+
+	//A set changed twice between two evaluations compiles once, so the sets are counted, not the changes.
+	double times[3] = {0};
+	uint64_t changedSets = 0;
+	uint64_t compiles = 0;
+	for (int mode = 0; mode < 3; mode++){
+		for (long i = 0; mode == 1 && i < count; i++){
+			compiles -= sets[i].compiles;
+		}
+		for (int it = 0; it < iterations; it++){
+			double start = NowNs();
+			for (long k = 0; mode > 0 && k < changesPerEvaluation; k++){
+				long i = NEXT_RANDOM() % count;
+				int b = (int)(NEXT_RANDOM() % buffs->buffCount);
+				ModifierSetEnable(&sets[i], b, !ModifierSetActive(&sets[i], b));
+			}
+			times[mode] += NowNs() - start;
+			for (long i = 0; mode == 1 && i < count; i++){
+				changedSets += (uint64_t)sets[i].dirty;
+			}
+
+			start = NowNs();
+			if (mode == 0){
+				for (long i = 0; i < count; i++){
+					t.islands[i].modifiers = NULL;
+				}
+			}
+			else{
+				CompileIslands(&t, sets, count, mode == 2);
+			}
+			EmpireEvaluate(&empire, t.islands, count);
+			times[mode] += NowNs() - start;
+		}
+		for (long i = 0; mode == 1 && i < count; i++){
+			compiles += sets[i].compiles;
+		}
+	}
+	#undef NEXT_RANDOM
+
+	if (compiles != changedSets){
+		printf("%llu changed sets compiled %llu times\n", (unsigned long long)changedSets, (unsigned long long)compiles);
+		errors++;
+	}
+	long mismatched = 0;
+	for (long i = 0; i < count; i++){
+		int n = def->goodCount;
+		ReferenceModifiers(&sets[i], buffs, def, &plan, vectors, vectors + n, vectors + 2 * n);
+		mismatched += memcmp(vectors, sets[i].needScale, sizeof(double) * (size_t)n) != 0
+			|| memcmp(vectors + n, sets[i].supply, sizeof(double) * (size_t)n) != 0
+			|| memcmp(vectors + 2 * n, sets[i].outputPerMinute, sizeof(double) * (size_t)n) != 0;
+	}
+	if (mismatched){
+		printf("%ld of %ld compiled sets differ from their buffs\n", mismatched, count);
+		errors++;
+	}
+
+	printf("%ld islands, %d buffs, %ld buffs toggled between evaluations:\n", count, buffs->buffCount, changesPerEvaluation);
+	printf("  without buffs          %10.3f us per evaluation\n", times[0] / iterations / 1e3);
+	printf("  compiled on change     %10.3f us per evaluation (%.1f sets compiled per evaluation)\n",
+		times[1] / iterations / 1e3, (double)compiles / iterations);
+	printf("  compiled every time    %10.3f us per evaluation\n", times[2] / iterations / 1e3);
+	printf("%d errors\n", errors);
+
+	for (long i = 0; i < count; i++){
+		ModifierSetFree(&sets[i]);
+	}
+	free(sets);
+	free(vectors);
+	free(reference);
+	TestEmpireFree(&t);
+	EmpireFree(&empire);
+	ModifierLibraryFree(&library);
+	ChainPlanFree(&plan);
+	return errors != 0;
+}
+
+
+/* Reads optimizer arguments from argv[first] on: <tier>=<residents>, blocks=<width>x<length>x<count> for
+ * farmer blocks the way the window adds them, and <building>=<most buildings> to cap a building. Returns 0
+ * on a bad argument.
+ */
+static int ParseOptimizeArgs(int argc, char **argv, int first, const ChainDefinition *def, Optimizer *opt, double *residents){
+	for (int i = first; i < argc; i++){
+		char name[64];
+		double value;
+		HousingBlock block;
+		int blocks;
+		if (sscanf(argv[i], "blocks=%dx%dx%d", &block.width, &block.length, &blocks) == 3 && blocks >= 0){
+			residents[ChainFindTier(def, "Farmers")] += (double)CalcHousesPerBlock(&block) * blocks * CALC_RESIDENTS_PER_HOUSE;
+			continue;
+		}
+		if (sscanf(argv[i], "%63[^=]=%lf", name, &value) != 2){
+			fprintf(stderr, "bad argument '%s'\n", argv[i]);
+			return 0;
+		}
+		if (ChainFindTier(def, name) >= 0){
+			residents[ChainFindTier(def, name)] += value;
+		}
+		else if (OptimizerFindRecipe(opt, name) >= 0){
+			OptimizerSetLimit(opt, OptimizerFindRecipe(opt, name), (long)value);
+		}
+		else{
+			fprintf(stderr, "'%s' is neither a tier nor a building\n", name);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+//Prints the smallest set of whole production buildings for the given population.
+static int CmdOptimize(int argc, char **argv){
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	ChainPlan plan;
+	Optimizer opt;
+	OptResult result;
+
+	if (!ChainPlanBuild(&plan, def) || !OptimizerInit(&opt, def, &plan) || !OptResultInit(&result, &opt)){
+		fprintf(stderr, "could not build the optimizer\n");
+		return 1;
+	}
+	double *residents = calloc((size_t)def->tierCount, sizeof(double));
+	if (!residents){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	if (!ParseOptimizeArgs(argc, argv, 2, def, &opt, residents)){
+		return 2;
+	}
+
+	double start = NowNs();
+	OptStatus status = OptimizerSolve(&opt, residents, &result);
+	double elapsed = NowNs() - start;
+
+	if (status != OPT_Ok){
+		fprintf(stderr, "%s\n", OptStatusName(status));
+		return 1;
+	}
+	for (int r = 0; r < opt.recipeCount; r++){
+		const OptRecipe *recipe = &opt.recipes[r];
+		if (result.buildings[r] > 0){
+			printf("%4ld x %-24s %-16s %6.1f%% busy\n", result.buildings[r], recipe->buildingName, def->goods[recipe->good].name,
+				100.0 * result.produced[r] / ((double)result.buildings[r] * recipe->outputPerMinute));
+		}
+	}
+	printf("%ld buildings (bound %ld, %s), %llu branches, %.3f ms\n", result.totalBuildings, result.lowerBound,
+		result.optimal ? "optimal" : "budget reached", (unsigned long long)result.nodes, elapsed / 1e6);
+
+	OptResultFree(&result);
+	OptimizerFree(&opt);
+	ChainPlanFree(&plan);
+	free(residents);
+	return 0;
+}
+
+
+/* Times optimizer queries with every tier populated, a different population each time so the cache does not
+ * answer, and reports the slowest one against the 5 ms an interactive answer may take.
+ */
+static int CmdBenchOptimize(int argc, char **argv){
+	if (argc < 4){
+		PrintUsage();
+		return 2;
+	}
+
+	const ChainDefinition *def = ChainBuiltinDefinition();
+	double perTier = atof(argv[2]);
+	long iterations = atol(argv[3]);
+	ChainPlan plan;
+	Optimizer opt;
+	OptResult result;
+
+	if (iterations <= 0){
+		PrintUsage();
+		return 2;
+	}
+	double start = NowNs();
+	if (!ChainPlanBuild(&plan, def) || !OptimizerInit(&opt, def, &plan) || !OptResultInit(&result, &opt)){
+		fprintf(stderr, "could not build the optimizer\n");
+		return 1;
+	}
+	double initNs = NowNs() - start;
+
+	double *residents = calloc((size_t)def->tierCount, sizeof(double));
+	if (!residents){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	if (!ParseOptimizeArgs(argc, argv, 4, def, &opt, residents)){
+		return 2;
+	}
+
+	double total = 0.0;
+	double worst = 0.0;
+	uint64_t nodes = 0;
+	long proven = 0;
+	long belowBound = 0;
+	for (long i = 0; i < iterations; i++){
+		for (int t = 0; t < def->tierCount; t++){
+			residents[t] = perTier + (double)((i * 37 + t * 101) % 1000);
+		}
+		start = NowNs();
+		OptimizerSolve(&opt, residents, &result);
+		double elapsed = NowNs() - start;
+		total += elapsed;
+		if (elapsed > worst){
+			worst = elapsed;
+		}
+		nodes += result.nodes;
+		proven += result.optimal;
+		belowBound += result.status == OPT_Ok && result.totalBuildings < result.lowerBound;
+	}
+
+	start = NowNs();
+	for (long i = 0; i < iterations; i++){
+		OptimizerSolve(&opt, residents, &result);
+	}
+	double cachedNs = (NowNs() - start) / iterations;
+
+	printf("init %.3f ms, %ld queries: mean %.3f ms, worst %.3f ms (%s 5 ms), %.0f branches per query\n",
+		initNs / 1e6, iterations, total / iterations / 1e6, worst / 1e6, worst < 5e6 ? "within" : "OVER",
+		(double)nodes / iterations);
+	printf("%ld of %ld proven optimal, %ld below the bound, cached answer %.3f us\n", proven, iterations, belowBound, cachedNs / 1e3);
+
+	OptResultFree(&result);
+	OptimizerFree(&opt);
+	ChainPlanFree(&plan);
+	free(residents);
+	return belowBound != 0;
+}
+
+
+//CPU time of the calling thread in nanoseconds, so time spent on other threads is not counted.
+static double ThreadCpuNs(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+//Formats a line the way main.c logs a window message, with a sequence number to check the order by.
+static size_t FormatLogLine(wchar_t *buffer, size_t size, long seq){
+	int chars = swprintf(buffer, size, L"[msg] hwnd=%p %ls (0x%04X) wParam=0x%p lParam=0x%p seq=%ld", (void *)0x1234,
+		L"WM_MOUSEMOVE", 0x200u, (void *)(uintptr_t)seq, (void *)(uintptr_t)(seq * 3), seq);
+	return chars > 0 ? (size_t)chars : 0;
+}
+
+
+/* Checks that the lines in a log file are in order: every "seq=" is higher than the one before it (lines
+ * may be missing where the ring was full). Returns the number of lines with a sequence number, -1 if the
+ * order is broken.
+ */
+static long CheckLogOrder(const char *path){
+	FILE *f = fopen(path, "r");
+	if (!f){
+		return -1;
+	}
+	char line[2048];
+	long lines = 0;
+	long last = -1;
+	int ordered = 1;
+	while (fgets(line, sizeof(line), f)){
+		const char *seq = strstr(line, "seq=");
+		if (seq){
+			long value = atol(seq + 4);
+			ordered &= value > last;
+			last = value;
+			lines++;
+		}
+	}
+	fclose(f);
+	return ordered ? lines : -1;
+}
+
+
+/* Floods the background log writer from one thread the way a message storm does, and compares the time per
+ * call with formatting and writing each line to a file synchronously (what the debugger output costs the
+ * UI thread without the writer). Every line has to end up either written or counted as dropped.
+ */
+static int CmdBenchLog(int argc, char **argv){
+	if (argc < 4 || argc > 6){
+		PrintUsage();
+		return 2;
+	}
+
+	long lines = atol(argv[2]);
+	const char *path = argv[3];
+	AsyncLogConfig config;
+	AsyncLogDefaultConfig(&config, path);
+	if (argc >= 5){
+		config.ringBytes = (size_t)atol(argv[4]) * 1024;
+	}
+	config.maxFileBytes = argc >= 6 ? (uint64_t)atol(argv[5]) * 1024 : 0;
+	if (lines <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	wchar_t buffer[ASYNC_LOG_MAX_CHARS];
+	char utf8[ASYNC_LOG_MAX_CHARS * 4];
+
+	//Formatting is the same in both modes, so it is timed on its own.
+	double start = NowNs();
+	size_t sink = 0;
+	for (long i = 0; i < lines; i++){
+		sink += FormatLogLine(buffer, ASYNC_LOG_MAX_CHARS, i);
+	}
+	double formatNs = (NowNs() - start) / lines;
+
+	//Synchronous baseline: format, convert and write every line on the calling thread.
+	remove(path);
+	FILE *f = fopen(path, "w");
+	if (!f){
+		fprintf(stderr, "could not open %s\n", path);
+		return 1;
+	}
+	start = NowNs();
+	for (long i = 0; i < lines; i++){
+		FormatLogLine(buffer, ASYNC_LOG_MAX_CHARS, i);
+		size_t n = wcstombs(utf8, buffer, sizeof(utf8));
+		fwrite(utf8, 1, n, f);
+		fputc('\n', f);
+		fflush(f);
+	}
+	double syncNs = (NowNs() - start) / lines;
+	fclose(f);
+
+	remove(path);
+	AsyncLog log;
+	if (!AsyncLogOpen(&log, &config)){
+		fprintf(stderr, "could not open the log %s\n", path);
+		return 1;
+	}
+	double worst = 0.0;
+	double cpuStart = ThreadCpuNs();
+	start = NowNs();
+	for (long i = 0; i < lines; i++){
+		double before = NowNs();
+		AsyncLogWrite(&log, buffer, FormatLogLine(buffer, ASYNC_LOG_MAX_CHARS, i));
+		double took = NowNs() - before;
+		if (took > worst){
+			worst = took;
+		}
+	}
+	double asyncNs = (NowNs() - start) / lines;
+	double asyncCpuNs = (ThreadCpuNs() - cpuStart) / lines;
+	AsyncLogClose(&log);
+
+	AsyncLogStats stats;
+	AsyncLogGetStats(&log, &stats);
+	long inFile = CheckLogOrder(path);
+
+	printf("formatting:  %8.1f ns per line (%zu characters)\n", formatNs, sink);
+	printf("synchronous: %8.1f ns per line, %.1f ns after formatting\n", syncNs, syncNs - formatNs);
+	printf("ring:        %8.1f ns per line, %.1f ns after formatting, slowest %.1f us\n", asyncNs, asyncNs - formatNs, worst / 1e3);
+	printf("ring:        %8.1f ns per line on the logging thread itself (CPU time, the writer thread excluded)\n", asyncCpuNs);
+	printf("%llu written, %llu dropped, %llu bytes, %llu rotations, %ld lines in the last file %s\n",
+		(unsigned long long)stats.written, (unsigned long long)stats.dropped, (unsigned long long)stats.fileBytes,
+		(unsigned long long)stats.rotations, inFile, inFile < 0 ? "OUT OF ORDER" : "in order");
+
+	return stats.written + stats.dropped != (uint64_t)lines || inFile < 0;
+}
+
+
+//The window message line of main.c as a deferred format, with the sequence number of FormatLogLine.
+static const LogFormat g_benchFormats[] = {
+	{0, LOG_LEVEL_DEBUG, "[msg] hwnd=%p %Tm (0x%04X) wParam=0x%p lParam=0x%p seq=%d"}
+};
+static const LogName g_benchNames[] = {
+	{'m', 0x200, "WM_MOUSEMOVE"}
+};
+static const LogSchema g_benchSchema = {g_benchFormats, 1, g_benchNames, 1};
+
+
+/* Runs lines through one log and returns the CPU time per line of the logging thread. Formatted lines
+ * (deferred == 0) are built with swprintf like Logfw does, deferred lines only store their arguments.
+ */
+static double RunLogFlood(AsyncLog *log, long lines, int deferred){
+	wchar_t buffer[ASYNC_LOG_MAX_CHARS];
+	double cpuStart = ThreadCpuNs();
+	for (long i = 0; i < lines; i++){
+		if (deferred){
+			const uint64_t args[] = {0x1234, 0x200, (uint64_t)i, (uint64_t)i * 3, (uint64_t)i};
+			AsyncLogWriteArgs(log, 0, args, 5);
+		}
+		else{
+			AsyncLogWrite(log, buffer, FormatLogLine(buffer, ASYNC_LOG_MAX_CHARS, i));
+		}
+	}
+	return (ThreadCpuNs() - cpuStart) / lines;
+}
+
+
+/* Compares the logging thread's cost per line of a formatted text line, a deferred line in a text file and
+ * a deferred line in a binary file, then decodes the binary file the way log_decode does and checks that
+ * every line written is in it, in order.
+ */
+static int CmdBenchBinaryLog(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+
+	long lines = atol(argv[2]);
+	const char *path = argv[3];
+	if (lines <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	static const char *modes[] = {"formatted text", "deferred, text file", "deferred, binary file"};
+	double cpuNs[3];
+	AsyncLogStats stats[3];
+	for (int mode = 0; mode < 3; mode++){
+		AsyncLogConfig config;
+		AsyncLogDefaultConfig(&config, path);
+		config.maxFileBytes = 0;
+		config.schema = &g_benchSchema;
+		config.binary = mode == 2;
+
+		AsyncLog log;
+		remove(path);
+		if (!AsyncLogOpen(&log, &config)){
+			fprintf(stderr, "could not open the log %s\n", path);
+			return 1;
+		}
+		cpuNs[mode] = RunLogFlood(&log, lines, mode > 0);
+		AsyncLogClose(&log);
+		AsyncLogGetStats(&log, &stats[mode]);
+		printf("%-22s %8.1f ns per line on the logging thread, %llu written, %llu dropped, %llu bytes\n", modes[mode], cpuNs[mode],
+			(unsigned long long)stats[mode].written, (unsigned long long)stats[mode].dropped, (unsigned long long)stats[mode].fileBytes);
+	}
+
+	//The binary file of the last run, decoded to text next to it.
+	char decodedPath[512];
+	snprintf(decodedPath, sizeof(decodedPath), "%s.txt", path);
+	FILE *in = fopen(path, "rb");
+	FILE *out = fopen(decodedPath, "w");
+	if (!in || !out){
+		fprintf(stderr, "could not open %s or %s\n", path, decodedPath);
+		if (in){
+			fclose(in);
+		}
+		if (out){
+			fclose(out);
+		}
+		return 1;
+	}
+	double start = NowNs();
+	LogDecodeStats decoded;
+	LogDecodeStatus status = LogDecodeFile(in, out, &decoded);
+	double decodeNs = NowNs() - start;
+	fclose(in);
+	fclose(out);
+
+	long inOrder = CheckLogOrder(decodedPath);
+	int ok = status == LOG_DECODE_Ok && inOrder == (long)stats[2].written && decoded.dropped == stats[2].dropped;
+	printf("decoded %llu records (%llu dropped) in %.1f ms into %s: %s, %ld lines %s\n", (unsigned long long)decoded.records,
+		(unsigned long long)decoded.dropped, decodeNs / 1e6, decodedPath, LogDecodeStatusName(status), inOrder,
+		ok ? "in order, none missing" : "MISMATCH");
+	return !ok;
+}
+
+//Window messages a synthetic session surrounds its commands with (Win32 values, see overlay.h).
+#define SESSION_WM_SETCURSOR 0x0020
+#define SESSION_WM_NCHITTEST 0x0084
+#define SESSION_WM_MOUSEMOVE 0x0200
+
+
+static int WriteSessionRecord(MsgRecorder *recorder, uint32_t *timeMs, uint32_t message, uint64_t wParam, int64_t lParam){
+	MsgRecord record = {*timeMs, message, wParam, lParam};
+	*timeMs += 16;
+	return MsgRecorderWrite(recorder, &record);
+}
+
+
+/* Writes a made up session the way main_noDebug.c --record would: Farmer Block +1/-1 clicks and spinner
+ * changes (some outside the spinner range, which the overlay clamps), each after a few mouse messages.
+ * The same seed always gives the same file.
+ */
+static int CmdGenSession(int argc, char **argv){
+	if (argc < 4 || argc > 5){
+		PrintUsage();
+		return 2;
+	}
+
+	long commands = atol(argv[3]);
+	unsigned int seed = argc == 5 ? (unsigned int)atol(argv[4]) : 12345;
+	if (commands <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	MsgRecorder recorder;
+	if (!MsgRecorderOpen(&recorder, argv[2])){
+		fprintf(stderr, "could not create %s\n", argv[2]);
+		return 1;
+	}
+
+	uint32_t timeMs = 1000;
+	int ok = 1;
+	long clicks = 0;
+	long spins = 0;
+	for (long i = 0; i < commands; i++){
+		seed = seed * 1103515245u + 12345u;
+		unsigned int r = seed >> 8;
+
+		for (unsigned int m = 0; m < 1 + r % 4; m++){
+			int64_t point = (int64_t)((100 + (r >> 4) % 200) | (100 + m * 7) << 16);
+			ok &= WriteSessionRecord(&recorder, &timeMs, SESSION_WM_NCHITTEST, 0, point);
+			ok &= WriteSessionRecord(&recorder, &timeMs, SESSION_WM_SETCURSOR, 0, 0x02000001);
+			ok &= WriteSessionRecord(&recorder, &timeMs, SESSION_WM_MOUSEMOVE, 0, point);
+		}
+
+		unsigned int kind = (r >> 10) % 10;
+		if (kind < 6){
+			int control = kind < 4 ? ID_BTN_FarmerBlockInc : ID_BTN_FarmerBlockDec;
+			ok &= WriteSessionRecord(&recorder, &timeMs, OVERLAY_WM_COMMAND, (uint64_t)control | (uint64_t)OVERLAY_BN_CLICKED << 16, 0);
+			clicks++;
+		}
+		else{
+			const SpinnerInfo *info = ControlSpinnerInfo((int)((r >> 14) % SPINNER_COUNT));
+			long value = info->minVal - 1 + (long)((r >> 16) % (unsigned int)(info->maxVal - info->minVal + 3));
+			ok &= WriteSessionRecord(&recorder, &timeMs, OVERLAY_WM_COMMAND, (uint64_t)info->field | (uint64_t)OVERLAY_EN_CHANGE << 16, value);
+			spins++;
+		}
+	}
+
+	uint64_t written = recorder.count;
+	long bytes = recorder.file ? ftell(recorder.file) : 0;
+	MsgRecorderClose(&recorder);
+	if (!ok){
+		fprintf(stderr, "could not write %s\n", argv[2]);
+		return 1;
+	}
+	printf("%s: %llu messages (%ld block clicks, %ld spinner changes), %ld bytes, %.1f bytes per message\n", argv[2],
+		(unsigned long long)written, clicks, spins, bytes, (double)bytes / (double)written);
+	return 0;
+}
+
+
+//Names the messages of a replay for LatencyDump (msg_names.c needs windows.h).
+static void ReplayMsgName(int key, char *out, size_t size){
+	const char *name = key == OVERLAY_WM_COMMAND ? "WM_COMMAND" : key == SESSION_WM_SETCURSOR ? "WM_SETCURSOR" :
+		key == SESSION_WM_NCHITTEST ? "WM_NCHITTEST" : key == SESSION_WM_MOUSEMOVE ? "WM_MOUSEMOVE" : key == 0x400 ? "(WM_USER and above)" : "";
+	snprintf(out, size, "%s (0x%04X)", name, (unsigned)key);
+}
+
+
+static void ReplayControlName(int key, char *out, size_t size){
+	snprintf(out, size, "%ls", ControlIdName(ControlIdFromIndex(key)));
+}
+
+
+/* Replays the session once more with every message timed the way main_noDebug.c does with MEASURE_LATENCY,
+ * prints the tables and returns the time per message including the timing.
+ */
+static double ReplayLatency(const MsgRecording *recording){
+
+	LatencyTable byMsg;
+	LatencyTable byControl;
+	OverlayState state;
+	OverlayReplayStats stats;
+
+	if (!LatencyInit(&byMsg, 0x400 + 1) || !LatencyInit(&byControl, CONTROL_COUNT)){
+		LatencyFree(&byMsg);
+		return 0.0;
+	}
+	memset(&stats, 0, sizeof(stats));
+	OverlayInit(&state);
+
+	double start = NowNs();
+	for (size_t i = 0; i < recording->count; i++){
+		const MsgRecord *record = &recording->records[i];
+		uint64_t before = SysNowNs();
+		OverlayReplay(&state, record, 1, &stats);
+		uint64_t elapsed = SysNowNs() - before;
+		LatencyAdd(&byMsg, record->message < 0x400 ? (int)record->message : 0x400, elapsed);
+		if (record->message == OVERLAY_WM_COMMAND){
+			LatencyAdd(&byControl, ControlIndexFromId((int)(record->wParam & 0xFFFF)), elapsed);
+		}
+	}
+	double perMessage = (NowNs() - start) / (double)(recording->count ? recording->count : 1);
+
+	LatencyDump(&byMsg, "replay by message:", ReplayMsgName, stdout);
+	LatencyDump(&byControl, "WM_COMMAND by control:", ReplayControlName, stdout);
+
+	OverlayFree(&state);
+	LatencyFree(&byMsg);
+	LatencyFree(&byControl);
+	return perMessage;
+}
+
+
+/* Replays a recorded session through the overlay logic, the given number of times from a fresh state, and
+ * checks that every run renders exactly the same display texts. With "latency" the session is replayed
+ * once more with per-message histograms.
+ */
+static int CmdReplay(int argc, char **argv){
+	if (argc < 3 || argc > 5){
+		PrintUsage();
+		return 2;
+	}
+
+	int latency = strcmp(argv[argc - 1], "latency") == 0;
+	long iterations = argc - latency >= 4 ? atol(argv[3]) : 1;
+	if (iterations <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	MsgRecording recording;
+	MsgRecordStatus status = MsgRecordingLoad(&recording, argv[2]);
+	if (status != MSG_RECORD_Ok && status != MSG_RECORD_Truncated){
+		fprintf(stderr, "%s: %s\n", argv[2], MsgRecordStatusName(status));
+		return 1;
+	}
+	if (status == MSG_RECORD_Truncated){
+		fprintf(stderr, "%s: %s, replaying the %zu complete messages\n", argv[2], MsgRecordStatusName(status), recording.count);
+	}
+
+	OverlayReplayStats first;
+	OverlayState state;
+	int blocks = 0;
+	Demand demand;
+	int deterministic = 1;
+	double best = 0.0;
+	for (long it = 0; it < iterations; it++){
+		OverlayReplayStats stats;
+		memset(&stats, 0, sizeof(stats));
+		OverlayInit(&state);
+		double start = NowNs();
+		OverlayReplay(&state, recording.records, recording.count, &stats);
+		double elapsed = NowNs() - start;
+		if (it == 0 || elapsed < best){
+			best = elapsed;
+		}
+		if (it == 0){
+			first = stats;
+			blocks = state.farmerBlocks.blockCount;
+			DemandAggResult(&state.farmerBlocks, &demand);
+		}
+		else{
+			deterministic &= stats.displayHash == first.displayHash && stats.refreshes == first.refreshes;
+		}
+		OverlayFree(&state);
+	}
+
+	printf("%zu messages, %llu commands, %llu display refreshes, %d blocks at the end\n", recording.count,
+		(unsigned long long)first.commands, (unsigned long long)first.refreshes, blocks);
+	for (int g = 0; g < GOOD_COUNT; g++){
+		printf("  %-20s %10.4f t/min %8.2f buildings\n", CalcGoodInfo((Good)g)->name, demand.tonsPerMinute[g], demand.buildings[g]);
+	}
+	printf("best of %ld: %.3f ms, %.1f ns per message, %.1f ns per command\n", iterations, best / 1e6,
+		best / (double)(recording.count ? recording.count : 1), best / (double)(first.commands ? first.commands : 1));
+	printf("display hash %08X, %s\n", (unsigned)first.displayHash, deterministic ? "identical in every run" : "DIFFERS BETWEEN RUNS");
+
+	if (latency){
+		double timed = ReplayLatency(&recording);
+		printf("timed replay: %.1f ns per message, %.1f ns more than untimed\n", timed,
+			timed - best / (double)(recording.count ? recording.count : 1));
+	}
+
+	MsgRecordingFree(&recording);
+	return !deterministic;
+}
+
+//Hands the commands of the headless message queue to the overlay, as MainWndProc's WM_COMMAND does.
+static void UiFlowCommand(void *user, int controlId, int notifyCode){
+	OverlayUiCommand(user, controlId, notifyCode);
+}
+
+
+//The scheduled display flush, as FlushDisplays in main_noDebug.c does.
+static void UiFlowFlush(void *user){
+	OverlayUiFlush(user);
+}
+
+
+/* Checks the headless controls against the overlay state: every display shows OverlayDisplayText and every
+ * spinner value is what its text field holds (clamped to the range). Returns the number of mismatches.
+ */
+static int CheckUiFlow(OverlayUi *ui, UiHeadless *headless){
+	int mismatches = 0;
+	for (int i = 0; i < CONTROL_COUNT; i++){
+		int id = ControlIdFromIndex(i);
+		UiHeadlessControl *control = UiHeadlessFind(headless, id);
+		if (!control){
+			continue;
+		}
+		if (ControlKindFromId(id) == CONTROL_Display){
+			wchar_t expected[OVERLAY_DISPLAY_CHARS];
+			OverlayDisplayText(&ui->state, (Good)ControlDisplayGood(id), expected, OVERLAY_DISPLAY_CHARS);
+			if (wcscmp(control->text, expected) != 0){
+				fprintf(stderr, "%ls shows \"%ls\", expected \"%ls\"\n", ControlIdName(id), control->text, expected);
+				mismatches++;
+			}
+		}
+		else if (ControlKindFromId(id) == CONTROL_Spinner){
+			const SpinnerInfo *info = ControlSpinnerInfo(ControlSpinnerIndex(id));
+			long typed = wcstol(UiHeadlessFind(headless, info->field)->text, NULL, 10);
+			typed = typed < info->minVal ? info->minVal : typed > info->maxVal ? info->maxVal : typed;
+			if (ui->state.spinnerPos[ControlSpinnerIndex(id)] != typed || control->pos != typed){
+				fprintf(stderr, "%ls is at %d (state %d), its field says %ld\n", ControlIdName(id), control->pos,
+					ui->state.spinnerPos[ControlSpinnerIndex(id)], typed);
+				mismatches++;
+			}
+		}
+	}
+	return mismatches;
+}
+
+
+/* Opens the overlay window on the headless backend and drives it like a user would: Farmer Block clicks,
+ * spinner arrow clicks (also against the ends of the range) and numbers typed into the fields, pumping
+ * the queue after each. The actions come in bursts a few milliseconds apart with longer pauses between,
+ * on the headless clock. Checks the controls against the overlay state and prints the cost per command,
+ * the windowing calls it took and the display writes the frame interval saved (frame ms 0 writes after
+ * every command).
+ */
+static int CmdUiFlow(int argc, char **argv){
+	if (argc < 3 || argc > 5){
+		PrintUsage();
+		return 2;
+	}
+
+	long commands = atol(argv[2]);
+	unsigned int seed = argc >= 4 ? (unsigned int)atol(argv[3]) : 12345;
+	int frameMs = argc == 5 ? atoi(argv[4]) : OVERLAY_UI_FRAME_MS;
+	if (commands <= 0 || frameMs < 0){
+		PrintUsage();
+		return 2;
+	}
+
+	UiHeadless *headless = malloc(sizeof(*headless));
+	if (!headless){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	OverlayUi ui;
+	UiHeadlessInit(headless, UiFlowCommand, UiFlowFlush, &ui);
+	OverlayUiInit(&ui, &headless->backend);
+	ui.frameMs = frameMs;
+	if (!OverlayUiOpen(&ui)){
+		fprintf(stderr, "could not create the controls\n");
+		OverlayUiFree(&ui);
+		free(headless);
+		return 1;
+	}
+	UiHeadlessPump(headless);
+	UiHeadlessStats opened = headless->stats;
+	uint64_t openedWrites = ui.view.stats.writes;
+
+	long clicks = 0;
+	long spins = 0;
+	long typed = 0;
+	double start = NowNs();
+	for (long i = 0; i < commands; i++){
+		seed = seed * 1103515245u + 12345u;
+		unsigned int r = seed >> 8;
+		unsigned int kind = r % 10;
+		const SpinnerInfo *info = ControlSpinnerInfo((int)((r >> 4) % SPINNER_COUNT));
+
+		if (kind < 6){
+			UiHeadlessClick(headless, kind < 4 ? ID_BTN_FarmerBlockInc : ID_BTN_FarmerBlockDec);
+			clicks++;
+		}
+		else if (kind < 9){
+			UiHeadlessSpin(headless, info->spinner, (r >> 8) & 1 ? 1 : -1);
+			spins++;
+		}
+		else{
+			wchar_t text[16];
+			swprintf(text, 16, L"%ld", info->minVal - 1 + (long)((r >> 8) % (unsigned int)(info->maxVal - info->minVal + 3)));
+			UiHeadlessType(headless, info->field, text);
+			typed++;
+		}
+		UiHeadlessPump(headless);
+		UiHeadlessAdvance(headless, (r >> 12) % 5 ? 5 + (r >> 16) % 30 : 100 + (r >> 16) % 500);
+	}
+	UiHeadlessAdvance(headless, (uint32_t)frameMs);
+	double elapsed = NowNs() - start;
+
+	int mismatches = CheckUiFlow(&ui, headless);
+	UiHeadlessStats s = headless->stats;
+	double perCommand = (double)(s.dispatched - opened.dispatched ? s.dispatched - opened.dispatched : 1);
+	printf("opened: %llu controls created, %llu texts set\n", (unsigned long long)opened.creates, (unsigned long long)opened.setTexts);
+	printf("%ld commands (%ld block clicks, %ld spinner clicks, %ld typed values), %llu dispatched, %llu dropped, %d blocks at the end\n",
+		commands, clicks, spins, typed, (unsigned long long)(s.dispatched - opened.dispatched), (unsigned long long)s.dropped,
+		ui.state.farmerBlocks.blockCount);
+	printf("%.1f ns per user action, %.1f ns per dispatched command\n", elapsed / (double)commands, elapsed / perCommand);
+	printf("per dispatched command: %.2f setText (%.1f chars), %.2f spinner reads\n",
+		(double)(s.setTexts - opened.setTexts) / perCommand, (double)(s.textChars - opened.textChars) / perCommand,
+		(double)(s.spinnerReads - opened.spinnerReads) / perCommand);
+	const OverlayViewStats *v = &ui.view.stats;
+	printf("frame %d ms: %llu display updates, %llu flushes, %llu texts formatted, %llu unchanged, %llu written\n", frameMs,
+		(unsigned long long)(v->updates - 1), (unsigned long long)(v->flushes - 1), (unsigned long long)(v->formatted - GOOD_COUNT),
+		(unsigned long long)v->unchanged, (unsigned long long)(v->writes - openedWrites));
+	printf("setText calls saved: %llu of %llu (%llu coalesced in a frame)\n", (unsigned long long)OverlayViewSaved(&ui.view),
+		(unsigned long long)((v->updates - 1) * GOOD_COUNT), (unsigned long long)v->coalesced);
+	printf("controls %s the overlay state\n", mismatches ? "DIFFER FROM" : "match");
+
+	OverlayUiFree(&ui);
+	free(headless);
+	return mismatches != 0;
+}
+
+/* Golden image scenes for raster-check. Each draws into a surface cleared to 0 (fully transparent).
+ */
+static void SceneOverlay(RasterSurface *s, const double buildings[GOOD_COUNT]){
+	OverlayRender render;
+	if (OverlayRenderInit(&render, s->pixels, s->stride)){
+		OverlayRenderUpdate(&render, buildings);
+	}
+	OverlayRenderFree(&render);
+}
+
+
+static void ScenePanel(RasterSurface *s){
+	static const double buildings[GOOD_COUNT] = {1.25, 0.5, 3.0};
+	SceneOverlay(s, buildings);
+}
+
+
+//Three updates, each redrawing only the boxes that changed; must end up equal to a full draw.
+static void SceneIncremental(RasterSurface *s){
+	static const double steps[3][GOOD_COUNT] = {{0.0, 0.0, 0.0}, {2.75, 0.0, 0.3}, {2.75, 1.6, 0.3}};
+	OverlayRender render;
+	if (OverlayRenderInit(&render, s->pixels, s->stride)){
+		for (int i = 0; i < 3; i++){
+			OverlayRenderUpdate(&render, steps[i]);
+		}
+	}
+	OverlayRenderFree(&render);
+}
+
+
+//Every alpha value as a solid colour (top half) and in an image with per-pixel alpha (bottom half).
+static void SceneAlpha(RasterSurface *s){
+
+	for (int y = 0; y < s->height; y += 8){
+		for (int x = 0; x < s->width; x += 8){
+			RasterFill(s, (RasterRect){x, y, 8, 8}, ((x + y) / 8) % 2 ? RASTER_ARGB(255, 230, 230, 230) : RASTER_ARGB(255, 40, 60, 90));
+		}
+	}
+	for (int a = 0; a < 256; a++){
+		RasterBlendRect(s, (RasterRect){a, 0, 1, s->height / 2}, RASTER_ARGB(a, a * 200 / 255, a * 100 / 255, a * 50 / 255));
+	}
+
+	uint32_t pixels[256 * 4];
+	RasterSurface image = {pixels, 256, 4, 256};
+	for (int y = 0; y < 4; y++){
+		for (int x = 0; x < 256; x++){
+			unsigned int a = (unsigned int)(255 - x) ^ (unsigned int)(y * 37);
+			a &= 255;
+			pixels[y * 256 + x] = RASTER_ARGB(a, a * (unsigned int)x / 255, a / 2, a * (unsigned int)(255 - x) / 255);
+		}
+	}
+	for (int y = s->height / 2; y < s->height; y += 4){
+		RasterBlendImage(s, 0, y, &image);
+	}
+}
+
+
+//Odd sizes, odd offsets and clipping, so the SIMD loops end in every possible tail.
+static void SceneEdges(RasterSurface *s){
+	for (int i = 0; i < 24; i++){
+		RasterRect r = {i * 5 - 7, i * 3 - 4, 1 + i % 13, 3 + i % 7 * 4};
+		RasterBlendRect(s, r, RASTER_ARGB(40 + i * 9, 30 + i * 7, 20 + i * 3, 40 + i * 2));
+		RasterFrame(s, (RasterRect){r.x + 2, r.y + 1, r.width + 5, r.height}, RASTER_ARGB(200, 180, 20 + i, 90));
+	}
+	uint32_t pixels[13 * 9];
+	RasterSurface image = {pixels, 13, 9, 13};
+	for (int i = 0; i < 13 * 9; i++){
+		unsigned int a = (unsigned int)(i * 29) & 255;
+		pixels[i] = RASTER_ARGB(a, a / 3, a, a / 2);
+	}
+	for (int i = 0; i < 9; i++){
+		RasterBlendImage(s, i * 8 - 5, i * 5 - 3, &image);
+	}
+}
+
+
+/* Every font at sizes from 5 to the largest, whole multiples of the design (crisp) and between them
+ * (antialiased), opaque and translucent, with a codepoint the font does not have. Each line is drawn twice,
+ * the second time from the atlas. Returns the glyphs evicted, which is 0 unless the atlas is small.
+ */
+static uint64_t DrawTextScene(RasterSurface *s, int atlasSize){
+	static const struct {
+		GlyphFont font;
+		int size;
+		const wchar_t *text;
+		uint32_t color;
+	} lines[] = {
+		{GLYPH_FONT_Regular,	5,		L"The quick brown fox 0123456789",	RASTER_ARGB(0xFF, 0xFF, 0xFF, 0xFF)},
+		{GLYPH_FONT_Regular,	8,		L"Required Fish:\r\n12.50 buildings",	RASTER_ARGB(0xFF, 0xD8, 0xD8, 0xD8)},
+		{GLYPH_FONT_Bold,	8,		L"Required Schnapps: 0.33",		RASTER_ARGB(0xFF, 0xF0, 0xC8, 0x60)},
+		{GLYPH_FONT_Regular,	11,		L"Work Clothes 3.75",			RASTER_ARGB(0x80, 0x80, 0x80, 0x80)},
+		{GLYPH_FONT_Bold,	14,		L"Wx@&%? {~}",				RASTER_ARGB(0xFF, 0x40, 0xB0, 0x40)},
+		{GLYPH_FONT_Regular,	20,		L"Ag9 \u00E9",				RASTER_ARGB(0xC0, 0xC0, 0x60, 0x20)},
+		{GLYPH_FONT_Bold,	GLYPH_MAX_SIZE,	L"M!",					RASTER_ARGB(0xFF, 0xC8, 0xA0, 0x50)},
+	};
+
+	GlyphCache cache;
+	if (!GlyphCacheInit(&cache, atlasSize)){
+		return 0;
+	}
+	RasterFill(s, (RasterRect){0, 0, s->width, s->height}, RASTER_ARGB(0xB0, 0x10, 0x10, 0x18));
+	for (int pass = 0; pass < 2; pass++){
+		int y = 2;
+		for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++){
+			GlyphCacheText(&cache, s, lines[i].font, lines[i].size, lines[i].text, 2 + pass, y, lines[i].color);
+			y += GlyphFontLineHeight(lines[i].size) * (wcschr(lines[i].text, L'\n') ? 2 : 1);
+		}
+	}
+	uint64_t evicted = cache.stats.evicted;
+	GlyphCacheFree(&cache);
+	return evicted;
+}
+
+
+static void SceneText(RasterSurface *s){
+	DrawTextScene(s, 0);
+}
+
+
+typedef struct RasterScene {
+	const char *name;
+	int width;
+	int height;
+	void (*draw)(RasterSurface *s);
+} RasterScene;
+
+static const RasterScene g_rasterScenes[] = {
+	{"panel",	OVERLAY_RENDER_WIDTH,	OVERLAY_RENDER_HEIGHT,	ScenePanel},
+	{"incremental",	OVERLAY_RENDER_WIDTH,	OVERLAY_RENDER_HEIGHT,	SceneIncremental},
+	{"alpha",	256,			64,			SceneAlpha},
+	{"edges",	67,			45,			SceneEdges},
+	{"text",	260,			130,			SceneText},
+};
+#define RASTER_SCENE_COUNT (int)(sizeof(g_rasterScenes) / sizeof(g_rasterScenes[0]))
+
+
+//FNV-1a over the pixels, byte by byte in memory order (B G R A).
+static uint32_t HashPixels(const RasterSurface *s){
+	uint32_t hash = 2166136261u;
+	for (int y = 0; y < s->height; y++){
+		for (int x = 0; x < s->width; x++){
+			uint32_t p = s->pixels[(size_t)y * s->stride + x];
+			for (int b = 0; b < 32; b += 8){
+				hash = (hash ^ ((p >> b) & 255)) * 16777619u;
+			}
+		}
+	}
+	return hash;
+}
+
+
+//Writes the surface as a PAM image (RGB_ALPHA, not premultiplied), which most image viewers open.
+static int WritePam(const char *path, const RasterSurface *s){
+	FILE *f = fopen(path, "wb");
+	if (!f){
+		return 0;
+	}
+	fprintf(f, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", s->width, s->height);
+	for (int y = 0; y < s->height; y++){
+		for (int x = 0; x < s->width; x++){
+			uint32_t p = s->pixels[(size_t)y * s->stride + x];
+			unsigned int a = p >> 24;
+			unsigned char rgba[4] = {0, 0, 0, (unsigned char)a};
+			for (int c = 0; c < 3 && a; c++){
+				unsigned int v = (p >> (16 - 8 * c)) & 255;
+				v = (v * 255 + a / 2) / a;
+				rgba[c] = (unsigned char)(v > 255 ? 255 : v);
+			}
+			fwrite(rgba, 1, 4, f);
+		}
+	}
+	return fclose(f) == 0;
+}
+
+
+static uint32_t *RenderScene(const RasterScene *scene, RasterSurface *s){
+	s->pixels = calloc((size_t)scene->width * (size_t)scene->height, sizeof(uint32_t));
+	s->width = scene->width;
+	s->height = scene->height;
+	s->stride = scene->width;
+	if (s->pixels){
+		scene->draw(s);
+	}
+	return s->pixels;
+}
+
+
+/* Renders every golden scene with every raster backend the CPU supports and checks that all of them give
+ * the same pixels and that the pixels hash to the values in the golden file. With "write" the golden file
+ * is written from the scalar backend instead; with an image dir every scene is also saved there as a PAM.
+ */
+static int CmdRasterCheck(int argc, char **argv){
+	if (argc < 3 || argc > 5){
+		PrintUsage();
+		return 2;
+	}
+
+	const char *goldenPath = argv[2];
+	int write = argc >= 4 && strcmp(argv[3], "write") == 0;
+	const char *imageDir = argc == 5 ? argv[4] : (argc == 4 && !write ? argv[3] : NULL);
+
+	uint32_t golden[RASTER_SCENE_COUNT];
+	int haveGolden[RASTER_SCENE_COUNT] = {0};
+	if (!write){
+		FILE *f = fopen(goldenPath, "r");
+		if (!f){
+			fprintf(stderr, "cannot open %s\n", goldenPath);
+			return 1;
+		}
+		char line[256];
+		while (fgets(line, sizeof(line), f)){
+			char name[64];
+			int width, height;
+			unsigned int hash;
+			if (line[0] == '#' || sscanf(line, "%63s %d %d %x", name, &width, &height, &hash) != 4){
+				continue;
+			}
+			for (int i = 0; i < RASTER_SCENE_COUNT; i++){
+				if (strcmp(name, g_rasterScenes[i].name) == 0 && width == g_rasterScenes[i].width && height == g_rasterScenes[i].height){
+					golden[i] = hash;
+					haveGolden[i] = 1;
+				}
+			}
+		}
+		fclose(f);
+	}
+
+	FILE *out = NULL;
+	if (write){
+		out = fopen(goldenPath, "w");
+		if (!out){
+			fprintf(stderr, "cannot create %s\n", goldenPath);
+			return 1;
+		}
+		fprintf(out, "# raster golden images: scene width height FNV-1a of the pixels (anno_calc raster-check)\n");
+	}
+
+	RasterBackend initial = RasterCurrentBackend();
+	int failures = 0;
+	for (int i = 0; i < RASTER_SCENE_COUNT; i++){
+		const RasterScene *scene = &g_rasterScenes[i];
+
+		RasterUseBackend(RASTER_Scalar);
+		RasterSurface reference;
+		if (!RenderScene(scene, &reference)){
+			fprintf(stderr, "out of memory\n");
+			failures++;
+			break;
+		}
+		uint32_t hash = HashPixels(&reference);
+		printf("%-12s %3dx%-3d %08X", scene->name, scene->width, scene->height, (unsigned)hash);
+
+		if (write){
+			fprintf(out, "%s %d %d %08X\n", scene->name, scene->width, scene->height, (unsigned)hash);
+		}
+		else if (!haveGolden[i]){
+			printf("  not in %s", goldenPath);
+			failures++;
+		}
+		else if (golden[i] != hash){
+			printf("  DIFFERS from golden %08X", (unsigned)golden[i]);
+			failures++;
+		}
+
+		for (int b = RASTER_Scalar + 1; b < RASTER_BACKEND_COUNT; b++){
+			if (!RasterUseBackend((RasterBackend)b)){
+				printf("  %s: not supported", RasterBackendName((RasterBackend)b));
+				continue;
+			}
+			RasterSurface simd;
+			if (!RenderScene(scene, &simd)){
+				continue;
+			}
+			size_t pixels = (size_t)scene->width * (size_t)scene->height;
+			size_t differ = 0;
+			for (size_t p = 0; p < pixels; p++){
+				differ += simd.pixels[p] != reference.pixels[p];
+			}
+			printf(differ ? "  %s: %zu PIXELS DIFFER" : "  %s: identical", RasterBackendName((RasterBackend)b), differ);
+			failures += differ != 0;
+			free(simd.pixels);
+		}
+		printf("\n");
+
+		if (imageDir){
+			char path[1024];
+			snprintf(path, sizeof(path), "%s/%s.pam", imageDir, scene->name);
+			if (!WritePam(path, &reference)){
+				fprintf(stderr, "cannot write %s\n", path);
+			}
+		}
+		free(reference.pixels);
+	}
+	RasterUseBackend(initial);
+
+	//The incremental scene has to match a full draw of its last step.
+	{
+		RasterSurface full, incremental;
+		static const double last[GOOD_COUNT] = {2.75, 1.6, 0.3};
+		full.pixels = calloc((size_t)OVERLAY_RENDER_WIDTH * OVERLAY_RENDER_HEIGHT, sizeof(uint32_t));
+		full.width = full.stride = OVERLAY_RENDER_WIDTH;
+		full.height = OVERLAY_RENDER_HEIGHT;
+		if (full.pixels && RenderScene(&g_rasterScenes[1], &incremental)){
+			SceneOverlay(&full, last);
+			int same = HashPixels(&full) == HashPixels(&incremental) &&
+				memcmp(full.pixels, incremental.pixels, (size_t)OVERLAY_RENDER_WIDTH * OVERLAY_RENDER_HEIGHT * sizeof(uint32_t)) == 0;
+			printf("incremental redraw %s a full redraw\n", same ? "equals" : "DIFFERS FROM");
+			failures += !same;
+			free(incremental.pixels);
+		}
+		free(full.pixels);
+	}
+
+	//Text drawn from an atlas too small for all of it (glyphs evicted and rasterized again) looks the same.
+	{
+		const RasterScene *scene = &g_rasterScenes[RASTER_SCENE_COUNT - 1];
+		RasterSurface cached, evicting;
+		evicting.pixels = calloc((size_t)scene->width * scene->height, sizeof(uint32_t));
+		evicting.width = evicting.stride = scene->width;
+		evicting.height = scene->height;
+		if (evicting.pixels && RenderScene(scene, &cached)){
+			uint64_t evicted = DrawTextScene(&evicting, 6 * GLYPH_CELL_SIZE);
+			int same = evicted > 0 && memcmp(cached.pixels, evicting.pixels, (size_t)scene->width * scene->height * sizeof(uint32_t)) == 0;
+			printf("text with %llu glyphs evicted %s text from a full atlas\n", (unsigned long long)evicted, same ? "equals" : "DIFFERS FROM");
+			failures += !same;
+			free(cached.pixels);
+		}
+		free(evicting.pixels);
+	}
+
+	if (out && fclose(out) != 0){
+		fprintf(stderr, "cannot write %s\n", goldenPath);
+		return 1;
+	}
+	if (write){
+		printf("wrote %s\n", goldenPath);
+	}
+	else{
+		printf(failures ? "%d FAILURES\n" : "all scenes match\n", failures);
+	}
+	return failures != 0;
+}
+
+
+/* Times the overlay drawing with every supported raster backend: the whole panel, one changed box (what a
+ * click costs) and a translucent blend over a 1920x1080 surface for raw throughput.
+ */
+static int CmdBenchRaster(int argc, char **argv){
+	if (argc != 3){
+		PrintUsage();
+		return 2;
+	}
+	long frames = atol(argv[2]);
+	if (frames <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	uint32_t *panel = calloc((size_t)OVERLAY_RENDER_WIDTH * OVERLAY_RENDER_HEIGHT, sizeof(uint32_t));
+	RasterSurface screen = {calloc((size_t)1920 * 1080, sizeof(uint32_t)), 1920, 1080, 1920};
+	if (!panel || !screen.pixels){
+		fprintf(stderr, "out of memory\n");
+		free(panel);
+		free(screen.pixels);
+		return 1;
+	}
+
+	RasterBackend initial = RasterCurrentBackend();
+	printf("best backend: %s\n", RasterBackendName(RasterBestBackend()));
+	for (int b = 0; b < RASTER_BACKEND_COUNT; b++){
+		if (!RasterUseBackend((RasterBackend)b)){
+			printf("%-7s not supported\n", RasterBackendName((RasterBackend)b));
+			continue;
+		}
+
+		OverlayRender render;
+		if (!OverlayRenderInit(&render, panel, OVERLAY_RENDER_WIDTH)){
+			fprintf(stderr, "out of memory\n");
+			break;
+		}
+		double buildings[GOOD_COUNT] = {0};
+		double start = NowNs();
+		for (long f = 0; f < frames; f++){
+			buildings[0] = (double)(f % 97) / 8.0;
+			OverlayRenderInvalidate(&render);
+			OverlayRenderUpdate(&render, buildings);
+		}
+		double full = (NowNs() - start) / (double)frames;
+
+		start = NowNs();
+		for (long f = 0; f < frames; f++){
+			buildings[f % GOOD_COUNT] += 0.125;
+			OverlayRenderUpdate(&render, buildings);
+			RasterDirtyClear(&render.dirty);
+		}
+		double one = (NowNs() - start) / (double)frames;
+
+		long screenFrames = frames / 100 > 0 ? frames / 100 : 1;
+		start = NowNs();
+		for (long f = 0; f < screenFrames; f++){
+			RasterBlendRect(&screen, (RasterRect){0, 0, 1920, 1080}, RASTER_ARGB(0x80, 0x10, 0x20, 0x30 + f % 16));
+		}
+		double blend = (NowNs() - start) / (double)screenFrames;
+
+		printf("%-7s panel %7.2f us, one box %6.2f us, 1920x1080 blend %6.3f ms (%.0f Mpixel/s)\n", RasterBackendName((RasterBackend)b),
+			full / 1e3, one / 1e3, blend / 1e6, 1920.0 * 1080.0 / (blend / 1e3));
+		OverlayRenderFree(&render);
+	}
+	RasterUseBackend(initial);
+
+	free(panel);
+	free(screen.pixels);
+	return 0;
+}
+
+/* The display texts the way they were drawn without the atlas: every glyph rasterized again for every
+ * string, into a scratch cell, and blended from there.
+ */
+static void DrawTextUncached(RasterSurface *s, GlyphFont font, int size, const wchar_t *text, int x, int y, uint32_t color){
+	static uint8_t cell[GLYPH_CELL_SIZE * GLYPH_CELL_SIZE];
+	int penX = x;
+	for (; *text; text++){
+		if (*text == L'\r'){
+			continue;
+		}
+		if (*text == L'\n'){
+			penX = x;
+			y += GlyphFontLineHeight(size);
+			continue;
+		}
+		GlyphMetrics m = GlyphFontRasterize(font, size, (uint32_t)*text, cell, GLYPH_CELL_SIZE);
+		if (!m.empty){
+			RasterBlendMask(s, penX, y, cell, GLYPH_CELL_SIZE, m.width, m.height, color);
+		}
+		penX += m.advance;
+	}
+}
+
+
+/* Times the text of the overlay panel: every display text of every good with changing values, drawn from
+ * the glyph atlas and rasterized directly. After the first frame the atlas has every glyph, so steady state
+ * must not rasterize any; a small atlas with more sizes than it holds shows what eviction costs.
+ */
+static int CmdBenchText(int argc, char **argv){
+	if (argc != 3){
+		PrintUsage();
+		return 2;
+	}
+	long frames = atol(argv[2]);
+	if (frames <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	uint32_t *pixels = calloc((size_t)OVERLAY_RENDER_WIDTH * OVERLAY_RENDER_HEIGHT, sizeof(uint32_t));
+	RasterSurface s = {pixels, OVERLAY_RENDER_WIDTH, OVERLAY_RENDER_HEIGHT, OVERLAY_RENDER_WIDTH};
+	GlyphCache cache, small;
+	if (!pixels || !GlyphCacheInit(&cache, 0) || !GlyphCacheInit(&small, 6 * GLYPH_CELL_SIZE)){
+		fprintf(stderr, "out of memory\n");
+		free(pixels);
+		return 1;
+	}
+
+	const int textValues = 1000;
+
+	//One frame: the label and the value line of every good, each a batch, at the sizes given.
+	#define TEXT_FRAME(draw, sizeOf) \
+		for (int g = 0; g < GOOD_COUNT; g++){ \
+			wchar_t text[OVERLAY_DISPLAY_CHARS]; \
+			OverlayFormatDisplay((Good)g, (double)((f * 7 + g * 13) % textValues) / 8.0, text, OVERLAY_DISPLAY_CHARS); \
+			RasterRect box = OverlayRenderBox((Good)g); \
+			draw(GLYPH_FONT_Regular, sizeOf(g), text, box.x + 6, box.y + 6, RASTER_ARGB(0xFF, 0xD8, 0xD8, 0xD8)); \
+		}
+	#define CACHED(font, size, text, x, y, color) GlyphCacheText(&cache, &s, font, size, text, x, y, color)
+	#define SMALL(font, size, text, x, y, color) GlyphCacheText(&small, &s, font, size, text, x, y, color)
+	#define UNCACHED(font, size, text, x, y, color) DrawTextUncached(&s, font, size, text, x, y, color)
+	#define PANEL_SIZE(g) GLYPH_FONT_EM
+	#define MIXED_SIZE(g) (GLYPH_FONT_EM + (int)(f + g) % 4)
+
+	//The values repeat every textValues frames, so after one cycle the atlas holds every glyph they need.
+	long f;
+	uint64_t first = 0;
+	for (f = 0; f < textValues; f++){
+		TEXT_FRAME(CACHED, PANEL_SIZE)
+		if (f == 0){
+			first = cache.stats.rasterized;
+		}
+	}
+	uint64_t cold = cache.stats.rasterized;
+	GlyphCacheStats warm = cache.stats;
+
+	double start = NowNs();
+	for (f = textValues; f < textValues + frames; f++){
+		TEXT_FRAME(CACHED, PANEL_SIZE)
+	}
+	double cached = (NowNs() - start) / (double)frames;
+	uint64_t steady = cache.stats.rasterized - warm.rasterized;
+
+	start = NowNs();
+	for (f = textValues; f < textValues + frames; f++){
+		TEXT_FRAME(UNCACHED, PANEL_SIZE)
+	}
+	double uncached = (NowNs() - start) / (double)frames;
+
+	start = NowNs();
+	for (f = textValues; f < textValues + frames; f++){
+		TEXT_FRAME(SMALL, MIXED_SIZE)
+	}
+	double churn = (NowNs() - start) / (double)frames;
+
+	#undef TEXT_FRAME
+	#undef CACHED
+	#undef SMALL
+	#undef UNCACHED
+	#undef PANEL_SIZE
+	#undef MIXED_SIZE
+
+	const GlyphCacheStats *c = &cache.stats;
+	printf("backend %s, %d display texts per frame\n", RasterBackendName(RasterCurrentBackend()), GOOD_COUNT);
+	printf("first frame: %llu glyphs rasterized, %llu after the first %d frames\n", (unsigned long long)first, (unsigned long long)cold, textValues);
+	printf("atlas     %8.2f us/frame, %llu lookups, %llu hits, %llu rasterized after warm-up, %.1f quads per batch\n",
+		cached / 1e3, (unsigned long long)(c->lookups - warm.lookups), (unsigned long long)(c->hits - warm.hits), (unsigned long long)steady,
+		(double)(c->quads - warm.quads) / (double)(c->batches - warm.batches));
+	printf("no atlas  %8.2f us/frame (%.1fx the atlas)\n", uncached / 1e3, uncached / cached);
+	printf("36 cells  %8.2f us/frame with 4 sizes: %llu hits, %llu rasterized, %llu evicted\n", churn / 1e3,
+		(unsigned long long)small.stats.hits, (unsigned long long)small.stats.rasterized, (unsigned long long)small.stats.evicted);
+	printf("steady state %s\n", steady ? "RASTERIZED GLYPHS" : "rasterized nothing");
+
+	GlyphCacheFree(&cache);
+	GlyphCacheFree(&small);
+	free(pixels);
+	return steady != 0;
+}
+
+/* Draws value in the built-in font at size over a noisy gradient, the way a HUD number looks in a capture.
+ * Returns the frame as RGB (free it with PngFree), 0 if out of memory.
+ */
+static int RenderHudFrame(const char *value, int size, uint32_t textColor, int background, int noise, uint32_t seed, PngImage *frame){
+
+	int pad = size / 2;
+	int digits = (int)strlen(value);
+	int width = 2 * pad + digits * GlyphFontMeasure(GLYPH_FONT_Regular, size, '0').advance;
+	int height = 2 * pad + GlyphFontMeasure(GLYPH_FONT_Regular, size, '0').height;
+
+	uint32_t *pixels = malloc(sizeof(uint32_t) * (size_t)width * (size_t)height);
+	frame->pixels = malloc((size_t)width * (size_t)height * 3);
+	GlyphCache cache;
+	if (!pixels || !frame->pixels || !GlyphCacheInit(&cache, 0)){
+		free(pixels);
+		PngFree(frame);
+		return 0;
+	}
+	frame->width = width;
+	frame->height = height;
+	frame->channels = 3;
+
+	for (int y = 0; y < height; y++){
+		for (int x = 0; x < width; x++){
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			int v = background + x * 24 / width - 12 + (noise ? (int)(seed % (uint32_t)(2 * noise + 1)) - noise : 0);
+			v = v < 0 ? 0 : v > 255 ? 255 : v;
+			pixels[(size_t)y * width + x] = RASTER_ARGB(255, v, v * 7 / 8, v * 3 / 4);
+		}
+	}
+	RasterSurface s = {pixels, width, height, width};
+	wchar_t text[32];
+	swprintf(text, 32, L"%s", value);
+	GlyphCacheText(&cache, &s, GLYPH_FONT_Regular, size, text, pad, pad, textColor);
+	GlyphCacheFree(&cache);
+
+	for (size_t i = 0; i < (size_t)width * (size_t)height; i++){
+		frame->pixels[i * 3] = (uint8_t)(pixels[i] >> 16);
+		frame->pixels[i * 3 + 1] = (uint8_t)(pixels[i] >> 8);
+		frame->pixels[i * 3 + 2] = (uint8_t)pixels[i];
+	}
+	free(pixels);
+	return 1;
+}
+
+
+/* The HUD reader's fixture frames: numbers of every length at several sizes (crisp and antialiased),
+ * colours and contrasts. Named <value>_h<digit height>.png, which hud-check reads back. Also writes the
+ * built-in font's digits as a strip for HudTemplatesFromPng to digits/font.png, at twice the template size
+ * so loading it scales: the layout a strip of crops from the game has to have.
+ */
+static int CmdHudFixtures(int argc, char **argv){
+	if (argc != 3){
+		PrintUsage();
+		return 2;
+	}
+	static const struct {
+		const char *value;
+		int size;
+		uint32_t color;
+		int background;
+		int noise;
+	} fixtures[] = {
+		{"0",		16,	RASTER_ARGB(0xFF, 0xF0, 0xE8, 0xD0),	40,	6},
+		{"7",		24,	RASTER_ARGB(0xFF, 0xFF, 0xFF, 0xFF),	60,	10},
+		{"42",		32,	RASTER_ARGB(0xFF, 0xE0, 0xC0, 0x60),	30,	8},
+		{"1234",	16,	RASTER_ARGB(0xFF, 0xFF, 0xFF, 0xFF),	50,	12},
+		{"90817",	24,	RASTER_ARGB(0xFF, 0xD0, 0xD0, 0xD0),	80,	6},
+		{"5550123",	16,	RASTER_ARGB(0xFF, 0x70, 0x70, 0x70),	40,	4},
+		{"31415926",	20,	RASTER_ARGB(0xFF, 0xF0, 0xE0, 0xB0),	45,	8},
+		{"868",		28,	RASTER_ARGB(0xC0, 0xC0, 0xC0, 0xC0),	20,	16},
+	};
+
+	int failures = 0;
+	for (size_t i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]); i++){
+		PngImage frame;
+		if (!RenderHudFrame(fixtures[i].value, fixtures[i].size, fixtures[i].color, fixtures[i].background, fixtures[i].noise, 0x9E3779B9u + (uint32_t)i, &frame)){
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s_h%d.png", argv[2], fixtures[i].value, (fixtures[i].size * GLYPH_FONT_ROWS + GLYPH_FONT_EM / 2) / GLYPH_FONT_EM);
+		if (PngWrite(path, &frame)){
+			printf("wrote %s (%dx%d)\n", path, frame.width, frame.height);
+		}
+		else{
+			fprintf(stderr, "cannot write %s\n", path);
+			failures++;
+		}
+		PngFree(&frame);
+	}
+
+	//Cells of 2 * HUD_DIGIT_WIDTH x 2 * HUD_DIGIT_HEIGHT, the font's digits at four times the design size.
+	PngImage strip = {NULL, 20 * HUD_DIGIT_WIDTH, 2 * HUD_DIGIT_HEIGHT, 1};
+	strip.pixels = calloc((size_t)strip.width * (size_t)strip.height, 1);
+	if (!strip.pixels){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int d = 0; d < 10; d++){
+		GlyphFontRasterize(GLYPH_FONT_Regular, 4 * GLYPH_FONT_EM, (uint32_t)('0' + d), strip.pixels + d * 2 * HUD_DIGIT_WIDTH, strip.width);
+	}
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/digits", argv[2]);
+	mkdir(path, 0777);
+	snprintf(path, sizeof(path), "%s/digits/font.png", argv[2]);
+	if (PngWrite(path, &strip)){
+		printf("wrote %s (%dx%d)\n", path, strip.width, strip.height);
+	}
+	else{
+		fprintf(stderr, "cannot write %s\n", path);
+		failures++;
+	}
+	PngFree(&strip);
+	return failures != 0;
+}
+
+
+//The grey values of a PNG frame, for HudRead.
+static uint8_t *GreyFromPng(const PngImage *image){
+	uint8_t *grey = malloc((size_t)image->width * (size_t)image->height);
+	if (!grey){
+		return NULL;
+	}
+	for (size_t i = 0; i < (size_t)image->width * (size_t)image->height; i++){
+		const uint8_t *p = image->pixels + i * (size_t)image->channels;
+		grey[i] = image->channels >= 3 ? HUD_GREY(p[0], p[1], p[2]) : p[0];
+	}
+	return grey;
+}
+
+
+/* Reads every fixture frame with every supported kernel and checks the number against the one in the file
+ * name (<value>_h<digit height>.png) and the kernels against each other. The digits are the font's, or
+ * those of the strip after --digits (like HUD_DIGITS_FILE of the overlay).
+ */
+static int CmdHudCheck(int argc, char **argv){
+	int first = argc >= 4 && strcmp(argv[2], "--digits") == 0 ? 4 : 2;
+	if (argc <= first){
+		PrintUsage();
+		return 2;
+	}
+
+	HudTemplates templates;
+	const char *error;
+	if (first == 2){
+		HudTemplatesFromFont(&templates);
+	}
+	else if (!HudTemplatesFromPng(&templates, argv[3], &error)){
+		fprintf(stderr, "%s: %s\n", argv[3], error);
+		return 1;
+	}
+	RasterBackend initial = HudCurrentBackend();
+	int failures = 0;
+
+	for (int a = first; a < argc; a++){
+		const char *name = strrchr(argv[a], '/') ? strrchr(argv[a], '/') + 1 : argv[a];
+		long long expected;
+		int digitHeight;
+		if (sscanf(name, "%lld_h%d", &expected, &digitHeight) != 2){
+			printf("%-24s name is not <value>_h<digit height>.png\n", name);
+			failures++;
+			continue;
+		}
+		PngImage image;
+		if (!PngRead(argv[a], &image, &error)){
+			printf("%-24s %s\n", name, error);
+			failures++;
+			continue;
+		}
+		uint8_t *grey = GreyFromPng(&image);
+		HudImage region = {grey, image.width, image.height, image.width};
+
+		HudReading reference;
+		HudUseBackend(RASTER_Scalar);
+		int found = grey && HudRead(&region, digitHeight, &templates, &reference);
+		int ok = found && reference.value == expected;
+		printf("%-24s %3dx%-3d read %-10lld worst score %.3f", name, image.width, image.height, found ? reference.value : -1LL, reference.minScore);
+
+		for (int b = RASTER_Scalar + 1; b < RASTER_BACKEND_COUNT && grey; b++){
+			if (!HudUseBackend((RasterBackend)b)){
+				continue;
+			}
+			HudReading simd;
+			HudRead(&region, digitHeight, &templates, &simd);
+			int same = simd.value == reference.value && simd.digits == reference.digits && simd.minScore == reference.minScore;
+			printf("  %s: %s", RasterBackendName((RasterBackend)b), same ? "identical" : "DIFFERS");
+			ok &= same;
+		}
+		printf(ok ? "\n" : "  FAILED (expected %lld)\n", expected);
+		failures += !ok;
+		free(grey);
+		PngFree(&image);
+	}
+	HudUseBackend(initial);
+	printf(failures ? "%d FAILURES\n" : "all frames read correctly\n", failures);
+	return failures != 0;
+}
+
+
+/* Times HudRead on a seven digit number 28 pixels high (a HUD at 4K) with every supported kernel, against
+ * the 2 ms a read may take at 10 reads a second.
+ */
+static int CmdBenchHud(int argc, char **argv){
+	if (argc != 3){
+		PrintUsage();
+		return 2;
+	}
+	long reads = atol(argv[2]);
+	if (reads <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	PngImage frame;
+	if (!RenderHudFrame("1234567", 32, RASTER_ARGB(0xFF, 0xFF, 0xFF, 0xFF), 50, 10, 12345u, &frame)){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	uint8_t *grey = GreyFromPng(&frame);
+	HudImage region = {grey, frame.width, frame.height, frame.width};
+	HudTemplates templates;
+	HudTemplatesFromFont(&templates);
+	int digitHeight = (32 * GLYPH_FONT_ROWS + GLYPH_FONT_EM / 2) / GLYPH_FONT_EM;
+
+	//The scaling alone, the same for every kernel.
+	uint8_t scaled[HUD_MAX_HEIGHT * HUD_MAX_WIDTH];
+	int width = (region.width * HUD_DIGIT_HEIGHT + digitHeight / 2) / digitHeight;
+	int height = (region.height * HUD_DIGIT_HEIGHT + digitHeight / 2) / digitHeight;
+	double start = NowNs();
+	for (long i = 0; i < reads; i++){
+		HudScale(&region, scaled, width, height, HUD_MAX_WIDTH);
+	}
+	double scale = (NowNs() - start) / (double)reads;
+	printf("region %dx%d, digits %d px high, scaled to %dx%d in %.1f us\n", region.width, region.height, digitHeight, width, height, scale / 1e3);
+
+	RasterBackend initial = HudCurrentBackend();
+	int failures = 0;
+	for (int b = 0; b < RASTER_BACKEND_COUNT; b++){
+		if (!HudUseBackend((RasterBackend)b)){
+			printf("%-7s not supported\n", RasterBackendName((RasterBackend)b));
+			continue;
+		}
+		HudReading reading;
+		start = NowNs();
+		for (long i = 0; i < reads; i++){
+			HudRead(&region, digitHeight, &templates, &reading);
+		}
+		double read = (NowNs() - start) / (double)reads;
+		int ok = reading.value == 1234567 && read < 2e6;
+		printf("%-7s %8.1f us per read (%ld windows), %.2f%% of a core at 10 Hz, read %lld: %s\n", RasterBackendName((RasterBackend)b),
+			read / 1e3, reading.windows, read * 10.0 / 1e9 * 100.0, reading.value, ok ? "within the 2 ms budget" : "FAILED");
+		failures += !ok;
+	}
+	HudUseBackend(initial);
+
+	free(grey);
+	PngFree(&frame);
+	return failures != 0;
+}
+
+
+/* Tile hashes 1920x1080 BGRA frames the way a full screen sampler would see them: paused (nothing changes), a
+ * ticking HUD number (one 48x24 area changes every frame) and a moving camera (every pixel changes). Checks
+ * that every kernel gives the same hashes and that one changed byte marks exactly its tile, then times the
+ * hashing and compares a paused HUD capture (hash only) with one that reads the digits again.
+ */
+static int CmdBenchTiles(int argc, char **argv){
+	if (argc != 3){
+		PrintUsage();
+		return 2;
+	}
+	long frames = atol(argv[2]);
+	if (frames <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	const int width = 1920;
+	const int height = 1080;
+	const int stride = width * 4;
+	uint8_t *frame = malloc((size_t)stride * height);
+	uint8_t *moved = malloc((size_t)stride * height);
+	uint8_t *copy = malloc((size_t)stride * height);
+	uint32_t *scalarHashes = NULL;
+	TileHash tiles;
+	if (!frame || !moved || !copy || !TileHashInit(&tiles, width, height, 4)){
+		fprintf(stderr, "out of memory\n");
+		free(frame);
+		free(moved);
+		free(copy);
+		return 1;
+	}
+	uint32_t seed = 12345u;
+	for (size_t i = 0; i < (size_t)stride * height; i++){
+		seed = seed * 1103515245u + 12345u;
+		frame[i] = (uint8_t)(seed >> 24);
+		moved[i] = (uint8_t)(seed >> 16);
+	}
+	size_t tileCount = (size_t)tiles.columns * (size_t)tiles.rows;
+	scalarHashes = malloc(sizeof(uint32_t) * tileCount);
+
+	//Every kernel against the scalar one: the whole frame, then areas whose rows end in a partial block.
+	RasterBackend initial = TileHashCurrentBackend();
+	int failures = 0;
+	for (int b = 0; b < RASTER_BACKEND_COUNT; b++){
+		if (!TileHashUseBackend((RasterBackend)b)){
+			printf("%-7s not supported\n", RasterBackendName((RasterBackend)b));
+			continue;
+		}
+		TileHashReset(&tiles);
+		TileHashUpdate(&tiles, frame, stride, NULL);
+		int mismatches = 0;
+		if (b == RASTER_Scalar && scalarHashes){
+			memcpy(scalarHashes, tiles.hashes, sizeof(uint32_t) * tileCount);
+		}
+		else if (scalarHashes){
+			mismatches += memcmp(scalarHashes, tiles.hashes, sizeof(uint32_t) * tileCount) != 0;
+		}
+		for (int w = 1; w <= 40; w++){
+			uint32_t hash = TileHashArea(frame + 4 * w + 3, stride, w, 5, 4);
+			TileHashUseBackend(RASTER_Scalar);
+			mismatches += hash != TileHashArea(frame + 4 * w + 3, stride, w, 5, 4);
+			TileHashUseBackend((RasterBackend)b);
+		}
+		printf("%-7s %s\n", RasterBackendName((RasterBackend)b), mismatches ? "DIFFERS from scalar" : "same hashes as scalar");
+		failures += mismatches != 0;
+	}
+	TileHashUseBackend(initial);
+
+	//One flipped bit at a time must mark its tile and no other, and flipping it back must mark it again.
+	TileHashReset(&tiles);
+	TileHashUpdate(&tiles, frame, stride, NULL);
+	int flipFailures = 0;
+	for (int i = 0; i < 256; i++){
+		seed = seed * 1103515245u + 12345u;
+		size_t offset = (seed >> 8) % ((size_t)stride * height);
+		int x = (int)(offset % (size_t)stride) / 4;
+		int y = (int)(offset / (size_t)stride);
+		for (int pass = 0; pass < 2; pass++){
+			frame[offset] ^= (uint8_t)(1 << (i & 7));
+			RasterDirty changed;
+			RasterDirtyClear(&changed);
+			int count = TileHashUpdate(&tiles, frame, stride, &changed);
+			RasterRect r = changed.bounds;
+			flipFailures += count != 1 || changed.count != 1 || x < r.x || x >= r.x + r.width || y < r.y || y >= r.y + r.height
+				|| r.width > TILE_HASH_SIZE || r.height > TILE_HASH_SIZE;
+		}
+	}
+	printf("single bit changes: %s\n", flipFailures ? "WRONG tiles marked" : "every one marked its tile only");
+	failures += flipFailures != 0;
+
+	//The three kinds of frames, with the fastest kernel.
+	static const char *const names[] = {"paused", "ticking", "moving"};
+	memcpy(copy, frame, (size_t)stride * height);
+	double start = NowNs();
+	for (long i = 0; i < frames; i++){
+		memcpy(copy, frame, (size_t)stride * height);
+	}
+	double copyNs = (NowNs() - start) / (double)frames;
+	printf("%s kernel, %dx%d frame, %zu tiles of %d px; copying a frame takes %.0f us\n", RasterBackendName(initial), width, height,
+		tileCount, TILE_HASH_SIZE, copyNs / 1e3);
+	for (int scene = 0; scene < 3; scene++){
+		TileHashReset(&tiles);
+		TileHashUpdate(&tiles, frame, stride, NULL);
+		memset(&tiles.stats, 0, sizeof(tiles.stats));
+		start = NowNs();
+		for (long i = 0; i < frames; i++){
+			const uint8_t *pixels = frame;
+			if (scene == 1){
+				for (int y = 12; y < 36; y++){
+					memset(frame + (size_t)y * stride + 1640 * 4, (int)(i & 255), 48 * 4);
+				}
+			}
+			else if (scene == 2 && (i & 1) == 0){
+				pixels = moved;
+			}
+			TileHashUpdate(&tiles, pixels, stride, NULL);
+		}
+		double ns = (NowNs() - start) / (double)frames;
+		const TileHashStats *s = &tiles.stats;
+		double changedPerFrame = (double)s->changedTiles / (double)s->frames;
+		int ok = scene == 0 ? s->changedTiles == 0 : scene == 1 ? changedPerFrame <= 12.0 : s->changedTiles == s->tiles;
+		printf("%-7s %8.1f us per frame (%.1f GB/s), %.1f tiles changed per frame, %.2f%% hits, %llu of %llu frames unchanged: %s\n",
+			names[scene], ns / 1e3, (double)s->bytesHashed / (double)s->frames / ns, changedPerFrame,
+			100.0 - 100.0 * (double)s->changedTiles / (double)s->tiles, (unsigned long long)s->unchangedFrames,
+			(unsigned long long)s->frames, ok ? "ok" : "FAILED");
+		failures += !ok;
+	}
+
+	//A paused HUD capture (hud_capture.c): the region's tiles instead of the grey conversion and the digit match.
+	PngImage hud;
+	if (RenderHudFrame("1234", 16, RASTER_ARGB(0xFF, 0xFF, 0xFF, 0xFF), 50, 10, 12345u, &hud)){
+		uint32_t *bgra = malloc(sizeof(uint32_t) * (size_t)hud.width * (size_t)hud.height);
+		uint8_t *grey = malloc((size_t)hud.width * (size_t)hud.height);
+		TileHash hudTiles;
+		if (bgra && grey && TileHashInit(&hudTiles, hud.width, hud.height, 4)){
+			for (size_t i = 0; i < (size_t)hud.width * (size_t)hud.height; i++){
+				const uint8_t *p = hud.pixels + i * 3;
+				bgra[i] = RASTER_ARGB(0xFF, p[0], p[1], p[2]);
+			}
+			HudTemplates templates;
+			HudTemplatesFromFont(&templates);
+			HudReading reading;
+			int digitHeight = (16 * GLYPH_FONT_ROWS + GLYPH_FONT_EM / 2) / GLYPH_FONT_EM;
+
+			start = NowNs();
+			for (long i = 0; i < frames; i++){
+				for (int j = 0; j < hud.width * hud.height; j++){
+					grey[j] = HUD_GREY((bgra[j] >> 16) & 255, (bgra[j] >> 8) & 255, bgra[j] & 255);
+				}
+				HudImage image = {grey, hud.width, hud.height, hud.width};
+				HudRead(&image, digitHeight, &templates, &reading);
+			}
+			double readNs = (NowNs() - start) / (double)frames;
+			TileHashUpdate(&hudTiles, (const uint8_t *)bgra, hud.width * 4, NULL);
+			long skipped = 0;
+			start = NowNs();
+			for (long i = 0; i < frames; i++){
+				skipped += TileHashUpdate(&hudTiles, (const uint8_t *)bgra, hud.width * 4, NULL) == 0;
+			}
+			double hashNs = (NowNs() - start) / (double)frames;
+			int ok = reading.value == 1234 && skipped == frames;
+			printf("paused HUD region %dx%d: %.2f us hashed vs %.1f us read (%.0fx less), %.4f%% of a core at 10 Hz: %s\n",
+				hud.width, hud.height, hashNs / 1e3, readNs / 1e3, readNs / hashNs, hashNs * 10.0 / 1e9 * 100.0, ok ? "ok" : "FAILED");
+			failures += !ok;
+			TileHashFree(&hudTiles);
+		}
+		free(bgra);
+		free(grey);
+		PngFree(&hud);
+	}
+
+	TileHashFree(&tiles);
+	free(scalarHashes);
+	free(frame);
+	free(moved);
+	free(copy);
+	return failures != 0;
+}
+
+
+//Sleeps for ms milliseconds, for the stand-in and reader loops.
+static void SleepMs(long ms){
+	struct timespec wait = {ms / 1000, (ms % 1000) * 1000000L};
+	nanosleep(&wait, NULL);
+}
+
+
+/* Runs a stand-in game process (game_standin.h) for a while: the farmers grow by 10 every 100 ms, the
+ * other values follow, and every 5 seconds the island object moves like on a session change. Read it with
+ * anno_calc game-read <pid> from another shell (as root, or with ptrace_scope 0).
+ */
+static int CmdGameStandin(int argc, char **argv){
+	if (argc > 3){
+		PrintUsage();
+		return 2;
+	}
+	long seconds = argc == 3 ? atol(argv[2]) : 60;
+	GameLayout layout;
+	GameStandin standin;
+	if (seconds <= 0 || !GameStandinLayout(&layout) || !GameStandinInit(&standin, &layout)){
+		fprintf(stderr, "cannot set up the stand-in\n");
+		return 1;
+	}
+	printf("stand-in pid %ld, running %ld s\n", (long)getpid(), seconds);
+	fflush(stdout);
+	for (long step = 0; step < seconds * 10; step++){
+		GameStandinSet(&standin, GAME_Farmers, (int32_t)(10 * step));
+		GameStandinSet(&standin, GAME_Workers, (int32_t)(step / 4));
+		GameStandinSet(&standin, GAME_StockFish, (int32_t)(step % 50));
+		GameStandinSet(&standin, GAME_StockWorkClothes, (int32_t)(step % 30));
+		GameStandinSet(&standin, GAME_StockSchnapps, (int32_t)(step % 20));
+		if (step % 50 == 49){
+			GameStandinMove(&standin, GAME_NODE_Island);
+		}
+		SleepMs(100);
+	}
+	GameStandinFree(&standin);
+	return 0;
+}
+
+
+static void PrintGameValues(const int32_t values[GAME_FIELD_COUNT]){
+	for (int f = 0; f < GAME_FIELD_COUNT; f++){
+		printf("%s%s %d", f ? ", " : "", GameFieldName((GameField)f), values[f]);
+	}
+	printf("\n");
+}
+
+
+static void PrintGameStats(const GameMemory *game){
+	const GameMemoryStats *s = &game->stats;
+	printf("%llu ticks with values, %llu resolves, %llu stale, %llu failed, %llu batches of %.1f spans, %llu system calls\n",
+		(unsigned long long)s->ticks, (unsigned long long)s->resolves, (unsigned long long)s->stale, (unsigned long long)s->failures,
+		(unsigned long long)s->reads, s->reads ? (double)s->spans / (double)s->reads : 0.0, (unsigned long long)game->process.calls);
+}
+
+
+/* Reads a running stand-in (anno_calc game-standin) every 100 ms, the way the overlay reads the game.
+ */
+static int CmdGameRead(int argc, char **argv){
+	if (argc != 3 && argc != 4){
+		PrintUsage();
+		return 2;
+	}
+	long pid = atol(argv[2]);
+	long ticks = argc == 4 ? atol(argv[3]) : 10;
+	GameLayout layout;
+	GameMemory game;
+	if (pid <= 0 || ticks <= 0 || !GameStandinLayout(&layout)){
+		PrintUsage();
+		return 2;
+	}
+	if (!GameMemoryOpen(&game, pid, NULL, &layout)){
+		fprintf(stderr, "cannot read process %ld\n", pid);
+		return 1;
+	}
+	for (long i = 0; i < ticks; i++){
+		if (GameMemoryTick(&game)){
+			PrintGameValues(game.values);
+		}
+		else {
+			printf("no values this tick\n");
+		}
+		SleepMs(100);
+	}
+	PrintGameStats(&game);
+	GameMemoryClose(&game);
+	return 0;
+}
+
+
+/* What bench-game asks of its stand-in child: 's' set the values, 'm' move node then set them, 'q' quit.
+ */
+typedef struct StandinCommand {
+	int op;
+	int node;
+	int32_t values[GAME_FIELD_COUNT];
+} StandinCommand;
+
+
+//The child of bench-game: applies commands from in and answers each with a byte on out.
+static int RunStandinChild(int in, int out, const GameLayout *layout){
+	GameStandin standin;
+	char ack = GameStandinInit(&standin, layout) ? 'r' : 'e';
+	if (write(out, &ack, 1) != 1 || ack != 'r'){
+		return 1;
+	}
+	StandinCommand command;
+	while (read(in, &command, sizeof(command)) == (ssize_t)sizeof(command) && command.op != 'q'){
+		if (command.op == 'm'){
+			GameStandinMove(&standin, (GameNode)command.node);
+		}
+		for (int f = 0; f < GAME_FIELD_COUNT; f++){
+			GameStandinSet(&standin, (GameField)f, command.values[f]);
+		}
+		if (write(out, &ack, 1) != 1){
+			break;
+		}
+	}
+	GameStandinFree(&standin);
+	return 0;
+}
+
+
+/* Starts a stand-in child, changes its values and moves its objects between ticks and checks that every tick
+ * that returns values returns the current ones and that a moved object costs one dropped tick. Then times a
+ * tick (chains cached, one batch) against following every chain for every value.
+ */
+static int CmdBenchGame(int argc, char **argv){
+	if (argc != 3){
+		PrintUsage();
+		return 2;
+	}
+	long ticks = atol(argv[2]);
+	GameLayout layout;
+	if (ticks <= 0 || !GameStandinLayout(&layout)){
+		PrintUsage();
+		return 2;
+	}
+
+	int toChild[2];
+	int toParent[2];
+	if (pipe(toChild) != 0 || pipe(toParent) != 0){
+		fprintf(stderr, "pipe failed\n");
+		return 1;
+	}
+	fflush(stdout);
+	pid_t child = fork();
+	if (child < 0){
+		fprintf(stderr, "fork failed\n");
+		return 1;
+	}
+	if (child == 0){
+		close(toChild[1]);
+		close(toParent[0]);
+		_exit(RunStandinChild(toChild[0], toParent[1], &layout));
+	}
+	close(toChild[0]);
+	close(toParent[1]);
+
+	char ack = 0;
+	GameMemory game;
+	if (read(toParent[0], &ack, 1) != 1 || ack != 'r' || !GameMemoryOpen(&game, (long)child, NULL, &layout)){
+		fprintf(stderr, "cannot read the stand-in (ptrace_scope?)\n");
+		kill(child, SIGKILL);
+		waitpid(child, NULL, 0);
+		return 1;
+	}
+
+	//Changing values, and every 16th tick a moved object.
+	int failures = 0;
+	long moves = 0;
+	long retried = 0;
+	uint32_t seed = 12345u;
+	for (long i = 0; i < ticks && !failures; i++){
+		StandinCommand command = {'s', 0, {0}};
+		for (int f = 0; f < GAME_FIELD_COUNT; f++){
+			seed = seed * 1103515245u + 12345u;
+			command.values[f] = (int32_t)(seed >> 8);
+		}
+		if (i % 16 == 15){
+			command.op = 'm';
+			command.node = (int)(i / 16 % GAME_NODE_COUNT);
+			moves++;
+		}
+		if (write(toChild[1], &command, sizeof(command)) != (ssize_t)sizeof(command) || read(toParent[0], &ack, 1) != 1){
+			failures++;
+			break;
+		}
+		int ok = GameMemoryTick(&game);
+		if (!ok){
+			retried++;
+			ok = GameMemoryTick(&game);
+		}
+		int32_t uncached[GAME_FIELD_COUNT];
+		if (!ok || memcmp(game.values, command.values, sizeof(command.values)) != 0
+			|| !GameMemoryReadUncached(&game, uncached) || memcmp(uncached, command.values, sizeof(uncached)) != 0){
+			printf("tick %ld: read ", i);
+			PrintGameValues(game.values);
+			printf("expected ");
+			PrintGameValues(command.values);
+			failures++;
+		}
+	}
+	int staleOk = game.stats.stale == (uint64_t)moves && retried == moves;
+	printf("%ld ticks with changing values, %ld objects moved, %ld ticks dropped and retried: %s\n", ticks, moves, retried,
+		failures ? "WRONG values read" : staleOk ? "every value current" : "FAILED (dropped ticks differ from moves)");
+	failures += !staleOk;
+	PrintGameStats(&game);
+
+	//Steady state: nothing moves, every tick is one batch.
+	uint64_t calls = game.process.calls;
+	double start = NowNs();
+	for (long i = 0; i < ticks; i++){
+		GameMemoryTick(&game);
+	}
+	double tickNs = (NowNs() - start) / (double)ticks;
+	double tickCalls = (double)(game.process.calls - calls) / (double)ticks;
+	calls = game.process.calls;
+	int32_t values[GAME_FIELD_COUNT];
+	start = NowNs();
+	for (long i = 0; i < ticks; i++){
+		GameMemoryReadUncached(&game, values);
+	}
+	double uncachedNs = (NowNs() - start) / (double)ticks;
+	double uncachedCalls = (double)(game.process.calls - calls) / (double)ticks;
+	printf("tick: %.2f us, %.1f system calls (%d spans); every chain every time: %.2f us, %.1f system calls (%.1fx slower)\n",
+		tickNs / 1e3, tickCalls, game.spanCount, uncachedNs / 1e3, uncachedCalls, uncachedNs / tickNs);
+
+	StandinCommand quit = {'q', 0, {0}};
+	if (write(toChild[1], &quit, sizeof(quit)) != (ssize_t)sizeof(quit)){
+		kill(child, SIGKILL);
+	}
+	waitpid(child, NULL, 0);
+	close(toChild[1]);
+	close(toParent[0]);
+	GameMemoryClose(&game);
+	return failures != 0;
+}
+
+
+/* A simulated source of bench-sampler: every sample takes costNs of simulated time, and the value changes
+ * every changeNs (never if 0).
+ *
+ * version : the change last seen
+ * delayNs / detected : time from a change to the sample that saw it, summed, and the changes seen
+ */
+typedef struct SimSource {
+	const char *name;
+	uint64_t costNs;
+	uint64_t changeNs;
+	uint32_t minMs;
+	uint32_t maxMs;
+	uint64_t version;
+	uint64_t delayNs;
+	uint64_t detected;
+} SimSource;
+
+static uint64_t g_simNowNs;
+
+
+static uint64_t SimClock(void *user){
+	(void)user;
+	return g_simNowNs;
+}
+
+
+static SampleResult SimSample(void *user){
+	SimSource *source = user;
+	g_simNowNs += source->costNs;
+	uint64_t version = source->changeNs ? g_simNowNs / source->changeNs : 0;
+	if (version == source->version){
+		return SAMPLE_Unchanged;
+	}
+	source->version = version;
+	source->delayNs += g_simNowNs - version * source->changeNs;
+	source->detected++;
+	return SAMPLE_Changed;
+}
+
+
+/* Runs the sampler on a simulated clock for the given seconds with a cheap and an expensive HUD-like source,
+ * the game's memory, an expensive source that never changes and one that would take 40 % of a core at its
+ * fastest rate; the game is minimised for the middle fifth. Checks the budget held and nothing ran while
+ * minimised, and compares the CPU used with sampling every source at 10 Hz.
+ */
+static int CmdBenchSampler(int argc, char **argv){
+	if (argc != 3 && argc != 4){
+		PrintUsage();
+		return 2;
+	}
+	long seconds = atol(argv[2]);
+	double budget = argc == 4 ? atof(argv[3]) / 100.0 : SAMPLER_BUDGET;
+	if (seconds <= 0 || budget <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	SimSource sources[] = {
+		{"hud", 300000, 3000000000ULL, 100, 2000, 0, 0, 0},
+		{"game", 3000, 500000000ULL, 50, 2000, 0, 0, 0},
+		{"idle", 2000000, 0, 100, 5000, 0, 0, 0},
+		{"heavy", 20000000, 100000000ULL, 50, 1000, 0, 0, 0},
+	};
+	int sourceCount = (int)(sizeof(sources) / sizeof(sources[0]));
+
+	g_simNowNs = 1000000000ULL;
+	Sampler sampler;
+	SamplerInit(&sampler, budget, SimClock, NULL);
+	double fixedCost = 0.0;
+	for (int i = 0; i < sourceCount; i++){
+		SamplerAdd(&sampler, sources[i].name, SimSample, &sources[i], sources[i].minMs, sources[i].maxMs);
+		fixedCost += (double)sources[i].costNs * 10.0 / 1e9;
+	}
+
+	uint64_t start = g_simNowNs;
+	uint64_t end = start + (uint64_t)seconds * 1000000000ULL;
+	uint64_t pauseStart = start + (end - start) * 2 / 5;
+	uint64_t pauseEnd = start + (end - start) * 3 / 5;
+	uint64_t samplesAtPause = 0;
+	int pausedSamples = 0;
+	double wallStart = NowNs();
+	while (g_simNowNs < end){
+		if (!sampler.paused && g_simNowNs >= pauseStart && g_simNowNs < pauseEnd){
+			SamplerPause(&sampler, 1);
+			for (int i = 0; i < sourceCount; i++){
+				samplesAtPause += sampler.sources[i].stats.samples;
+			}
+		}
+		long waitMs = SamplerRun(&sampler);
+		if (waitMs < 0){
+			//Minimised: nothing is scheduled until the game comes back.
+			uint64_t samples = 0;
+			for (int i = 0; i < sourceCount; i++){
+				samples += sampler.sources[i].stats.samples;
+			}
+			pausedSamples += samples != samplesAtPause;
+			g_simNowNs = pauseEnd;
+			SamplerPause(&sampler, 0);
+			continue;
+		}
+		g_simNowNs += (uint64_t)waitMs * 1000000ULL;
+	}
+	double wallNs = NowNs() - wallStart;
+
+	SamplerDump(&sampler, stdout);
+	for (int i = 0; i < sourceCount; i++){
+		const SimSource *s = &sources[i];
+		if (s->changeNs){
+			printf("%-12s %llu of %llu changes seen, %.0f ms after the change on average\n", s->name, (unsigned long long)s->detected,
+				(unsigned long long)((end - start) / s->changeNs), s->detected ? (double)s->delayNs / (double)s->detected / 1e6 : 0.0);
+		}
+	}
+	double usage = SamplerUsage(&sampler);
+	int ok = usage <= 1.05 && !pausedSamples && sampler.sources[3].stats.deferred > 0;
+	printf("%.3f%% of a core against %.1f%% sampling everything at 10 Hz, %s while minimised, %.0f ns per scheduled run: %s\n",
+		usage * budget * 100.0, fixedCost * 100.0, pausedSamples ? "SAMPLED" : "nothing sampled", wallNs / (double)sampler.runs,
+		ok ? "within the budget" : "FAILED");
+	return !ok;
+}
+
+
+/* A timer of the bench-loop wheel check: when it must fire and whether it did.
+ */
+typedef struct WheelCheckTimer {
+	Timer timer;
+	int pending;
+	uint64_t expires;
+} WheelCheckTimer;
+
+//State of the wheel check, shared with the callbacks.
+static TimerWheel g_checkWheel;
+static WheelCheckTimer g_checkTimers[4096];
+static uint64_t g_checkSeed = 12345;
+static uint64_t g_checkLastFire;
+static int g_checkErrors;
+
+
+static uint64_t CheckRandom(void){
+	g_checkSeed = g_checkSeed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return g_checkSeed >> 20;
+}
+
+
+//Delays short and long, some beyond the range of the wheels.
+static uint64_t CheckDelay(void){
+	uint64_t kind = CheckRandom() % 10;
+	if (kind < 4){
+		return CheckRandom() % 70;
+	}
+	if (kind < 7){
+		return CheckRandom() % 5000;
+	}
+	if (kind < 9){
+		return CheckRandom() % 300000;
+	}
+	return CheckRandom() % (TIMER_WHEEL_RANGE * 2);
+}
+
+
+static void CheckStart(WheelCheckTimer *t);
+
+//Checks the tick it fires at, then sometimes starts itself again or cancels another timer.
+static void CheckFire(void *user){
+	WheelCheckTimer *t = user;
+	if (!t->pending || g_checkWheel.now != t->expires || t->expires < g_checkLastFire){
+		g_checkErrors++;
+	}
+	g_checkLastFire = g_checkWheel.now;
+	t->pending = 0;
+	uint64_t r = CheckRandom() % 8;
+	if (r < 2){
+		CheckStart(t);
+	}
+	else if (r == 2){
+		WheelCheckTimer *other = &g_checkTimers[CheckRandom() % 4096];
+		TimerCancel(&g_checkWheel, &other->timer);
+		other->pending = 0;
+	}
+}
+
+
+static void CheckStart(WheelCheckTimer *t){
+	uint64_t delay = CheckDelay();
+	TimerStart(&g_checkWheel, &t->timer, delay, CheckFire, t);
+	t->pending = 1;
+	t->expires = g_checkWheel.now + (delay ? delay : 1);
+}
+
+
+/* Runs random starts, cancels and advances (some limited to a few timers) on a timer wheel and checks
+ * every timer fires exactly at its tick, in order, none is left behind and TimerWheelNextDelay never
+ * points past the next timer. Returns the number of errors.
+ */
+static int CheckTimerWheel(long operations){
+	TimerWheelInit(&g_checkWheel, 1000);
+	memset(g_checkTimers, 0, sizeof(g_checkTimers));
+	g_checkLastFire = 0;
+	g_checkErrors = 0;
+	int n = (int)(sizeof(g_checkTimers) / sizeof(g_checkTimers[0]));
+	int misses = 0;
+	int overshoots = 0;
+
+	for (long op = 0; op < operations; op++){
+		uint64_t r = CheckRandom() % 100;
+		WheelCheckTimer *t = &g_checkTimers[CheckRandom() % (uint64_t)n];
+		if (r < 45){
+			CheckStart(t);
+			continue;
+		}
+		if (r < 60){
+			TimerCancel(&g_checkWheel, &t->timer);
+			t->pending = 0;
+			continue;
+		}
+		uint64_t step = r < 95 ? CheckRandom() % 200 : CheckRandom() % 2000000;
+		uint64_t target = g_checkWheel.now + step;
+		if (r < 70){
+			//A limited slice and the rest after it, the way the event loop runs them.
+			while (TimerWheelAdvance(&g_checkWheel, target, 3) == 3){
+			}
+		}
+		else {
+			TimerWheelAdvance(&g_checkWheel, target, 0);
+		}
+
+		uint64_t earliest = UINT64_MAX;
+		int pending = 0;
+		for (int i = 0; i < n; i++){
+			if (!g_checkTimers[i].pending){
+				continue;
+			}
+			pending++;
+			misses += g_checkTimers[i].expires <= g_checkWheel.now;
+			earliest = g_checkTimers[i].expires < earliest ? g_checkTimers[i].expires : earliest;
+		}
+		int64_t next = TimerWheelNextDelay(&g_checkWheel);
+		misses += pending != g_checkWheel.count;
+		overshoots += pending ? next < 0 || g_checkWheel.now + (uint64_t)next > earliest : next != -1;
+	}
+	printf("wheel check: %ld operations, %llu started, %llu fired, %llu cancelled, %llu cascaded, %d wrong tick, %d missed, %d next delay past a timer\n",
+		operations, (unsigned long long)g_checkWheel.stats.started, (unsigned long long)g_checkWheel.stats.fired,
+		(unsigned long long)g_checkWheel.stats.cancelled, (unsigned long long)g_checkWheel.stats.cascaded, g_checkErrors, misses, overshoots);
+	return g_checkErrors + misses + overshoots;
+}
+
+
+static void NoTimer(void *user){
+	(void)user;
+}
+
+
+/* Times starting and cancelling a timer with count others pending. Returns ns per start and cancel pair.
+ */
+static double TimeWheelOps(int count, long operations){
+	TimerWheel *wheel = malloc(sizeof(TimerWheel));
+	Timer *timers = calloc((size_t)count, sizeof(Timer));
+	if (!wheel || !timers){
+		free(wheel);
+		free(timers);
+		return 0.0;
+	}
+	TimerWheelInit(wheel, 0);
+	for (int i = 0; i < count; i++){
+		TimerStart(wheel, &timers[i], CheckDelay(), NoTimer, NULL);
+	}
+	double start = NowNs();
+	for (long op = 0; op < operations; op++){
+		Timer *t = &timers[CheckRandom() % (uint64_t)count];
+		TimerCancel(wheel, t);
+		TimerStart(wheel, t, CheckDelay(), NoTimer, NULL);
+	}
+	double ns = (NowNs() - start) / (double)operations;
+	free(timers);
+	free(wheel);
+	return ns;
+}
+
+
+/* A periodic timer of the bench-loop latency run: busy for workNs, then due again after periodMs.
+ */
+typedef struct LoopWork {
+	Timer timer;
+	EventLoop *loop;
+	uint64_t periodMs;
+	uint64_t workNs;
+} LoopWork;
+
+static LatHistogram g_loopLatency;
+static volatile int g_loopProducing;
+
+
+static void LoopWorkFire(void *user){
+	LoopWork *work = user;
+	uint64_t start = SysNowNs();
+	while (SysNowNs() - start < work->workNs){
+	}
+	EventLoopTimer(work->loop, &work->timer, work->periodMs, LoopWorkFire, work);
+}
+
+
+//A posted task carrying its post time: records how long it waited.
+static void LoopTask(void *user){
+	LatRecord(&g_loopLatency, SysNowNs() - (uint64_t)(uintptr_t)user);
+}
+
+
+static void LoopQuit(void *user){
+	EventLoopQuit(user, 0);
+}
+
+
+//Another thread posting a task every millisecond, like input arriving.
+static void LoopProducer(void *arg){
+	EventLoop *loop = arg;
+	struct timespec ms = {0, 1000000};
+	while (g_loopProducing){
+		EventLoopPost(loop, LoopTask, (void *)(uintptr_t)SysNowNs());
+		nanosleep(&ms, NULL);
+	}
+}
+
+
+/* Runs an event loop for the given seconds with 2000 timers that all fire together every 100 ms, 5 us of
+ * work each, while another thread posts a task every millisecond. Fills g_loopLatency with the tasks' waits.
+ */
+static int RunLoopLatency(EventLoop *loop, int sliceTimers, uint64_t sliceNs, double seconds){
+	enum { WORK_COUNT = 2000 };
+	static LoopWork work[WORK_COUNT];
+	if (!EventLoopInit(loop)){
+		return 0;
+	}
+	loop->sliceTimers = sliceTimers;
+	loop->sliceNs = sliceNs;
+	memset(&g_loopLatency, 0, sizeof(g_loopLatency));
+	for (int i = 0; i < WORK_COUNT; i++){
+		work[i].loop = loop;
+		work[i].periodMs = 100;
+		work[i].workNs = 5000;
+		EventLoopTimer(loop, &work[i].timer, 100, LoopWorkFire, &work[i]);
+	}
+	Timer quit = {0};
+	EventLoopTimer(loop, &quit, (uint64_t)(seconds * 1000.0), LoopQuit, loop);
+
+	SysThread producer;
+	g_loopProducing = 1;
+	if (!SysThreadStart(&producer, LoopProducer, loop)){
+		EventLoopFree(loop);
+		return 0;
+	}
+	EventLoopRun(loop);
+	g_loopProducing = 0;
+	SysThreadJoin(&producer);
+	EventLoopFree(loop);
+	return 1;
+}
+
+
+/* Checks the timer wheel against the expected fire ticks over the given random operations, times starting
+ * and cancelling with few and with a million timers pending, then runs the event loop with a burst of timers
+ * and posted tasks, with the default slices and with unbounded ones, and compares how long the tasks waited.
+ */
+static int CmdBenchLoop(int argc, char **argv){
+	if (argc != 3 && argc != 4){
+		PrintUsage();
+		return 2;
+	}
+	long operations = atol(argv[2]);
+	double seconds = argc == 4 ? atof(argv[3]) : 2.0;
+	if (operations <= 0 || seconds <= 0){
+		PrintUsage();
+		return 2;
+	}
+
+	int errors = CheckTimerWheel(operations);
+
+	double few = TimeWheelOps(1000, 2000000);
+	double many = TimeWheelOps(1000000, 2000000);
+	printf("start + cancel: %.1f ns with 1000 timers pending, %.1f ns with 1000000\n", few, many);
+
+	static EventLoop loop;
+	const char *names[2] = {"bounded", "unbounded"};
+	uint64_t p99[2] = {0};
+	uint64_t longest[2] = {0};
+	for (int mode = 0; mode < 2; mode++){
+		int ok = mode == 0 ? RunLoopLatency(&loop, EVENT_LOOP_SLICE_TIMERS, EVENT_LOOP_SLICE_NS, seconds) : RunLoopLatency(&loop, 0, 0, seconds);
+		if (!ok){
+			fprintf(stderr, "could not start the event loop\n");
+			return 1;
+		}
+		p99[mode] = LatPercentile(&g_loopLatency, 0.99);
+		longest[mode] = loop.stats.longestSliceNs;
+		printf("%-9s slices: %llu tasks waited p50 %.1f us, p99 %.1f us, max %.1f us; %llu timers fired, %llu slices cut, longest %.2f ms, %llu waits\n",
+			names[mode], (unsigned long long)g_loopLatency.count, (double)LatPercentile(&g_loopLatency, 0.5) / 1e3, (double)p99[mode] / 1e3,
+			(double)g_loopLatency.maxNs / 1e3, (unsigned long long)loop.stats.fired, (unsigned long long)loop.stats.cutSlices,
+			(double)longest[mode] / 1e6, (unsigned long long)loop.stats.waits);
+	}
+
+	int ok = errors == 0 && longest[0] < longest[1] && p99[0] < p99[1];
+	printf("%s\n", ok ? "timers exact, bounded slices keep tasks waiting less" : "FAILED");
+	return !ok;
+}
+
+
+/* Compiles a formula file the way the overlay does (demand_formula.h), prints its bytecode and the demand
+ * of the given residents (1000 by default) without and with it.
+ */
+static int CmdFormula(int argc, char **argv){
+	if (argc != 3 && argc != 4){
+		PrintUsage();
+		return 2;
+	}
+	long residents = argc == 4 ? atol(argv[3]) : 1000;
+	DemandFormulas formulas;
+	DemandFormulasInit(&formulas);
+	int loaded = DemandFormulasLoad(&formulas, argv[2]);
+	if (loaded < 0){
+		fprintf(stderr, "cannot read %s\n", argv[2]);
+		DemandFormulasFree(&formulas);
+		return 1;
+	}
+	if (loaded == 0){
+		fprintf(stderr, "%s:%d:%d: %s\n", argv[2], formulas.set.errorLine, formulas.set.errorColumn, formulas.set.error);
+		DemandFormulasFree(&formulas);
+		return 1;
+	}
+	FormulaSetDump(&formulas.set, stdout);
+
+	Demand plain;
+	if (!CalcDemandResidents(residents, &plain)){
+		DemandFormulasFree(&formulas);
+		PrintUsage();
+		return 2;
+	}
+	Demand adjusted = plain;
+	DemandFormulasApply(&formulas, &adjusted);
+	printf("%ld residents:\n", residents);
+	for (int g = 0; g < GOOD_COUNT; g++){
+		printf("  %-14s %8.3f t/min %7.2f buildings  ->  %8.3f t/min %7.2f buildings\n", CalcGoodInfo((Good)g)->name,
+			plain.tonsPerMinute[g], plain.buildings[g], adjusted.tonsPerMinute[g], adjusted.buildings[g]);
+	}
+	DemandFormulasFree(&formulas);
+	return 0;
+}
+
+
+/* A node of a random expression of bench-formula: an instruction and its operands (indices of other nodes),
+ * or a constant, or a slot to load.
+ */
+typedef struct GenNode {
+	FormulaOp op;
+	int args[3];
+	double value;
+	int slot;
+} GenNode;
+
+//Operations the generator picks from, with the functions among them; the arithmetic ones first.
+static const FormulaOp g_genOps[] = {
+	FORMULA_OP_Add, FORMULA_OP_Sub, FORMULA_OP_Mul, FORMULA_OP_Div, FORMULA_OP_Mod, FORMULA_OP_Pow, FORMULA_OP_Neg,
+	FORMULA_OP_Not, FORMULA_OP_Lt, FORMULA_OP_Le, FORMULA_OP_Gt, FORMULA_OP_Ge, FORMULA_OP_Eq, FORMULA_OP_Ne, FORMULA_OP_And,
+	FORMULA_OP_Or, FORMULA_OP_Select, FORMULA_OP_Min, FORMULA_OP_Max, FORMULA_OP_Clamp, FORMULA_OP_Abs, FORMULA_OP_Floor,
+	FORMULA_OP_Ceil, FORMULA_OP_Round, FORMULA_OP_Sqrt,
+};
+
+static const double g_genConsts[] = {0.0, 0.5, 1.0, 2.0, 3.25, 10.0, 100.0, 0.015};
+
+/* The generated formulas: nodes, the root node and slot of every line, and the text.
+ */
+typedef struct GenFormulas {
+	GenNode *nodes;
+	int nodeCount;
+	int nodeCapacity;
+	char *text;
+	size_t textSize;
+	size_t textCapacity;
+	uint64_t seed;
+} GenFormulas;
+
+
+static uint64_t GenRandom(GenFormulas *gen){
+	gen->seed = gen->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return gen->seed >> 20;
+}
+
+
+static void GenAppend(GenFormulas *gen, const char *text){
+	size_t length = strlen(text);
+	if (gen->textSize + length + 1 > gen->textCapacity){
+		size_t capacity = gen->textCapacity ? gen->textCapacity * 2 : 4096;
+		while (capacity < gen->textSize + length + 1){
+			capacity *= 2;
+		}
+		gen->text = realloc(gen->text, capacity);
+		gen->textCapacity = capacity;
+	}
+	memcpy(gen->text + gen->textSize, text, length + 1);
+	gen->textSize += length;
+}
+
+
+static int GenNewNode(GenFormulas *gen){
+	if (gen->nodeCount == gen->nodeCapacity){
+		gen->nodeCapacity = gen->nodeCapacity ? gen->nodeCapacity * 2 : 1024;
+		gen->nodes = realloc(gen->nodes, sizeof(GenNode) * (size_t)gen->nodeCapacity);
+	}
+	memset(&gen->nodes[gen->nodeCount], 0, sizeof(GenNode));
+	return gen->nodeCount++;
+}
+
+
+//Operands an operation takes.
+static int GenArity(FormulaOp op){
+	switch (op){
+		case FORMULA_OP_Neg: case FORMULA_OP_Not: case FORMULA_OP_Abs: case FORMULA_OP_Floor: case FORMULA_OP_Ceil:
+		case FORMULA_OP_Round: case FORMULA_OP_Sqrt:
+			return 1;
+		case FORMULA_OP_Select: case FORMULA_OP_Clamp:
+			return 3;
+		default:
+			return 2;
+	}
+}
+
+
+/* Generates an expression of at most depth levels over the first slotCount slots (names from names), writing
+ * its text fully parenthesised. Returns its node.
+ */
+static int GenExpr(GenFormulas *gen, int depth, int slotCount, char (*names)[FORMULA_NAME_CHARS]){
+	int node = GenNewNode(gen);
+	if (depth == 0 || GenRandom(gen) % 4 == 0){
+		char text[48];
+		if (GenRandom(gen) % 2){
+			gen->nodes[node].op = FORMULA_OP_Const;
+			gen->nodes[node].value = g_genConsts[GenRandom(gen) % (sizeof(g_genConsts) / sizeof(g_genConsts[0]))];
+			snprintf(text, sizeof(text), "%.17g", gen->nodes[node].value);
+		}
+		else {
+			gen->nodes[node].op = FORMULA_OP_Load;
+			gen->nodes[node].slot = (int)(GenRandom(gen) % (uint64_t)slotCount);
+			snprintf(text, sizeof(text), "%s", names[gen->nodes[node].slot]);
+		}
+		GenAppend(gen, text);
+		return node;
+	}
+
+	//Mostly arithmetic, like consumption formulas; the first four of g_genOps.
+	FormulaOp op = g_genOps[GenRandom(gen) % (GenRandom(gen) % 3 ? 4 : sizeof(g_genOps) / sizeof(g_genOps[0]))];
+	gen->nodes[node].op = op;
+	int arity = GenArity(op);
+	static const char *infix[FORMULA_OP_COUNT] = {
+		[FORMULA_OP_Add] = " + ", [FORMULA_OP_Sub] = " - ", [FORMULA_OP_Mul] = " * ", [FORMULA_OP_Div] = " / ",
+		[FORMULA_OP_Mod] = " % ", [FORMULA_OP_Pow] = "^", [FORMULA_OP_Lt] = " < ", [FORMULA_OP_Le] = " <= ",
+		[FORMULA_OP_Gt] = " > ", [FORMULA_OP_Ge] = " >= ", [FORMULA_OP_Eq] = " == ", [FORMULA_OP_Ne] = " != ",
+		[FORMULA_OP_And] = " && ", [FORMULA_OP_Or] = " || ",
+	};
+	static const char *call[FORMULA_OP_COUNT] = {
+		[FORMULA_OP_Min] = "min(", [FORMULA_OP_Max] = "max(", [FORMULA_OP_Clamp] = "clamp(", [FORMULA_OP_Abs] = "abs(",
+		[FORMULA_OP_Floor] = "floor(", [FORMULA_OP_Ceil] = "ceil(", [FORMULA_OP_Round] = "round(", [FORMULA_OP_Sqrt] = "sqrt(",
+	};
+	if (infix[op]){
+		GenAppend(gen, "(");
+		int a = GenExpr(gen, depth - 1, slotCount, names);
+		GenAppend(gen, infix[op]);
+		int b = GenExpr(gen, depth - 1, slotCount, names);
+		GenAppend(gen, ")");
+		gen->nodes[node].args[0] = a;
+		gen->nodes[node].args[1] = b;
+	}
+	else if (op == FORMULA_OP_Neg || op == FORMULA_OP_Not){
+		GenAppend(gen, op == FORMULA_OP_Neg ? "(-" : "(!");
+		int a = GenExpr(gen, depth - 1, slotCount, names);
+		gen->nodes[node].args[0] = a;
+		GenAppend(gen, ")");
+	}
+	else if (op == FORMULA_OP_Select){
+		GenAppend(gen, "(");
+		int c = GenExpr(gen, depth - 1, slotCount, names);
+		GenAppend(gen, " ? ");
+		int a = GenExpr(gen, depth - 1, slotCount, names);
+		GenAppend(gen, " : ");
+		int b = GenExpr(gen, depth - 1, slotCount, names);
+		GenAppend(gen, ")");
+		gen->nodes[node].args[0] = c;
+		gen->nodes[node].args[1] = a;
+		gen->nodes[node].args[2] = b;
+	}
+	else {
+		GenAppend(gen, call[op]);
+		for (int i = 0; i < arity; i++){
+			if (i > 0){
+				GenAppend(gen, ", ");
+			}
+			//Not in one statement: GenExpr may move the nodes.
+			int arg = GenExpr(gen, depth - 1, slotCount, names);
+			gen->nodes[node].args[i] = arg;
+		}
+		GenAppend(gen, ")");
+	}
+	return node;
+}
+
+
+//Walks the tree of node: the reference the bytecode is checked and timed against, same operations in C.
+static double GenEval(const GenNode *nodes, int node, const double *values){
+	const GenNode *n = &nodes[node];
+	if (n->op == FORMULA_OP_Const){
+		return n->value;
+	}
+	if (n->op == FORMULA_OP_Load){
+		return values[n->slot];
+	}
+	double a = GenEval(nodes, n->args[0], values);
+	double b = GenArity(n->op) > 1 ? GenEval(nodes, n->args[1], values) : 0.0;
+	double c = GenArity(n->op) > 2 ? GenEval(nodes, n->args[2], values) : 0.0;
+	switch (n->op){
+		case FORMULA_OP_Add: return a + b;
+		case FORMULA_OP_Sub: return a - b;
+		case FORMULA_OP_Mul: return a * b;
+		case FORMULA_OP_Div: return a / b;
+		case FORMULA_OP_Mod: return fmod(a, b);
+		case FORMULA_OP_Pow: return pow(a, b);
+		case FORMULA_OP_Neg: return -a;
+		case FORMULA_OP_Not: return a == 0.0;
+		case FORMULA_OP_Lt: return a < b;
+		case FORMULA_OP_Le: return a <= b;
+		case FORMULA_OP_Gt: return a > b;
+		case FORMULA_OP_Ge: return a >= b;
+		case FORMULA_OP_Eq: return a == b;
+		case FORMULA_OP_Ne: return a != b;
+		case FORMULA_OP_And: return a != 0.0 && b != 0.0;
+		case FORMULA_OP_Or: return a != 0.0 || b != 0.0;
+		case FORMULA_OP_Select: return a != 0.0 ? b : c;
+		case FORMULA_OP_Min: return b < a ? b : a;
+		case FORMULA_OP_Max: return b > a ? b : a;
+		case FORMULA_OP_Clamp: return a < b ? b : a > c ? c : a;
+		case FORMULA_OP_Abs: return fabs(a);
+		case FORMULA_OP_Floor: return floor(a);
+		case FORMULA_OP_Ceil: return ceil(a);
+		case FORMULA_OP_Round: return round(a);
+		case FORMULA_OP_Sqrt: return sqrt(a);
+		default: return 0.0;
+	}
+}
+
+
+//Equal bits, or both not a number.
+static int SameValue(double a, double b){
+	return memcmp(&a, &b, sizeof(a)) == 0 || (isnan(a) && isnan(b));
+}
+
+
+/* Hand-written lines with known results or errors: precedence, associativity, folding and error positions.
+ */
+static int CheckFormulaLanguage(void){
+	static const struct { const char *line; double expected; } values[] = {
+		{"a = -2^2", -4.0}, {"a = 2^3^2", 512.0}, {"a = 2^-1", 0.5}, {"a = 1 + 2 * 3 < 7 ? 10 : 20", 20.0},
+		{"a = 10 % 4 - 7 / 2", -1.5}, {"a = !0 && 1 || 0", 1.0}, {"a = clamp(5, 0, 3) + min(2, 1) * max(-1, -2)", 2.0},
+		{"a = 1e3 + .5 # comment", 1000.5}, {"a = 1 < 2 == 2 > 1", 1.0}, {"a = 0 ? 1 : 0 ? 2 : 3", 3.0},
+		{"a = x * 2 + if(x >= 3, 1, 0)", 7.0}, {"a = round(2.5) + floor(-0.5) + ceil(0.2) + abs(-3) + sqrt(16)", 10.0},
+	};
+	static const struct { const char *text; int line; int column; } errors[] = {
+		{"a = 1 +", 1, 8}, {"a = 1\nb = nope * 2", 2, 5}, {"a = min(1)", 1, 10}, {"a = (1", 1, 7}, {"a = 1 2", 1, 7},
+		{"min = 1", 1, 1}, {"a = 1 = 2", 1, 7}, {"\n\n  = 3", 3, 3}, {"a = a + 1", 1, 5},
+	};
+	int failures = 0;
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++){
+		FormulaSet set;
+		FormulaSetInit(&set);
+		int x = FormulaSetInput(&set, "x");
+		double slots[4] = {0};
+		int ok = FormulaSetCompile(&set, values[i].line, strlen(values[i].line));
+		int a = FormulaSetSlot(&set, "a");
+		if (ok && a >= 0){
+			slots[x] = 3.0;
+			FormulaSetEval(&set, slots);
+		}
+		if (!ok || a < 0 || slots[a] != values[i].expected){
+			printf("  %-60s gives %g, expected %g %s\n", values[i].line, a >= 0 ? slots[a] : 0.0, values[i].expected, ok ? "" : set.error);
+			failures++;
+		}
+		FormulaSetFree(&set);
+	}
+	for (size_t i = 0; i < sizeof(errors) / sizeof(errors[0]); i++){
+		FormulaSet set;
+		FormulaSetInit(&set);
+		int ok = FormulaSetCompile(&set, errors[i].text, strlen(errors[i].text));
+		if (ok || set.errorLine != errors[i].line || set.errorColumn != errors[i].column){
+			printf("  \"%s\" : %s at %d:%d, expected an error at %d:%d\n", errors[i].text, ok ? "compiled" : set.error, set.errorLine,
+				set.errorColumn, errors[i].line, errors[i].column);
+			failures++;
+		}
+		FormulaSetFree(&set);
+	}
+
+	//A line of constants folds down to one constant and its store.
+	FormulaSet set;
+	FormulaSetInit(&set);
+	const char *folded = "a = (1 + 2) * 3 - max(4, 2 ^ 3) / 2\nb = -a";
+	if (!FormulaSetCompile(&set, folded, strlen(folded)) || set.codeSize != 3 + 3 + 3 + 1 + 3 + 1){
+		printf("  constants not folded: %lu bytes\n", (unsigned long)set.codeSize);
+		failures++;
+	}
+	FormulaSetFree(&set);
+
+	printf("language check: %lu values, %lu errors, %d failed\n", (unsigned long)(sizeof(values) / sizeof(values[0])),
+		(unsigned long)(sizeof(errors) / sizeof(errors[0])), failures);
+	return failures;
+}
+
+
+/* Checks the language on known lines, then compiles the given number of random formulas over 8 inputs and
+ * each other, changes the inputs the given number of times and compares every result of the bytecode with
+ * walking the expression trees, and times both.
+ */
+static int CmdBenchFormula(int argc, char **argv){
+	if (argc != 4){
+		PrintUsage();
+		return 2;
+	}
+	int count = atoi(argv[2]);
+	long evaluations = atol(argv[3]);
+	if (count <= 0 || count > FORMULA_MAX_POOL - 8 || evaluations <= 0){
+		PrintUsage();
+		return 2;
+	}
+	int failures = CheckFormulaLanguage();
+
+	enum { INPUTS = 8 };
+	FormulaSet set;
+	FormulaSetInit(&set);
+	int slotCount = INPUTS + count;
+	char (*names)[FORMULA_NAME_CHARS] = calloc((size_t)slotCount, sizeof(*names));
+	int *roots = malloc(sizeof(int) * (size_t)count);
+	double *values = calloc((size_t)slotCount, sizeof(double));
+	double *expected = calloc((size_t)slotCount, sizeof(double));
+	GenFormulas gen = {0};
+	gen.seed = 12345;
+	if (!names || !roots || !values || !expected){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int i = 0; i < INPUTS; i++){
+		snprintf(names[i], FORMULA_NAME_CHARS, "in%d", i);
+		FormulaSetInput(&set, names[i]);
+	}
+	//Every line may use the inputs and the lines before it.
+	for (int i = 0; i < count; i++){
+		snprintf(names[INPUTS + i], FORMULA_NAME_CHARS, "v%d", i);
+		GenAppend(&gen, names[INPUTS + i]);
+		GenAppend(&gen, " = ");
+		roots[i] = GenExpr(&gen, 1 + (int)(GenRandom(&gen) % 4), INPUTS + i, names);
+		GenAppend(&gen, "\n");
+	}
+
+	double compileStart = NowNs();
+	int compiled = FormulaSetCompile(&set, gen.text, gen.textSize);
+	double compileNs = NowNs() - compileStart;
+	if (!compiled){
+		printf("compile failed: %s at %d:%d\n", set.error, set.errorLine, set.errorColumn);
+		return 1;
+	}
+
+	uint64_t seed = 777;
+	double bytecodeNs = 0.0;
+	double treeNs = 0.0;
+	long mismatches = 0;
+	for (long e = 0; e < evaluations; e++){
+		for (int i = 0; i < INPUTS; i++){
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			values[i] = expected[i] = (double)((seed >> 33) % 20000) / 8.0 - 100.0;
+		}
+		double start = NowNs();
+		FormulaSetEval(&set, values);
+		double middle = NowNs();
+		for (int i = 0; i < count; i++){
+			expected[INPUTS + i] = GenEval(gen.nodes, roots[i], expected);
+		}
+		double end = NowNs();
+		bytecodeNs += middle - start;
+		treeNs += end - middle;
+		for (int i = 0; i < slotCount; i++){
+			mismatches += !SameValue(values[i], expected[i]);
+		}
+	}
+
+	printf("%d formulas, %lu bytes of text compiled in %.2f ms to %lu bytes of bytecode, %d constants, stack %d\n", count,
+		(unsigned long)gen.textSize, compileNs / 1e6, (unsigned long)set.codeSize, set.constCount, set.stackDepth);
+	printf("all formulas per input change: bytecode %.1f us, tree walk %.1f us (%.1fx), %ld results differ\n",
+		bytecodeNs / (double)evaluations / 1e3, treeNs / (double)evaluations / 1e3, treeNs / (bytecodeNs > 0 ? bytecodeNs : 1), mismatches);
+
+	int ok = failures == 0 && mismatches == 0 && bytecodeNs / (double)evaluations < 1e6;
+	printf("%s\n", ok ? "results identical, within 1 ms per input change" : "FAILED");
+	FormulaSetFree(&set);
+	free(gen.nodes);
+	free(gen.text);
+	free(names);
+	free(roots);
+	free(values);
+	free(expected);
+	return !ok;
+}
+
+
+int main(int argc, char **argv){
+
+	if (argc < 2){
+		PrintUsage();
+		return 2;
+	}
+
+	if (strcmp(argv[1], "demand") == 0){
+		return CmdDemand(argc, argv);
+	}
+	if (strcmp(argv[1], "bench") == 0){
+		return CmdBench(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-clicks") == 0){
+		return CmdBenchClicks(argc, argv);
+	}
+	if (strcmp(argv[1], "verify-agg") == 0){
+		return CmdVerifyAgg(argc, argv);
+	}
+	if (strcmp(argv[1], "chain") == 0){
+		return CmdChain(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-chain") == 0){
+		return CmdBenchChain(argc, argv);
+	}
+	if (strcmp(argv[1], "controls") == 0){
+		return CmdControls();
+	}
+	if (strcmp(argv[1], "import") == 0){
+		return CmdImport(argc, argv);
+	}
+	if (strcmp(argv[1], "gen-assets") == 0){
+		return CmdGenAssets(argc, argv);
+	}
+	if (strcmp(argv[1], "cache") == 0){
+		return CmdCache(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-startup") == 0){
+		return CmdBenchStartup(argc, argv);
+	}
+	if (strcmp(argv[1], "save") == 0){
+		return CmdSave(argc, argv);
+	}
+	if (strcmp(argv[1], "gen-save") == 0){
+		return CmdGenSave(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-save") == 0){
+		return CmdBenchSave(argc, argv);
+	}
+	if (strcmp(argv[1], "save-extract") == 0){
+		return CmdSaveExtract(argc, argv);
+	}
+	if (strcmp(argv[1], "filedb") == 0){
+		return CmdFileDb(argc, argv);
+	}
+	if (strcmp(argv[1], "empire") == 0){
+		return CmdEmpire(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-empire") == 0){
+		return CmdBenchEmpire(argc, argv);
+	}
+	if (strcmp(argv[1], "modifiers") == 0){
+		return CmdModifiers(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-modifiers") == 0){
+		return CmdBenchModifiers(argc, argv);
+	}
+	if (strcmp(argv[1], "optimize") == 0){
+		return CmdOptimize(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-optimize") == 0){
+		return CmdBenchOptimize(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-log") == 0){
+		return CmdBenchLog(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-blog") == 0){
+		return CmdBenchBinaryLog(argc, argv);
+	}
+	if (strcmp(argv[1], "gen-session") == 0){
+		return CmdGenSession(argc, argv);
+	}
+	if (strcmp(argv[1], "replay") == 0){
+		return CmdReplay(argc, argv);
+	}
+	if (strcmp(argv[1], "ui-flow") == 0){
+		return CmdUiFlow(argc, argv);
+	}
+	if (strcmp(argv[1], "raster-check") == 0){
+		return CmdRasterCheck(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-raster") == 0){
+		return CmdBenchRaster(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-text") == 0){
+		return CmdBenchText(argc, argv);
+	}
+	if (strcmp(argv[1], "hud-fixtures") == 0){
+		return CmdHudFixtures(argc, argv);
+	}
+	if (strcmp(argv[1], "hud-check") == 0){
+		return CmdHudCheck(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-hud") == 0){
+		return CmdBenchHud(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-tiles") == 0){
+		return CmdBenchTiles(argc, argv);
+	}
+	if (strcmp(argv[1], "game-standin") == 0){
+		return CmdGameStandin(argc, argv);
+	}
+	if (strcmp(argv[1], "game-read") == 0){
+		return CmdGameRead(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-game") == 0){
+		return CmdBenchGame(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-sampler") == 0){
+		return CmdBenchSampler(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-loop") == 0){
+		return CmdBenchLoop(argc, argv);
+	}
+	if (strcmp(argv[1], "formula") == 0){
+		return CmdFormula(argc, argv);
+	}
+	if (strcmp(argv[1], "bench-formula") == 0){
+		return CmdBenchFormula(argc, argv);
+	}
+
+	PrintUsage();
+	return 2;
+}
@@ -0,0 +1,249 @@
+#include <stdlib.h>	//malloc, calloc, free
+#include <string.h>	//memset, strcmp
+
+#include "chain.h"
+
+
+int ChainFindGood(const ChainDefinition *def, const char *name){
+	for (int i = 0; i < def->goodCount; i++){
+		if (strcmp(def->goods[i].name, name) == 0){
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+int ChainFindTier(const ChainDefinition *def, const char *name){
+	for (int i = 0; i < def->tierCount; i++){
+		if (strcmp(def->tiers[i].name, name) == 0){
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+void ChainPlanFree(ChainPlan *plan){
+	free(plan->slotGood);
+	free(plan->goodSlot);
+	free(plan->slotOutputPerMinute);
+	free(plan->edgeStart);
+	free(plan->edgeSlot);
+	free(plan->edgeFactor);
+	free(plan->needStart);
+	free(plan->needSlot);
+	free(plan->needRate);
+	memset(plan, 0, sizeof(*plan));
+}
+
+
+/* Orders the goods so that every good comes before all of its inputs (Kahn's algorithm). A good's
+ * "consumer count" is the number of buildings that use it as an input; goods nobody uses go first.
+ * Returns 0 if the inputs contain a cycle.
+ */
+static int TopologicalOrder(const ChainDefinition *def, int *order){
+
+	int n = def->goodCount;
+	int *consumers = calloc((size_t)n, sizeof(int));
+	if (!consumers){
+		return 0;
+	}
+
+	for (int g = 0; g < n; g++){
+		for (int i = 0; i < def->goods[g].inputCount; i++){
+			consumers[def->goods[g].inputs[i].good]++;
+		}
+	}
+
+	//order doubles as the queue: head reads from it, tail appends to it.
+	int head = 0;
+	int tail = 0;
+	for (int g = 0; g < n; g++){
+		if (consumers[g] == 0){
+			order[tail++] = g;
+		}
+	}
+
+	while (head < tail){
+		const ChainGoodDef *good = &def->goods[order[head++]];
+		for (int i = 0; i < good->inputCount; i++){
+			if (--consumers[good->inputs[i].good] == 0){
+				order[tail++] = good->inputs[i].good;
+			}
+		}
+	}
+
+	free(consumers);
+	return tail == n;
+}
+
+
+int ChainPlanBuild(ChainPlan *plan, const ChainDefinition *def){
+
+	memset(plan, 0, sizeof(*plan));
+
+	int n = def->goodCount;
+	int edgeCount = 0;
+	int needCount = 0;
+
+	for (int g = 0; g < n; g++){
+		const ChainGoodDef *good = &def->goods[g];
+		if (good->inputCount < 0 || good->inputCount > CHAIN_MAX_INPUTS || good->cycleSeconds <= 0.0){
+			return 0;
+		}
+		for (int i = 0; i < good->inputCount; i++){
+			if (good->inputs[i].good < 0 || good->inputs[i].good >= n){
+				return 0;
+			}
+		}
+		edgeCount += good->inputCount;
+	}
+	for (int t = 0; t < def->tierCount; t++){
+		for (int i = 0; i < def->tiers[t].needCount; i++){
+			if (def->tiers[t].needs[i].good < 0 || def->tiers[t].needs[i].good >= n){
+				return 0;
+			}
+		}
+		needCount += def->tiers[t].needCount;
+	}
+
+	plan->goodCount = n;
+	plan->tierCount = def->tierCount;
+	plan->slotGood = malloc(sizeof(int) * (size_t)(n + 1));
+	plan->goodSlot = malloc(sizeof(int) * (size_t)(n + 1));
+	plan->slotOutputPerMinute = malloc(sizeof(double) * (size_t)(n + 1));
+	plan->edgeStart = malloc(sizeof(int) * (size_t)(n + 1));
+	plan->edgeSlot = malloc(sizeof(int) * (size_t)(edgeCount + 1));
+	plan->edgeFactor = malloc(sizeof(double) * (size_t)(edgeCount + 1));
+	plan->needStart = malloc(sizeof(int) * (size_t)(def->tierCount + 1));
+	plan->needSlot = malloc(sizeof(int) * (size_t)(needCount + 1));
+	plan->needRate = malloc(sizeof(double) * (size_t)(needCount + 1));
+
+	if (!plan->slotGood || !plan->goodSlot || !plan->slotOutputPerMinute || !plan->edgeStart || !plan->edgeSlot ||
+	    !plan->edgeFactor || !plan->needStart || !plan->needSlot || !plan->needRate){
+		ChainPlanFree(plan);
+		return 0;
+	}
+
+	if (!TopologicalOrder(def, plan->slotGood)){
+		ChainPlanFree(plan);
+		return 0;
+	}
+
+	for (int s = 0; s < n; s++){
+		plan->goodSlot[plan->slotGood[s]] = s;
+	}
+
+	int e = 0;
+	for (int s = 0; s < n; s++){
+		const ChainGoodDef *good = &def->goods[plan->slotGood[s]];
+		plan->slotOutputPerMinute[s] = 60.0 / good->cycleSeconds;
+		plan->edgeStart[s] = e;
+		for (int i = 0; i < good->inputCount; i++){
+			plan->edgeSlot[e] = plan->goodSlot[good->inputs[i].good];
+			plan->edgeFactor[e] = good->inputs[i].amount;
+			e++;
+		}
+	}
+	plan->edgeStart[n] = e;
+
+	int k = 0;
+	for (int t = 0; t < def->tierCount; t++){
+		plan->needStart[t] = k;
+		for (int i = 0; i < def->tiers[t].needCount; i++){
+			plan->needSlot[k] = plan->goodSlot[def->tiers[t].needs[i].good];
+			plan->needRate[k] = def->tiers[t].needs[i].perResident;
+			k++;
+		}
+	}
+	plan->needStart[def->tierCount] = k;
+
+	return 1;
+}
+
+
+int ChainResultInit(ChainResult *result, const ChainPlan *plan){
+	result->tonsPerMinute = calloc((size_t)plan->goodCount + 1, sizeof(double));
+	result->buildings = calloc((size_t)plan->goodCount + 1, sizeof(double));
+	if (!result->tonsPerMinute || !result->buildings){
+		ChainResultFree(result);
+		return 0;
+	}
+	return 1;
+}
+
+
+void ChainResultFree(ChainResult *result){
+	free(result->tonsPerMinute);
+	free(result->buildings);
+	result->tonsPerMinute = NULL;
+	result->buildings = NULL;
+}
+
+
+/* The pass in topological order of ChainSolveModified. When slot s is reached every consumer of it has
+ * already been visited, so required[s] is final and can be pushed down to the inputs. Inlined twice, with
+ * and without supply, so the plain solve does not test for it on every slot.
+ */
+static inline void Resolve(const ChainPlan *plan, double *required, const double *output, const double *supply,
+	ChainResult *out){
+
+	for (int s = 0; s < plan->goodCount; s++){
+		double amount = required[s];
+		if (supply){
+			//Written so that it becomes a max instruction rather than a branch on every slot.
+			double net = amount - supply[s];
+			amount = net > 0.0 ? net : 0.0;
+		}
+		for (int e = plan->edgeStart[s]; e < plan->edgeStart[s + 1]; e++){
+			required[plan->edgeSlot[e]] += amount * plan->edgeFactor[e];
+		}
+
+		int g = plan->slotGood[s];
+		out->tonsPerMinute[g] = amount;
+		out->buildings[g] = amount / output[s];
+	}
+}
+
+
+void ChainSolve(const ChainPlan *plan, const double *residents, ChainResult *out, double *scratch){
+	ChainSolveModified(plan, residents, NULL, out, scratch);
+}
+
+
+void ChainSolveModified(const ChainPlan *plan, const double *residents, const ChainModifiers *modifiers, ChainResult *out,
+	double *scratch){
+
+	int n = plan->goodCount;
+	double *required = scratch;
+	memset(required, 0, sizeof(double) * (size_t)n);
+
+	//Seed the required amounts with what the residents consume directly.
+	for (int t = 0; t < plan->tierCount; t++){
+		double r = residents[t];
+		for (int k = plan->needStart[t]; k < plan->needStart[t + 1]; k++){
+			required[plan->needSlot[k]] += r * plan->needRate[k];
+		}
+	}
+
+	//A missing vector changes nothing: a scale of 1, no supply, the plan's output.
+	const ChainModifiers none = {NULL, NULL, NULL};
+	if (!modifiers){
+		modifiers = &none;
+	}
+	if (modifiers->needScale){
+		//Straight over contiguous arrays, so the compiler vectorises it.
+		const double *scale = modifiers->needScale;
+		for (int s = 0; s < n; s++){
+			required[s] *= scale[s];
+		}
+	}
+	const double *output = modifiers->outputPerMinute ? modifiers->outputPerMinute : plan->slotOutputPerMinute;
+	if (modifiers->supply){
+		Resolve(plan, required, output, modifiers->supply, out);
+	}
+	else{
+		Resolve(plan, required, output, NULL, out);
+	}
+}
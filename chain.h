@@ -0,0 +1,205 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+/* Production chain solver for every population tier.
+ *
+ * The chains are described by a ChainDefinition (goods, the building that makes each good and its inputs,
+ * and the needs of every tier). ChainPlanBuild flattens that description once into a ChainPlan: the goods
+ * are renumbered in topological order (finished goods first, raw materials last) and the inputs and needs
+ * are stored as flat index/factor arrays. ChainSolve then resolves the whole chain, from the residents of
+ * every tier down to the raw materials, in one forward pass over those arrays.
+ */
+
+
+//Most inputs a single production building can have.
+#define CHAIN_MAX_INPUTS 3
+
+
+/* The session (map region) a building or tier belongs to. SESSION_COUNT sizes arrays.
+ */
+typedef enum Session {
+	SESSION_OldWorld,
+	SESSION_NewWorld,
+	SESSION_Arctic,
+	SESSION_Enbesa,
+	SESSION_COUNT
+} Session;
+
+
+/* One input of a production building.
+ *
+ * good : index of the input good in ChainDefinition.goods
+ * amount : tons of the input used per ton of output
+ */
+typedef struct ChainInput {
+	int good;
+	double amount;
+} ChainInput;
+
+
+/* A good and the building that produces it.
+ *
+ * name : name of the good
+ * buildingName : name of the building that makes it
+ * session : where the building is built
+ * cycleSeconds : length of one production cycle at 100% productivity
+ * inputs / inputCount : the goods consumed per ton of output
+ */
+typedef struct ChainGoodDef {
+	const char *name;
+	const char *buildingName;
+	Session session;
+	double cycleSeconds;
+	ChainInput inputs[CHAIN_MAX_INPUTS];
+	int inputCount;
+} ChainGoodDef;
+
+
+/* One need of a population tier.
+ *
+ * good : index of the good in ChainDefinition.goods
+ * perResident : tons per minute a single resident consumes
+ */
+typedef struct ChainNeedDef {
+	int good;
+	double perResident;
+} ChainNeedDef;
+
+
+/* A population tier and what its residents consume.
+ */
+typedef struct ChainTierDef {
+	const char *name;
+	Session session;
+	int residentsPerHouse;
+	const ChainNeedDef *needs;
+	int needCount;
+} ChainTierDef;
+
+
+/* Another building that makes an existing good, e.g. a coal mine next to the charcoal kiln. ChainSolve only
+ * uses the building of ChainGoodDef; the optimizer (optimizer.h) chooses between all of them.
+ *
+ * good : index of the good in ChainDefinition.goods
+ * buildingName / cycleSeconds / inputs / inputCount : as in ChainGoodDef
+ */
+typedef struct ChainAlternativeDef {
+	int good;
+	const char *buildingName;
+	double cycleSeconds;
+	ChainInput inputs[CHAIN_MAX_INPUTS];
+	int inputCount;
+} ChainAlternativeDef;
+
+
+typedef struct ChainDefinition {
+	const ChainGoodDef *goods;
+	int goodCount;
+	const ChainTierDef *tiers;
+	int tierCount;
+	const ChainAlternativeDef *alternatives;
+	int alternativeCount;
+} ChainDefinition;
+
+
+/* The flattened, topologically sorted form of a ChainDefinition. All arrays indexed by "slot" are in
+ * solve order; slotGood maps a slot back to the good index of the definition.
+ *
+ * goodCount / tierCount : sizes of the definition
+ * slotGood / goodSlot : slot -> good and good -> slot
+ * slotOutputPerMinute : tons per minute one building of the slot makes
+ * edgeStart : inputs of slot s are edges edgeStart[s] .. edgeStart[s + 1] - 1
+ * edgeSlot / edgeFactor : input slot and tons of input per ton of output (edgeSlot[e] > s always)
+ * needStart : needs of tier t are needStart[t] .. needStart[t + 1] - 1
+ * needSlot / needRate : slot of the needed good and tons per minute per resident
+ */
+typedef struct ChainPlan {
+	int goodCount;
+	int tierCount;
+
+	int *slotGood;
+	int *goodSlot;
+	double *slotOutputPerMinute;
+
+	int *edgeStart;
+	int *edgeSlot;
+	double *edgeFactor;
+
+	int *needStart;
+	int *needSlot;
+	double *needRate;
+} ChainPlan;
+
+
+/* Result of a solve, indexed by good (not by slot).
+ *
+ * tonsPerMinute : total amount of each good needed, by residents and by the buildings further up the chain
+ * buildings : production buildings needed at 100% productivity (fractional)
+ */
+typedef struct ChainResult {
+	double *tonsPerMinute;
+	double *buildings;
+} ChainResult;
+
+
+/* Per-slot adjustments of a solve, e.g. items and buffs compiled by modifier.h. Every array is indexed by
+ * slot, like the plan, and has plan->goodCount entries; a NULL array changes nothing (a scale of 1, no supply,
+ * the plan's slotOutputPerMinute).
+ *
+ * needScale : factor on what the residents consume of a slot (0.8: 20 % less)
+ * supply : tons per minute of a slot that come from elsewhere (extra outputs of items), taken off the total
+ * outputPerMinute : tons per minute one building of the slot makes, replaces slotOutputPerMinute
+ */
+typedef struct ChainModifiers {
+	const double *needScale;
+	const double *supply;
+	const double *outputPerMinute;
+} ChainModifiers;
+
+
+/* The built-in chain data (chain_data.c).
+ */
+const ChainDefinition *ChainBuiltinDefinition(void);
+
+
+/* Returns the index of the good or tier with the given name, or -1 if there is none.
+ */
+int ChainFindGood(const ChainDefinition *def, const char *name);
+int ChainFindTier(const ChainDefinition *def, const char *name);
+
+
+/* Flattens def into plan. Returns 1 on success, 0 if memory ran out, an index is out of range or the
+ * inputs form a cycle. The plan does not keep a pointer to def.
+ */
+int ChainPlanBuild(ChainPlan *plan, const ChainDefinition *def);
+
+
+void ChainPlanFree(ChainPlan *plan);
+
+
+/* Allocates the two result arrays for a plan. Returns 0 if memory ran out.
+ */
+int ChainResultInit(ChainResult *result, const ChainPlan *plan);
+
+
+void ChainResultFree(ChainResult *result);
+
+
+/* Resolves the full chain.
+ *
+ * const ChainPlan *plan : the flattened chains
+ * const double *residents : number of residents of each tier, indexed like ChainDefinition.tiers
+ * ChainResult *out : receives the totals (allocated with ChainResultInit)
+ * double *scratch : plan->goodCount doubles of working space
+ */
+void ChainSolve(const ChainPlan *plan, const double *residents, ChainResult *out, double *scratch);
+
+
+/* ChainSolve with modifiers applied, NULL for none. The residents' needs are scaled in one pass over the
+ * slots before the chain is resolved; a supply is taken off a good's total (never below 0) before it is
+ * pushed down to the inputs.
+ */
+void ChainSolveModified(const ChainPlan *plan, const double *residents, const ChainModifiers *modifiers, ChainResult *out,
+	double *scratch);
+
+#endif
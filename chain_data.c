@@ -0,0 +1,327 @@
+#include "chain.h"
+
+
+/* Built-in production chains for all population tiers.
+ *
+ * These are approximate values for a building without items, electricity or trade union bonuses, and
+ * every building makes one ton per cycle. Consumption is written as "output of one building per minute /
+ * residents one building supplies", e.g. a fishery (30s cycle, 2 t/min) supplies 800 farmers.
+ */
+
+
+//Index of every good in g_goods. Only used to make the tables below readable.
+enum {
+	CG_Fish,
+	CG_Wool,
+	CG_Potatoes,
+	CG_Pigs,
+	CG_Grain,
+	CG_Hops,
+	CG_Wood,
+	CG_Clay,
+	CG_Iron,
+	CG_QuartzSand,
+	CG_Copper,
+	CG_Zinc,
+	CG_Beef,
+	CG_RedPeppers,
+	CG_Furs,
+	CG_Grapes,
+	CG_Timber,
+	CG_Coal,
+	CG_Flour,
+	CG_Bread,
+	CG_Sausages,
+	CG_Malt,
+	CG_Beer,
+	CG_Tallow,
+	CG_Soap,
+	CG_Schnapps,
+	CG_WorkClothes,
+	CG_Bricks,
+	CG_Steel,
+	CG_SewingMachines,
+	CG_Goulash,
+	CG_CannedFood,
+	CG_FurCoats,
+	CG_Glass,
+	CG_Brass,
+	CG_Spectacles,
+	CG_Gold,
+	CG_PocketWatches,
+	CG_HighWheelers,
+	CG_Champagne,
+	CG_Jewelry,
+	CG_Gramophones,
+	CG_Sugar,
+	CG_Chocolate,
+	CG_Cigars,
+	CG_Coffee,
+	CG_SugarCane,
+	CG_Cotton,
+	CG_CottonFabric,
+	CG_Caoutchouc,
+	CG_CoffeeBeans,
+	CG_Tobacco,
+	CG_Cocoa,
+	CG_Pearls,
+	CG_GoldOre,
+	CG_Rum,
+	CG_Plantains,
+	CG_FishOil,
+	CG_FriedPlantains,
+	CG_AlpacaWool,
+	CG_Ponchos,
+	CG_Corn,
+	CG_Tortillas,
+	CG_Felt,
+	CG_BowlerHats,
+	CG_CaribouMeat,
+	CG_WhaleOil,
+	CG_Pemmican,
+	CG_OilLamps,
+	CG_GooseFeathers,
+	CG_SealSkin,
+	CG_SleepingBags,
+	CG_BearFur,
+	CG_Parkas,
+	CG_Sleds,
+	CG_GoatMilk,
+	CG_Teff,
+	CG_Spices,
+	CG_Wat,
+	CG_HibiscusPetals,
+	CG_HibiscusTea,
+	CG_Linseed,
+	CG_Linen,
+	CG_Indigo,
+	CG_Tapestries,
+	CG_Ceramics,
+	CG_Lanterns,
+	CG_COUNT
+};
+
+
+static const ChainGoodDef g_goods[CG_COUNT] = {
+	[CG_Fish]           = { "Fish",            "Fishery",                 SESSION_OldWorld,  30, { { 0 } }, 0 },
+	[CG_Wool]           = { "Wool",            "Sheep Farm",              SESSION_OldWorld,  30, { { 0 } }, 0 },
+	[CG_Potatoes]       = { "Potatoes",        "Potato Farm",             SESSION_OldWorld,  60, { { 0 } }, 0 },
+	[CG_Pigs]           = { "Pigs",            "Pig Farm",                SESSION_OldWorld,  60, { { 0 } }, 0 },
+	[CG_Grain]          = { "Grain",           "Grain Farm",              SESSION_OldWorld,  60, { { 0 } }, 0 },
+	[CG_Hops]           = { "Hops",            "Hop Farm",                SESSION_OldWorld,  90, { { 0 } }, 0 },
+	[CG_Wood]           = { "Wood",            "Lumberjack's Hut",        SESSION_OldWorld,  15, { { 0 } }, 0 },
+	[CG_Clay]           = { "Clay",            "Clay Pit",                SESSION_OldWorld,  30, { { 0 } }, 0 },
+	[CG_Iron]           = { "Iron",            "Iron Mine",               SESSION_OldWorld,  15, { { 0 } }, 0 },
+	[CG_QuartzSand]     = { "Quartz Sand",     "Sand Mine",               SESSION_OldWorld,  30, { { 0 } }, 0 },
+	[CG_Copper]         = { "Copper",          "Copper Mine",             SESSION_OldWorld,  30, { { 0 } }, 0 },
+	[CG_Zinc]           = { "Zinc",            "Zinc Mine",               SESSION_OldWorld,  30, { { 0 } }, 0 },
+	[CG_Beef]           = { "Beef",            "Cattle Farm",             SESSION_OldWorld, 120, { { 0 } }, 0 },
+	[CG_RedPeppers]     = { "Red Peppers",     "Red Pepper Farm",         SESSION_OldWorld, 120, { { 0 } }, 0 },
+	[CG_Furs]           = { "Furs",            "Hunting Cabin",           SESSION_OldWorld,  30, { { 0 } }, 0 },
+	[CG_Grapes]         = { "Grapes",          "Vineyard",                SESSION_OldWorld, 120, { { 0 } }, 0 },
+	[CG_Timber]         = { "Timber",          "Sawmill",                 SESSION_OldWorld,  15, { { CG_Wood, 1.0 } }, 1 },
+	[CG_Coal]           = { "Coal",            "Charcoal Kiln",           SESSION_OldWorld,  30, { { CG_Wood, 1.0 } }, 1 },
+	[CG_Flour]          = { "Flour",           "Flour Mill",              SESSION_OldWorld,  30, { { CG_Grain, 1.0 } }, 1 },
+	[CG_Bread]          = { "Bread",           "Bakery",                  SESSION_OldWorld,  60, { { CG_Flour, 1.0 } }, 1 },
+	[CG_Sausages]       = { "Sausages",        "Slaughterhouse",          SESSION_OldWorld,  60, { { CG_Pigs, 1.0 } }, 1 },
+	[CG_Malt]           = { "Malt",            "Malthouse",               SESSION_OldWorld,  30, { { CG_Grain, 1.0 } }, 1 },
+	[CG_Beer]           = { "Beer",            "Brewery",                 SESSION_OldWorld,  60, { { CG_Malt, 1.0 }, { CG_Hops, 1.0 } }, 2 },
+	[CG_Tallow]         = { "Tallow",          "Rendering Works",         SESSION_OldWorld,  60, { { CG_Pigs, 1.0 } }, 1 },
+	[CG_Soap]           = { "Soap",            "Soap Factory",            SESSION_OldWorld,  30, { { CG_Tallow, 1.0 } }, 1 },
+	[CG_Schnapps]       = { "Schnapps",        "Schnapps Distillery",     SESSION_OldWorld,  30, { { CG_Potatoes, 1.0 } }, 1 },
+	[CG_WorkClothes]    = { "Work Clothes",    "Framework Knitters",      SESSION_OldWorld,  30, { { CG_Wool, 1.0 } }, 1 },
+	[CG_Bricks]         = { "Bricks",          "Brick Factory",           SESSION_OldWorld,  60, { { CG_Clay, 1.0 } }, 1 },
+	[CG_Steel]          = { "Steel",           "Furnace",                 SESSION_OldWorld,  30, { { CG_Iron, 1.0 }, { CG_Coal, 1.0 } }, 2 },
+	[CG_SewingMachines] = { "Sewing Machines", "Sewing Machine Factory",  SESSION_OldWorld,  30, { { CG_Timber, 1.0 }, { CG_Steel, 1.0 } }, 2 },
+	[CG_Goulash]        = { "Goulash",         "Artisanal Kitchen",       SESSION_OldWorld, 120, { { CG_Beef, 1.0 }, { CG_RedPeppers, 1.0 } }, 2 },
+	[CG_CannedFood]     = { "Canned Food",     "Cannery",                 SESSION_OldWorld,  90, { { CG_Iron, 1.0 }, { CG_Goulash, 1.0 } }, 2 },
+	[CG_FurCoats]       = { "Fur Coats",       "Fur Dealer",              SESSION_OldWorld,  30, { { CG_Furs, 1.0 }, { CG_CottonFabric, 1.0 } }, 2 },
+	[CG_Glass]          = { "Glass",           "Glassmakers",             SESSION_OldWorld,  30, { { CG_QuartzSand, 1.0 } }, 1 },
+	[CG_Brass]          = { "Brass",           "Brass Smeltery",          SESSION_OldWorld,  60, { { CG_Copper, 1.0 }, { CG_Zinc, 1.0 } }, 2 },
+	[CG_Spectacles]     = { "Spectacles",      "Spectacle Factory",       SESSION_OldWorld,  90, { { CG_Glass, 1.0 }, { CG_Brass, 1.0 } }, 2 },
+	[CG_Gold]           = { "Gold",            "Goldsmiths",              SESSION_OldWorld,  60, { { CG_Coal, 1.0 }, { CG_GoldOre, 1.0 } }, 2 },
+	[CG_PocketWatches]  = { "Pocket Watches",  "Clockmakers",             SESSION_OldWorld,  90, { { CG_Glass, 1.0 }, { CG_Gold, 1.0 } }, 2 },
+	[CG_HighWheelers]   = { "High-Wheelers",   "High-Wheeler Factory",    SESSION_OldWorld,  30, { { CG_Steel, 1.0 }, { CG_Caoutchouc, 1.0 } }, 2 },
+	[CG_Champagne]      = { "Champagne",       "Champagne Cellar",        SESSION_OldWorld, 120, { { CG_Glass, 1.0 }, { CG_Grapes, 1.0 } }, 2 },
+	[CG_Jewelry]        = { "Jewelry",         "Jeweller",                SESSION_OldWorld,  60, { { CG_Pearls, 1.0 }, { CG_Gold, 1.0 } }, 2 },
+	[CG_Gramophones]    = { "Gramophones",     "Gramophone Factory",      SESSION_OldWorld, 120, { { CG_Brass, 1.0 }, { CG_Wood, 1.0 } }, 2 },
+	[CG_Sugar]          = { "Sugar",           "Sugar Refinery",          SESSION_OldWorld,  30, { { CG_SugarCane, 1.0 } }, 1 },
+	[CG_Chocolate]      = { "Chocolate",       "Chocolate Factory",       SESSION_OldWorld,  60, { { CG_Cocoa, 1.0 }, { CG_Sugar, 1.0 } }, 2 },
+	[CG_Cigars]         = { "Cigars",          "Cigar Factory",           SESSION_OldWorld,  60, { { CG_Tobacco, 1.0 }, { CG_Wood, 1.0 } }, 2 },
+	[CG_Coffee]         = { "Coffee",          "Coffee Roaster",          SESSION_NewWorld,  30, { { CG_CoffeeBeans, 1.0 } }, 1 },
+	[CG_SugarCane]      = { "Sugar Cane",      "Sugar Cane Plantation",   SESSION_NewWorld,  30, { { 0 } }, 0 },
+	[CG_Cotton]         = { "Cotton",          "Cotton Plantation",       SESSION_NewWorld,  60, { { 0 } }, 0 },
+	[CG_CottonFabric]   = { "Cotton Fabric",   "Cotton Mill",             SESSION_NewWorld,  30, { { CG_Cotton, 1.0 } }, 1 },
+	[CG_Caoutchouc]     = { "Caoutchouc",      "Caoutchouc Plantation",   SESSION_NewWorld,  60, { { 0 } }, 0 },
+	[CG_CoffeeBeans]    = { "Coffee Beans",    "Coffee Plantation",       SESSION_NewWorld, 120, { { 0 } }, 0 },
+	[CG_Tobacco]        = { "Tobacco",         "Tobacco Plantation",      SESSION_NewWorld, 120, { { 0 } }, 0 },
+	[CG_Cocoa]          = { "Cocoa",           "Cocoa Plantation",        SESSION_NewWorld,  60, { { 0 } }, 0 },
+	[CG_Pearls]         = { "Pearls",          "Pearl Farm",              SESSION_NewWorld,  90, { { 0 } }, 0 },
+	[CG_GoldOre]        = { "Gold Ore",        "Gold Mine",               SESSION_NewWorld, 150, { { 0 } }, 0 },
+	[CG_Rum]            = { "Rum",             "Rum Distillery",          SESSION_NewWorld,  30, { { CG_SugarCane, 1.0 }, { CG_Wood, 1.0 } }, 2 },
+	[CG_Plantains]      = { "Plantains",       "Plantain Plantation",     SESSION_NewWorld,  30, { { 0 } }, 0 },
+	[CG_FishOil]        = { "Fish Oil",        "Fish Oil Factory",        SESSION_NewWorld,  30, { { 0 } }, 0 },
+	[CG_FriedPlantains] = { "Fried Plantains", "Fried Plantain Kitchen",  SESSION_NewWorld,  60, { { CG_Plantains, 1.0 }, { CG_FishOil, 1.0 } }, 2 },
+	[CG_AlpacaWool]     = { "Alpaca Wool",     "Alpaca Farm",             SESSION_NewWorld,  30, { { 0 } }, 0 },
+	[CG_Ponchos]        = { "Ponchos",         "Poncho Darner",           SESSION_NewWorld,  30, { { CG_AlpacaWool, 1.0 } }, 1 },
+	[CG_Corn]           = { "Corn",            "Corn Farm",               SESSION_NewWorld,  60, { { 0 } }, 0 },
+	[CG_Tortillas]      = { "Tortillas",       "Tortilla Maker",          SESSION_NewWorld,  60, { { CG_Corn, 1.0 }, { CG_Beef, 1.0 } }, 2 },
+	[CG_Felt]           = { "Felt",            "Felt Producer",           SESSION_NewWorld,  60, { { CG_AlpacaWool, 1.0 } }, 1 },
+	[CG_BowlerHats]     = { "Bowler Hats",     "Bowler Hat Factory",      SESSION_NewWorld,  60, { { CG_Felt, 1.0 }, { CG_CottonFabric, 1.0 } }, 2 },
+	[CG_CaribouMeat]    = { "Caribou Meat",    "Caribou Hunting Cabin",   SESSION_Arctic,    60, { { 0 } }, 0 },
+	[CG_WhaleOil]       = { "Whale Oil",       "Whaling Station",         SESSION_Arctic,    60, { { 0 } }, 0 },
+	[CG_Pemmican]       = { "Pemmican",        "Pemmican Cookhouse",      SESSION_Arctic,    90, { { CG_CaribouMeat, 1.0 }, { CG_WhaleOil, 1.0 } }, 2 },
+	[CG_OilLamps]       = { "Oil Lamps",       "Oil Lamp Factory",        SESSION_Arctic,    90, { { CG_WhaleOil, 1.0 }, { CG_Brass, 1.0 } }, 2 },
+	[CG_GooseFeathers]  = { "Goose Feathers",  "Goose Farm",              SESSION_Arctic,    60, { { 0 } }, 0 },
+	[CG_SealSkin]       = { "Seal Skin",       "Seal Hunting Docks",      SESSION_Arctic,    60, { { 0 } }, 0 },
+	[CG_SleepingBags]   = { "Sleeping Bags",   "Sleeping Bag Factory",    SESSION_Arctic,    60, { { CG_GooseFeathers, 1.0 }, { CG_SealSkin, 1.0 } }, 2 },
+	[CG_BearFur]        = { "Bear Fur",        "Bear Hunting Cabin",      SESSION_Arctic,    60, { { 0 } }, 0 },
+	[CG_Parkas]         = { "Parkas",          "Parka Factory",           SESSION_Arctic,    60, { { CG_BearFur, 1.0 }, { CG_SealSkin, 1.0 } }, 2 },
+	[CG_Sleds]          = { "Sleds",           "Sled Frame Factory",      SESSION_Arctic,    60, { { CG_Timber, 1.0 }, { CG_Brass, 1.0 } }, 2 },
+	[CG_GoatMilk]       = { "Goat Milk",       "Goat Farm",               SESSION_Enbesa,    60, { { 0 } }, 0 },
+	[CG_Teff]           = { "Teff",            "Teff Farm",               SESSION_Enbesa,    60, { { 0 } }, 0 },
+	[CG_Spices]         = { "Spices",          "Spice Farm",              SESSION_Enbesa,    60, { { 0 } }, 0 },
+	[CG_Wat]            = { "Wat",             "Wat Kitchen",             SESSION_Enbesa,    60, { { CG_Teff, 1.0 }, { CG_Spices, 1.0 } }, 2 },
+	[CG_HibiscusPetals] = { "Hibiscus Petals", "Hibiscus Farm",           SESSION_Enbesa,    60, { { 0 } }, 0 },
+	[CG_HibiscusTea]    = { "Hibiscus Tea",    "Tea Spicer",              SESSION_Enbesa,    60, { { CG_HibiscusPetals, 1.0 }, { CG_Spices, 1.0 } }, 2 },
+	[CG_Linseed]        = { "Linseed",         "Linseed Farm",            SESSION_Enbesa,    60, { { 0 } }, 0 },
+	[CG_Linen]          = { "Linen",           "Linen Mill",              SESSION_Enbesa,    60, { { CG_Linseed, 1.0 } }, 1 },
+	[CG_Indigo]         = { "Indigo",          "Indigo Farm",             SESSION_Enbesa,    60, { { 0 } }, 0 },
+	[CG_Tapestries]     = { "Tapestries",      "Embroiderer",             SESSION_Enbesa,    60, { { CG_Linen, 1.0 }, { CG_Indigo, 1.0 } }, 2 },
+	[CG_Ceramics]       = { "Ceramics",        "Ceramics Workshop",       SESSION_Enbesa,    60, { { CG_Clay, 1.0 } }, 1 },
+	[CG_Lanterns]       = { "Lanterns",        "Lanternsmith",            SESSION_Enbesa,    60, { { CG_Ceramics, 1.0 }, { CG_Linen, 1.0 } }, 2 },
+};
+
+static const ChainNeedDef g_needsFarmers[] = {
+	{ CG_Fish,             2.0 / 800.0 },
+	{ CG_WorkClothes,      2.0 / 650.0 },
+	{ CG_Schnapps,         2.0 / 600.0 },
+};
+
+static const ChainNeedDef g_needsWorkers[] = {
+	{ CG_Fish,             2.0 / 800.0 },
+	{ CG_WorkClothes,      2.0 / 650.0 },
+	{ CG_Schnapps,         2.0 / 1200.0 },
+	{ CG_Sausages,         1.0 / 1000.0 },
+	{ CG_Bread,            1.0 / 1100.0 },
+	{ CG_Soap,             2.0 / 2400.0 },
+	{ CG_Beer,             1.0 / 2600.0 },
+};
+
+static const ChainNeedDef g_needsArtisans[] = {
+	{ CG_Sausages,         1.0 / 500.0 },
+	{ CG_Bread,            1.0 / 550.0 },
+	{ CG_Soap,             2.0 / 1600.0 },
+	{ CG_Beer,             1.0 / 1300.0 },
+	{ CG_CannedFood,       (60.0 / 90.0) / 1750.0 },
+	{ CG_SewingMachines,   2.0 / 1300.0 },
+	{ CG_Rum,              2.0 / 1400.0 },
+	{ CG_FurCoats,         2.0 / 1900.0 },
+};
+
+static const ChainNeedDef g_needsEngineers[] = {
+	{ CG_Beer,             1.0 / 650.0 },
+	{ CG_CannedFood,       (60.0 / 90.0) / 900.0 },
+	{ CG_SewingMachines,   2.0 / 650.0 },
+	{ CG_Rum,              2.0 / 700.0 },
+	{ CG_FurCoats,         2.0 / 950.0 },
+	{ CG_Spectacles,       (60.0 / 90.0) / 1800.0 },
+	{ CG_Coffee,           2.0 / 1700.0 },
+	{ CG_HighWheelers,     2.0 / 3400.0 },
+	{ CG_PocketWatches,    (60.0 / 90.0) / 3700.0 },
+};
+
+static const ChainNeedDef g_needsInvestors[] = {
+	{ CG_Spectacles,       (60.0 / 90.0) / 900.0 },
+	{ CG_Coffee,           2.0 / 850.0 },
+	{ CG_HighWheelers,     2.0 / 1700.0 },
+	{ CG_PocketWatches,    (60.0 / 90.0) / 1850.0 },
+	{ CG_Champagne,        0.5 / 2500.0 },
+	{ CG_Cigars,           1.0 / 3000.0 },
+	{ CG_Chocolate,        1.0 / 3400.0 },
+	{ CG_Jewelry,          1.0 / 3500.0 },
+	{ CG_Gramophones,      0.5 / 5000.0 },
+};
+
+static const ChainNeedDef g_needsJornaleros[] = {
+	{ CG_FriedPlantains,   1.0 / 700.0 },
+	{ CG_Ponchos,          2.0 / 1000.0 },
+	{ CG_Rum,              2.0 / 500.0 },
+};
+
+static const ChainNeedDef g_needsObreros[] = {
+	{ CG_FriedPlantains,   1.0 / 700.0 },
+	{ CG_Ponchos,          2.0 / 1000.0 },
+	{ CG_Rum,              2.0 / 1000.0 },
+	{ CG_Tortillas,        1.0 / 800.0 },
+	{ CG_Coffee,           2.0 / 1500.0 },
+	{ CG_BowlerHats,       1.0 / 1600.0 },
+};
+
+static const ChainNeedDef g_needsExplorers[] = {
+	{ CG_Pemmican,         (60.0 / 90.0) / 350.0 },
+	{ CG_OilLamps,         (60.0 / 90.0) / 400.0 },
+	{ CG_SleepingBags,     1.0 / 400.0 },
+};
+
+static const ChainNeedDef g_needsTechnicians[] = {
+	{ CG_Pemmican,         (60.0 / 90.0) / 700.0 },
+	{ CG_OilLamps,         (60.0 / 90.0) / 800.0 },
+	{ CG_SleepingBags,     1.0 / 800.0 },
+	{ CG_Parkas,           1.0 / 600.0 },
+	{ CG_Sleds,            1.0 / 900.0 },
+};
+
+static const ChainNeedDef g_needsShepherds[] = {
+	{ CG_GoatMilk,         1.0 / 550.0 },
+	{ CG_Wat,              1.0 / 650.0 },
+	{ CG_HibiscusTea,      1.0 / 800.0 },
+};
+
+static const ChainNeedDef g_needsElders[] = {
+	{ CG_GoatMilk,         1.0 / 1100.0 },
+	{ CG_Wat,              1.0 / 1300.0 },
+	{ CG_HibiscusTea,      1.0 / 1600.0 },
+	{ CG_Tapestries,       1.0 / 1400.0 },
+	{ CG_Ceramics,         1.0 / 1300.0 },
+	{ CG_Lanterns,         1.0 / 1800.0 },
+};
+
+
+//Number of entries in a static array.
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+
+static const ChainTierDef g_tiers[] = {
+	{ "Farmers",     SESSION_OldWorld, 10, g_needsFarmers, COUNT_OF(g_needsFarmers) },
+	{ "Workers",     SESSION_OldWorld, 20, g_needsWorkers, COUNT_OF(g_needsWorkers) },
+	{ "Artisans",    SESSION_OldWorld, 30, g_needsArtisans, COUNT_OF(g_needsArtisans) },
+	{ "Engineers",   SESSION_OldWorld, 40, g_needsEngineers, COUNT_OF(g_needsEngineers) },
+	{ "Investors",   SESSION_OldWorld, 50, g_needsInvestors, COUNT_OF(g_needsInvestors) },
+	{ "Jornaleros",  SESSION_NewWorld, 10, g_needsJornaleros, COUNT_OF(g_needsJornaleros) },
+	{ "Obreros",     SESSION_NewWorld, 20, g_needsObreros, COUNT_OF(g_needsObreros) },
+	{ "Explorers",   SESSION_Arctic,   10, g_needsExplorers, COUNT_OF(g_needsExplorers) },
+	{ "Technicians", SESSION_Arctic,   20, g_needsTechnicians, COUNT_OF(g_needsTechnicians) },
+	{ "Shepherds",   SESSION_Enbesa,   10, g_needsShepherds, COUNT_OF(g_needsShepherds) },
+	{ "Elders",      SESSION_Enbesa,   20, g_needsElders, COUNT_OF(g_needsElders) },
+};
+
+
+/* Buildings that make a good in a second way. A coal mine needs a coal deposit, so how many can be built
+ * depends on the island (see OptimizerSetLimit).
+ */
+static const ChainAlternativeDef g_alternatives[] = {
+	{ CG_Coal,       "Coal Mine",             15, { { 0 } }, 0 },
+};
+
+
+static const ChainDefinition g_builtin = {
+	g_goods, CG_COUNT,
+	g_tiers, COUNT_OF(g_tiers),
+	g_alternatives, COUNT_OF(g_alternatives)
+};
+
+
+const ChainDefinition *ChainBuiltinDefinition(void){
+	return &g_builtin;
+}
@@ -0,0 +1,137 @@
+#include "controls.h"
+
+/* Two table entries writing the same array element (two controls with the same ID, or two displays for the
+ * same good) is turned from a warning into an error, which makes the designated initializers below the
+ * collision check for the tables.
+ */
+#pragma GCC diagnostic error "-Woverride-init"
+
+
+//Every ID has to use the thousands digit of its kind and a slot that fits into the lookup tables.
+#define X_CONTROL_CHECK(name, id, kind) \
+	_Static_assert((id) / 1000 == (kind) && (id) % 1000 < CONTROL_SLOTS, #name " does not fit its kind or CONTROL_SLOTS");
+CONTROL_TABLE(X_CONTROL_CHECK)
+#undef X_CONTROL_CHECK
+
+
+/* Dense index + 1 of every control, by [kind][slot]. 0 means "no control with this ID".
+ */
+#define X_CONTROL_SLOT(name, id, kind) [(id) / 1000][(id) % 1000] = CONTROL_INDEX_##name + 1,
+static const unsigned char g_controlSlots[CONTROL_KIND_COUNT][CONTROL_SLOTS] = {
+	CONTROL_TABLE(X_CONTROL_SLOT)
+};
+#undef X_CONTROL_SLOT
+
+
+#define X_CONTROL_ID(name, id, kind) [CONTROL_INDEX_##name] = id,
+static const int g_controlIds[CONTROL_COUNT] = {
+	CONTROL_TABLE(X_CONTROL_ID)
+};
+#undef X_CONTROL_ID
+
+
+#define X_CONTROL_NAME(name, id, kind) [CONTROL_INDEX_##name] = L"" #name,
+static const wchar_t *const g_controlNames[CONTROL_COUNT] = {
+	CONTROL_TABLE(X_CONTROL_NAME)
+};
+#undef X_CONTROL_NAME
+
+
+//Good shown by each display + 1, by control index. 0 means "not a display".
+#define X_DISPLAY_GOOD(control, good, label) [CONTROL_INDEX_##control] = (good) + 1,
+static const signed char g_displayGoods[CONTROL_COUNT] = {
+	DISPLAY_TABLE(X_DISPLAY_GOOD)
+};
+#undef X_DISPLAY_GOOD
+
+
+#define X_DISPLAY_LABEL(control, good, label) [good] = label,
+static const wchar_t *const g_displayLabels[GOOD_COUNT] = {
+	DISPLAY_TABLE(X_DISPLAY_LABEL)
+};
+#undef X_DISPLAY_LABEL
+
+
+#define X_SPINNER_INFO(spinner, field, minVal, maxVal, initialVal) {spinner, field, minVal, maxVal, initialVal},
+static const SpinnerInfo g_spinners[SPINNER_COUNT] = {
+	SPINNER_TABLE(X_SPINNER_INFO)
+};
+#undef X_SPINNER_INFO
+
+
+//Spinner index + 1 of every control that is a spinner or its text field, by control index.
+#define X_SPINNER_OF(spinner, field, minVal, maxVal, initialVal) \
+	[CONTROL_INDEX_##spinner] = SPINNER_INDEX_##spinner + 1, [CONTROL_INDEX_##field] = SPINNER_INDEX_##spinner + 1,
+static const signed char g_spinnerOf[CONTROL_COUNT] = {
+	SPINNER_TABLE(X_SPINNER_OF)
+};
+#undef X_SPINNER_OF
+
+
+int ControlIndexFromId(int id){
+	int kind = id / 1000;
+	int slot = id % 1000;
+	if (id < 0 || kind >= CONTROL_KIND_COUNT || slot >= CONTROL_SLOTS){
+		return -1;
+	}
+	return (int)g_controlSlots[kind][slot] - 1;
+}
+
+
+int ControlIdFromIndex(int index){
+	if (index < 0 || index >= CONTROL_COUNT){
+		return -1;
+	}
+	return g_controlIds[index];
+}
+
+
+ControlKind ControlKindFromId(int id){
+	if (ControlIndexFromId(id) < 0){
+		return CONTROL_None;
+	}
+	return (ControlKind)(id / 1000);
+}
+
+
+const wchar_t *ControlIdName(int id){
+	int index = ControlIndexFromId(id);
+	if (index < 0){
+		return L"(unknown control id)";
+	}
+	return g_controlNames[index];
+}
+
+
+int ControlDisplayGood(int id){
+	int index = ControlIndexFromId(id);
+	if (index < 0){
+		return -1;
+	}
+	return g_displayGoods[index] - 1;
+}
+
+
+const wchar_t *ControlDisplayLabel(Good good){
+	if ((int)good < 0 || good >= GOOD_COUNT){
+		return NULL;
+	}
+	return g_displayLabels[good];
+}
+
+
+const SpinnerInfo *ControlSpinnerInfo(int index){
+	if (index < 0 || index >= SPINNER_COUNT){
+		return NULL;
+	}
+	return &g_spinners[index];
+}
+
+
+int ControlSpinnerIndex(int id){
+	int index = ControlIndexFromId(id);
+	if (index < 0){
+		return -1;
+	}
+	return g_spinnerOf[index] - 1;
+}
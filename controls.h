@@ -0,0 +1,163 @@
+#ifndef CONTROLS_H
+#define CONTROLS_H
+
+#include <stddef.h>	//wchar_t
+
+#include "calc.h"
+
+/* Every control of the main window is listed exactly once in the tables below. The enum of control IDs,
+ * the readable names used in logs, the window class/style used by CreateButton and the display labels are
+ * all generated from these lists ("X-macros"), so adding a control is a one line change here.
+ *
+ * The thousands digit of a control ID is its kind (1xxx push buttons, 2xxx frames, ...), and the rest of
+ * the ID is its slot inside that kind. Lookups split an ID into kind and slot and index small dense arrays,
+ * and controls.c turns two controls sharing an ID into a compile error.
+ */
+
+
+//Highest slot (ID % 1000) a control may use. Raise this if a kind needs more controls.
+#define CONTROL_SLOTS 32
+
+
+/* X(kind, number, className, style)
+ *
+ * kind : enum name of the kind
+ * number : the thousands digit that control IDs of this kind start with
+ * className / style : window class and style macros for CreateWindowExW (only expanded in Win32 code)
+ */
+#define CONTROL_KIND_TABLE(X) \
+	X(CONTROL_PushButton,	1, BUTTON,	PUSHBUTTON) \
+	X(CONTROL_Frame,	2, BUTTON,	FRAMEBUTTON) \
+	X(CONTROL_TextField,	3, EDIT,	TEXTFIELD) \
+	X(CONTROL_Label,	4, STATIC,	STATICLABEL) \
+	X(CONTROL_Spinner,	5, SPINNER,	SPINNERBUTTON) \
+	X(CONTROL_Display,	6, STATIC,	DISPLAY)
+
+
+/* X(name, id, kind)
+ */
+#define CONTROL_TABLE(X) \
+	X(ID_BTN_TEST,			1001, CONTROL_PushButton) \
+	X(ID_BTN_FarmerBlockInc,	1002, CONTROL_PushButton) \
+	X(ID_BTN_FarmerBlockDec,	1003, CONTROL_PushButton) \
+	\
+	X(ID_FRM_SetHousingFrame,	2001, CONTROL_Frame) \
+	X(ID_FRM_AdjustHousingFrame,	2002, CONTROL_Frame) \
+	X(ID_FRM_ResourceReqFrame,	2003, CONTROL_Frame) \
+	\
+	X(ID_FLD_HousingWidth,		3001, CONTROL_TextField) \
+	X(ID_FLD_HousingLength,		3002, CONTROL_TextField) \
+	\
+	X(ID_LBL_HousingWidth,		4001, CONTROL_Label) \
+	X(ID_LBL_HousingLength,		4002, CONTROL_Label) \
+	\
+	X(ID_SPN_HousingWidth,		5001, CONTROL_Spinner) \
+	X(ID_SPN_HousingLength,		5002, CONTROL_Spinner) \
+	\
+	X(ID_DSP_Fish,			6001, CONTROL_Display) \
+	X(ID_DSP_Clothes,		6002, CONTROL_Display) \
+	X(ID_DSP_Schnnaps,		6003, CONTROL_Display)
+
+
+/* X(control, good, label) : which good each ID_DSP_* display shows and the label written above the number.
+ */
+#define DISPLAY_TABLE(X) \
+	X(ID_DSP_Fish,		GOOD_Fish,		L"Required Fish:") \
+	X(ID_DSP_Clothes,	GOOD_WorkClothes,	L"Required Clothes:") \
+	X(ID_DSP_Schnnaps,	GOOD_Schnapps,		L"Required Schnapps:")
+
+
+/* X(spinner, field, minVal, maxVal, initialVal) : range and start value of each ID_SPN_* spinner and the
+ * ID_FLD_* text field next to it, which shows the value and can be typed into.
+ */
+#define SPINNER_TABLE(X) \
+	X(ID_SPN_HousingWidth,	ID_FLD_HousingWidth,	1, 2, 1) \
+	X(ID_SPN_HousingLength,	ID_FLD_HousingLength,	1, 12, 8)
+
+
+#define X_CONTROL_KIND_ENUM(kind, number, className, style) kind = number,
+typedef enum ControlKind {
+	CONTROL_None = 0,
+	CONTROL_KIND_TABLE(X_CONTROL_KIND_ENUM)
+	CONTROL_KIND_COUNT
+} ControlKind;
+#undef X_CONTROL_KIND_ENUM
+
+
+#define X_CONTROL_ID_ENUM(name, id, kind) name = id,
+enum {
+	CONTROL_TABLE(X_CONTROL_ID_ENUM)
+};
+#undef X_CONTROL_ID_ENUM
+
+
+//Dense index of every control (0 .. CONTROL_COUNT - 1), in table order.
+#define X_CONTROL_INDEX_ENUM(name, id, kind) CONTROL_INDEX_##name,
+enum {
+	CONTROL_TABLE(X_CONTROL_INDEX_ENUM)
+	CONTROL_COUNT
+};
+#undef X_CONTROL_INDEX_ENUM
+
+
+//Dense index of every spinner (0 .. SPINNER_COUNT - 1), in table order.
+#define X_SPINNER_INDEX_ENUM(spinner, field, minVal, maxVal, initialVal) SPINNER_INDEX_##spinner,
+enum {
+	SPINNER_TABLE(X_SPINNER_INDEX_ENUM)
+	SPINNER_COUNT
+};
+#undef X_SPINNER_INDEX_ENUM
+
+
+/* One row of SPINNER_TABLE.
+ */
+typedef struct SpinnerInfo {
+	int spinner;
+	int field;
+	int minVal;
+	int maxVal;
+	int initialVal;
+} SpinnerInfo;
+
+
+/* Returns the dense index of a control ID, or -1 if the ID is not in CONTROL_TABLE.
+ */
+int ControlIndexFromId(int id);
+
+
+/* Returns the control ID of a dense index, or -1 if the index is out of range.
+ */
+int ControlIdFromIndex(int index);
+
+
+/* Returns the kind of a control ID (from its thousands digit), or CONTROL_None if the ID is not in
+ * CONTROL_TABLE.
+ */
+ControlKind ControlKindFromId(int id);
+
+
+/* Converts a control ID back into its name for logs, or L"(unknown control id)".
+ */
+const wchar_t *ControlIdName(int id);
+
+
+/* Returns the good shown by an ID_DSP_* display, or -1 if the control is not a display.
+ */
+int ControlDisplayGood(int id);
+
+
+/* Returns the label of the display that shows a good, or NULL if no display shows it.
+ */
+const wchar_t *ControlDisplayLabel(Good good);
+
+
+/* Returns the SPINNER_TABLE row of a spinner index, or NULL if it is out of range.
+ */
+const SpinnerInfo *ControlSpinnerInfo(int index);
+
+
+/* Returns the index of the spinner whose text field (ID_FLD_*) or spinner (ID_SPN_*) has this ID, or -1.
+ */
+int ControlSpinnerIndex(int id);
+
+#endif
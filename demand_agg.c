@@ -0,0 +1,160 @@
+#include <stdlib.h>	//realloc, free
+#include <string.h>	//memset
+#include <math.h>	//fabs
+
+#include "demand_agg.h"
+
+
+void DemandAggInit(DemandAggregate *agg){
+	memset(agg, 0, sizeof(*agg));
+}
+
+
+void DemandAggFree(DemandAggregate *agg){
+	free(agg->blocks);
+	free(agg->blockDemand);
+	int verify = agg->verify;
+	DemandAggInit(agg);
+	agg->verify = verify;
+}
+
+
+/* Makes sure there is room for one more block. The arrays double in size so adding stays amortised O(1).
+ */
+static int Reserve(DemandAggregate *agg){
+
+	if (agg->blockCount < agg->capacity){
+		return 1;
+	}
+
+	int capacity = agg->capacity ? agg->capacity * 2 : 16;
+
+	HousingBlock *blocks = realloc(agg->blocks, sizeof(*blocks) * (size_t)capacity);
+	if (!blocks){
+		return 0;
+	}
+	agg->blocks = blocks;
+
+	double (*blockDemand)[GOOD_COUNT] = realloc(agg->blockDemand, sizeof(*blockDemand) * (size_t)capacity);
+	if (!blockDemand){
+		return 0;
+	}
+	agg->blockDemand = blockDemand;
+
+	agg->capacity = capacity;
+	return 1;
+}
+
+
+//Adds (sign = 1) or subtracts (sign = -1) a block's vector from the running totals.
+static void Apply(DemandAggregate *agg, const HousingBlock *block, const double demand[GOOD_COUNT], int sign){
+	agg->houses += sign * (long)CalcHousesPerBlock(block);
+	for (int g = 0; g < GOOD_COUNT; g++){
+		agg->tonsPerMinute[g] += sign * demand[g];
+	}
+
+	//Once the last block is gone the totals are set back to an exact zero so rounding errors can't pile up.
+	if (agg->blockCount == 0){
+		agg->houses = 0;
+		memset(agg->tonsPerMinute, 0, sizeof(agg->tonsPerMinute));
+	}
+}
+
+
+static void AfterUpdate(DemandAggregate *agg){
+	if (agg->verify){
+		DemandAggVerify(agg);
+	}
+}
+
+
+int DemandAggAdd(DemandAggregate *agg, const HousingBlock *block){
+
+	double demand[GOOD_COUNT];
+	if (!CalcBlockDemand(block, demand) || !Reserve(agg)){
+		return -1;
+	}
+
+	int index = agg->blockCount++;
+	agg->blocks[index] = *block;
+	memcpy(agg->blockDemand[index], demand, sizeof(demand));
+	Apply(agg, block, demand, 1);
+
+	AfterUpdate(agg);
+	return index;
+}
+
+
+int DemandAggRemove(DemandAggregate *agg, int index){
+
+	if (index < 0 || index >= agg->blockCount){
+		return 0;
+	}
+
+	HousingBlock removed = agg->blocks[index];
+	double demand[GOOD_COUNT];
+	memcpy(demand, agg->blockDemand[index], sizeof(demand));
+
+	int last = --agg->blockCount;
+	if (index != last){
+		agg->blocks[index] = agg->blocks[last];
+		memcpy(agg->blockDemand[index], agg->blockDemand[last], sizeof(demand));
+	}
+	Apply(agg, &removed, demand, -1);
+
+	AfterUpdate(agg);
+	return 1;
+}
+
+
+int DemandAggRemoveLast(DemandAggregate *agg){
+	return DemandAggRemove(agg, agg->blockCount - 1);
+}
+
+
+int DemandAggResize(DemandAggregate *agg, int index, const HousingBlock *block){
+
+	double demand[GOOD_COUNT];
+	if (index < 0 || index >= agg->blockCount || !CalcBlockDemand(block, demand)){
+		return 0;
+	}
+
+	Apply(agg, &agg->blocks[index], agg->blockDemand[index], -1);
+	agg->blocks[index] = *block;
+	memcpy(agg->blockDemand[index], demand, sizeof(demand));
+	Apply(agg, block, demand, 1);
+
+	AfterUpdate(agg);
+	return 1;
+}
+
+
+void DemandAggResult(const DemandAggregate *agg, Demand *out){
+	out->residents = agg->houses * CALC_RESIDENTS_PER_HOUSE;
+	for (int g = 0; g < GOOD_COUNT; g++){
+		out->tonsPerMinute[g] = agg->tonsPerMinute[g];
+		out->buildings[g] = agg->tonsPerMinute[g] / CalcGoodInfo((Good)g)->productionPerBuilding;
+	}
+}
+
+
+int DemandAggVerify(DemandAggregate *agg){
+
+	Demand full;
+	Demand running;
+	CalcDemand(agg->blocks, agg->blockCount, &full);
+	DemandAggResult(agg, &running);
+
+	int ok = (full.residents == running.residents);
+	for (int g = 0; g < GOOD_COUNT; g++){
+		if (fabs(full.tonsPerMinute[g] - running.tonsPerMinute[g]) > DEMAND_AGG_TOLERANCE){
+			ok = 0;
+		}
+	}
+
+	agg->verifyChecks++;
+	if (!ok){
+		agg->verifyFailures++;
+	}
+	return ok;
+}
@@ -0,0 +1,85 @@
+#ifndef DEMAND_AGG_H
+#define DEMAND_AGG_H
+
+#include "calc.h"
+
+/* Running demand totals for a list of housing blocks.
+ *
+ * Each block's consumption vector is calculated once when the block is added or resized and kept next to
+ * the block. Adding, removing or resizing a block then only adds/subtracts that vector from the totals, so
+ * a Farmer Block +1/-1 click costs the same whether 1 or 1000 blocks are tracked.
+ *
+ * With verify switched on every update is followed by a full recompute (CalcDemand) and the two results
+ * are compared. This is meant for debugging and benchmarks, it makes every update O(n) again.
+ */
+
+
+//Largest difference (in tons per minute) that verification accepts between the running and the full result.
+#define DEMAND_AGG_TOLERANCE 1e-9
+
+
+/* blocks : the tracked blocks (dense, removal moves the last block into the hole)
+ * blockDemand : tons per minute of every block, same index as blocks
+ * blockCount / capacity : used and allocated entries of the two arrays
+ * houses : running total of houses
+ * tonsPerMinute : running total of every good
+ * verify : if non zero, every update is checked against a full recompute
+ * verifyChecks / verifyFailures : number of checks done and how many of them disagreed
+ */
+typedef struct DemandAggregate {
+	HousingBlock *blocks;
+	double (*blockDemand)[GOOD_COUNT];
+	int blockCount;
+	int capacity;
+
+	long houses;
+	double tonsPerMinute[GOOD_COUNT];
+
+	int verify;
+	long verifyChecks;
+	long verifyFailures;
+} DemandAggregate;
+
+
+/* Sets up an empty aggregate. Nothing is allocated until the first block is added.
+ */
+void DemandAggInit(DemandAggregate *agg);
+
+
+/* Frees the block arrays and resets the aggregate to empty.
+ */
+void DemandAggFree(DemandAggregate *agg);
+
+
+/* Adds a block and returns its index, or -1 if the block is invalid or memory ran out.
+ */
+int DemandAggAdd(DemandAggregate *agg, const HousingBlock *block);
+
+
+/* Removes the block at index. The last block is moved into its place, so the index of the last block
+ * changes to index. Returns 0 if index is out of range.
+ */
+int DemandAggRemove(DemandAggregate *agg, int index);
+
+
+/* Removes the most recently added block (Farmer Block -1). Returns 0 if there are no blocks.
+ */
+int DemandAggRemoveLast(DemandAggregate *agg);
+
+
+/* Changes the size of the block at index. Returns 0 if index is out of range or the block is invalid.
+ */
+int DemandAggResize(DemandAggregate *agg, int index, const HousingBlock *block);
+
+
+/* Fills out with the running totals in the same form CalcDemand produces.
+ */
+void DemandAggResult(const DemandAggregate *agg, Demand *out);
+
+
+/* Compares the running totals with a full recompute of all blocks. Returns 1 if they agree within
+ * DEMAND_AGG_TOLERANCE. Updates verifyChecks/verifyFailures.
+ */
+int DemandAggVerify(DemandAggregate *agg);
+
+#endif
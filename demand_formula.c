@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>	//realloc, free
+#include <string.h>	//memset
+#include <math.h>	//isfinite
+
+#include "demand_formula.h"
+
+
+#define X_GOOD_VARIABLE(good, variable) [good] = variable,
+static const char *g_goodVariables[GOOD_COUNT] = {
+	DEMAND_FORMULA_GOOD_TABLE(X_GOOD_VARIABLE)
+};
+#undef X_GOOD_VARIABLE
+
+
+void DemandFormulasInit(DemandFormulas *formulas){
+	memset(formulas, 0, sizeof(*formulas));
+	FormulaSetInit(&formulas->set);
+	formulas->residentsSlot = FormulaSetInput(&formulas->set, "residents");
+	for (int g = 0; g < GOOD_COUNT; g++){
+		formulas->goodSlot[g] = FormulaSetInput(&formulas->set, g_goodVariables[g]);
+	}
+}
+
+
+void DemandFormulasFree(DemandFormulas *formulas){
+	FormulaSetFree(&formulas->set);
+	free(formulas->values);
+	memset(formulas, 0, sizeof(*formulas));
+}
+
+
+int DemandFormulasCompile(DemandFormulas *formulas, const char *text, size_t length){
+	int ok = FormulaSetCompile(&formulas->set, text, length);
+	//Lines that compiled before an error stay, so the slots grow either way.
+	double *values = realloc(formulas->values, sizeof(double) * (size_t)(formulas->set.slotCount ? formulas->set.slotCount : 1));
+	if (!values){
+		snprintf(formulas->set.error, sizeof(formulas->set.error), "out of memory");
+		formulas->set.errorLine = formulas->set.errorColumn = 0;
+		return 0;
+	}
+	memset(values, 0, sizeof(double) * (size_t)formulas->set.slotCount);
+	formulas->values = values;
+	return ok;
+}
+
+
+int DemandFormulasLoad(DemandFormulas *formulas, const char *path){
+	FILE *f = fopen(path, "rb");
+	if (!f){
+		return -1;
+	}
+	char *text = malloc(DEMAND_FORMULA_MAX_BYTES);
+	size_t length = text ? fread(text, 1, DEMAND_FORMULA_MAX_BYTES, f) : 0;
+	int tooLarge = length == DEMAND_FORMULA_MAX_BYTES && fgetc(f) != EOF;
+	fclose(f);
+	if (!text || tooLarge){
+		free(text);
+		return -1;
+	}
+	int ok = DemandFormulasCompile(formulas, text, length);
+	free(text);
+	return ok;
+}
+
+
+void DemandFormulasApply(DemandFormulas *formulas, Demand *demand){
+	if (!formulas->set.lines || !formulas->values){
+		return;
+	}
+	double *values = formulas->values;
+	values[formulas->residentsSlot] = (double)demand->residents;
+	for (int g = 0; g < GOOD_COUNT; g++){
+		values[formulas->goodSlot[g]] = demand->tonsPerMinute[g];
+	}
+	FormulaSetEval(&formulas->set, values);
+	for (int g = 0; g < GOOD_COUNT; g++){
+		double tons = values[formulas->goodSlot[g]];
+		demand->tonsPerMinute[g] = isfinite(tons) && tons > 0.0 ? tons : 0.0;
+		demand->buildings[g] = demand->tonsPerMinute[g] / CalcGoodInfo((Good)g)->productionPerBuilding;
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef DEMAND_FORMULA_H
+#define DEMAND_FORMULA_H
+
+#include <stddef.h>
+
+#include "calc.h"
+#include "formula.h"
+
+/* User formulas on top of the calculated demand (formula.h): the demand of the blocks or the game comes in
+ * as inputs, the formulas adjust it (newspaper effects, festivals, items) and whatever they leave in the
+ * variables of the goods is shown.
+ *
+ * Inputs: residents, and the tons per minute of every good under its name in DEMAND_FORMULA_GOOD_TABLE.
+ * E.g. a file with
+ *
+ * 	newspaper = 0.10
+ * 	fish = fish * (1 - newspaper)
+ *
+ * shows 10 % less fish. The buildings follow from the tons per minute and GOOD_TABLE's production.
+ */
+
+
+//Read by the overlay at start when present, next to the executable.
+#define DEMAND_FORMULA_FILE "Anno_1800_In_Game_Overlay_formulas.txt"
+
+//Largest formula file read.
+#define DEMAND_FORMULA_MAX_BYTES (1 << 20)
+
+
+/* X(good, variable) : the name of a good's tons per minute in the formulas
+ */
+#define DEMAND_FORMULA_GOOD_TABLE(X) \
+	X(GOOD_Fish,		"fish") \
+	X(GOOD_WorkClothes,	"work_clothes") \
+	X(GOOD_Schnapps,	"schnapps")
+
+
+/* set : the compiled formulas
+ * residentsSlot / goodSlot : the slots of the inputs
+ * values : a value per slot of set, for evaluating
+ */
+typedef struct DemandFormulas {
+	FormulaSet set;
+	int residentsSlot;
+	int goodSlot[GOOD_COUNT];
+	double *values;
+} DemandFormulas;
+
+
+/* Starts without formulas, DemandFormulasApply changes nothing.
+ */
+void DemandFormulasInit(DemandFormulas *formulas);
+
+
+void DemandFormulasFree(DemandFormulas *formulas);
+
+
+/* Compiles formula text after the ones there are. Returns 0 with the error in formulas->set (at line 0 if
+ * memory for the values ran out).
+ */
+int DemandFormulasCompile(DemandFormulas *formulas, const char *text, size_t length);
+
+
+/* Compiles the file at path. Returns -1 if there is no such file (or it is larger than
+ * DEMAND_FORMULA_MAX_BYTES), 0 if it does not compile, 1 if it does.
+ */
+int DemandFormulasLoad(DemandFormulas *formulas, const char *path);
+
+
+/* Runs the formulas on demand and replaces its goods' tons per minute and buildings with their results.
+ * A result that is negative or not a number shows as 0.
+ */
+void DemandFormulasApply(DemandFormulas *formulas, Demand *demand);
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdlib.h>	//malloc, calloc, free
+#include <string.h>	//memset
+
+#include "empire.h"
+
+
+//Islands per task and goods per task. Big enough that the pool's bookkeeping stays small next to the work.
+#define EMPIRE_ISLAND_GRAIN 8
+#define EMPIRE_GOOD_GRAIN 8
+
+/* Solving an island takes well under a microsecond, so waking the pool costs more than it saves until the
+ * empire is a few hundred islands big. Smaller empires are evaluated on the calling thread.
+ */
+#define EMPIRE_PARALLEL_MIN_ISLANDS 256
+
+
+int EmpireInit(Empire *empire, const ChainPlan *plan, ThreadPool *pool){
+
+	memset(empire, 0, sizeof(*empire));
+	empire->plan = plan;
+	empire->pool = pool;
+	empire->goodCount = plan->goodCount;
+
+	size_t row = (size_t)plan->goodCount;
+	int workers = pool ? PoolWorkers(pool) : 1;
+	empire->sessionDemand = calloc(SESSION_COUNT * row, sizeof(double));
+	empire->sessionSupply = calloc(SESSION_COUNT * row, sizeof(double));
+	empire->sessionBalance = calloc(SESSION_COUNT * row, sizeof(double));
+	empire->scratch = calloc((size_t)workers * row, sizeof(double));
+	if (!empire->sessionDemand || !empire->sessionSupply || !empire->sessionBalance || !empire->scratch){
+		EmpireFree(empire);
+		return 0;
+	}
+	return 1;
+}
+
+
+void EmpireFree(Empire *empire){
+	free(empire->demand);
+	free(empire->needed);
+	free(empire->supply);
+	free(empire->sessions);
+	free(empire->sessionDemand);
+	free(empire->sessionSupply);
+	free(empire->sessionBalance);
+	free(empire->scratch);
+	memset(empire, 0, sizeof(*empire));
+}
+
+
+//Makes room for count islands. The rows are only reallocated when the empire grows.
+static int Reserve(Empire *empire, long count){
+
+	if (count <= empire->islandCapacity){
+		return 1;
+	}
+
+	size_t cells = (size_t)count * (size_t)empire->goodCount;
+	double *demand = realloc(empire->demand, cells * sizeof(double));
+	if (demand){
+		empire->demand = demand;
+	}
+	double *needed = realloc(empire->needed, cells * sizeof(double));
+	if (needed){
+		empire->needed = needed;
+	}
+	double *supply = realloc(empire->supply, cells * sizeof(double));
+	if (supply){
+		empire->supply = supply;
+	}
+	Session *sessions = realloc(empire->sessions, (size_t)count * sizeof(Session));
+	if (sessions){
+		empire->sessions = sessions;
+	}
+	if (!demand || !needed || !supply || !sessions){
+		return 0;
+	}
+	empire->islandCapacity = count;
+	return 1;
+}
+
+
+typedef struct EvaluateTask {
+	Empire *empire;
+	const EmpireIsland *islands;
+} EvaluateTask;
+
+
+static void SolveIslands(void *user, long begin, long end, int worker){
+
+	EvaluateTask *task = user;
+	Empire *e = task->empire;
+	const ChainPlan *plan = e->plan;
+	int n = e->goodCount;
+	double *scratch = e->scratch + (size_t)worker * n;
+
+	for (long i = begin; i < end; i++){
+		const EmpireIsland *island = &task->islands[i];
+		double *demand = e->demand + (size_t)i * n;
+		double *supply = e->supply + (size_t)i * n;
+		ChainResult result = {demand, e->needed + (size_t)i * n};
+
+		e->sessions[i] = island->session;
+
+		if (island->residents){
+			ChainSolveModified(plan, island->residents, island->modifiers, &result, scratch);
+		}
+		else{
+			memset(demand, 0, sizeof(double) * (size_t)n);
+			memset(result.buildings, 0, sizeof(double) * (size_t)n);
+		}
+
+		const double *output = island->modifiers && island->modifiers->outputPerMinute ? island->modifiers->outputPerMinute
+			: plan->slotOutputPerMinute;
+		for (int g = 0; g < n; g++){
+			supply[g] = island->buildings ? island->buildings[g] * output[plan->goodSlot[g]] : 0.0;
+		}
+	}
+}
+
+
+//Adds up the columns begin .. end - 1, always in island order.
+static void SumGoods(void *user, long begin, long end, int worker){
+
+	Empire *e = user;
+	int n = e->goodCount;
+	(void)worker;
+
+	for (long g = begin; g < end; g++){
+		double demand[SESSION_COUNT] = {0};
+		double supply[SESSION_COUNT] = {0};
+		for (long i = 0; i < e->islandCount; i++){
+			demand[e->sessions[i]] += e->demand[(size_t)i * n + g];
+			supply[e->sessions[i]] += e->supply[(size_t)i * n + g];
+		}
+		for (int s = 0; s < SESSION_COUNT; s++){
+			e->sessionDemand[(size_t)s * n + g] = demand[s];
+			e->sessionSupply[(size_t)s * n + g] = supply[s];
+			e->sessionBalance[(size_t)s * n + g] = supply[s] - demand[s];
+		}
+	}
+}
+
+
+int EmpireEvaluate(Empire *empire, const EmpireIsland *islands, long count){
+
+	if (!Reserve(empire, count)){
+		return 0;
+	}
+	empire->islandCount = count;
+
+	EvaluateTask task = {empire, islands};
+	if (empire->pool && count >= EMPIRE_PARALLEL_MIN_ISLANDS){
+		PoolParallelFor(empire->pool, count, EMPIRE_ISLAND_GRAIN, SolveIslands, &task);
+		PoolParallelFor(empire->pool, empire->goodCount, EMPIRE_GOOD_GRAIN, SumGoods, empire);
+	}
+	else{
+		SolveIslands(&task, 0, count, 0);
+		SumGoods(empire, 0, empire->goodCount, 0);
+	}
+	return 1;
+}
+
+
+const double *EmpireSessionRow(const Empire *empire, const double *array, Session session){
+	return array + (size_t)session * empire->goodCount;
+}
@@ -0,0 +1,80 @@
+#ifndef EMPIRE_H
+#define EMPIRE_H
+
+#include "chain.h"
+#include "threadpool.h"
+
+/* Demand and supply of a whole empire: every island is solved on its own (ChainSolve over the residents of
+ * the island) and the islands are then added up into one balance per session.
+ *
+ * Islands are solved concurrently on a ThreadPool (from a few hundred islands on, below that the pool costs
+ * more than it saves), each writing its own rows. The session sums are also
+ * split over the pool, but by good: every good's column is added up in island order, so the balances come
+ * out bit for bit the same no matter how many threads there are.
+ *
+ * All per-good arrays are indexed like ChainDefinition.goods. Per-island arrays are islandCount rows of
+ * goodCount values, per-session arrays SESSION_COUNT rows of goodCount values.
+ */
+
+
+/* One island.
+ *
+ * session : the session the island is in
+ * residents : residents of every tier (ChainDefinition.tiers), NULL for none
+ * buildings : production buildings of every good on the island, NULL for none
+ * modifiers : items and buffs of the island (compiled by ModifierSetCompile), NULL for none
+ */
+typedef struct EmpireIsland {
+	Session session;
+	const double *residents;
+	const double *buildings;
+	const ChainModifiers *modifiers;
+} EmpireIsland;
+
+
+/* plan / pool : the chains and the pool the work runs on (NULL: everything on the calling thread)
+ * demand : tons per minute each island needs, whole chain down to raw materials
+ * needed : production buildings each island needs for that (fractional)
+ * supply : tons per minute the buildings of each island make
+ * sessionDemand / sessionSupply / sessionBalance : totals per session, balance = supply - demand
+ * sessions : session of each island
+ * scratch : goodCount doubles per pool worker for ChainSolve
+ */
+typedef struct Empire {
+	const ChainPlan *plan;
+	ThreadPool *pool;
+	int goodCount;
+
+	long islandCount;
+	long islandCapacity;
+	double *demand;
+	double *needed;
+	double *supply;
+	Session *sessions;
+
+	double *sessionDemand;
+	double *sessionSupply;
+	double *sessionBalance;
+
+	double *scratch;
+} Empire;
+
+
+/* Returns 0 if memory ran out. The plan and the pool have to outlive the empire.
+ */
+int EmpireInit(Empire *empire, const ChainPlan *plan, ThreadPool *pool);
+
+
+void EmpireFree(Empire *empire);
+
+
+/* Solves count islands and fills all arrays of the empire. Returns 0 if memory ran out.
+ */
+int EmpireEvaluate(Empire *empire, const EmpireIsland *islands, long count);
+
+
+/* Row of a per-session array, e.g. EmpireSessionRow(e, e->sessionBalance, SESSION_NewWorld)[good].
+ */
+const double *EmpireSessionRow(const Empire *empire, const double *array, Session session);
+
+#endif
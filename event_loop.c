@@ -0,0 +1,218 @@
+#include <string.h>	//memset
+
+#include "event_loop.h"
+#include "sys_thread.h"
+
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+//Thread message carrying an EventLoopPost task, fn in wParam and user in lParam.
+#define EVENT_LOOP_TASK_MSG (WM_APP + 0x3F0)
+
+
+static int PlatformInit(EventLoop *loop){
+	loop->thread = GetCurrentThreadId();
+	//A thread has no message queue until it asks for messages, and PostThreadMessage fails until then.
+	MSG msg;
+	PeekMessageW(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+	return 1;
+}
+
+
+static void PlatformFree(EventLoop *loop){
+	(void)loop;
+}
+
+
+int EventLoopPost(EventLoop *loop, EventTaskFn fn, void *user){
+	return PostThreadMessageW((DWORD)loop->thread, EVENT_LOOP_TASK_MSG, (WPARAM)(uintptr_t)fn, (LPARAM)(uintptr_t)user) != 0;
+}
+
+
+//Dispatches every pending message and task. WM_QUIT ends the loop.
+static void Dispatch(EventLoop *loop){
+	MSG msg;
+	while (!loop->quit && PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)){
+		if (msg.message == WM_QUIT){
+			EventLoopQuit(loop, (int)msg.wParam);
+			break;
+		}
+		loop->stats.messages++;
+		if (msg.hwnd == NULL && msg.message == EVENT_LOOP_TASK_MSG){
+			((EventTaskFn)(uintptr_t)msg.wParam)((void *)(uintptr_t)msg.lParam);
+			continue;
+		}
+		TranslateMessage(&msg);
+		DispatchMessageW(&msg);
+	}
+}
+
+
+//Sleeps until a message comes in or timeoutMs (-1: no timeout) is over.
+static void Wait(EventLoop *loop, int64_t timeoutMs){
+	(void)loop;
+	DWORD timeout = timeoutMs < 0 ? INFINITE : timeoutMs >= (int64_t)INFINITE ? INFINITE - 1 : (DWORD)timeoutMs;
+	MsgWaitForMultipleObjectsEx(0, NULL, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+//A task on the pipe, written in one piece (far below PIPE_BUF, so writes from several threads do not mix).
+typedef struct EventTask {
+	EventTaskFn fn;
+	void *user;
+} EventTask;
+
+//Tasks taken off the pipe per read.
+#define EVENT_LOOP_READ_TASKS 64
+
+
+static int PlatformInit(EventLoop *loop){
+	loop->thread = 0;
+	if (pipe(loop->pipe) != 0){
+		return 0;
+	}
+	//Neither end may block: the loop reads until the pipe is empty, a full pipe fails EventLoopPost.
+	for (int i = 0; i < 2; i++){
+		fcntl(loop->pipe[i], F_SETFL, fcntl(loop->pipe[i], F_GETFL) | O_NONBLOCK);
+	}
+	return 1;
+}
+
+
+static void PlatformFree(EventLoop *loop){
+	close(loop->pipe[0]);
+	close(loop->pipe[1]);
+}
+
+
+int EventLoopPost(EventLoop *loop, EventTaskFn fn, void *user){
+	EventTask task = {fn, user};
+	ssize_t written;
+	do {
+		written = write(loop->pipe[1], &task, sizeof(task));
+	} while (written < 0 && errno == EINTR);
+	return written == (ssize_t)sizeof(task);
+}
+
+
+//Runs every task on the pipe.
+static void Dispatch(EventLoop *loop){
+	EventTask tasks[EVENT_LOOP_READ_TASKS];
+	while (!loop->quit){
+		ssize_t got = read(loop->pipe[0], tasks, sizeof(tasks));
+		if (got < 0 && errno == EINTR){
+			continue;
+		}
+		if (got <= 0){
+			return;
+		}
+		//Writes are whole tasks, so the pipe only ever holds whole tasks.
+		int count = (int)(got / (ssize_t)sizeof(EventTask));
+		for (int i = 0; i < count; i++){
+			loop->stats.messages++;
+			tasks[i].fn(tasks[i].user);
+		}
+	}
+}
+
+
+static void Wait(EventLoop *loop, int64_t timeoutMs){
+	struct pollfd pfd = {loop->pipe[0], POLLIN, 0};
+	poll(&pfd, 1, timeoutMs < 0 ? -1 : timeoutMs > 0x7FFFFFFF ? 0x7FFFFFFF : (int)timeoutMs);
+}
+
+#endif
+
+
+int EventLoopInit(EventLoop *loop){
+	memset(loop, 0, sizeof(*loop));
+	loop->startNs = SysNowNs();
+	loop->sliceTimers = EVENT_LOOP_SLICE_TIMERS;
+	loop->sliceNs = EVENT_LOOP_SLICE_NS;
+	TimerWheelInit(&loop->wheel, 0);
+	return PlatformInit(loop);
+}
+
+
+void EventLoopFree(EventLoop *loop){
+	PlatformFree(loop);
+}
+
+
+uint64_t EventLoopNow(const EventLoop *loop){
+	return (SysNowNs() - loop->startNs) / 1000000ULL;
+}
+
+
+void EventLoopTimer(EventLoop *loop, Timer *timer, uint64_t delayMs, TimerFn fn, void *user){
+	//The wheel's time only moves in slices, so it lags behind after a long message.
+	uint64_t now = EventLoopNow(loop);
+	uint64_t lag = now > loop->wheel.now ? now - loop->wheel.now : 0;
+	TimerStart(&loop->wheel, timer, delayMs + lag, fn, user);
+}
+
+
+void EventLoopCancel(EventLoop *loop, Timer *timer){
+	TimerCancel(&loop->wheel, timer);
+}
+
+
+void EventLoopQuit(EventLoop *loop, int exitCode){
+	loop->quit = 1;
+	loop->exitCode = exitCode;
+}
+
+
+//Runs due timers one at a time until the slice is used up. Returns 1 if it was.
+static int RunSlice(EventLoop *loop){
+	uint64_t start = SysNowNs();
+	uint64_t now = (start - loop->startNs) / 1000000ULL;
+	uint64_t elapsed = 0;
+	int fired = 0;
+	int cut = 0;
+	while (!loop->quit && TimerWheelAdvance(&loop->wheel, now, 1)){
+		fired++;
+		elapsed = SysNowNs() - start;
+		if ((loop->sliceTimers > 0 && fired >= loop->sliceTimers) || (loop->sliceNs > 0 && elapsed >= loop->sliceNs)){
+			cut = 1;
+			break;
+		}
+	}
+	loop->stats.fired += (uint64_t)fired;
+	loop->stats.cutSlices += (uint64_t)cut;
+	if (elapsed > loop->stats.longestSliceNs){
+		loop->stats.longestSliceNs = elapsed;
+	}
+	return cut;
+}
+
+
+int EventLoopRun(EventLoop *loop){
+	while (!loop->quit){
+		loop->stats.turns++;
+		Dispatch(loop);
+		if (loop->quit || RunSlice(loop) || loop->quit){
+			continue;
+		}
+		int64_t timeout = TimerWheelNextDelay(&loop->wheel);
+		if (timeout > 0){
+			uint64_t due = loop->wheel.now + (uint64_t)timeout;
+			uint64_t now = EventLoopNow(loop);
+			timeout = due > now ? (int64_t)(due - now) : 0;
+		}
+		if (timeout != 0){
+			loop->stats.waits++;
+			Wait(loop, timeout);
+		}
+	}
+	return loop->exitCode;
+}
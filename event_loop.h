@@ -0,0 +1,104 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+
+#include "timer_wheel.h"
+
+/* The overlay's message loop: waits for window messages and for the next timer at once, so periodic work
+ * (the sampler, display refreshes) needs no WM_TIMER of its own.
+ *
+ * Every turn first dispatches all pending messages, then runs due timers for one slice of at most
+ * sliceTimers timers or sliceNs nanoseconds, then waits for a message until the next timer is due. A slice
+ * that was cut short does not wait, so the rest of the timers run after the messages that came in
+ * meanwhile: a burst of timers delays input by one slice, not by the whole burst. Timers count in
+ * milliseconds on a TimerWheel (timer_wheel.h).
+ *
+ * On Windows the messages are those of the thread's windows and the wait is MsgWaitForMultipleObjectsEx.
+ * Elsewhere there are no windows and the messages are only the tasks of EventLoopPost, waited for with
+ * poll on a pipe; anno_calc bench-loop runs that build. While Windows runs a modal loop of its own (the
+ * window is being moved or sized) neither timers nor posted tasks run.
+ */
+
+
+//Default slice: this many timers or this long, whichever comes first (0 for no limit).
+#define EVENT_LOOP_SLICE_TIMERS 16
+#define EVENT_LOOP_SLICE_NS 1000000ULL
+
+
+typedef void (*EventTaskFn)(void *user);
+
+
+/* turns : times round the loop
+ * waits : turns that waited
+ * messages : window messages dispatched (Windows) and tasks run
+ * fired : timers run
+ * cutSlices : slices that stopped at their limit with timers still due
+ * longestSliceNs : the longest slice
+ */
+typedef struct EventLoopStats {
+	uint64_t turns;
+	uint64_t waits;
+	uint64_t messages;
+	uint64_t fired;
+	uint64_t cutSlices;
+	uint64_t longestSliceNs;
+} EventLoopStats;
+
+
+/* wheel : the timers, one tick a millisecond since startNs
+ * sliceTimers / sliceNs : the slice limits
+ * quit / exitCode : EventLoopQuit was called (or WM_QUIT came), and its code
+ * thread : the Windows thread the loop runs on, for EventLoopPost
+ * pipe : the read and write end tasks are posted through (not Windows)
+ */
+typedef struct EventLoop {
+	TimerWheel wheel;
+	uint64_t startNs;
+	int sliceTimers;
+	uint64_t sliceNs;
+	int quit;
+	int exitCode;
+	unsigned long thread;
+	int pipe[2];
+	EventLoopStats stats;
+} EventLoop;
+
+
+/* Sets the loop up on the calling thread, the one that runs it, with the default slice. Returns 0 on failure.
+ */
+int EventLoopInit(EventLoop *loop);
+
+
+void EventLoopFree(EventLoop *loop);
+
+
+/* Milliseconds since EventLoopInit.
+ */
+uint64_t EventLoopNow(const EventLoop *loop);
+
+
+/* Starts (or restarts) timer to call fn(user) on the loop after delayMs milliseconds, counted from now even
+ * if the loop is behind. Only on the loop's thread.
+ */
+void EventLoopTimer(EventLoop *loop, Timer *timer, uint64_t delayMs, TimerFn fn, void *user);
+
+
+void EventLoopCancel(EventLoop *loop, Timer *timer);
+
+
+/* Runs fn(user) on the loop between messages, from any thread. Returns 0 if the queue is full.
+ */
+int EventLoopPost(EventLoop *loop, EventTaskFn fn, void *user);
+
+
+/* Makes EventLoopRun return exitCode after the current turn. Only on the loop's thread.
+ */
+void EventLoopQuit(EventLoop *loop, int exitCode);
+
+
+/* Runs the loop until EventLoopQuit or WM_QUIT. Returns the exit code (WM_QUIT's wParam).
+ */
+int EventLoopRun(EventLoop *loop);
+
+#endif
@@ -0,0 +1,317 @@
+#include <string.h>	//memcmp, memchr, strcmp
+
+#include "filedb.h"
+
+
+//Nodes are small, so the arena asks the heap for memory in big steps.
+#define FILEDB_ARENA_BLOCK (1024 * 1024)
+
+
+static const char *g_statusNames[] = {
+	[FILEDB_Ok]		= "ok",
+	[FILEDB_NoFile]		= "could not open file",
+	[FILEDB_Corrupt]	= "corrupt",
+	[FILEDB_OutOfMemory]	= "out of memory"
+};
+
+
+const char *FileDbStatusName(FileDbStatus status){
+	if ((int)status < 0 || status > FILEDB_OutOfMemory){
+		return "(unknown)";
+	}
+	return g_statusNames[status];
+}
+
+
+static uint32_t ReadU32(const unsigned char *p){
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+
+/* Reads one dictionary section [p, end) into a name array indexed by id - firstId.
+ */
+static FileDbStatus ReadNames(FileDb *db, const unsigned char *p, const unsigned char *end, long firstId,
+	const char ***names, long *nameCount){
+
+	if (end - p < 4){
+		return FILEDB_Corrupt;
+	}
+	uint32_t count = ReadU32(p);
+	if ((uint64_t)count * 2 > (uint64_t)(end - p - 4)){
+		return FILEDB_Corrupt;
+	}
+	const unsigned char *ids = p + 4;
+	const unsigned char *s = ids + (size_t)count * 2;
+
+	long highest = -1;
+	for (uint32_t i = 0; i < count; i++){
+		long id = (long)(ids[i * 2] | ids[i * 2 + 1] << 8) - firstId;
+		if (id < 0){
+			return FILEDB_Corrupt;
+		}
+		if (id > highest){
+			highest = id;
+		}
+	}
+
+	*nameCount = highest + 1;
+	*names = ArenaAlloc(&db->arena, (size_t)(highest + 1) * sizeof(**names) + 1);
+	if (!*names){
+		return FILEDB_OutOfMemory;
+	}
+
+	for (uint32_t i = 0; i < count; i++){
+		const unsigned char *nul = memchr(s, 0, (size_t)(end - s));
+		if (!nul){
+			return FILEDB_Corrupt;
+		}
+		(*names)[(ids[i * 2] | ids[i * 2 + 1] << 8) - firstId] = (const char *)s;
+		s = nul + 1;
+	}
+	return FILEDB_Ok;
+}
+
+
+FileDbStatus FileDbOpenMemory(FileDb *db, const void *data, size_t size){
+
+	memset(db, 0, sizeof(*db));
+	ArenaInit(&db->arena, FILEDB_ARENA_BLOCK);
+	db->data = data;
+	db->size = size;
+
+	const unsigned char *end = db->data + size;
+	if (size < FILEDB_TRAILER_BYTES || memcmp(end - 8, FILEDB_MAGIC, 8) != 0){
+		return FILEDB_Corrupt;
+	}
+	uint32_t tagsOffset = ReadU32(end - 16);
+	uint32_t attribsOffset = ReadU32(end - 12);
+	if (tagsOffset > attribsOffset || attribsOffset > size - FILEDB_TRAILER_BYTES){
+		return FILEDB_Corrupt;
+	}
+
+	FileDbStatus status = ReadNames(db, db->data + tagsOffset, db->data + attribsOffset, 0, &db->tagNames, &db->tagNameCount);
+	if (status == FILEDB_Ok){
+		status = ReadNames(db, db->data + attribsOffset, end - FILEDB_TRAILER_BYTES, FILEDB_ATTRIB_FIRST,
+			&db->attribNames, &db->attribNameCount);
+	}
+	if (status != FILEDB_Ok){
+		ArenaFree(&db->arena);
+		return status;
+	}
+
+	db->root.begin = db->data;
+	db->root.end = db->data + tagsOffset;
+	return FILEDB_Ok;
+}
+
+
+FileDbStatus FileDbOpenFile(FileDb *db, const char *path){
+
+	MappedFile mf;
+	if (!MappedFileOpen(&mf, path, 0)){
+		memset(db, 0, sizeof(*db));
+		return FILEDB_NoFile;
+	}
+
+	FileDbStatus status = FileDbOpenMemory(db, mf.data, mf.size);
+	if (status != FILEDB_Ok){
+		MappedFileClose(&mf);
+		return status;
+	}
+	db->file = mf;
+	db->mapped = 1;
+	return FILEDB_Ok;
+}
+
+
+void FileDbClose(FileDb *db){
+	ArenaFree(&db->arena);
+	if (db->mapped){
+		MappedFileClose(&db->file);
+	}
+	memset(db, 0, sizeof(*db));
+}
+
+
+/* Steps over the contents of a tag that starts at p. Returns its closing node, or NULL if the subtree runs
+ * past end. This is the only place that has to look at every node of a subtree.
+ */
+static const unsigned char *SkipSubtree(const unsigned char *p, const unsigned char *end){
+	long depth = 0;
+	while (end - p >= 8){
+		uint32_t id = ReadU32(p + 4);
+		if (id == 0){
+			if (depth == 0){
+				return p;
+			}
+			depth--;
+			p += 8;
+		}
+		else if (id < FILEDB_ATTRIB_FIRST){
+			depth++;
+			p += 8;
+		}
+		else{
+			uint64_t padded = ((uint64_t)ReadU32(p) + 7) & ~(uint64_t)7;
+			if (padded > (uint64_t)(end - p - 8)){
+				return NULL;
+			}
+			p += 8 + padded;
+		}
+	}
+	return NULL;
+}
+
+
+FileDbNode *FileDbChildren(FileDb *db, FileDbNode *node){
+
+	if (node->expanded || node->id >= FILEDB_ATTRIB_FIRST){
+		return node->children;
+	}
+
+	const unsigned char *p = node->begin;
+	const unsigned char *end = node->end;
+	FileDbNode **link = &node->children;
+
+	while (end - p >= 8){
+		uint32_t size = ReadU32(p);
+		uint32_t id = ReadU32(p + 4);
+
+		//The closing node of node itself is end, so a close in between is a broken document.
+		if (id == 0){
+			db->failed = 1;
+			node->children = NULL;
+			return NULL;
+		}
+
+		FileDbNode *child = ArenaAlloc(&db->arena, sizeof(*child));
+		if (!child){
+			db->failed = 1;
+			node->children = NULL;
+			return NULL;
+		}
+		child->id = id;
+		child->begin = p + 8;
+
+		if (id < FILEDB_ATTRIB_FIRST){
+			child->end = SkipSubtree(p + 8, end);
+			if (!child->end){
+				db->failed = 1;
+				node->children = NULL;
+				return NULL;
+			}
+			p = child->end + 8;
+		}
+		else{
+			uint64_t padded = ((uint64_t)size + 7) & ~(uint64_t)7;
+			if (padded > (uint64_t)(end - p - 8)){
+				db->failed = 1;
+				node->children = NULL;
+				return NULL;
+			}
+			child->end = child->begin + size;
+			p += 8 + padded;
+		}
+
+		*link = child;
+		link = &child->next;
+		db->nodes++;
+	}
+
+	node->expanded = 1;
+	return node->children;
+}
+
+
+FileDbNode *FileDbChild(FileDb *db, FileDbNode *node, long id){
+	for (FileDbNode *child = FileDbChildren(db, node); child; child = child->next){
+		if ((long)child->id == id){
+			return child;
+		}
+	}
+	return NULL;
+}
+
+
+int FileDbVisitTags(FileDb *db, FileDbNode *node, long id, int maxDepth, FileDbVisitFn fn, void *user){
+	if (maxDepth <= 0){
+		return 1;
+	}
+	for (FileDbNode *child = FileDbChildren(db, node); child; child = child->next){
+		if (child->id >= FILEDB_ATTRIB_FIRST){
+			continue;
+		}
+		if ((long)child->id == id){
+			if (!fn(db, child, user)){
+				return 0;
+			}
+		}
+		else if (!FileDbVisitTags(db, child, id, maxDepth - 1, fn, user)){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+static long FindName(const char **names, long count, const char *name){
+	for (long i = 0; i < count; i++){
+		if (names[i] && strcmp(names[i], name) == 0){
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+long FileDbTagId(const FileDb *db, const char *name){
+	return FindName(db->tagNames, db->tagNameCount, name);
+}
+
+
+long FileDbAttribId(const FileDb *db, const char *name){
+	long index = FindName(db->attribNames, db->attribNameCount, name);
+	return index < 0 ? -1 : index + FILEDB_ATTRIB_FIRST;
+}
+
+
+const char *FileDbNodeName(const FileDb *db, const FileDbNode *node){
+	const char *name = NULL;
+	if (node->id >= FILEDB_ATTRIB_FIRST){
+		if ((long)(node->id - FILEDB_ATTRIB_FIRST) < db->attribNameCount){
+			name = db->attribNames[node->id - FILEDB_ATTRIB_FIRST];
+		}
+	}
+	else if ((long)node->id < db->tagNameCount){
+		name = db->tagNames[node->id];
+	}
+	return name ? name : "(unknown)";
+}
+
+
+int FileDbIsAttrib(const FileDbNode *node){
+	return node->id >= FILEDB_ATTRIB_FIRST;
+}
+
+
+FileDbView FileDbValue(const FileDbNode *node){
+	FileDbView view = {node->begin, 0};
+	if (FileDbIsAttrib(node)){
+		view.len = (size_t)(node->end - node->begin);
+	}
+	return view;
+}
+
+
+int FileDbInt(const FileDbNode *node, int64_t *value){
+	FileDbView view = FileDbValue(node);
+	if (view.len == 4){
+		*value = (int32_t)ReadU32(view.ptr);
+		return 1;
+	}
+	if (view.len == 8){
+		*value = (int64_t)((uint64_t)ReadU32(view.ptr) | (uint64_t)ReadU32(view.ptr + 4) << 32);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,147 @@
+#ifndef FILEDB_H
+#define FILEDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "mapped_file.h"
+
+/* Tree view of a FileDB v2 document (the format of data.a7s inside a savegame, see savegame.h).
+ *
+ * The document stays where it is (a mapped file or a caller's buffer); nodes only point into it, names
+ * point into the dictionaries at its end and attribute values are views of the bytes in place. All nodes
+ * come from one arena and are freed together by FileDbClose.
+ *
+ * The tree is built lazily: a node's children are only created the first time they are asked for. FileDB
+ * has no subtree sizes, so creating the children of a node still steps over the node headers of the whole
+ * subtree, but nothing below the first level is allocated. Querying one island of a big save therefore
+ * only creates the nodes on the way down to it and inside it.
+ */
+
+
+/* Layout shared with the streaming reader: every node starts with int32 byte size and int32 id. Id 0 closes
+ * the last open tag, ids below FILEDB_ATTRIB_FIRST open a tag, higher ids are attributes followed by their
+ * content padded to a multiple of 8. The stream ends with the tag and attribute dictionaries (int32 count,
+ * count uint16 ids, count null terminated names), their two int32 offsets and the 8 byte magic.
+ */
+#define FILEDB_ATTRIB_FIRST 0x8000
+#define FILEDB_TRAILER_BYTES 16
+#define FILEDB_MAGIC "\x08\x00\x00\x00\xFE\xFF\xFF\xFF"
+
+
+typedef enum FileDbStatus {
+	FILEDB_Ok,
+	FILEDB_NoFile,		//the file could not be mapped
+	FILEDB_Corrupt,		//no trailer, broken dictionaries or nodes running past their parent
+	FILEDB_OutOfMemory
+} FileDbStatus;
+
+
+/* Bytes inside the document. Not null terminated.
+ */
+typedef struct FileDbView {
+	const unsigned char *ptr;
+	size_t len;
+} FileDbView;
+
+
+/* A tag or attribute.
+ *
+ * next : next sibling
+ * children : first child, only valid once expanded is set (use FileDbChildren)
+ * begin / end : tags: first byte after the opening node and the closing node, attributes: the content
+ * id : tag id, or attribute id (>= FILEDB_ATTRIB_FIRST)
+ */
+typedef struct FileDbNode {
+	struct FileDbNode *next;
+	struct FileDbNode *children;
+	const unsigned char *begin;
+	const unsigned char *end;
+	uint32_t id;
+	int expanded;
+} FileDbNode;
+
+
+/* An open document.
+ *
+ * root : virtual node whose children are the top level nodes
+ * tagNames / attribNames : names by id (attributes by id - FILEDB_ATTRIB_FIRST), NULL for unused ids
+ * nodes : nodes created so far
+ * failed : a subtree turned out to be corrupt, or memory ran out, while expanding it
+ */
+typedef struct FileDb {
+	MappedFile file;
+	int mapped;
+	const unsigned char *data;
+	size_t size;
+	Arena arena;
+	FileDbNode root;
+	const char **tagNames;
+	long tagNameCount;
+	const char **attribNames;
+	long attribNameCount;
+	uint64_t nodes;
+	int failed;
+} FileDb;
+
+
+/* Maps the FileDB file at path (a data.a7s taken out of a savegame with SaveExtractData) and reads its
+ * dictionaries. No nodes are created yet.
+ */
+FileDbStatus FileDbOpenFile(FileDb *db, const char *path);
+
+
+/* Same for a document already in memory. data has to stay valid until FileDbClose.
+ */
+FileDbStatus FileDbOpenMemory(FileDb *db, const void *data, size_t size);
+
+
+void FileDbClose(FileDb *db);
+
+
+/* Returns the first child of node, creating the children on the first call. NULL if there are none, if the
+ * subtree is corrupt (db->failed is set) or memory ran out.
+ */
+FileDbNode *FileDbChildren(FileDb *db, FileDbNode *node);
+
+
+/* First child of node with the given id, or NULL.
+ */
+FileDbNode *FileDbChild(FileDb *db, FileDbNode *node, long id);
+
+
+/* Calls fn for every tag with the given id in the first maxDepth levels below node, in document order.
+ * The matches themselves are not descended into. Stops and returns 0 if fn returns 0.
+ */
+typedef int (*FileDbVisitFn)(FileDb *db, FileDbNode *node, void *user);
+int FileDbVisitTags(FileDb *db, FileDbNode *node, long id, int maxDepth, FileDbVisitFn fn, void *user);
+
+
+/* Ids of the names, -1 if the document does not use the name.
+ */
+long FileDbTagId(const FileDb *db, const char *name);
+long FileDbAttribId(const FileDb *db, const char *name);
+
+
+/* Name of a node, "(unknown)" for ids without a dictionary entry.
+ */
+const char *FileDbNodeName(const FileDb *db, const FileDbNode *node);
+
+
+int FileDbIsAttrib(const FileDbNode *node);
+
+
+/* Content of an attribute (empty for tags).
+ */
+FileDbView FileDbValue(const FileDbNode *node);
+
+
+/* Reads an attribute holding a 4 or 8 byte little endian integer. Returns 0 if the size does not fit.
+ */
+int FileDbInt(const FileDbNode *node, int64_t *value);
+
+
+const char *FileDbStatusName(FileDbStatus status);
+
+#endif
@@ -0,0 +1,837 @@
+#include <stdlib.h>	//realloc, free, strtod
+#include <string.h>	//memset, memcmp, strcmp
+#include <math.h>	//fmod, pow, floor, ceil, round, sqrt
+
+#include "formula.h"
+
+
+#define FORMULA_THREADED 1 //if '1' the interpreter jumps straight from instruction to instruction (GCC's labels as values), '0' uses a switch
+
+
+//Deepest nesting of parentheses, calls, ?: and unary operators in a line.
+#define FORMULA_NEST_MAX 64
+
+//Longest number literal.
+#define FORMULA_NUMBER_CHARS 64
+
+
+#define X_FORMULA_OP_ARG(op, arg, pops, name) [op] = arg,
+static const uint8_t g_opArgs[FORMULA_OP_COUNT] = {
+	FORMULA_OP_TABLE(X_FORMULA_OP_ARG)
+};
+#undef X_FORMULA_OP_ARG
+
+#define X_FORMULA_OP_POPS(op, arg, pops, name) [op] = pops,
+static const uint8_t g_opPops[FORMULA_OP_COUNT] = {
+	FORMULA_OP_TABLE(X_FORMULA_OP_POPS)
+};
+#undef X_FORMULA_OP_POPS
+
+#define X_FORMULA_OP_NAME(op, arg, pops, name) [op] = name,
+static const char *g_opNames[FORMULA_OP_COUNT] = {
+	FORMULA_OP_TABLE(X_FORMULA_OP_NAME)
+};
+#undef X_FORMULA_OP_NAME
+
+
+typedef struct FormulaFunction {
+	const char *name;
+	int args;
+	FormulaOp op;
+} FormulaFunction;
+
+#define X_FORMULA_FUNCTION(name, args, op) { name, args, op },
+static const FormulaFunction g_functions[] = {
+	FORMULA_FUNCTION_TABLE(X_FORMULA_FUNCTION)
+};
+#undef X_FORMULA_FUNCTION
+
+#define FUNCTION_COUNT ((int)(sizeof(g_functions) / sizeof(g_functions[0])))
+
+
+//16 bit operand at pc, little endian.
+static inline unsigned Operand(const uint8_t *pc){
+	return (unsigned)pc[0] | (unsigned)pc[1] << 8;
+}
+
+
+/* The interpreter: runs code until FORMULA_OP_End. The top of the stack is kept in top, the values below
+ * it in stack, sp one past the last; stack needs room for the deepest line plus one. The code comes from
+ * the compiler, so instructions are not checked.
+ */
+static void Run(const uint8_t *pc, const double *consts, double *values, double *stack){
+	double *sp = stack;
+	double top = 0.0;
+
+#if FORMULA_THREADED
+	#define X_FORMULA_OP_LABEL(op, arg, pops, name) [op] = &&L_##op,
+	static const void *labels[FORMULA_OP_COUNT] = {
+		FORMULA_OP_TABLE(X_FORMULA_OP_LABEL)
+	};
+	#undef X_FORMULA_OP_LABEL
+	#define OP(op) L_##op:
+	#define NEXT() goto *labels[*pc++]
+	NEXT();
+#else
+	#define OP(op) case op:
+	#define NEXT() continue
+	for (;;) switch ((FormulaOp)*pc++){
+#endif
+
+	OP(FORMULA_OP_End) return;
+	OP(FORMULA_OP_Const) *sp++ = top; top = consts[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_Load) *sp++ = top; top = values[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_Store) values[Operand(pc)] = top; top = *--sp; pc += 2; NEXT();
+	OP(FORMULA_OP_Add) top = *--sp + top; NEXT();
+	OP(FORMULA_OP_Sub) top = *--sp - top; NEXT();
+	OP(FORMULA_OP_Mul) top = *--sp * top; NEXT();
+	OP(FORMULA_OP_Div) top = *--sp / top; NEXT();
+	OP(FORMULA_OP_AddConst) top += consts[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_SubConst) top -= consts[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_MulConst) top *= consts[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_DivConst) top /= consts[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_AddLoad) top += values[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_SubLoad) top -= values[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_MulLoad) top *= values[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_DivLoad) top /= values[Operand(pc)]; pc += 2; NEXT();
+	OP(FORMULA_OP_Mod) sp--; top = fmod(*sp, top); NEXT();
+	OP(FORMULA_OP_Pow) sp--; top = pow(*sp, top); NEXT();
+	OP(FORMULA_OP_Neg) top = -top; NEXT();
+	OP(FORMULA_OP_Not) top = top == 0.0; NEXT();
+	OP(FORMULA_OP_Lt) sp--; top = *sp < top; NEXT();
+	OP(FORMULA_OP_Le) sp--; top = *sp <= top; NEXT();
+	OP(FORMULA_OP_Gt) sp--; top = *sp > top; NEXT();
+	OP(FORMULA_OP_Ge) sp--; top = *sp >= top; NEXT();
+	OP(FORMULA_OP_Eq) sp--; top = *sp == top; NEXT();
+	OP(FORMULA_OP_Ne) sp--; top = *sp != top; NEXT();
+	OP(FORMULA_OP_And) sp--; top = *sp != 0.0 && top != 0.0; NEXT();
+	OP(FORMULA_OP_Or) sp--; top = *sp != 0.0 || top != 0.0; NEXT();
+	//c, a below b: c ? a : b
+	OP(FORMULA_OP_Select) sp -= 2; top = sp[0] != 0.0 ? sp[1] : top; NEXT();
+	OP(FORMULA_OP_Min) sp--; top = top < *sp ? top : *sp; NEXT();
+	OP(FORMULA_OP_Max) sp--; top = top > *sp ? top : *sp; NEXT();
+	//x, lo below hi
+	OP(FORMULA_OP_Clamp) sp -= 2; top = sp[0] < sp[1] ? sp[1] : sp[0] > top ? top : sp[0]; NEXT();
+	OP(FORMULA_OP_Abs) top = fabs(top); NEXT();
+	OP(FORMULA_OP_Floor) top = floor(top); NEXT();
+	OP(FORMULA_OP_Ceil) top = ceil(top); NEXT();
+	OP(FORMULA_OP_Round) top = round(top); NEXT();
+	OP(FORMULA_OP_Sqrt) top = sqrt(top); NEXT();
+
+#if !FORMULA_THREADED
+		default:
+			return;
+	}
+#endif
+	#undef OP
+	#undef NEXT
+}
+
+
+void FormulaSetInit(FormulaSet *set){
+	memset(set, 0, sizeof(*set));
+}
+
+
+void FormulaSetFree(FormulaSet *set){
+	free(set->code);
+	free(set->consts);
+	free(set->names);
+	free(set->constIndex);
+	free(set->nameIndex);
+	FormulaSetInit(set);
+}
+
+
+static int IsNameStart(char c){
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+
+static int IsNameChar(char c){
+	return IsNameStart(c) || (c >= '0' && c <= '9');
+}
+
+
+static int IsDigit(char c){
+	return c >= '0' && c <= '9';
+}
+
+
+//The function called name (length chars), NULL if there is none.
+static const FormulaFunction *FindFunction(const char *name, size_t length){
+	for (int i = 0; i < FUNCTION_COUNT; i++){
+		if (strlen(g_functions[i].name) == length && memcmp(g_functions[i].name, name, length) == 0){
+			return &g_functions[i];
+		}
+	}
+	return NULL;
+}
+
+
+//FNV-1a of a name.
+static uint32_t HashName(const char *name, size_t length){
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++){
+		hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+	}
+	return hash;
+}
+
+
+//The bits of a constant, mixed (murmur's finaliser).
+static uint32_t HashConst(double value){
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bits ^= bits >> 33;
+	bits *= 0xFF51AFD7ED558CCDULL;
+	bits ^= bits >> 33;
+	return (uint32_t)bits;
+}
+
+
+static void IndexInsert(int *table, int size, uint32_t hash, int entry){
+	uint32_t mask = (uint32_t)size - 1;
+	uint32_t i = hash & mask;
+	while (table[i]){
+		i = (i + 1) & mask;
+	}
+	table[i] = entry + 1;
+}
+
+
+//Makes room in the hash tables for one more constant and name: past half full both double and are refilled.
+static int GrowIndex(FormulaSet *set){
+	int needed = (set->constCount > set->slotCount ? set->constCount : set->slotCount) + 1;
+	if (needed * 2 <= set->indexSize){
+		return 1;
+	}
+	int size = set->indexSize ? set->indexSize * 2 : 64;
+	while (size < needed * 2){
+		size *= 2;
+	}
+	int *constIndex = calloc((size_t)size, sizeof(int));
+	int *nameIndex = calloc((size_t)size, sizeof(int));
+	if (!constIndex || !nameIndex){
+		free(constIndex);
+		free(nameIndex);
+		return 0;
+	}
+	free(set->constIndex);
+	free(set->nameIndex);
+	set->constIndex = constIndex;
+	set->nameIndex = nameIndex;
+	set->indexSize = size;
+	for (int i = 0; i < set->constCount; i++){
+		IndexInsert(constIndex, size, HashConst(set->consts[i]), i);
+	}
+	for (int i = 0; i < set->slotCount; i++){
+		IndexInsert(nameIndex, size, HashName(set->names[i], strlen(set->names[i])), i);
+	}
+	return 1;
+}
+
+
+static int FindSlot(const FormulaSet *set, const char *name, size_t length){
+	if (length >= FORMULA_NAME_CHARS || !set->indexSize){
+		return -1;
+	}
+	uint32_t mask = (uint32_t)set->indexSize - 1;
+	for (uint32_t i = HashName(name, length) & mask; set->nameIndex[i]; i = (i + 1) & mask){
+		int slot = set->nameIndex[i] - 1;
+		if (memcmp(set->names[slot], name, length) == 0 && set->names[slot][length] == '\0'){
+			return slot;
+		}
+	}
+	return -1;
+}
+
+
+int FormulaSetSlot(const FormulaSet *set, const char *name){
+	return FindSlot(set, name, strlen(name));
+}
+
+
+//Adds a slot called name (length chars, checked by the caller). Returns it, -1 if out of memory or slots.
+static int AddSlot(FormulaSet *set, const char *name, size_t length){
+	if (set->slotCount >= FORMULA_MAX_POOL || !GrowIndex(set)){
+		return -1;
+	}
+	if (set->slotCount == set->nameCapacity){
+		int capacity = set->nameCapacity ? set->nameCapacity * 2 : 16;
+		char (*names)[FORMULA_NAME_CHARS] = realloc(set->names, sizeof(*names) * (size_t)capacity);
+		if (!names){
+			return -1;
+		}
+		set->names = names;
+		set->nameCapacity = capacity;
+	}
+	memcpy(set->names[set->slotCount], name, length);
+	set->names[set->slotCount][length] = '\0';
+	IndexInsert(set->nameIndex, set->indexSize, HashName(name, length), set->slotCount);
+	return set->slotCount++;
+}
+
+
+int FormulaSetInput(FormulaSet *set, const char *name){
+	size_t length = strlen(name);
+	if (set->codeSize || length == 0 || length >= FORMULA_NAME_CHARS || !IsNameStart(name[0]) || FindFunction(name, length) ||
+		FindSlot(set, name, length) >= 0){
+		return -1;
+	}
+	for (size_t i = 1; i < length; i++){
+		if (!IsNameChar(name[i])){
+			return -1;
+		}
+	}
+	int slot = AddSlot(set, name, length);
+	set->inputCount += slot >= 0;
+	return slot;
+}
+
+
+//Index of value in the pool, added if new. -1 if out of memory or constants.
+static int AddConst(FormulaSet *set, double value){
+	if (!GrowIndex(set)){
+		return -1;
+	}
+	uint32_t hash = HashConst(value);
+	uint32_t mask = (uint32_t)set->indexSize - 1;
+	for (uint32_t i = hash & mask; set->constIndex[i]; i = (i + 1) & mask){
+		int index = set->constIndex[i] - 1;
+		if (memcmp(&set->consts[index], &value, sizeof(value)) == 0){
+			return index;
+		}
+	}
+	if (set->constCount >= FORMULA_MAX_POOL){
+		return -1;
+	}
+	if (set->constCount == set->constCapacity){
+		int capacity = set->constCapacity ? set->constCapacity * 2 : 16;
+		double *consts = realloc(set->consts, sizeof(*consts) * (size_t)capacity);
+		if (!consts){
+			return -1;
+		}
+		set->consts = consts;
+		set->constCapacity = capacity;
+	}
+	set->consts[set->constCount] = value;
+	IndexInsert(set->constIndex, set->indexSize, hash, set->constCount);
+	return set->constCount++;
+}
+
+
+/* A value on the stack while compiling: where its code starts, and its value if it is a constant.
+ */
+typedef struct StackEntry {
+	size_t start;
+	int isConst;
+	double value;
+} StackEntry;
+
+
+/* State of compiling a text.
+ *
+ * pos / end : the text left
+ * lineStart / line : where the current line starts and its number, for errors
+ * nest : levels of Expr and Unary open, against FORMULA_NEST_MAX
+ * stack / depth : the values the code compiled so far leaves on the stack
+ * failed : an error was set, everything after it does nothing
+ */
+typedef struct Parser {
+	FormulaSet *set;
+	const char *pos;
+	const char *end;
+	const char *lineStart;
+	int line;
+	int nest;
+	StackEntry stack[FORMULA_STACK_MAX];
+	int depth;
+	int failed;
+} Parser;
+
+
+//Keeps the first error of the text.
+static void Fail(Parser *p, const char *message){
+	if (p->failed){
+		return;
+	}
+	p->failed = 1;
+	size_t length = strlen(message);
+	if (length >= FORMULA_ERROR_CHARS){
+		length = FORMULA_ERROR_CHARS - 1;
+	}
+	memcpy(p->set->error, message, length);
+	p->set->error[length] = '\0';
+	p->set->errorLine = p->line;
+	p->set->errorColumn = (int)(p->pos - p->lineStart) + 1;
+}
+
+
+static void SkipSpace(Parser *p){
+	while (p->pos < p->end && (*p->pos == ' ' || *p->pos == '\t' || *p->pos == '\r')){
+		p->pos++;
+	}
+}
+
+
+//Takes the token tok (one or two chars) if it comes next.
+static int Accept(Parser *p, const char *tok){
+	SkipSpace(p);
+	size_t length = strlen(tok);
+	if ((size_t)(p->end - p->pos) < length || memcmp(p->pos, tok, length) != 0){
+		return 0;
+	}
+	//"<" must not take the start of "<=", "=" not that of "==", "!" not that of "!=".
+	if (length == 1 && p->pos + 1 < p->end && p->pos[1] == '=' && (tok[0] == '<' || tok[0] == '>' || tok[0] == '=' || tok[0] == '!')){
+		return 0;
+	}
+	p->pos += length;
+	return 1;
+}
+
+
+static void Expect(Parser *p, const char *tok, const char *message){
+	if (!p->failed && !Accept(p, tok)){
+		Fail(p, message);
+	}
+}
+
+
+static int Reserve(FormulaSet *set, size_t bytes){
+	if (set->codeSize + bytes <= set->codeCapacity){
+		return 1;
+	}
+	size_t capacity = set->codeCapacity ? set->codeCapacity * 2 : 256;
+	while (capacity < set->codeSize + bytes){
+		capacity *= 2;
+	}
+	uint8_t *code = realloc(set->code, capacity);
+	if (!code){
+		return 0;
+	}
+	set->code = code;
+	set->codeCapacity = capacity;
+	return 1;
+}
+
+
+static void Emit(Parser *p, FormulaOp op, int operand){
+	if (p->failed){
+		return;
+	}
+	if (!Reserve(p->set, 3)){
+		Fail(p, "out of memory");
+		return;
+	}
+	FormulaSet *set = p->set;
+	set->code[set->codeSize++] = (uint8_t)op;
+	if (g_opArgs[op] != FORMULA_ARG_None){
+		set->code[set->codeSize++] = (uint8_t)(operand & 0xFF);
+		set->code[set->codeSize++] = (uint8_t)(operand >> 8);
+	}
+}
+
+
+static void Push(Parser *p, int isConst, double value){
+	if (p->depth >= FORMULA_STACK_MAX){
+		Fail(p, "expression too large");
+		return;
+	}
+	StackEntry *e = &p->stack[p->depth++];
+	e->start = p->set->codeSize;
+	e->isConst = isConst;
+	e->value = value;
+	if (p->depth > p->set->stackDepth){
+		p->set->stackDepth = p->depth;
+	}
+}
+
+
+static void EmitConst(Parser *p, double value){
+	int index = AddConst(p->set, value);
+	if (index < 0){
+		Fail(p, "too many constants");
+		return;
+	}
+	Push(p, 1, value);
+	Emit(p, FORMULA_OP_Const, index);
+}
+
+
+static void EmitLoad(Parser *p, int slot){
+	Push(p, 0, 0.0);
+	Emit(p, FORMULA_OP_Load, slot);
+}
+
+
+/* The Const or Load form of a binary op whose right operand right is a lone Const or Load instruction at the
+ * end of the code, with that instruction's operand; op itself if there is none.
+ */
+static FormulaOp FuseOperand(Parser *p, FormulaOp op, const StackEntry *right, int *operand){
+	static const FormulaOp fusedConst[FORMULA_OP_COUNT] = {
+		[FORMULA_OP_Add] = FORMULA_OP_AddConst, [FORMULA_OP_Sub] = FORMULA_OP_SubConst,
+		[FORMULA_OP_Mul] = FORMULA_OP_MulConst, [FORMULA_OP_Div] = FORMULA_OP_DivConst,
+	};
+	static const FormulaOp fusedLoad[FORMULA_OP_COUNT] = {
+		[FORMULA_OP_Add] = FORMULA_OP_AddLoad, [FORMULA_OP_Sub] = FORMULA_OP_SubLoad,
+		[FORMULA_OP_Mul] = FORMULA_OP_MulLoad, [FORMULA_OP_Div] = FORMULA_OP_DivLoad,
+	};
+	const uint8_t *code = p->set->code;
+	if (!fusedConst[op] || right->start + 3 != p->set->codeSize){
+		return op;
+	}
+	*operand = (int)Operand(code + right->start + 1);
+	if (code[right->start] == FORMULA_OP_Const){
+		return fusedConst[op];
+	}
+	if (code[right->start] == FORMULA_OP_Load){
+		return fusedLoad[op];
+	}
+	return op;
+}
+
+
+/* Emits an operation on the top values of the stack. If they are all constants their code is replaced by
+ * the result, worked out by the interpreter itself so folding can never differ from running.
+ */
+static void EmitOp(Parser *p, FormulaOp op){
+	if (p->failed){
+		return;
+	}
+	int pops = g_opPops[op];
+	StackEntry *args = &p->stack[p->depth - pops];
+	int folds = 1;
+	for (int i = 0; i < pops; i++){
+		folds &= args[i].isConst;
+	}
+	if (!folds){
+		size_t start = args[0].start;
+		int operand = 0;
+		FormulaOp fused = FuseOperand(p, op, &args[pops - 1], &operand);
+		p->depth -= pops;
+		Push(p, 0, 0.0);
+		p->stack[p->depth - 1].start = start;
+		if (fused != op){
+			p->set->codeSize -= 3;
+		}
+		Emit(p, fused, operand);
+		return;
+	}
+
+	double consts[3];
+	for (int i = 0; i < pops; i++){
+		consts[i] = args[i].value;
+	}
+	uint8_t code[3 * 3 + 1 + 3 + 1] = {0};
+	int size = 0;
+	for (int i = 0; i < pops; i++){
+		code[size++] = FORMULA_OP_Const;
+		code[size++] = (uint8_t)i;
+		code[size++] = 0;
+	}
+	code[size++] = (uint8_t)op;
+	code[size++] = FORMULA_OP_Store;
+	code[size++] = 0;
+	code[size++] = 0;
+	code[size] = FORMULA_OP_End;
+	double result = 0.0;
+	double stack[4];
+	Run(code, consts, &result, stack);
+
+	p->set->codeSize = args[0].start;
+	p->depth -= pops;
+	EmitConst(p, result);
+}
+
+
+static void Expr(Parser *p);
+
+
+//number | name | function(args) | (expr)
+static void Primary(Parser *p){
+	SkipSpace(p);
+	if (p->failed){
+		return;
+	}
+	if (p->pos < p->end && (IsDigit(*p->pos) || (*p->pos == '.' && p->pos + 1 < p->end && IsDigit(p->pos[1])))){
+		//Copied out, the text need not be terminated.
+		char number[FORMULA_NUMBER_CHARS];
+		size_t length = 0;
+		const char *c = p->pos;
+		while (c < p->end && length < FORMULA_NUMBER_CHARS - 1 && (IsDigit(*c) || *c == '.' || *c == 'e' || *c == 'E' ||
+			((*c == '+' || *c == '-') && length > 0 && (c[-1] == 'e' || c[-1] == 'E')))){
+			number[length++] = *c++;
+		}
+		number[length] = '\0';
+		char *numberEnd;
+		double value = strtod(number, &numberEnd);
+		if ((size_t)(numberEnd - number) != length){
+			Fail(p, "malformed number");
+			return;
+		}
+		p->pos = c;
+		EmitConst(p, value);
+		return;
+	}
+	if (p->pos < p->end && IsNameStart(*p->pos)){
+		const char *name = p->pos;
+		while (p->pos < p->end && IsNameChar(*p->pos)){
+			p->pos++;
+		}
+		size_t length = (size_t)(p->pos - name);
+		const FormulaFunction *function = FindFunction(name, length);
+		if (function){
+			Expect(p, "(", "expected ( after a function name");
+			for (int i = 0; i < function->args; i++){
+				if (i > 0){
+					Expect(p, ",", function->args == 2 ? "the function takes 2 arguments" : function->args == 3 ?
+						"the function takes 3 arguments" : "the function takes 1 argument");
+				}
+				Expr(p);
+			}
+			Expect(p, ")", "expected ) after the arguments");
+			EmitOp(p, function->op);
+			return;
+		}
+		int slot = FindSlot(p->set, name, length);
+		if (slot < 0){
+			p->pos = name;
+			Fail(p, "unknown name");
+			return;
+		}
+		EmitLoad(p, slot);
+		return;
+	}
+	if (Accept(p, "(")){
+		Expr(p);
+		Expect(p, ")", "expected )");
+		return;
+	}
+	Fail(p, "expected a number, a name or (");
+}
+
+
+static void Unary(Parser *p);
+
+//primary [^ unary], so -2^2 is -4 and 2^-1 is 0.5; right associative.
+static void Power(Parser *p){
+	Primary(p);
+	if (!p->failed && Accept(p, "^")){
+		Unary(p);
+		EmitOp(p, FORMULA_OP_Pow);
+	}
+}
+
+
+//Counts a level of recursion, 0 (and an error) past FORMULA_NEST_MAX. Every Enter has a Leave.
+static int Enter(Parser *p){
+	if (++p->nest > FORMULA_NEST_MAX){
+		Fail(p, "nested too deep");
+	}
+	return !p->failed;
+}
+
+
+static void Leave(Parser *p){
+	p->nest--;
+}
+
+
+static void Unary(Parser *p){
+	if (!Enter(p)){
+		Leave(p);
+		return;
+	}
+	if (Accept(p, "-")){
+		Unary(p);
+		EmitOp(p, FORMULA_OP_Neg);
+	}
+	else if (Accept(p, "!")){
+		Unary(p);
+		EmitOp(p, FORMULA_OP_Not);
+	}
+	else if (Accept(p, "+")){
+		Unary(p);
+	}
+	else {
+		Power(p);
+	}
+	Leave(p);
+}
+
+
+/* A level of left associative binary operators: next (op next)*, the operators as tokens and instructions.
+ */
+typedef struct BinaryLevel {
+	const char *tokens[4];
+	FormulaOp ops[4];
+} BinaryLevel;
+
+static const BinaryLevel g_levels[] = {
+	{{"||"}, {FORMULA_OP_Or}},
+	{{"&&"}, {FORMULA_OP_And}},
+	{{"==", "!="}, {FORMULA_OP_Eq, FORMULA_OP_Ne}},
+	{{"<=", ">=", "<", ">"}, {FORMULA_OP_Le, FORMULA_OP_Ge, FORMULA_OP_Lt, FORMULA_OP_Gt}},
+	{{"+", "-"}, {FORMULA_OP_Add, FORMULA_OP_Sub}},
+	{{"*", "/", "%"}, {FORMULA_OP_Mul, FORMULA_OP_Div, FORMULA_OP_Mod}},
+};
+
+#define LEVEL_COUNT ((int)(sizeof(g_levels) / sizeof(g_levels[0])))
+
+
+static void Binary(Parser *p, int level){
+	if (level == LEVEL_COUNT){
+		Unary(p);
+		return;
+	}
+	Binary(p, level + 1);
+	const BinaryLevel *l = &g_levels[level];
+	while (!p->failed){
+		int found = -1;
+		for (int i = 0; i < 4 && l->tokens[i] && found < 0; i++){
+			if (Accept(p, l->tokens[i])){
+				found = i;
+			}
+		}
+		if (found < 0){
+			return;
+		}
+		Binary(p, level + 1);
+		EmitOp(p, l->ops[found]);
+	}
+}
+
+
+//or [? expr : expr], right associative.
+static void Expr(Parser *p){
+	if (Enter(p)){
+		Binary(p, 0);
+		if (!p->failed && Accept(p, "?")){
+			Expr(p);
+			Expect(p, ":", "expected : after ? and a value");
+			Expr(p);
+			EmitOp(p, FORMULA_OP_Select);
+		}
+	}
+	Leave(p);
+}
+
+
+//name = expr, a blank line or a comment. Stops at the end of the line.
+static void Line(Parser *p){
+	SkipSpace(p);
+	if (p->pos >= p->end || *p->pos == '\n' || *p->pos == '#'){
+		return;
+	}
+	if (!IsNameStart(*p->pos)){
+		Fail(p, "expected a name to assign");
+		return;
+	}
+	const char *name = p->pos;
+	while (p->pos < p->end && IsNameChar(*p->pos)){
+		p->pos++;
+	}
+	size_t length = (size_t)(p->pos - name);
+	if (length >= FORMULA_NAME_CHARS || FindFunction(name, length)){
+		p->pos = name;
+		Fail(p, length >= FORMULA_NAME_CHARS ? "name too long" : "a function name cannot be assigned");
+		return;
+	}
+	Expect(p, "=", "expected =");
+	p->depth = 0;
+	Expr(p);
+	SkipSpace(p);
+	if (!p->failed && p->pos < p->end && *p->pos != '\n' && *p->pos != '#'){
+		Fail(p, "unexpected text after the expression");
+	}
+	if (p->failed){
+		return;
+	}
+	//A new name gets its slot only now, so it cannot be used in its own expression.
+	int slot = FindSlot(p->set, name, length);
+	if (slot < 0 && (slot = AddSlot(p->set, name, length)) < 0){
+		Fail(p, "too many names");
+		return;
+	}
+	Emit(p, FORMULA_OP_Store, slot);
+	p->set->lines += !p->failed;
+}
+
+
+int FormulaSetCompile(FormulaSet *set, const char *text, size_t length){
+
+	set->error[0] = '\0';
+	set->errorLine = 0;
+	set->errorColumn = 0;
+
+	//The program's End goes, the new lines are appended and it comes back after them.
+	if (set->codeSize){
+		set->codeSize--;
+	}
+
+	Parser p;
+	memset(&p, 0, sizeof(p));
+	p.set = set;
+	p.pos = text;
+	p.end = text + length;
+	p.lineStart = text;
+	p.line = 1;
+	while (!p.failed && p.pos < p.end){
+		size_t lineCode = set->codeSize;
+		Line(&p);
+		if (p.failed){
+			set->codeSize = lineCode;
+			break;
+		}
+		while (p.pos < p.end && *p.pos != '\n'){
+			p.pos++;
+		}
+		if (p.pos < p.end){
+			p.pos++;
+			p.lineStart = p.pos;
+			p.line++;
+		}
+	}
+
+	if (!Reserve(set, 1)){
+		Fail(&p, "out of memory");
+		return 0;
+	}
+	set->code[set->codeSize++] = FORMULA_OP_End;
+	return !p.failed;
+}
+
+
+void FormulaSetEval(const FormulaSet *set, double *values){
+	if (!set->codeSize){
+		return;
+	}
+	double stack[FORMULA_STACK_MAX + 1];
+	Run(set->code, set->consts, values, stack);
+}
+
+
+int FormulaSetDump(const FormulaSet *set, FILE *out){
+	int ok = fprintf(out, "%d lines, %d slots (%d inputs), %d constants, %lu bytes, stack %d\n", set->lines, set->slotCount,
+		set->inputCount, set->constCount, (unsigned long)set->codeSize, set->stackDepth) > 0;
+	size_t pc = 0;
+	while (ok && pc < set->codeSize){
+		FormulaOp op = (FormulaOp)set->code[pc];
+		if (op >= FORMULA_OP_COUNT){
+			fprintf(out, "%6lu  bad instruction %d\n", (unsigned long)pc, (int)op);
+			return 0;
+		}
+		if (g_opArgs[op] == FORMULA_ARG_Const){
+			ok = fprintf(out, "%6lu  %-7s %.17g\n", (unsigned long)pc, g_opNames[op], set->consts[Operand(set->code + pc + 1)]) > 0;
+		}
+		else if (g_opArgs[op] == FORMULA_ARG_Slot){
+			ok = fprintf(out, "%6lu  %-7s %s\n", (unsigned long)pc, g_opNames[op], set->names[Operand(set->code + pc + 1)]) > 0;
+		}
+		else {
+			ok = fprintf(out, "%6lu  %s\n", (unsigned long)pc, g_opNames[op]) > 0;
+		}
+		pc += g_opArgs[op] == FORMULA_ARG_None ? 1 : 3;
+	}
+	return ok;
+}
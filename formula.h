@@ -0,0 +1,182 @@
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* A small expression language for consumption formulas, compiled once into bytecode for a stack machine
+ * and run by a single interpreter loop that keeps the top of the stack in a register.
+ *
+ * A formula text is a list of assignments, one per line, evaluated top to bottom:
+ *
+ * 	# comment
+ * 	newspaper = 0.15
+ * 	fish = fish * (1 - newspaper) * (festival ? 1.5 : 1)
+ *
+ * A name is an input set by the caller (declared with FormulaSetInput before the text is compiled) or a
+ * name assigned on an earlier line; assigning an input overwrites its value for the lines below and for
+ * the caller. Expressions have numbers, + - * / % ^ (power, right associative, above unary minus),
+ * comparisons and && || ! giving 1 or 0, c ? a : b, and the functions of FORMULA_FUNCTION_TABLE. Values are
+ * doubles with IEEE results (a division by zero is an infinity, not an error), and both sides of && || ?:
+ * are evaluated, since nothing has side effects.
+ *
+ * All lines go into one program that ends in FORMULA_OP_End, so evaluating a whole set is one call without
+ * any per-formula overhead. Constant sub-expressions are folded when compiled and constants are pooled.
+ */
+
+
+//Deepest evaluation stack a line may need.
+#define FORMULA_STACK_MAX 64
+
+//Longest name, terminator included.
+#define FORMULA_NAME_CHARS 32
+
+//Most constants and names of a set (operands are 16 bit).
+#define FORMULA_MAX_POOL 65535
+
+//Length of a compile error message, terminator included.
+#define FORMULA_ERROR_CHARS 96
+
+
+//What the 16 bit operand of an instruction is.
+typedef enum FormulaArg {
+	FORMULA_ARG_None,	//the instruction has no operand
+	FORMULA_ARG_Const,	//an index into the constant pool
+	FORMULA_ARG_Slot	//a value slot
+} FormulaArg;
+
+
+/* X(op, arg, pops, name) : an instruction of the bytecode, its operand (2 bytes after it, little endian,
+ * unless FORMULA_ARG_None), and the values it takes from the stack (each pushes one, except Store and End
+ * which push none). The Const and Load forms of add, sub, mul and div take their right operand from the
+ * operand instead of the stack; the compiler fuses them, as most formulas scale and add inputs.
+ */
+#define FORMULA_OP_TABLE(X) \
+	X(FORMULA_OP_End,	FORMULA_ARG_None,	0, "end") \
+	X(FORMULA_OP_Const,	FORMULA_ARG_Const,	0, "const") \
+	X(FORMULA_OP_Load,	FORMULA_ARG_Slot,	0, "load") \
+	X(FORMULA_OP_Store,	FORMULA_ARG_Slot,	1, "store") \
+	X(FORMULA_OP_Add,	FORMULA_ARG_None,	2, "add") \
+	X(FORMULA_OP_Sub,	FORMULA_ARG_None,	2, "sub") \
+	X(FORMULA_OP_Mul,	FORMULA_ARG_None,	2, "mul") \
+	X(FORMULA_OP_Div,	FORMULA_ARG_None,	2, "div") \
+	X(FORMULA_OP_AddConst,	FORMULA_ARG_Const,	1, "add") \
+	X(FORMULA_OP_SubConst,	FORMULA_ARG_Const,	1, "sub") \
+	X(FORMULA_OP_MulConst,	FORMULA_ARG_Const,	1, "mul") \
+	X(FORMULA_OP_DivConst,	FORMULA_ARG_Const,	1, "div") \
+	X(FORMULA_OP_AddLoad,	FORMULA_ARG_Slot,	1, "add") \
+	X(FORMULA_OP_SubLoad,	FORMULA_ARG_Slot,	1, "sub") \
+	X(FORMULA_OP_MulLoad,	FORMULA_ARG_Slot,	1, "mul") \
+	X(FORMULA_OP_DivLoad,	FORMULA_ARG_Slot,	1, "div") \
+	X(FORMULA_OP_Mod,	FORMULA_ARG_None,	2, "mod") \
+	X(FORMULA_OP_Pow,	FORMULA_ARG_None,	2, "pow") \
+	X(FORMULA_OP_Neg,	FORMULA_ARG_None,	1, "neg") \
+	X(FORMULA_OP_Not,	FORMULA_ARG_None,	1, "not") \
+	X(FORMULA_OP_Lt,	FORMULA_ARG_None,	2, "lt") \
+	X(FORMULA_OP_Le,	FORMULA_ARG_None,	2, "le") \
+	X(FORMULA_OP_Gt,	FORMULA_ARG_None,	2, "gt") \
+	X(FORMULA_OP_Ge,	FORMULA_ARG_None,	2, "ge") \
+	X(FORMULA_OP_Eq,	FORMULA_ARG_None,	2, "eq") \
+	X(FORMULA_OP_Ne,	FORMULA_ARG_None,	2, "ne") \
+	X(FORMULA_OP_And,	FORMULA_ARG_None,	2, "and") \
+	X(FORMULA_OP_Or,	FORMULA_ARG_None,	2, "or") \
+	X(FORMULA_OP_Select,	FORMULA_ARG_None,	3, "select") \
+	X(FORMULA_OP_Min,	FORMULA_ARG_None,	2, "min") \
+	X(FORMULA_OP_Max,	FORMULA_ARG_None,	2, "max") \
+	X(FORMULA_OP_Clamp,	FORMULA_ARG_None,	3, "clamp") \
+	X(FORMULA_OP_Abs,	FORMULA_ARG_None,	1, "abs") \
+	X(FORMULA_OP_Floor,	FORMULA_ARG_None,	1, "floor") \
+	X(FORMULA_OP_Ceil,	FORMULA_ARG_None,	1, "ceil") \
+	X(FORMULA_OP_Round,	FORMULA_ARG_None,	1, "round") \
+	X(FORMULA_OP_Sqrt,	FORMULA_ARG_None,	1, "sqrt")
+
+#define X_FORMULA_OP_ENUM(op, arg, pops, name) op,
+typedef enum FormulaOp {
+	FORMULA_OP_TABLE(X_FORMULA_OP_ENUM)
+	FORMULA_OP_COUNT
+} FormulaOp;
+#undef X_FORMULA_OP_ENUM
+
+
+/* X(name, args, op) : a function of the language and the instruction it compiles to
+ */
+#define FORMULA_FUNCTION_TABLE(X) \
+	X("min",	2, FORMULA_OP_Min) \
+	X("max",	2, FORMULA_OP_Max) \
+	X("clamp",	3, FORMULA_OP_Clamp) \
+	X("if",		3, FORMULA_OP_Select) \
+	X("abs",	1, FORMULA_OP_Abs) \
+	X("floor",	1, FORMULA_OP_Floor) \
+	X("ceil",	1, FORMULA_OP_Ceil) \
+	X("round",	1, FORMULA_OP_Round) \
+	X("sqrt",	1, FORMULA_OP_Sqrt)
+
+
+/* code / codeSize / codeCapacity : the program, FORMULA_OP_End at codeSize - 1 once compiled
+ * consts / constCount : the constant pool
+ * names / slotCount : the name of every value slot, inputs first
+ * constIndex / nameIndex / indexSize : hash tables of the pool and the names (entry + 1, 0 for free), so a
+ * 	large text compiles in linear time
+ * inputCount : slots set by the caller
+ * lines : assignments compiled
+ * stackDepth : deepest stack any line needs
+ * constCapacity / nameCapacity : allocated entries of consts and names
+ * error / errorLine / errorColumn : why and where the last FormulaSetCompile failed (line and column from 1)
+ */
+typedef struct FormulaSet {
+	uint8_t *code;
+	size_t codeSize;
+	size_t codeCapacity;
+	double *consts;
+	int constCount;
+	char (*names)[FORMULA_NAME_CHARS];
+	int slotCount;
+	int *constIndex;
+	int *nameIndex;
+	int indexSize;
+	int inputCount;
+	int lines;
+	int stackDepth;
+	int constCapacity;
+	int nameCapacity;
+	char error[FORMULA_ERROR_CHARS];
+	int errorLine;
+	int errorColumn;
+} FormulaSet;
+
+
+void FormulaSetInit(FormulaSet *set);
+
+
+void FormulaSetFree(FormulaSet *set);
+
+
+/* Declares an input, before anything is compiled. Returns its slot, -1 if the name is not an identifier,
+ * taken, or lines were compiled already.
+ */
+int FormulaSetInput(FormulaSet *set, const char *name);
+
+
+/* Compiles the lines of text (length bytes, need not be terminated) and appends them to the program.
+ * Returns 0 with error, errorLine and errorColumn set if a line does not compile; the lines before it stay.
+ */
+int FormulaSetCompile(FormulaSet *set, const char *text, size_t length);
+
+
+/* The slot of a name, -1 if there is none.
+ */
+int FormulaSetSlot(const FormulaSet *set, const char *name);
+
+
+/* Runs the program on values (slotCount entries, the inputs filled in by the caller): every line stores
+ * its result into its slot.
+ */
+void FormulaSetEval(const FormulaSet *set, double *values);
+
+
+/* Writes the program as text, one instruction per line. Returns 0 on a write error.
+ */
+int FormulaSetDump(const FormulaSet *set, FILE *out);
+
+#endif
@@ -0,0 +1,399 @@
+#include <stdio.h>	//fopen, fwrite, rename, remove
+#include <stdlib.h>	//realloc, free
+#include <string.h>	//memcpy, memset, memcmp
+
+#include "game_cache.h"
+#include "assets_import.h"
+
+
+//Bytes hashed at the start, middle and end of assets.xml to notice edits that keep size and time.
+#define SOURCE_SAMPLE_BYTES 4096
+
+
+static const char *g_statusNames[] = {
+	[GAMECACHE_Ok]		= "ok",
+	[GAMECACHE_Missing]	= "missing",
+	[GAMECACHE_Corrupt]	= "corrupt",
+	[GAMECACHE_OldVersion]	= "old version",
+	[GAMECACHE_Stale]	= "stale",
+	[GAMECACHE_NoSource]	= "no source",
+	[GAMECACHE_WriteFailed]	= "write failed"
+};
+
+
+const char *GameCacheStatusName(GameCacheStatus status){
+	if ((int)status < 0 || status > GAMECACHE_WriteFailed){
+		return "(unknown)";
+	}
+	return g_statusNames[status];
+}
+
+
+static uint64_t Fnv1a(uint64_t hash, const unsigned char *data, size_t size){
+	for (size_t i = 0; i < size; i++){
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+#define FNV_OFFSET 14695981039346656037ULL
+
+
+/* Checksum of the cache contents: FNV-1a over 8 byte words instead of single bytes, so checking a cache
+ * of several MB at startup costs about a millisecond. The contents are padded to a multiple of 8 bytes.
+ */
+static uint64_t ContentChecksum(uint64_t hash, const unsigned char *data, size_t size){
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8){
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash ^= word;
+		hash *= 1099511628211ULL;
+		hash ^= hash >> 29;
+	}
+	return Fnv1a(hash, data + i, size - i);
+}
+
+
+/* Size, time and a sampled hash of assets.xml. Only three small pieces of the file are read, so this is
+ * cheap even for a file of several hundred MB.
+ */
+static int ReadSourceIdentity(const char *sourcePath, CacheSource *out){
+
+	MappedFile mf;
+	if (!MappedFileOpen(&mf, sourcePath, 0)){
+		return 0;
+	}
+
+	memset(out, 0, sizeof(*out));
+	out->size = mf.size;
+	out->modifiedTime = mf.modifiedTime;
+
+	uint64_t hash = FNV_OFFSET;
+	size_t sample = mf.size < SOURCE_SAMPLE_BYTES ? mf.size : SOURCE_SAMPLE_BYTES;
+	if (sample > 0){
+		hash = Fnv1a(hash, mf.data, sample);
+		hash = Fnv1a(hash, mf.data + (mf.size - sample) / 2, sample);
+		hash = Fnv1a(hash, mf.data + mf.size - sample, sample);
+	}
+	out->sampleHash = hash;
+
+	MappedFileClose(&mf);
+	return 1;
+}
+
+
+const char *GameCacheText(const GameCache *cache, CacheString s){
+	return cache->strings + s.offset;
+}
+
+
+void GameCacheClose(GameCache *cache){
+	MappedFileClose(&cache->file);
+	memset(cache, 0, sizeof(*cache));
+}
+
+
+//Checks that a section lies inside the file and is aligned for its record type.
+static int SectionFits(const CacheHeader *h, int section, size_t recordSize, size_t fileSize){
+	const CacheSection *s = &h->sections[section];
+	if (s->offset % 8 != 0 || s->offset < sizeof(CacheHeader) || s->offset > fileSize){
+		return 0;
+	}
+	return s->count <= (fileSize - s->offset) / recordSize;
+}
+
+
+GameCacheStatus GameCacheOpen(GameCache *cache, const char *cachePath, const char *sourcePath){
+
+	memset(cache, 0, sizeof(*cache));
+
+	if (!MappedFileOpen(&cache->file, cachePath, 0)){
+		return GAMECACHE_Missing;
+	}
+
+	const CacheHeader *h = (const CacheHeader *)cache->file.data;
+	size_t size = cache->file.size;
+
+	if (size < sizeof(CacheHeader) || memcmp(h->magic, GAME_CACHE_MAGIC, 8) != 0){
+		GameCacheClose(cache);
+		return GAMECACHE_Corrupt;
+	}
+	if (h->version != GAME_CACHE_VERSION || h->headerSize != sizeof(CacheHeader)){
+		GameCacheClose(cache);
+		return GAMECACHE_OldVersion;
+	}
+	if (h->fileSize != size ||
+	    !SectionFits(h, CACHE_SECTION_Products, sizeof(CacheProduct), size) ||
+	    !SectionFits(h, CACHE_SECTION_Residences, sizeof(CacheResidence), size) ||
+	    !SectionFits(h, CACHE_SECTION_Populations, sizeof(CachePopulation), size) ||
+	    !SectionFits(h, CACHE_SECTION_Productions, sizeof(CacheProduction), size) ||
+	    !SectionFits(h, CACHE_SECTION_Items, sizeof(CacheItem), size) ||
+	    !SectionFits(h, CACHE_SECTION_Strings, 1, size)){
+		GameCacheClose(cache);
+		return GAMECACHE_Corrupt;
+	}
+	if (ContentChecksum(FNV_OFFSET, cache->file.data + sizeof(CacheHeader), size - sizeof(CacheHeader)) != h->checksum){
+		GameCacheClose(cache);
+		return GAMECACHE_Corrupt;
+	}
+
+	if (sourcePath){
+		CacheSource current;
+		if (!ReadSourceIdentity(sourcePath, &current)){
+			GameCacheClose(cache);
+			return GAMECACHE_NoSource;
+		}
+		if (current.size != h->source.size || current.modifiedTime != h->source.modifiedTime ||
+		    current.sampleHash != h->source.sampleHash){
+			GameCacheClose(cache);
+			return GAMECACHE_Stale;
+		}
+	}
+
+	const unsigned char *base = cache->file.data;
+	cache->header = h;
+	cache->products = (const CacheProduct *)(base + h->sections[CACHE_SECTION_Products].offset);
+	cache->productCount = (int)h->sections[CACHE_SECTION_Products].count;
+	cache->residences = (const CacheResidence *)(base + h->sections[CACHE_SECTION_Residences].offset);
+	cache->residenceCount = (int)h->sections[CACHE_SECTION_Residences].count;
+	cache->populations = (const CachePopulation *)(base + h->sections[CACHE_SECTION_Populations].offset);
+	cache->populationCount = (int)h->sections[CACHE_SECTION_Populations].count;
+	cache->productions = (const CacheProduction *)(base + h->sections[CACHE_SECTION_Productions].offset);
+	cache->productionCount = (int)h->sections[CACHE_SECTION_Productions].count;
+	cache->items = (const CacheItem *)(base + h->sections[CACHE_SECTION_Items].offset);
+	cache->itemCount = (int)h->sections[CACHE_SECTION_Items].count;
+	cache->strings = (const char *)(base + h->sections[CACHE_SECTION_Strings].offset);
+	cache->stringBytes = h->sections[CACHE_SECTION_Strings].count;
+	return GAMECACHE_Ok;
+}
+
+
+/* A growable byte array, one per section while the cache is being built.
+ */
+typedef struct ByteBuffer {
+	unsigned char *data;
+	size_t length;
+	size_t capacity;
+	int failed;
+} ByteBuffer;
+
+
+static void *BufferAppend(ByteBuffer *b, const void *data, size_t size){
+	if (b->failed || size == 0){
+		return NULL;
+	}
+	if (b->length + size > b->capacity){
+		size_t capacity = b->capacity ? b->capacity : 4096;
+		while (capacity < b->length + size){
+			capacity *= 2;
+		}
+		unsigned char *grown = realloc(b->data, capacity);
+		if (!grown){
+			b->failed = 1;
+			return NULL;
+		}
+		b->data = grown;
+		b->capacity = capacity;
+	}
+	void *at = b->data + b->length;
+	memcpy(at, data, size);
+	b->length += size;
+	return at;
+}
+
+
+typedef struct CacheBuilder {
+	ByteBuffer sections[CACHE_SECTION_COUNT];
+} CacheBuilder;
+
+
+static CacheString AddString(CacheBuilder *b, AssetView text){
+	CacheString s;
+	s.offset = (uint32_t)b->sections[CACHE_SECTION_Strings].length;
+	s.length = (uint32_t)text.len;
+	BufferAppend(&b->sections[CACHE_SECTION_Strings], text.ptr, text.len);
+	return s;
+}
+
+
+static uint32_t AddItems(CacheBuilder *b, const AssetItem *items, int count){
+	uint32_t first = (uint32_t)(b->sections[CACHE_SECTION_Items].length / sizeof(CacheItem));
+	for (int i = 0; i < count; i++){
+		CacheItem item = { items[i].product, items[i].amount };
+		BufferAppend(&b->sections[CACHE_SECTION_Items], &item, sizeof(item));
+	}
+	return first;
+}
+
+
+static int CollectRecord(const AssetRecord *r, void *user){
+
+	CacheBuilder *b = user;
+
+	switch (r->kind){
+		case ASSET_Product:{
+			CacheProduct p;
+			memset(&p, 0, sizeof(p));
+			p.guid = r->guid;
+			p.name = AddString(b, r->name);
+			BufferAppend(&b->sections[CACHE_SECTION_Products], &p, sizeof(p));
+			break;
+		}
+		case ASSET_Residence:{
+			CacheResidence res;
+			memset(&res, 0, sizeof(res));
+			res.guid = r->guid;
+			res.populationLevel = r->populationLevel;
+			res.residentMax = r->residentMax;
+			res.name = AddString(b, r->name);
+			BufferAppend(&b->sections[CACHE_SECTION_Residences], &res, sizeof(res));
+			break;
+		}
+		case ASSET_PopulationLevel:{
+			CachePopulation pop;
+			memset(&pop, 0, sizeof(pop));
+			pop.guid = r->guid;
+			pop.name = AddString(b, r->name);
+			pop.firstNeed = AddItems(b, r->inputs, r->inputCount);
+			pop.needCount = (uint32_t)r->inputCount;
+			BufferAppend(&b->sections[CACHE_SECTION_Populations], &pop, sizeof(pop));
+			break;
+		}
+		case ASSET_Production:{
+			CacheProduction prod;
+			memset(&prod, 0, sizeof(prod));
+			prod.guid = r->guid;
+			prod.cycleTime = r->cycleTime;
+			prod.name = AddString(b, r->name);
+			prod.firstInput = AddItems(b, r->inputs, r->inputCount);
+			prod.inputCount = (uint32_t)r->inputCount;
+			prod.firstOutput = AddItems(b, r->outputs, r->outputCount);
+			prod.outputCount = (uint32_t)r->outputCount;
+			BufferAppend(&b->sections[CACHE_SECTION_Productions], &prod, sizeof(prod));
+			break;
+		}
+		default:
+			break;
+	}
+	return 1;
+}
+
+
+static const size_t g_recordSizes[CACHE_SECTION_COUNT] = {
+	[CACHE_SECTION_Products]	= sizeof(CacheProduct),
+	[CACHE_SECTION_Residences]	= sizeof(CacheResidence),
+	[CACHE_SECTION_Populations]	= sizeof(CachePopulation),
+	[CACHE_SECTION_Productions]	= sizeof(CacheProduction),
+	[CACHE_SECTION_Items]		= sizeof(CacheItem),
+	[CACHE_SECTION_Strings]		= 1
+};
+
+
+/* Lays the sections out behind the header (each starting on an 8 byte boundary), fills in the header and
+ * writes everything to a temporary file that then replaces cachePath, so a crash never leaves half a cache.
+ */
+static GameCacheStatus WriteCache(CacheBuilder *b, const CacheSource *source, const char *cachePath){
+
+	static const unsigned char padding[8];
+
+	CacheHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, GAME_CACHE_MAGIC, 8);
+	h.version = GAME_CACHE_VERSION;
+	h.headerSize = sizeof(CacheHeader);
+	h.source = *source;
+
+	uint64_t offset = sizeof(CacheHeader);
+	uint64_t checksum = FNV_OFFSET;
+	for (int s = 0; s < CACHE_SECTION_COUNT; s++){
+		h.sections[s].offset = offset;
+		h.sections[s].count = b->sections[s].length / g_recordSizes[s];
+
+		//Padding goes into the buffer itself so every section is a whole number of checksum words.
+		BufferAppend(&b->sections[s], padding, (8 - b->sections[s].length % 8) % 8);
+		if (b->sections[s].failed){
+			return GAMECACHE_WriteFailed;
+		}
+		checksum = ContentChecksum(checksum, b->sections[s].data, b->sections[s].length);
+		offset += b->sections[s].length;
+	}
+	h.fileSize = offset;
+	h.checksum = checksum;
+
+	char tempPath[1024];
+	if (snprintf(tempPath, sizeof(tempPath), "%s.tmp", cachePath) >= (int)sizeof(tempPath)){
+		return GAMECACHE_WriteFailed;
+	}
+
+	FILE *f = fopen(tempPath, "wb");
+	if (!f){
+		return GAMECACHE_WriteFailed;
+	}
+
+	int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+	for (int s = 0; s < CACHE_SECTION_COUNT && ok; s++){
+		if (b->sections[s].length > 0){
+			ok = fwrite(b->sections[s].data, b->sections[s].length, 1, f) == 1;
+		}
+	}
+	if (fclose(f) != 0){
+		ok = 0;
+	}
+
+	//rename does not replace an existing file on Windows.
+	remove(cachePath);
+	if (!ok || rename(tempPath, cachePath) != 0){
+		remove(tempPath);
+		return GAMECACHE_WriteFailed;
+	}
+	return GAMECACHE_Ok;
+}
+
+
+GameCacheStatus GameCacheBuild(const char *cachePath, const char *sourcePath){
+
+	CacheSource source;
+	if (!ReadSourceIdentity(sourcePath, &source)){
+		return GAMECACHE_NoSource;
+	}
+
+	CacheBuilder b;
+	memset(&b, 0, sizeof(b));
+
+	GameCacheStatus status;
+	if (!AssetsImportFile(sourcePath, CollectRecord, &b, NULL)){
+		status = GAMECACHE_NoSource;
+	}
+	else{
+		status = WriteCache(&b, &source, cachePath);
+	}
+
+	for (int s = 0; s < CACHE_SECTION_COUNT; s++){
+		free(b.sections[s].data);
+	}
+	return status;
+}
+
+
+GameCacheStatus GameCacheLoad(GameCache *cache, const char *cachePath, const char *sourcePath, GameCacheStatus *why){
+
+	GameCacheStatus status = GameCacheOpen(cache, cachePath, sourcePath);
+	if (why){
+		*why = status;
+	}
+	if (status == GAMECACHE_Ok){
+		return status;
+	}
+	//Without assets.xml there is nothing to rebuild from, but a cache that is intact on its own is still usable.
+	if (status == GAMECACHE_NoSource){
+		return GameCacheOpen(cache, cachePath, NULL);
+	}
+
+	status = GameCacheBuild(cachePath, sourcePath);
+	if (status != GAMECACHE_Ok){
+		return status;
+	}
+	return GameCacheOpen(cache, cachePath, sourcePath);
+}
@@ -0,0 +1,183 @@
+#ifndef GAME_CACHE_H
+#define GAME_CACHE_H
+
+#include <stdint.h>
+
+#include "mapped_file.h"
+
+/* Binary snapshot of the game data imported from assets.xml (assets_import.c).
+ *
+ * The cache file is a fixed header followed by flat arrays of fixed-size records and one string block.
+ * It is memory mapped and the arrays are used where they lie, there is no loading or unpacking step.
+ *
+ * The header remembers the size, modification time and a sampled hash of the assets.xml it was built from.
+ * GameCacheLoad compares those with the current assets.xml and rebuilds the cache if anything changed, if
+ * the format version is different, or if the checksum over the contents does not match.
+ *
+ * All numbers are stored in the byte order of the machine that wrote the file; a cache written on a
+ * different byte order fails the magic check and is rebuilt.
+ */
+
+
+//Bump this whenever a record layout or the header changes.
+#define GAME_CACHE_VERSION 1
+
+#define GAME_CACHE_MAGIC "A18OCACH"
+
+
+typedef enum GameCacheStatus {
+	GAMECACHE_Ok,
+	GAMECACHE_Missing,	//the cache file does not exist
+	GAMECACHE_Corrupt,	//wrong magic, truncated or checksum mismatch
+	GAMECACHE_OldVersion,	//written by a different GAME_CACHE_VERSION
+	GAMECACHE_Stale,	//assets.xml changed since the cache was written
+	GAMECACHE_NoSource,	//assets.xml could not be read
+	GAMECACHE_WriteFailed	//rebuilding failed
+} GameCacheStatus;
+
+
+/* Text in the string block. offset/length are relative to the start of the block, not null terminated.
+ */
+typedef struct CacheString {
+	uint32_t offset;
+	uint32_t length;
+} CacheString;
+
+
+typedef struct CacheProduct {
+	int64_t guid;
+	CacheString name;
+} CacheProduct;
+
+
+typedef struct CacheResidence {
+	int64_t guid;
+	int64_t populationLevel;
+	int32_t residentMax;
+	uint32_t reserved;
+	CacheString name;
+} CacheResidence;
+
+
+/* needs are items firstNeed .. firstNeed + needCount - 1 of the item array.
+ */
+typedef struct CachePopulation {
+	int64_t guid;
+	CacheString name;
+	uint32_t firstNeed;
+	uint32_t needCount;
+} CachePopulation;
+
+
+typedef struct CacheProduction {
+	int64_t guid;
+	double cycleTime;
+	CacheString name;
+	uint32_t firstInput;
+	uint32_t inputCount;
+	uint32_t firstOutput;
+	uint32_t outputCount;
+} CacheProduction;
+
+
+typedef struct CacheItem {
+	int64_t product;
+	double amount;
+} CacheItem;
+
+
+/* Identity of the assets.xml a cache was built from.
+ */
+typedef struct CacheSource {
+	uint64_t size;
+	int64_t modifiedTime;
+	uint64_t sampleHash;
+} CacheSource;
+
+
+/* One array of the file: byte offset from the start of the file and number of records.
+ */
+typedef struct CacheSection {
+	uint64_t offset;
+	uint64_t count;
+} CacheSection;
+
+
+enum {
+	CACHE_SECTION_Products,
+	CACHE_SECTION_Residences,
+	CACHE_SECTION_Populations,
+	CACHE_SECTION_Productions,
+	CACHE_SECTION_Items,
+	CACHE_SECTION_Strings,
+	CACHE_SECTION_COUNT
+};
+
+
+/* The fixed header at the start of the file.
+ *
+ * checksum : FNV-1a hash of everything after the header
+ */
+typedef struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	CacheSource source;
+	uint64_t fileSize;
+	uint64_t checksum;
+	CacheSection sections[CACHE_SECTION_COUNT];
+} CacheHeader;
+
+
+/* An open cache. The arrays point straight into the mapped file.
+ */
+typedef struct GameCache {
+	MappedFile file;
+	const CacheHeader *header;
+
+	const CacheProduct *products;
+	int productCount;
+	const CacheResidence *residences;
+	int residenceCount;
+	const CachePopulation *populations;
+	int populationCount;
+	const CacheProduction *productions;
+	int productionCount;
+	const CacheItem *items;
+	int itemCount;
+	const char *strings;
+	uint64_t stringBytes;
+} GameCache;
+
+
+/* Maps an existing cache and checks it against the assets.xml at sourcePath (sourcePath may be NULL to
+ * skip that check). The cache is only usable if GAMECACHE_Ok is returned.
+ */
+GameCacheStatus GameCacheOpen(GameCache *cache, const char *cachePath, const char *sourcePath);
+
+
+/* Imports sourcePath and writes a new cache file to cachePath. Returns GAMECACHE_Ok,
+ * GAMECACHE_NoSource or GAMECACHE_WriteFailed.
+ */
+GameCacheStatus GameCacheBuild(const char *cachePath, const char *sourcePath);
+
+
+/* Opens the cache, rebuilding it first if it is missing, stale, corrupt or of another version.
+ *
+ * GameCacheStatus *why : if not NULL, receives the result of the first open attempt (GAMECACHE_Ok means
+ * 			the existing cache was used as is)
+ */
+GameCacheStatus GameCacheLoad(GameCache *cache, const char *cachePath, const char *sourcePath, GameCacheStatus *why);
+
+
+void GameCacheClose(GameCache *cache);
+
+
+/* Returns a pointer to the text of s (not null terminated, use s.length).
+ */
+const char *GameCacheText(const GameCache *cache, CacheString s);
+
+
+const char *GameCacheStatusName(GameCacheStatus status);
+
+#endif
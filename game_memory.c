@@ -0,0 +1,200 @@
+#include <string.h>	//memset, memcpy
+
+#include "game_memory.h"
+
+
+#define X_GAME_NODE_PARENT(node, parent, offset) [node] = parent,
+static const GameNode g_nodeParent[GAME_NODE_COUNT] = {
+	GAME_NODE_TABLE(X_GAME_NODE_PARENT)
+};
+#undef X_GAME_NODE_PARENT
+
+#define X_GAME_NODE_OFFSET(node, parent, offset) [node] = offset,
+static const int64_t g_nodeOffset[GAME_NODE_COUNT] = {
+	GAME_NODE_TABLE(X_GAME_NODE_OFFSET)
+};
+#undef X_GAME_NODE_OFFSET
+
+#define X_GAME_FIELD_NODE(field, name, node, offset) [field] = node,
+static const GameNode g_fieldNode[GAME_FIELD_COUNT] = {
+	GAME_FIELD_TABLE(X_GAME_FIELD_NODE)
+};
+#undef X_GAME_FIELD_NODE
+
+#define X_GAME_FIELD_OFFSET(field, name, node, offset) [field] = offset,
+static const int64_t g_fieldOffset[GAME_FIELD_COUNT] = {
+	GAME_FIELD_TABLE(X_GAME_FIELD_OFFSET)
+};
+#undef X_GAME_FIELD_OFFSET
+
+#define X_GAME_FIELD_NAME(field, name, node, offset) [field] = name,
+static const char *const g_fieldNames[GAME_FIELD_COUNT] = {
+	GAME_FIELD_TABLE(X_GAME_FIELD_NAME)
+};
+#undef X_GAME_FIELD_NAME
+
+
+const char *GameFieldName(GameField field){
+	if ((int)field < 0 || field >= GAME_FIELD_COUNT){
+		return "?";
+	}
+	return g_fieldNames[field];
+}
+
+
+void GameLayoutDefault(GameLayout *layout){
+	memcpy(layout->nodeOffset, g_nodeOffset, sizeof(layout->nodeOffset));
+	memcpy(layout->fieldOffset, g_fieldOffset, sizeof(layout->fieldOffset));
+}
+
+
+int GameMemoryOpen(GameMemory *game, long pid, const char *moduleName, const GameLayout *layout){
+	memset(game, 0, sizeof(*game));
+	game->layout = *layout;
+	return ProcMemOpen(&game->process, pid, moduleName);
+}
+
+
+//Where the pointer to node's object is, given the objects of the nodes before it.
+static uint64_t PointerAddress(const GameMemory *game, const uint64_t node[GAME_NODE_COUNT], GameNode n){
+	GameNode parent = g_nodeParent[n];
+	return (parent == GAME_NODE_Module ? game->process.base : node[parent]) + (uint64_t)game->layout.nodeOffset[n];
+}
+
+
+static int ReadPointer(GameMemory *game, uint64_t address, uint64_t *pointer){
+	*pointer = 0;
+	ProcMemSpan span = {address, pointer, GAME_POINTER_SIZE};
+	return ProcMemRead(&game->process, &span, 1) && *pointer;
+}
+
+
+/* A value or chain pointer of the batch.
+ *
+ * address / size : where it is in the game
+ * at : receives its position in the buffer
+ */
+typedef struct GameSlot {
+	uint64_t address;
+	uint32_t size;
+	uint16_t *at;
+} GameSlot;
+
+
+int GameMemoryResolve(GameMemory *game){
+
+	game->resolved = 0;
+	game->stats.resolves++;
+	for (int n = 0; n < GAME_NODE_COUNT; n++){
+		if (!ReadPointer(game, PointerAddress(game, game->node, (GameNode)n), &game->node[n])){
+			return 0;
+		}
+	}
+
+	GameSlot slots[GAME_SLOT_COUNT];
+	int count = 0;
+	for (int f = 0; f < GAME_FIELD_COUNT; f++){
+		uint64_t address = game->node[g_fieldNode[f]] + (uint64_t)game->layout.fieldOffset[f];
+		slots[count++] = (GameSlot){address, sizeof(int32_t), &game->fieldAt[f]};
+	}
+	for (int n = 0; n < GAME_NODE_COUNT; n++){
+		slots[count++] = (GameSlot){PointerAddress(game, game->node, (GameNode)n), GAME_POINTER_SIZE, &game->pointerAt[n]};
+	}
+	for (int i = 1; i < count; i++){
+		GameSlot slot = slots[i];
+		int j = i;
+		for (; j > 0 && slots[j - 1].address > slot.address; j--){
+			slots[j] = slots[j - 1];
+		}
+		slots[j] = slot;
+	}
+
+	//Sorted slots closer than GAME_SPAN_GAP share a span; the spans lie one after the other in the buffer.
+	game->spanCount = 0;
+	size_t used = 0;
+	uint64_t end = 0;
+	for (int i = 0; i < count; i++){
+		ProcMemSpan *span;
+		if (game->spanCount > 0 && slots[i].address <= end + GAME_SPAN_GAP){
+			span = &game->spans[game->spanCount - 1];
+		}
+		else {
+			span = &game->spans[game->spanCount++];
+			span->address = slots[i].address;
+			span->out = game->buffer + used;
+			span->size = 0;
+			end = slots[i].address;
+		}
+		if (slots[i].address + slots[i].size > end){
+			end = slots[i].address + slots[i].size;
+		}
+		size_t grown = (size_t)(end - span->address);
+		if ((uint8_t *)span->out - game->buffer + grown > GAME_BATCH_BYTES){
+			return 0;
+		}
+		used += grown - span->size;
+		span->size = grown;
+		*slots[i].at = (uint16_t)((uint8_t *)span->out - game->buffer + (slots[i].address - span->address));
+	}
+	game->resolved = 1;
+	return 1;
+}
+
+
+int GameMemoryTick(GameMemory *game){
+
+	if (!game->resolved && !GameMemoryResolve(game)){
+		game->stats.failures++;
+		return 0;
+	}
+	game->stats.reads++;
+	game->stats.spans += (uint64_t)game->spanCount;
+	if (!ProcMemRead(&game->process, game->spans, game->spanCount)){
+		game->resolved = 0;
+		game->stats.failures++;
+		return 0;
+	}
+	for (int n = 0; n < GAME_NODE_COUNT; n++){
+		uint64_t pointer;
+		memcpy(&pointer, game->buffer + game->pointerAt[n], GAME_POINTER_SIZE);
+		if (pointer != game->node[n]){
+			game->resolved = 0;
+			game->stats.stale++;
+			return 0;
+		}
+	}
+	for (int f = 0; f < GAME_FIELD_COUNT; f++){
+		memcpy(&game->values[f], game->buffer + game->fieldAt[f], sizeof(int32_t));
+	}
+	game->stats.ticks++;
+	return 1;
+}
+
+
+int GameMemoryReadUncached(GameMemory *game, int32_t values[GAME_FIELD_COUNT]){
+	for (int f = 0; f < GAME_FIELD_COUNT; f++){
+		//The chain from the module down to the field's node.
+		GameNode path[GAME_NODE_COUNT];
+		int depth = 0;
+		for (GameNode n = g_fieldNode[f]; n != GAME_NODE_Module; n = g_nodeParent[n]){
+			path[depth++] = n;
+		}
+		uint64_t node[GAME_NODE_COUNT] = {0};
+		while (depth--){
+			if (!ReadPointer(game, PointerAddress(game, node, path[depth]), &node[path[depth]])){
+				return 0;
+			}
+		}
+		ProcMemSpan span = {node[g_fieldNode[f]] + (uint64_t)game->layout.fieldOffset[f], &values[f], sizeof(int32_t)};
+		if (!ProcMemRead(&game->process, &span, 1)){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+void GameMemoryClose(GameMemory *game){
+	ProcMemClose(&game->process);
+	memset(game, 0, sizeof(*game));
+}
@@ -0,0 +1,160 @@
+#ifndef GAME_MEMORY_H
+#define GAME_MEMORY_H
+
+#include <stdint.h>
+
+#include "proc_mem.h"
+
+/* Reads population and stock values straight out of the running game's memory, so they need not be typed
+ * into the spinners (or read off the HUD).
+ *
+ * Every value lives at a fixed offset in some game object, and the objects are found by following pointers
+ * from a static address in the game module (GAME_NODE_TABLE). Following a chain costs one read per pointer,
+ * so the chains are followed once (GameMemoryResolve) and the address of every value is kept. A tick then
+ * fetches everything in one batch: the value addresses and the pointers of the chains are sorted, nearby
+ * ones are merged into spans and the spans go to a single ProcMemRead. If a pointer in the batch differs from
+ * the one the chains were followed through (the game loaded another session or moved an object), the tick's
+ * values are dropped and the chains are followed again on the next tick.
+ *
+ * The offsets depend on the game build and change with patches. GameLayout holds a copy of them, so a
+ * caller can use others; the Linux stand-in process (game_standin.h) puts its own objects behind them.
+ */
+
+
+/* X(node, parent, offset) : the object pointed to by the pointer at offset in the object of parent, or at
+ * offset from the module base for GAME_NODE_Module. A node comes after its parent.
+ */
+#define GAME_NODE_TABLE(X) \
+	X(GAME_NODE_Session,	GAME_NODE_Module,	0x05A3C1F8) \
+	X(GAME_NODE_Island,	GAME_NODE_Session,	0x48) \
+	X(GAME_NODE_Population,	GAME_NODE_Island,	0x1C0) \
+	X(GAME_NODE_Storage,	GAME_NODE_Island,	0x2F8)
+
+#define X_GAME_NODE_ENUM(node, parent, offset) node,
+typedef enum GameNode {
+	GAME_NODE_Module = -1,
+	GAME_NODE_TABLE(X_GAME_NODE_ENUM)
+	GAME_NODE_COUNT
+} GameNode;
+#undef X_GAME_NODE_ENUM
+
+
+/* X(field, name, node, offset) : a 32 bit value at offset in the object of node
+ */
+#define GAME_FIELD_TABLE(X) \
+	X(GAME_Farmers,		"farmers",	GAME_NODE_Population,	0x10) \
+	X(GAME_Workers,		"workers",	GAME_NODE_Population,	0x14) \
+	X(GAME_StockFish,	"fish",		GAME_NODE_Storage,	0x20) \
+	X(GAME_StockWorkClothes,	"work clothes",	GAME_NODE_Storage,	0x28) \
+	X(GAME_StockSchnapps,	"schnapps",	GAME_NODE_Storage,	0x30)
+
+#define X_GAME_FIELD_ENUM(field, name, node, offset) field,
+typedef enum GameField {
+	GAME_FIELD_TABLE(X_GAME_FIELD_ENUM)
+	GAME_FIELD_COUNT
+} GameField;
+#undef X_GAME_FIELD_ENUM
+
+
+//The game's executable, the module the chains start from.
+#define GAME_EXE_NAME "Anno1800.exe"
+
+//Range of the interval between the overlay's reads, the sampler (sampler.h) picks it by how often values change.
+#define GAME_MEMORY_MIN_INTERVAL_MS 50
+#define GAME_MEMORY_MAX_INTERVAL_MS 2000
+
+//Pointers are those of the 64 bit game.
+#define GAME_POINTER_SIZE 8
+
+//Values closer than this many bytes are read as one span.
+#define GAME_SPAN_GAP 64
+
+//Most bytes a batch reads, gaps included.
+#define GAME_BATCH_BYTES 1024
+
+//Values and chain pointers a batch holds.
+#define GAME_SLOT_COUNT (GAME_FIELD_COUNT + GAME_NODE_COUNT)
+
+
+/* nodeOffset / fieldOffset : the offsets of GAME_NODE_TABLE and GAME_FIELD_TABLE
+ */
+typedef struct GameLayout {
+	int64_t nodeOffset[GAME_NODE_COUNT];
+	int64_t fieldOffset[GAME_FIELD_COUNT];
+} GameLayout;
+
+
+/* ticks : GameMemoryTick calls that returned values
+ * resolves : times the chains were followed
+ * stale : ticks dropped because a chain pointer had changed
+ * failures : ticks without values because a read failed (no session loaded, the game exited)
+ * reads / spans : ProcMemRead calls and spans of the ticks
+ */
+typedef struct GameMemoryStats {
+	uint64_t ticks;
+	uint64_t resolves;
+	uint64_t stale;
+	uint64_t failures;
+	uint64_t reads;
+	uint64_t spans;
+} GameMemoryStats;
+
+
+/* process : the game
+ * layout : the offsets followed
+ * resolved : node and the batch are valid
+ * node : address of every node's object when the chains were followed
+ * spans / spanCount : the batch of a tick, reading into buffer
+ * fieldAt / pointerAt : where every value and every chain pointer is in buffer
+ * values : the values of the last tick that returned 1
+ */
+typedef struct GameMemory {
+	ProcMem process;
+	GameLayout layout;
+	int resolved;
+	uint64_t node[GAME_NODE_COUNT];
+	ProcMemSpan spans[GAME_SLOT_COUNT];
+	int spanCount;
+	uint16_t fieldAt[GAME_FIELD_COUNT];
+	uint16_t pointerAt[GAME_NODE_COUNT];
+	uint8_t buffer[GAME_BATCH_BYTES];
+	int32_t values[GAME_FIELD_COUNT];
+	GameMemoryStats stats;
+} GameMemory;
+
+
+const char *GameFieldName(GameField field);
+
+
+/* The offsets of the tables.
+ */
+void GameLayoutDefault(GameLayout *layout);
+
+
+/* Opens process pid, whose module moduleName (NULL for its executable) the layout starts from. Nothing is
+ * read yet. Returns 0 if the process cannot be read.
+ */
+int GameMemoryOpen(GameMemory *game, long pid, const char *moduleName, const GameLayout *layout);
+
+
+/* Follows the chains and plans the batch. Returns 0 if a pointer could not be read or is NULL (the game has
+ * no session loaded), or the values are too far apart for GAME_BATCH_BYTES.
+ */
+int GameMemoryResolve(GameMemory *game);
+
+
+/* Reads every value in one batch into game->values, following the chains first if needed. Returns 1 if
+ * the values are current, 0 if there are none this tick (see GameMemoryStats).
+ */
+int GameMemoryTick(GameMemory *game);
+
+
+/* Reads every value by following its whole chain, one read per pointer, without the cache or the batch.
+ * Returns 0 if a read failed. For checking and timing GameMemoryTick against.
+ */
+int GameMemoryReadUncached(GameMemory *game, int32_t values[GAME_FIELD_COUNT]);
+
+
+void GameMemoryClose(GameMemory *game);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdlib.h>	//calloc, malloc, free
+#include <string.h>	//memcpy, memset
+#include <unistd.h>	//getpid
+
+#include "game_standin.h"
+
+
+#define X_GAME_NODE_PARENT(node, parent, offset) [node] = parent,
+static const GameNode g_nodeParent[GAME_NODE_COUNT] = {
+	GAME_NODE_TABLE(X_GAME_NODE_PARENT)
+};
+#undef X_GAME_NODE_PARENT
+
+#define X_GAME_FIELD_NODE(field, name, node, offset) [field] = node,
+static const GameNode g_fieldNode[GAME_FIELD_COUNT] = {
+	GAME_FIELD_TABLE(X_GAME_FIELD_NODE)
+};
+#undef X_GAME_FIELD_NODE
+
+//What the game keeps at module + offset: the pointers of the nodes whose parent is GAME_NODE_Module.
+static uint64_t g_standinStatics[GAME_NODE_COUNT];
+
+
+int GameStandinLayout(GameLayout *layout){
+	ProcMem self;
+	if (!ProcMemOpen(&self, (long)getpid(), NULL)){
+		return 0;
+	}
+	GameLayoutDefault(layout);
+	for (int n = 0; n < GAME_NODE_COUNT; n++){
+		if (g_nodeParent[n] == GAME_NODE_Module){
+			layout->nodeOffset[n] = (int64_t)((uint64_t)(uintptr_t)&g_standinStatics[n] - self.base);
+		}
+	}
+	ProcMemClose(&self);
+	return 1;
+}
+
+
+//Points node's pointer at its object.
+static void Link(GameStandin *standin, GameNode n){
+	uint64_t pointer = (uint64_t)(uintptr_t)standin->objects[n];
+	GameNode parent = g_nodeParent[n];
+	if (parent == GAME_NODE_Module){
+		g_standinStatics[n] = pointer;
+	}
+	else {
+		memcpy(standin->objects[parent] + standin->layout.nodeOffset[n], &pointer, GAME_POINTER_SIZE);
+	}
+}
+
+
+int GameStandinInit(GameStandin *standin, const GameLayout *layout){
+
+	memset(standin, 0, sizeof(*standin));
+	standin->layout = *layout;
+	for (int n = 0; n < GAME_NODE_COUNT; n++){
+		int64_t offset = layout->nodeOffset[n];
+		if (g_nodeParent[n] != GAME_NODE_Module && (offset < 0 || offset > GAME_STANDIN_OBJECT_BYTES - GAME_POINTER_SIZE)){
+			GameStandinFree(standin);
+			return 0;
+		}
+	}
+	for (int f = 0; f < GAME_FIELD_COUNT; f++){
+		if (layout->fieldOffset[f] < 0 || layout->fieldOffset[f] > GAME_STANDIN_OBJECT_BYTES - (int64_t)sizeof(int32_t)){
+			GameStandinFree(standin);
+			return 0;
+		}
+	}
+	for (int n = 0; n < GAME_NODE_COUNT; n++){
+		standin->objects[n] = calloc(1, GAME_STANDIN_OBJECT_BYTES);
+		if (!standin->objects[n]){
+			GameStandinFree(standin);
+			return 0;
+		}
+		Link(standin, (GameNode)n);
+	}
+	return 1;
+}
+
+
+void GameStandinSet(GameStandin *standin, GameField field, int32_t value){
+	memcpy(standin->objects[g_fieldNode[field]] + standin->layout.fieldOffset[field], &value, sizeof(value));
+}
+
+
+int GameStandinMove(GameStandin *standin, GameNode node){
+	uint8_t *moved = malloc(GAME_STANDIN_OBJECT_BYTES);
+	if (!moved){
+		return 0;
+	}
+	memcpy(moved, standin->objects[node], GAME_STANDIN_OBJECT_BYTES);
+	//Clear the old block first, as the game's allocator would reuse it.
+	memset(standin->objects[node], 0, GAME_STANDIN_OBJECT_BYTES);
+	free(standin->objects[node]);
+	standin->objects[node] = moved;
+	Link(standin, node);
+	standin->moves++;
+	return 1;
+}
+
+
+void GameStandinFree(GameStandin *standin){
+	for (int n = 0; n < GAME_NODE_COUNT; n++){
+		if (standin->objects[n] && g_nodeParent[n] == GAME_NODE_Module){
+			g_standinStatics[n] = 0;
+		}
+		free(standin->objects[n]);
+	}
+	memset(standin, 0, sizeof(*standin));
+}
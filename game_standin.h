@@ -0,0 +1,56 @@
+#ifndef GAME_STANDIN_H
+#define GAME_STANDIN_H
+
+#include <stdint.h>
+
+#include "game_memory.h"
+
+/* Objects laid out the way GAME_NODE_TABLE and GAME_FIELD_TABLE expect the game's, so the memory reader can
+ * be run against a local process where the game does not run (anno_calc game-standin, bench-game).
+ *
+ * The chains start at a static array of this executable instead of the game module; it is at the same
+ * offset from the module base in every process running the same executable, so GameStandinLayout, called in
+ * the reader, gives a layout that finds the objects of a stand-in started separately. The objects below it
+ * are heap blocks holding pointers and values at the offsets of the tables.
+ */
+
+
+//Size of every stand-in object, the offsets of the tables must lie inside it.
+#define GAME_STANDIN_OBJECT_BYTES 4096
+
+
+/* layout : where the objects are, from GameStandinLayout
+ * objects : every node's object
+ * moves : GameStandinMove calls
+ */
+typedef struct GameStandin {
+	GameLayout layout;
+	uint8_t *objects[GAME_NODE_COUNT];
+	uint64_t moves;
+} GameStandin;
+
+
+/* The default layout with the chains starting at the stand-in's static array. Returns 0 if the module base
+ * of this process cannot be found.
+ */
+int GameStandinLayout(GameLayout *layout);
+
+
+/* Creates the objects with every value 0. Returns 0 if out of memory or an offset of layout is outside an
+ * object.
+ */
+int GameStandinInit(GameStandin *standin, const GameLayout *layout);
+
+
+void GameStandinSet(GameStandin *standin, GameField field, int32_t value);
+
+
+/* Moves node's object to a new heap block, the way the game replaces objects when it loads a session: the
+ * contents are copied, the pointer to it is changed and the old block is freed. Returns 0 if out of memory.
+ */
+int GameStandinMove(GameStandin *standin, GameNode node);
+
+
+void GameStandinFree(GameStandin *standin);
+
+#endif
@@ -0,0 +1,241 @@
+#include <stdlib.h>	//malloc, calloc, free
+#include <string.h>	//memset
+
+#include "glyph_cache.h"
+
+
+static uint64_t GlyphKey(GlyphFont font, int size, uint32_t codepoint){
+	return (uint64_t)font << 40 | (uint64_t)size << 32 | codepoint;
+}
+
+
+static uint32_t Bucket(const GlyphCache *cache, uint64_t key){
+	return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & cache->bucketMask;
+}
+
+
+static uint8_t *Cell(const GlyphCache *cache, int slot, int *stride){
+	*stride = cache->atlasSize;
+	return cache->atlas + (size_t)(slot / cache->cellsPerRow) * GLYPH_CELL_SIZE * cache->atlasSize
+		+ (size_t)(slot % cache->cellsPerRow) * GLYPH_CELL_SIZE;
+}
+
+
+//Takes slot out of the use order.
+static void Unlink(GlyphCache *cache, int slot){
+	GlyphSlot *s = &cache->slots[slot];
+	if (s->newer >= 0){
+		cache->slots[s->newer].older = s->older;
+	} else {
+		cache->newest = s->older;
+	}
+	if (s->older >= 0){
+		cache->slots[s->older].newer = s->newer;
+	} else {
+		cache->oldest = s->newer;
+	}
+}
+
+
+static void MakeNewest(GlyphCache *cache, int slot){
+	GlyphSlot *s = &cache->slots[slot];
+	s->newer = -1;
+	s->older = cache->newest;
+	if (cache->newest >= 0){
+		cache->slots[cache->newest].newer = slot;
+	} else {
+		cache->oldest = slot;
+	}
+	cache->newest = slot;
+}
+
+
+void GlyphCacheClear(GlyphCache *cache){
+	for (uint32_t b = 0; b <= cache->bucketMask; b++){
+		cache->buckets[b] = -1;
+	}
+	cache->newest = cache->oldest = -1;
+	for (int i = 0; i < cache->slotCount; i++){
+		cache->slots[i].key = 0;
+		cache->slots[i].chain = -1;
+		cache->slots[i].batch = 0;
+		MakeNewest(cache, i);
+	}
+}
+
+
+int GlyphCacheInit(GlyphCache *cache, int atlasSize){
+
+	memset(cache, 0, sizeof(*cache));
+	if (atlasSize <= 0){
+		atlasSize = GLYPH_ATLAS_SIZE;
+	}
+	cache->cellsPerRow = atlasSize / GLYPH_CELL_SIZE;
+	if (cache->cellsPerRow < 1){
+		cache->cellsPerRow = 1;
+	}
+	cache->atlasSize = cache->cellsPerRow * GLYPH_CELL_SIZE;
+	cache->slotCount = cache->cellsPerRow * cache->cellsPerRow;
+
+	//At least twice as many buckets as cells keeps the chains short.
+	uint32_t buckets = 1;
+	while (buckets < 2u * (uint32_t)cache->slotCount){
+		buckets <<= 1;
+	}
+	cache->bucketMask = buckets - 1;
+
+	cache->atlas = calloc((size_t)cache->atlasSize * cache->atlasSize, 1);
+	cache->slots = malloc(sizeof(GlyphSlot) * (size_t)cache->slotCount);
+	cache->buckets = malloc(sizeof(int) * buckets);
+	if (!cache->atlas || !cache->slots || !cache->buckets){
+		GlyphCacheFree(cache);
+		return 0;
+	}
+	GlyphCacheClear(cache);
+	return 1;
+}
+
+
+void GlyphCacheFree(GlyphCache *cache){
+	free(cache->atlas);
+	free(cache->slots);
+	free(cache->buckets);
+	memset(cache, 0, sizeof(*cache));
+}
+
+
+static int Find(const GlyphCache *cache, uint64_t key){
+	for (int slot = cache->buckets[Bucket(cache, key)]; slot >= 0; slot = cache->slots[slot].chain){
+		if (cache->slots[slot].key == key){
+			return slot;
+		}
+	}
+	return -1;
+}
+
+
+static void RemoveFromBucket(GlyphCache *cache, int slot){
+	int *link = &cache->buckets[Bucket(cache, cache->slots[slot].key)];
+	while (*link != slot){
+		link = &cache->slots[*link].chain;
+	}
+	*link = cache->slots[slot].chain;
+}
+
+
+/* The cell holding the glyph, rasterizing it into the least recently used cell if it is not there. Returns
+ * -1 if that cell is in use by the current batch, which means the atlas cannot hold the batch.
+ */
+static int Lookup(GlyphCache *cache, GlyphFont font, int size, uint32_t codepoint){
+
+	uint64_t key = GlyphKey(font, size, codepoint);
+	cache->stats.lookups++;
+
+	int slot = Find(cache, key);
+	if (slot >= 0){
+		cache->stats.hits++;
+	} else {
+		slot = cache->oldest;
+		GlyphSlot *s = &cache->slots[slot];
+		if (s->key && s->batch == cache->batch){
+			return -1;
+		}
+		if (s->key){
+			RemoveFromBucket(cache, slot);
+			cache->stats.evicted++;
+		}
+
+		int stride;
+		uint8_t *cell = Cell(cache, slot, &stride);
+		GlyphMetrics m = GlyphFontRasterize(font, size, codepoint, cell, stride);
+		cache->stats.rasterized++;
+
+		s->key = key;
+		s->width = (uint8_t)m.width;
+		s->height = (uint8_t)m.height;
+		s->advance = (uint8_t)m.advance;
+		s->empty = (uint8_t)m.empty;
+		uint32_t b = Bucket(cache, key);
+		s->chain = cache->buckets[b];
+		cache->buckets[b] = slot;
+	}
+
+	cache->slots[slot].batch = cache->batch;
+	Unlink(cache, slot);
+	MakeNewest(cache, slot);
+	return slot;
+}
+
+
+//Next codepoint of text, joining UTF-16 surrogate pairs where wchar_t is 16 bit.
+static uint32_t NextCodepoint(const wchar_t **text){
+	uint32_t c = (uint32_t)*(*text)++;
+#if WCHAR_MAX <= 0xFFFF
+	if (c >= 0xD800 && c < 0xDC00 && **text >= 0xDC00 && **text < 0xE000){
+		c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)*(*text)++ - 0xDC00);
+	}
+#endif
+	return c;
+}
+
+
+int GlyphCacheLayout(GlyphCache *cache, GlyphFont font, int size, const wchar_t *text, int x, int y, GlyphQuad *quads, int maxQuads){
+
+	size = size < 1 ? 1 : size > GLYPH_MAX_SIZE ? GLYPH_MAX_SIZE : size;
+	cache->batch++;
+	cache->stats.batches++;
+
+	int penX = x;
+	int count = 0;
+	while (*text){
+		uint32_t c = NextCodepoint(&text);
+		if (c == '\r'){
+			continue;
+		}
+		if (c == '\n'){
+			penX = x;
+			y += GlyphFontLineHeight(size);
+			continue;
+		}
+
+		int slot = Lookup(cache, font, size, c);
+		if (slot < 0){
+			cache->stats.truncated++;
+			break;
+		}
+		const GlyphSlot *s = &cache->slots[slot];
+		if (!s->empty){
+			if (count == maxQuads){
+				cache->stats.truncated++;
+				break;
+			}
+			GlyphQuad *q = &quads[count++];
+			q->x = (int16_t)penX;
+			q->y = (int16_t)y;
+			q->u = (uint16_t)(slot % cache->cellsPerRow * GLYPH_CELL_SIZE);
+			q->v = (uint16_t)(slot / cache->cellsPerRow * GLYPH_CELL_SIZE);
+			q->width = s->width;
+			q->height = s->height;
+		}
+		penX += s->advance;
+	}
+	cache->stats.quads += (uint64_t)count;
+	return count;
+}
+
+
+void GlyphCacheDraw(const GlyphCache *cache, RasterSurface *surface, const GlyphQuad *quads, int count, uint32_t color){
+	for (int i = 0; i < count; i++){
+		const GlyphQuad *q = &quads[i];
+		const uint8_t *mask = cache->atlas + (size_t)q->v * cache->atlasSize + q->u;
+		RasterBlendMask(surface, q->x, q->y, mask, cache->atlasSize, q->width, q->height, color);
+	}
+}
+
+
+int GlyphCacheText(GlyphCache *cache, RasterSurface *surface, GlyphFont font, int size, const wchar_t *text, int x, int y, uint32_t color){
+	GlyphQuad quads[128];
+	int count = GlyphCacheLayout(cache, font, size, text, x, y, quads, 128);
+	GlyphCacheDraw(cache, surface, quads, count, color);
+	return count;
+}
@@ -0,0 +1,130 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdint.h>
+#include <wchar.h>
+
+#include "glyph_font.h"
+#include "raster.h"
+
+/* Text for the overlay without rasterizing a glyph more than once: every glyph drawn is rasterized
+ * (glyph_font.c) into a cell of an 8 bit atlas and found again by (font, size, codepoint). When every cell
+ * is taken the least recently used glyph gives its cell up.
+ *
+ * A string is laid out into one batch of quads, each an atlas cell drawn at a position, and the batch is
+ * then drawn with RasterBlendMask. A glyph used by the batch being laid out is never evicted by it, so a
+ * batch stays valid until the next one starts.
+ */
+
+
+//Side of an atlas cell in pixels, which holds any glyph up to GLYPH_MAX_SIZE.
+#define GLYPH_CELL_SIZE 32
+#define GLYPH_MAX_SIZE 36
+
+//Side of the atlas GlyphCacheInit makes when asked for 0: 256 cells.
+#define GLYPH_ATLAS_SIZE 512
+
+
+/* x / y : top left corner on the surface
+ * u / v : top left corner in the atlas
+ * width / height : size in pixels
+ */
+typedef struct GlyphQuad {
+	int16_t x;
+	int16_t y;
+	uint16_t u;
+	uint16_t v;
+	uint8_t width;
+	uint8_t height;
+} GlyphQuad;
+
+
+/* key : (font, size, codepoint) of the glyph in the cell, 0 if it is free
+ * newer / older : neighbours in the use order, -1 at its ends
+ * chain : next cell in the same hash bucket, -1 at its end
+ * batch : the last batch that used it
+ * width / height / advance / empty : its metrics (glyph_font.h)
+ */
+typedef struct GlyphSlot {
+	uint64_t key;
+	int newer;
+	int older;
+	int chain;
+	uint32_t batch;
+	uint8_t width;
+	uint8_t height;
+	uint8_t advance;
+	uint8_t empty;
+} GlyphSlot;
+
+
+/* lookups : glyphs laid out
+ * hits : found in the atlas
+ * rasterized : rasterized into it, the misses
+ * evicted : glyphs that gave up their cell for another
+ * batches / quads : strings laid out and the quads they made
+ * truncated : strings cut short because the batch or the atlas was full
+ */
+typedef struct GlyphCacheStats {
+	uint64_t lookups;
+	uint64_t hits;
+	uint64_t rasterized;
+	uint64_t evicted;
+	uint64_t batches;
+	uint64_t quads;
+	uint64_t truncated;
+} GlyphCacheStats;
+
+
+/* atlas / atlasSize : atlasSize x atlasSize coverage bytes, GLYPH_CELL_SIZE cells in rows of cellsPerRow
+ * slots / slotCount : one per cell
+ * buckets / bucketMask : heads of the hash chains, a power of two of them
+ * newest / oldest : ends of the use order, the oldest is evicted first
+ * batch : the batch being laid out
+ */
+typedef struct GlyphCache {
+	uint8_t *atlas;
+	int atlasSize;
+	int cellsPerRow;
+	GlyphSlot *slots;
+	int slotCount;
+	int *buckets;
+	uint32_t bucketMask;
+	int newest;
+	int oldest;
+	uint32_t batch;
+	GlyphCacheStats stats;
+} GlyphCache;
+
+
+/* Makes an empty atlas of atlasSize x atlasSize pixels (rounded down to whole cells, GLYPH_ATLAS_SIZE
+ * for 0). Returns 0 if out of memory.
+ */
+int GlyphCacheInit(GlyphCache *cache, int atlasSize);
+
+
+void GlyphCacheFree(GlyphCache *cache);
+
+
+/* Forgets every glyph (the statistics stay).
+ */
+void GlyphCacheClear(GlyphCache *cache);
+
+
+/* Lays text out as one batch with its top left corner at (x, y): a quad per visible glyph, "\n" starting a
+ * new line ("\r" is ignored). size is clamped to 1 .. GLYPH_MAX_SIZE. Returns the number of quads written,
+ * at most maxQuads.
+ */
+int GlyphCacheLayout(GlyphCache *cache, GlyphFont font, int size, const wchar_t *text, int x, int y, GlyphQuad *quads, int maxQuads);
+
+
+/* Draws a batch in color (premultiplied).
+ */
+void GlyphCacheDraw(const GlyphCache *cache, RasterSurface *surface, const GlyphQuad *quads, int count, uint32_t color);
+
+
+/* GlyphCacheLayout and GlyphCacheDraw for a string of up to 128 visible glyphs. Returns the quads drawn.
+ */
+int GlyphCacheText(GlyphCache *cache, RasterSurface *surface, GlyphFont font, int size, const wchar_t *text, int x, int y, uint32_t color);
+
+#endif
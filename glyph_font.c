@@ -0,0 +1,134 @@
+#include "glyph_font.h"
+
+
+/* X(font, name, embolden)
+ */
+typedef struct GlyphFontInfo {
+	const char *name;
+	int embolden;
+} GlyphFontInfo;
+
+#define X_GLYPH_FONT_INFO(font, name, embolden) [font] = {name, embolden},
+static const GlyphFontInfo g_fontInfo[GLYPH_FONT_COUNT] = {
+	GLYPH_FONT_TABLE(X_GLYPH_FONT_INFO)
+};
+#undef X_GLYPH_FONT_INFO
+
+
+/* The design of ASCII 32..126: five columns per character, bit 0 is the top row.
+ */
+static const uint8_t g_glyphColumns[95][GLYPH_FONT_COLUMNS] = {
+	{0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},	// !"#
+	{0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},	//$%&'
+	{0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},	//()*+
+	{0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},	//,-./
+	{0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},	//0123
+	{0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},	//4567
+	{0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},	//89:;
+	{0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},	//<=>?
+	{0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},	//@ABC
+	{0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x49, 0x49, 0x7A},	//DEFG
+	{0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},	//HIJK
+	{0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},	//LMNO
+	{0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},	//PQRS
+	{0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F},	//TUVW
+	{0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},	//XYZ[
+	{0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},	//\]^_
+	{0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20},	//`abc
+	{0x38, 0x44, 0x44, 0x48, 0x7F}, {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},	//defg
+	{0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00}, {0x7F, 0x10, 0x28, 0x44, 0x00},	//hijk
+	{0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78}, {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38},	//lmno
+	{0x7C, 0x14, 0x14, 0x14, 0x08}, {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},	//pqrs
+	{0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, {0x3C, 0x40, 0x30, 0x40, 0x3C},	//tuvw
+	{0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C}, {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00},	//xyz{
+	{0x00, 0x00, 0x7F, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08}					//|}~
+};
+
+
+const char *GlyphFontName(GlyphFont font){
+	if ((int)font < 0 || font >= GLYPH_FONT_COUNT){
+		return "(unknown)";
+	}
+	return g_fontInfo[font].name;
+}
+
+
+static int Embolden(GlyphFont font){
+	return (int)font >= 0 && font < GLYPH_FONT_COUNT && g_fontInfo[font].embolden;
+}
+
+
+//Design units to pixels at size, rounded up.
+static int Scale(int units, int size){
+	return (units * size + GLYPH_FONT_EM - 1) / GLYPH_FONT_EM;
+}
+
+
+GlyphMetrics GlyphFontMeasure(GlyphFont font, int size, uint32_t codepoint){
+	int bold = Embolden(font);
+	GlyphMetrics m;
+	m.width = Scale(GLYPH_FONT_COLUMNS + bold, size);
+	m.height = Scale(GLYPH_FONT_ROWS, size);
+	m.advance = Scale(GLYPH_FONT_ADVANCE + bold, size);
+	m.empty = codepoint == ' ';
+	return m;
+}
+
+
+int GlyphFontLineHeight(int size){
+	return Scale(GLYPH_FONT_LINE, size);
+}
+
+
+/* Overlap of pixel p with design unit c along one axis, in 1/GLYPH_FONT_EM of a pixel. Measured that way
+ * pixel p spans [p * EM, (p + 1) * EM) and unit c spans [c * size, (c + 1) * size), so only integers are needed.
+ */
+static int Overlap(int p, int c, int size){
+	int lo = p * GLYPH_FONT_EM > c * size ? p * GLYPH_FONT_EM : c * size;
+	int hi = (p + 1) * GLYPH_FONT_EM < (c + 1) * size ? (p + 1) * GLYPH_FONT_EM : (c + 1) * size;
+	return hi > lo ? hi - lo : 0;
+}
+
+
+GlyphMetrics GlyphFontRasterize(GlyphFont font, int size, uint32_t codepoint, uint8_t *out, int stride){
+
+	GlyphMetrics m = GlyphFontMeasure(font, size, codepoint);
+	int bold = Embolden(font);
+	const uint8_t *design = g_glyphColumns[codepoint >= 32 && codepoint <= 126 ? codepoint - 32 : '?' - 32];
+
+	//The columns as drawn, one wider for bold (each column also lights the one to its right).
+	uint8_t columns[GLYPH_FONT_COLUMNS + 1] = {0};
+	for (int c = 0; c < GLYPH_FONT_COLUMNS; c++){
+		columns[c] |= design[c];
+		if (bold){
+			columns[c + 1] |= design[c];
+		}
+	}
+	int columnCount = GLYPH_FONT_COLUMNS + bold;
+
+	/* The coverage of a pixel is the sum of its overlap with every lit design unit, which is the exact
+	 * box filtered area. A pixel only touches the units between its edges, so those are all that is summed.
+	 */
+	int empty = 1;
+	for (int py = 0; py < m.height; py++){
+		int r0 = py * GLYPH_FONT_EM / size;
+		int r1 = ((py + 1) * GLYPH_FONT_EM - 1) / size;
+		for (int px = 0; px < m.width; px++){
+			int c0 = px * GLYPH_FONT_EM / size;
+			int c1 = ((px + 1) * GLYPH_FONT_EM - 1) / size;
+			int area = 0;
+			for (int c = c0; c <= c1 && c < columnCount; c++){
+				for (int r = r0; r <= r1 && r < GLYPH_FONT_ROWS; r++){
+					if (columns[c] >> r & 1){
+						area += Overlap(px, c, size) * Overlap(py, r, size);
+					}
+				}
+			}
+			int coverage = (area * 255 + GLYPH_FONT_EM * GLYPH_FONT_EM / 2) / (GLYPH_FONT_EM * GLYPH_FONT_EM);
+			out[py * stride + px] = (uint8_t)(coverage > 255 ? 255 : coverage);
+			empty &= coverage == 0;
+		}
+	}
+	m.empty = empty;
+	return m;
+}
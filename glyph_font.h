@@ -0,0 +1,64 @@
+#ifndef GLYPH_FONT_H
+#define GLYPH_FONT_H
+
+#include <stdint.h>
+
+/* The overlay's built-in font: a 5x7 pixel design for ASCII 32..126 (anything else draws as '?'), scaled to
+ * any pixel size by exact area coverage, so sizes that are not a multiple of the design are antialiased
+ * and every platform rasterizes the same coverage. A size is the height of the em in pixels, which is 8
+ * design units: 7 for the glyph and one of gap above the next line's glyphs.
+ */
+
+
+#define GLYPH_FONT_COLUMNS 5
+#define GLYPH_FONT_ROWS 7
+#define GLYPH_FONT_EM 8
+#define GLYPH_FONT_ADVANCE 6
+#define GLYPH_FONT_LINE 9
+
+
+/* X(font, name, embolden) : embolden widens every stroke by one design unit to the right.
+ */
+#define GLYPH_FONT_TABLE(X) \
+	X(GLYPH_FONT_Regular,	"regular",	0) \
+	X(GLYPH_FONT_Bold,	"bold",		1)
+
+#define X_GLYPH_FONT_ENUM(font, name, embolden) font,
+typedef enum GlyphFont {
+	GLYPH_FONT_TABLE(X_GLYPH_FONT_ENUM)
+	GLYPH_FONT_COUNT
+} GlyphFont;
+#undef X_GLYPH_FONT_ENUM
+
+
+/* width / height : size of the coverage bitmap in pixels
+ * advance : distance to the next glyph's origin
+ * empty : no pixel is covered (space), nothing needs drawing
+ */
+typedef struct GlyphMetrics {
+	int width;
+	int height;
+	int advance;
+	int empty;
+} GlyphMetrics;
+
+
+const char *GlyphFontName(GlyphFont font);
+
+
+/* Size of a glyph without rasterizing it.
+ */
+GlyphMetrics GlyphFontMeasure(GlyphFont font, int size, uint32_t codepoint);
+
+
+/* Distance between the tops of two lines.
+ */
+int GlyphFontLineHeight(int size);
+
+
+/* Writes the coverage (0 = none, 255 = full) of a glyph into out, row by row stride bytes apart; out must
+ * hold GlyphFontMeasure's width x height. Returns its metrics.
+ */
+GlyphMetrics GlyphFontRasterize(GlyphFont font, int size, uint32_t codepoint, uint8_t *out, int stride);
+
+#endif
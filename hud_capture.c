@@ -0,0 +1,136 @@
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdlib.h>	//malloc, free
+
+#include "hud_capture.h"
+#include "sys_thread.h"
+
+
+#define X_HUD_REGION_INFO(region, use, spinner, x, y, width, height, digitHeight) \
+	[region] = {use, spinner, {x, y, (x) + (width), (y) + (height)}, digitHeight},
+static const HudRegionInfo g_regions[HUD_REGION_COUNT] = {
+	HUD_REGION_TABLE(X_HUD_REGION_INFO)
+};
+#undef X_HUD_REGION_INFO
+
+
+const HudRegionInfo *HudRegionGet(HudRegion region){
+	if ((int)region < 0 || region >= HUD_REGION_COUNT){
+		return NULL;
+	}
+	return &g_regions[region];
+}
+
+
+int HudCaptureOpen(HudCapture *capture){
+
+	ZeroMemory(capture, sizeof(*capture));
+	for (int r = 0; r < HUD_REGION_COUNT; r++){
+		const RECT *rect = &g_regions[r].rect;
+		if (rect->right - rect->left > capture->width){
+			capture->width = rect->right - rect->left;
+		}
+		if (rect->bottom - rect->top > capture->height){
+			capture->height = rect->bottom - rect->top;
+		}
+	}
+	if (!HudTemplatesFromPng(&capture->templates, HUD_DIGITS_FILE, NULL)){
+		HudTemplatesFromFont(&capture->templates);
+		capture->fontTemplates = 1;
+	}
+
+	//Top-down, so row 0 of the pixels is the top of the region.
+	BITMAPINFO info;
+	ZeroMemory(&info, sizeof(info));
+	info.bmiHeader.biSize = sizeof(info.bmiHeader);
+	info.bmiHeader.biWidth = capture->width;
+	info.bmiHeader.biHeight = -capture->height;
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+
+	void *bits = NULL;
+	capture->screenDc = GetDC(NULL);
+	capture->memDc = capture->screenDc ? CreateCompatibleDC(capture->screenDc) : NULL;
+	capture->bitmap = capture->memDc ? CreateDIBSection(capture->memDc, &info, DIB_RGB_COLORS, &bits, NULL, 0) : NULL;
+	capture->grey = malloc((size_t)capture->width * (size_t)capture->height);
+	int tilesOk = 1;
+	for (int r = 0; r < HUD_REGION_COUNT; r++){
+		const RECT *rect = &g_regions[r].rect;
+		tilesOk &= TileHashInit(&capture->tiles[r], rect->right - rect->left, rect->bottom - rect->top, 4);
+	}
+	if (!capture->bitmap || !bits || !capture->grey || !tilesOk){
+		HudCaptureClose(capture);
+		return 0;
+	}
+	capture->pixels = bits;
+	capture->oldBitmap = SelectObject(capture->memDc, capture->bitmap);
+	return 1;
+}
+
+
+int HudCaptureRead(HudCapture *capture, HudRegion region, HudReading *reading){
+
+	const HudRegionInfo *info = HudRegionGet(region);
+	if (!capture->memDc || !info){
+		return 0;
+	}
+	uint64_t start = SysNowNs();
+	int width = info->rect.right - info->rect.left;
+	int height = info->rect.bottom - info->rect.top;
+
+	int found = 0;
+	if (BitBlt(capture->memDc, 0, 0, width, height, capture->screenDc, info->rect.left, info->rect.top, SRCCOPY)){
+		GdiFlush();
+		if (TileHashUpdate(&capture->tiles[region], (const uint8_t *)capture->pixels, capture->width * 4, NULL)){
+			for (int y = 0; y < height; y++){
+				const uint32_t *row = capture->pixels + (size_t)y * capture->width;
+				uint8_t *grey = capture->grey + (size_t)y * width;
+				for (int x = 0; x < width; x++){
+					grey[x] = HUD_GREY((row[x] >> 16) & 255, (row[x] >> 8) & 255, row[x] & 255);
+				}
+			}
+			HudImage image = {capture->grey, width, height, width};
+			found = HudRead(&image, info->digitHeight, &capture->templates, reading);
+			capture->last[region] = *reading;
+			capture->lastFound[region] = found;
+		}
+		else {
+			//Not a pixel changed, so HudRead would read the same again.
+			*reading = capture->last[region];
+			found = capture->lastFound[region];
+			capture->skipped++;
+		}
+	}
+
+	uint64_t elapsed = SysNowNs() - start;
+	capture->reads++;
+	capture->misses += !found;
+	capture->overBudget += elapsed > HUD_CAPTURE_BUDGET_NS;
+	if (elapsed > capture->slowestNs){
+		capture->slowestNs = elapsed;
+	}
+	return found;
+}
+
+
+void HudCaptureClose(HudCapture *capture){
+	if (capture->memDc){
+		if (capture->oldBitmap){
+			SelectObject(capture->memDc, capture->oldBitmap);
+		}
+		DeleteDC(capture->memDc);
+	}
+	if (capture->bitmap){
+		DeleteObject(capture->bitmap);
+	}
+	if (capture->screenDc){
+		ReleaseDC(NULL, capture->screenDc);
+	}
+	free(capture->grey);
+	for (int r = 0; r < HUD_REGION_COUNT; r++){
+		TileHashFree(&capture->tiles[r]);
+	}
+	ZeroMemory(capture, sizeof(*capture));
+}
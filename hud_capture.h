@@ -0,0 +1,117 @@
+#ifndef HUD_CAPTURE_H
+#define HUD_CAPTURE_H
+
+#include <windows.h>
+
+#include "controls.h"
+#include "hud_read.h"
+#include "tile_hash.h"
+
+/* Reads numbers off the game HUD, so they need not be typed: on every capture the screen region of each
+ * HUD_REGION_TABLE row is copied (BitBlt from the screen DC into a DIB section), turned grey and passed to
+ * HudRead. main_noDebug.c shows the demand of a population read, or sets a spinner to a number read.
+ *
+ * The copy of each region is tile hashed (tile_hash.h) first: if no tile changed since the last capture (the
+ * game is paused, or the number did not change), the last reading is returned without converting or
+ * matching anything.
+ */
+
+
+//Range of the interval between captures, the sampler (sampler.h) picks it by how often the numbers change.
+#define HUD_CAPTURE_MIN_INTERVAL_MS 100
+#define HUD_CAPTURE_MAX_INTERVAL_MS 2000
+
+//A read should stay under this, HudCaptureRead counts the ones that do not.
+#define HUD_CAPTURE_BUDGET_NS 2000000
+
+//The digits of the game's HUD, cropped from screenshots into a strip (HudTemplatesFromImage). Without it the
+//built-in font stands in, which does not look like the game's digits.
+#define HUD_DIGITS_FILE "Anno_1800_In_Game_Overlay_hud_digits.png"
+
+
+/* What a number read is used for.
+ */
+typedef enum HudUse {
+	HUD_USE_Residents,	//a population count, the displays show its demand (CalcDemandResidents)
+	HUD_USE_Spinner		//the value of a spinner, set only if it is in the spinner's range
+} HudUse;
+
+
+/* X(region, use, spinner, x, y, width, height, digitHeight)
+ *
+ * use / spinner : what the number is for, and the ID_SPN_* spinner it goes into for HUD_USE_Spinner (0 else)
+ * x / y / width / height : the screen rectangle around the number, in pixels
+ * digitHeight : height of a digit on the screen, in pixels
+ *
+ * The rectangles depend on the resolution and the UI scale of the game; these are for 1920x1080 at 100 %.
+ * The HUD shows nothing that fits the housing spinners, so there is no spinner row. At most one row may be
+ * HUD_USE_Residents, they would show their demand in turn.
+ */
+#define HUD_REGION_TABLE(X) \
+	X(HUD_Farmers,	HUD_USE_Residents,	0,	884, 12, 96, 24, 14)
+
+#define X_HUD_REGION_ENUM(region, use, spinner, x, y, width, height, digitHeight) region,
+typedef enum HudRegion {
+	HUD_REGION_TABLE(X_HUD_REGION_ENUM)
+	HUD_REGION_COUNT
+} HudRegion;
+#undef X_HUD_REGION_ENUM
+
+
+/* One row of HUD_REGION_TABLE.
+ */
+typedef struct HudRegionInfo {
+	HudUse use;
+	int spinner;
+	RECT rect;
+	int digitHeight;
+} HudRegionInfo;
+
+
+/* screenDc / memDc / bitmap / oldBitmap : the screen and a DIB section as large as the largest region
+ * pixels / grey : the DIB's pixels and their grey values
+ * templates / fontTemplates : the digits matched, from HUD_DIGITS_FILE or, if that did not load, the font
+ * tiles : tile hashes of each region's last capture
+ * last / lastFound : each region's last reading and HudRead's result, returned while no tile changes
+ * reads / misses / overBudget : HudCaptureRead calls, the ones that read no digit, the ones slower than the budget
+ * skipped : reads answered from last because no tile changed
+ * slowestNs : the slowest of them
+ */
+typedef struct HudCapture {
+	HDC screenDc;
+	HDC memDc;
+	HBITMAP bitmap;
+	HGDIOBJ oldBitmap;
+	uint32_t *pixels;
+	uint8_t *grey;
+	int width;
+	int height;
+	HudTemplates templates;
+	int fontTemplates;
+	TileHash tiles[HUD_REGION_COUNT];
+	HudReading last[HUD_REGION_COUNT];
+	int lastFound[HUD_REGION_COUNT];
+	unsigned long reads;
+	unsigned long misses;
+	unsigned long overBudget;
+	unsigned long skipped;
+	uint64_t slowestNs;
+} HudCapture;
+
+
+const HudRegionInfo *HudRegionGet(HudRegion region);
+
+
+/* Returns 0 if the DCs, the bitmap or the tile hashes could not be created.
+ */
+int HudCaptureOpen(HudCapture *capture);
+
+
+/* Captures and reads one region. Returns 1 and fills reading if a number was read.
+ */
+int HudCaptureRead(HudCapture *capture, HudRegion region, HudReading *reading);
+
+
+void HudCaptureClose(HudCapture *capture);
+
+#endif
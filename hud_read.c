@@ -0,0 +1,389 @@
+#define HUD_SIMD 1	//if '1' the SSE2 and AVX2 correlation kernels are built for x86 (picked at run time), '0' only the scalar one
+
+#include <math.h>	//sqrt
+#include <stdlib.h>	//malloc, free
+#include <string.h>	//memset, memcpy
+
+#include "glyph_font.h"
+#include "hud_read.h"
+#include "png_file.h"
+
+#if HUD_SIMD && (defined(__x86_64__) || defined(__i386__))
+#define HUD_X86 1
+#include <immintrin.h>
+#else
+#define HUD_X86 0
+#endif
+
+
+//Pixels in a template.
+#define HUD_TEMPLATE_PIXELS (HUD_DIGIT_WIDTH * HUD_DIGIT_HEIGHT)
+
+
+//Turns the grey values of digit d into its weights.
+static int SetTemplate(HudTemplates *templates, int d, const uint8_t coverage[HUD_DIGIT_HEIGHT][HUD_TEMPLATE_STRIDE]){
+
+	int sum = 0;
+	for (int r = 0; r < HUD_DIGIT_HEIGHT; r++){
+		for (int c = 0; c < HUD_DIGIT_WIDTH; c++){
+			sum += coverage[r][c];
+		}
+	}
+	int mean = (sum + HUD_TEMPLATE_PIXELS / 2) / HUD_TEMPLATE_PIXELS;
+	int64_t squares = 0;
+	templates->weightSum[d] = 0;
+	for (int r = 0; r < HUD_DIGIT_HEIGHT; r++){
+		for (int c = 0; c < HUD_DIGIT_WIDTH; c++){
+			int w = coverage[r][c] - mean;
+			templates->weights[d][r][c] = (int16_t)w;
+			templates->weightSum[d] += w;
+			squares += w * w;
+		}
+	}
+	int64_t wSum = templates->weightSum[d];
+	templates->weightNorm[d] = sqrt((double)(HUD_TEMPLATE_PIXELS * squares - wSum * wSum));
+	return templates->weightNorm[d] > 0.0;
+}
+
+
+void HudTemplatesFromFont(HudTemplates *templates){
+
+	memset(templates, 0, sizeof(*templates));
+	for (int d = 0; d < 10; d++){
+		uint8_t coverage[HUD_DIGIT_HEIGHT][HUD_TEMPLATE_STRIDE] = {{0}};
+		GlyphFontRasterize(GLYPH_FONT_Regular, 2 * GLYPH_FONT_EM, (uint32_t)('0' + d), &coverage[0][0], HUD_TEMPLATE_STRIDE);
+		SetTemplate(templates, d, coverage);
+	}
+}
+
+
+int HudTemplatesFromImage(HudTemplates *templates, const HudImage *strip){
+
+	memset(templates, 0, sizeof(*templates));
+	if (strip->width < 10 || strip->height <= 0){
+		return 0;
+	}
+	//The whole strip at once, so a digit whose cell does not start on a whole pixel still gets its share.
+	uint8_t scaled[HUD_DIGIT_HEIGHT][10 * HUD_DIGIT_WIDTH];
+	HudScale(strip, &scaled[0][0], 10 * HUD_DIGIT_WIDTH, HUD_DIGIT_HEIGHT, 10 * HUD_DIGIT_WIDTH);
+
+	int ok = 1;
+	for (int d = 0; d < 10; d++){
+		uint8_t coverage[HUD_DIGIT_HEIGHT][HUD_TEMPLATE_STRIDE] = {{0}};
+		for (int r = 0; r < HUD_DIGIT_HEIGHT; r++){
+			memcpy(coverage[r], &scaled[r][d * HUD_DIGIT_WIDTH], HUD_DIGIT_WIDTH);
+		}
+		ok &= SetTemplate(templates, d, coverage);
+	}
+	return ok;
+}
+
+
+int HudTemplatesFromPng(HudTemplates *templates, const char *path, const char **error){
+
+	PngImage image;
+	const char *pngError;
+	if (!PngRead(path, &image, &pngError)){
+		if (error){
+			*error = pngError;
+		}
+		return 0;
+	}
+	uint8_t *grey = malloc((size_t)image.width * (size_t)image.height);
+	int ok = 0;
+	if (grey){
+		for (size_t i = 0; i < (size_t)image.width * (size_t)image.height; i++){
+			const uint8_t *p = image.pixels + i * (size_t)image.channels;
+			grey[i] = image.channels >= 3 ? HUD_GREY(p[0], p[1], p[2]) : p[0];
+		}
+		HudImage strip = {grey, image.width, image.height, image.width};
+		ok = HudTemplatesFromImage(templates, &strip);
+	}
+	if (error && !ok){
+		*error = !grey ? "out of memory" : "not a strip of ten digits (one is blank or the image is too small)";
+	}
+	free(grey);
+	PngFree(&image);
+	return ok;
+}
+
+
+/* The kernel: the dot product of the window at window (rows stride bytes apart, HUD_TEMPLATE_STRIDE bytes
+ * of each readable) with every digit's weights.
+ */
+typedef void (*HudDotsFn)(const uint8_t *window, int stride, const HudTemplates *t, int32_t dots[10]);
+
+
+static void DotsScalar(const uint8_t *window, int stride, const HudTemplates *t, int32_t dots[10]){
+	for (int d = 0; d < 10; d++){
+		int32_t sum = 0;
+		for (int r = 0; r < HUD_DIGIT_HEIGHT; r++){
+			const uint8_t *row = window + (size_t)r * stride;
+			for (int c = 0; c < HUD_DIGIT_WIDTH; c++){
+				sum += t->weights[d][r][c] * row[c];
+			}
+		}
+		dots[d] = sum;
+	}
+}
+
+
+#if HUD_X86
+
+/* Each window row is loaded and widened to 16 bit once and multiplied into all ten digits with madd, which
+ * adds pairs of products into 32 bit lanes. The padding weights are 0, so reading 16 pixels is harmless.
+ */
+__attribute__((target("sse2")))
+static void DotsSse2(const uint8_t *window, int stride, const HudTemplates *t, int32_t dots[10]){
+
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc[10];
+	for (int d = 0; d < 10; d++){
+		acc[d] = zero;
+	}
+	for (int r = 0; r < HUD_DIGIT_HEIGHT; r++){
+		__m128i row = _mm_loadu_si128((const __m128i *)(window + (size_t)r * stride));
+		__m128i lo = _mm_unpacklo_epi8(row, zero);
+		__m128i hi = _mm_unpackhi_epi8(row, zero);
+		for (int d = 0; d < 10; d++){
+			const __m128i *w = (const __m128i *)t->weights[d][r];
+			acc[d] = _mm_add_epi32(acc[d], _mm_madd_epi16(lo, _mm_loadu_si128(w)));
+			acc[d] = _mm_add_epi32(acc[d], _mm_madd_epi16(hi, _mm_loadu_si128(w + 1)));
+		}
+	}
+	for (int d = 0; d < 10; d++){
+		__m128i s = _mm_add_epi32(acc[d], _mm_shuffle_epi32(acc[d], 0x4E));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+		dots[d] = _mm_cvtsi128_si32(s);
+	}
+}
+
+
+__attribute__((target("avx2")))
+static void DotsAvx2(const uint8_t *window, int stride, const HudTemplates *t, int32_t dots[10]){
+
+	__m256i acc[10];
+	for (int d = 0; d < 10; d++){
+		acc[d] = _mm256_setzero_si256();
+	}
+	for (int r = 0; r < HUD_DIGIT_HEIGHT; r++){
+		__m256i row = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(window + (size_t)r * stride)));
+		for (int d = 0; d < 10; d++){
+			acc[d] = _mm256_add_epi32(acc[d], _mm256_madd_epi16(row, _mm256_loadu_si256((const __m256i *)t->weights[d][r])));
+		}
+	}
+	for (int d = 0; d < 10; d++){
+		__m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc[d]), _mm256_extracti128_si256(acc[d], 1));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+		dots[d] = _mm_cvtsi128_si32(s);
+	}
+}
+
+#endif
+
+
+static const HudDotsFn g_dotsKernels[RASTER_BACKEND_COUNT] = {
+	[RASTER_Scalar]	= DotsScalar,
+#if HUD_X86
+	[RASTER_SSE2]	= DotsSse2,
+	[RASTER_AVX2]	= DotsAvx2,
+#endif
+};
+
+//The kernel in use, set by the first read (or HudUseBackend).
+static HudDotsFn g_dots = NULL;
+static RasterBackend g_dotsBackend = RASTER_Scalar;
+
+
+int HudUseBackend(RasterBackend backend){
+	if ((int)backend < 0 || backend >= RASTER_BACKEND_COUNT || !g_dotsKernels[backend] || !RasterBackendSupported(backend)){
+		return 0;
+	}
+	g_dots = g_dotsKernels[backend];
+	g_dotsBackend = backend;
+	return 1;
+}
+
+
+RasterBackend HudCurrentBackend(void){
+	if (!g_dots){
+		for (int b = RASTER_BACKEND_COUNT - 1; b >= RASTER_Scalar && !HudUseBackend((RasterBackend)b); b--);
+	}
+	return g_dotsBackend;
+}
+
+
+//Overlap of dst pixel i with src pixel j along one axis, in 1/(src size * dst size) of the axis.
+static int Overlap(int i, int j, int srcSize, int dstSize){
+	int lo = i * srcSize > j * dstSize ? i * srcSize : j * dstSize;
+	int hi = (i + 1) * srcSize < (j + 1) * dstSize ? (i + 1) * srcSize : (j + 1) * dstSize;
+	return hi > lo ? hi - lo : 0;
+}
+
+
+void HudScale(const HudImage *src, uint8_t *dst, int dstWidth, int dstHeight, int dstStride){
+
+	uint64_t area = (uint64_t)src->width * (uint64_t)src->height;
+	uint64_t acc[HUD_MAX_WIDTH];
+	if (dstWidth > HUD_MAX_WIDTH){
+		return;
+	}
+
+	for (int i = 0; i < dstHeight; i++){
+		memset(acc, 0, sizeof(acc[0]) * (size_t)dstWidth);
+		int j0 = i * src->height / dstHeight;
+		int j1 = ((i + 1) * src->height - 1) / dstHeight;
+		for (int j = j0; j <= j1 && j < src->height; j++){
+			uint64_t wy = (uint64_t)Overlap(i, j, src->height, dstHeight);
+			const uint8_t *row = src->pixels + (size_t)j * src->stride;
+			for (int x = 0; x < dstWidth; x++){
+				int k0 = x * src->width / dstWidth;
+				int k1 = ((x + 1) * src->width - 1) / dstWidth;
+				uint32_t sum = 0;
+				for (int k = k0; k <= k1 && k < src->width; k++){
+					sum += (uint32_t)Overlap(x, k, src->width, dstWidth) * row[k];
+				}
+				acc[x] += wy * sum;
+			}
+		}
+		for (int x = 0; x < dstWidth; x++){
+			dst[(size_t)i * dstStride + x] = (uint8_t)((acc[x] + area / 2) / area);
+		}
+	}
+}
+
+
+/* Correlation of the window with every digit from the integer sums: with n pixels, dot = sum(w * p) and the
+ * window's sum and sum of squares, NCC = (n dot - sum(w) sum(p)) / (weightNorm * sqrt(n sum(p^2) - sum(p)^2)).
+ * A flat window correlates with nothing.
+ */
+static void Correlate(const HudTemplates *t, const int32_t dots[10], int64_t pSum, int64_t pSquares, double scores[10]){
+	const int64_t n = HUD_TEMPLATE_PIXELS;
+	int64_t pVariance = n * pSquares - pSum * pSum;
+	double inverse = pVariance > 0 ? 1.0 / sqrt((double)pVariance) : 0.0;
+	for (int d = 0; d < 10; d++){
+		double denominator = t->weightNorm[d];
+		scores[d] = denominator > 0.0 ? (double)(n * dots[d] - t->weightSum[d] * pSum) * inverse / denominator : 0.0;
+	}
+}
+
+
+int HudRead(const HudImage *region, int digitHeight, const HudTemplates *templates, HudReading *reading){
+
+	memset(reading, 0, sizeof(*reading));
+	if (digitHeight <= 0 || region->width <= 0 || region->height <= 0){
+		return 0;
+	}
+	int width = (region->width * HUD_DIGIT_HEIGHT + digitHeight / 2) / digitHeight;
+	int height = (region->height * HUD_DIGIT_HEIGHT + digitHeight / 2) / digitHeight;
+	if (width < HUD_DIGIT_WIDTH || height < HUD_DIGIT_HEIGHT || width > HUD_MAX_WIDTH || height > HUD_MAX_HEIGHT){
+		return 0;
+	}
+
+	//The scaled region, with a template row of padding so the kernels can read past the last window.
+	uint8_t scaled[HUD_MAX_HEIGHT][HUD_MAX_WIDTH + HUD_TEMPLATE_STRIDE];
+	HudScale(region, &scaled[0][0], width, height, HUD_MAX_WIDTH + HUD_TEMPLATE_STRIDE);
+	for (int y = 0; y < height; y++){
+		memset(&scaled[y][width], 0, HUD_TEMPLATE_STRIDE);
+	}
+
+	HudCurrentBackend();
+	HudDotsFn dotsFn = g_dots;
+
+	//Best digit and score at every x over every vertical offset.
+	int positions = width - HUD_DIGIT_WIDTH + 1;
+	double best[HUD_MAX_WIDTH];
+	int bestDigit[HUD_MAX_WIDTH];
+	for (int x = 0; x < positions; x++){
+		best[x] = -2.0;
+		bestDigit[x] = 0;
+	}
+	for (int y = 0; y + HUD_DIGIT_HEIGHT <= height; y++){
+
+		//Column sums of the rows under the window, then a sliding sum over HUD_DIGIT_WIDTH columns.
+		int64_t columnSum[HUD_MAX_WIDTH], columnSquares[HUD_MAX_WIDTH];
+		for (int x = 0; x < width; x++){
+			int64_t s = 0, q = 0;
+			for (int r = 0; r < HUD_DIGIT_HEIGHT; r++){
+				int p = scaled[y + r][x];
+				s += p;
+				q += p * p;
+			}
+			columnSum[x] = s;
+			columnSquares[x] = q;
+		}
+		int64_t pSum = 0, pSquares = 0;
+		for (int x = 0; x < HUD_DIGIT_WIDTH - 1; x++){
+			pSum += columnSum[x];
+			pSquares += columnSquares[x];
+		}
+		for (int x = 0; x < positions; x++){
+			pSum += columnSum[x + HUD_DIGIT_WIDTH - 1];
+			pSquares += columnSquares[x + HUD_DIGIT_WIDTH - 1];
+
+			int32_t dots[10];
+			double scores[10];
+			dotsFn(&scaled[y][x], HUD_MAX_WIDTH + HUD_TEMPLATE_STRIDE, templates, dots);
+			Correlate(templates, dots, pSum, pSquares, scores);
+			for (int d = 0; d < 10; d++){
+				if (scores[d] > best[x]){
+					best[x] = scores[d];
+					bestDigit[x] = d;
+				}
+			}
+			reading->windows++;
+
+			pSum -= columnSum[x];
+			pSquares -= columnSquares[x];
+		}
+	}
+
+	/* The best remaining position is a digit, and no other digit can start closer to it than a template is
+	 * wide (less a column of tolerance); repeat until nothing scores HUD_MIN_SCORE.
+	 */
+	int taken[HUD_MAX_DIGITS];
+	double takenScore[HUD_MAX_DIGITS];
+	int count = 0;
+	while (count < HUD_MAX_DIGITS){
+		int at = -1;
+		for (int x = 0; x < positions; x++){
+			if (best[x] >= HUD_MIN_SCORE && (at < 0 || best[x] > best[at])){
+				at = x;
+			}
+		}
+		if (at < 0){
+			break;
+		}
+		taken[count] = at;
+		takenScore[count++] = best[at];
+		for (int x = at - (HUD_DIGIT_WIDTH - 2); x <= at + (HUD_DIGIT_WIDTH - 2); x++){
+			if (x >= 0 && x < positions){
+				best[x] = -2.0;
+			}
+		}
+	}
+
+	//Left to right.
+	for (int i = 1; i < count; i++){
+		for (int j = i; j > 0 && taken[j - 1] > taken[j]; j--){
+			int x = taken[j];
+			double score = takenScore[j];
+			taken[j] = taken[j - 1];
+			takenScore[j] = takenScore[j - 1];
+			taken[j - 1] = x;
+			takenScore[j - 1] = score;
+		}
+	}
+	reading->minScore = count ? 1.0 : 0.0;
+	for (int i = 0; i < count; i++){
+		reading->x[i] = taken[i];
+		reading->score[i] = takenScore[i];
+		reading->value = reading->value * 10 + bestDigit[taken[i]];
+		if (takenScore[i] < reading->minScore){
+			reading->minScore = takenScore[i];
+		}
+	}
+	reading->digits = count;
+	return count > 0;
+}
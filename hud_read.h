@@ -0,0 +1,120 @@
+#ifndef HUD_READ_H
+#define HUD_READ_H
+
+#include <stdint.h>
+
+#include "raster.h"
+
+/* Reads a number off the game HUD: a grey copy of the screen region around it is scaled so its digits are
+ * HUD_DIGIT_HEIGHT pixels high, every digit template is matched against every position by normalised cross
+ * correlation (NCC, which ignores the brightness and contrast of the HUD) and the best non-overlapping
+ * matches, left to right, are the number.
+ *
+ * The digit templates come from crops of the game's own HUD digits (HudTemplatesFromPng), the built-in font
+ * is only a stand-in for when there are none. Apart from loading those, nothing here captures or allocates:
+ * HudRead is a pure function of the pixels, so the Win32 capture (hud_capture.c) and the PNG fixture frames
+ * (hud_fixtures/, anno_calc hud-check) run the same code. The correlation sums are integers, so the scalar,
+ * SSE2 and AVX2 kernels (picked like raster.h's) give identical readings.
+ */
+
+
+//Size of a digit template: the built-in font's digits at twice the design size.
+#define HUD_DIGIT_WIDTH 10
+#define HUD_DIGIT_HEIGHT 14
+#define HUD_DIGIT_ADVANCE 12
+
+//Template rows are padded to 16 weights so a kernel reads a whole row at once.
+#define HUD_TEMPLATE_STRIDE 16
+
+//Largest region after scaling, in pixels (the scratch buffer of HudRead is on the stack).
+#define HUD_MAX_WIDTH 256
+#define HUD_MAX_HEIGHT 32
+
+#define HUD_MAX_DIGITS 12
+
+//Lowest correlation (-1 .. 1) accepted as a digit.
+#define HUD_MIN_SCORE 0.75
+
+//Grey value of an RGB pixel, the same in the capture and for the fixtures.
+#define HUD_GREY(r, g, b) (uint8_t)(((r) * 77 + (g) * 150 + (b) * 29 + 128) >> 8)
+
+
+/* pixels : grey values, first pixel of the top row
+ * width / height : size in pixels
+ * stride : bytes from one row to the next
+ */
+typedef struct HudImage {
+	const uint8_t *pixels;
+	int width;
+	int height;
+	int stride;
+} HudImage;
+
+
+/* weights : every digit's template minus its rounded mean, zero in the padding
+ * weightSum : sum of each digit's weights, for the correlation
+ * weightNorm : sqrt(n * sum of squares - sum^2) of each digit's weights, n being the pixels of a template
+ */
+typedef struct HudTemplates {
+	int16_t weights[10][HUD_DIGIT_HEIGHT][HUD_TEMPLATE_STRIDE];
+	int32_t weightSum[10];
+	double weightNorm[10];
+} HudTemplates;
+
+
+/* value : the digits read, left to right
+ * digits : how many, 0 if no digit matched
+ * x : left edge of each digit in the scaled region
+ * score : the correlation of each digit
+ * minScore : the worst of them
+ * windows : positions correlated, for the statistics
+ */
+typedef struct HudReading {
+	long long value;
+	int digits;
+	int x[HUD_MAX_DIGITS];
+	double score[HUD_MAX_DIGITS];
+	double minScore;
+	long windows;
+} HudReading;
+
+
+/* The digit templates from the built-in font (glyph_font.h).
+ */
+void HudTemplatesFromFont(HudTemplates *templates);
+
+
+/* The digit templates from a strip of the ten digits 0 .. 9, left to right in cells of the same width: each
+ * cell is a crop around one digit, as high as the digit and 5:7 (HUD_DIGIT_WIDTH:HUD_DIGIT_HEIGHT) wide, so
+ * the strip is scaled to the template size in one piece. Returns 0 if the strip is narrower than 10 pixels
+ * or a cell is blank.
+ */
+int HudTemplatesFromImage(HudTemplates *templates, const HudImage *strip);
+
+
+/* HudTemplatesFromImage with a PNG of the strip (png_file.h), turned grey with HUD_GREY. Returns 0 if the
+ * file cannot be read or is no such strip; error (if not NULL) then says why.
+ */
+int HudTemplatesFromPng(HudTemplates *templates, const char *path, const char **error);
+
+
+/* Switches the correlation kernel, like RasterUseBackend. Returns 0 if the backend is not supported.
+ */
+int HudUseBackend(RasterBackend backend);
+
+
+RasterBackend HudCurrentBackend(void);
+
+
+/* Scales src into dst (width and height of dst set by the caller) by averaging the area every dst pixel
+ * covers, exactly in integers. Works both ways, but is meant for shrinking.
+ */
+void HudScale(const HudImage *src, uint8_t *dst, int dstWidth, int dstHeight, int dstStride);
+
+
+/* Reads the number in region, whose digits are digitHeight pixels high. Returns 1 if at least one digit
+ * was read, 0 if none (or the region is too small or too large once scaled).
+ */
+int HudRead(const HudImage *region, int digitHeight, const HudTemplates *templates, HudReading *reading);
+
+#endif
@@ -0,0 +1,163 @@
+#include <stdlib.h>	//calloc, free, qsort
+#include <string.h>	//memset
+
+#include "latency.h"
+
+
+#define LAT_SUB_COUNT (1 << LAT_SUB_BITS)
+
+
+static int HighestBit(uint64_t v){
+	int bit = 0;
+	while (v >>= 1){
+		bit++;
+	}
+	return bit;
+}
+
+
+/* Values below 2 * LAT_SUB_COUNT index directly. Above, the highest bit picks the power of two and the
+ * LAT_SUB_BITS bits below it the bucket inside it.
+ */
+static int BucketIndex(uint64_t ns){
+	if (ns < 2 * LAT_SUB_COUNT){
+		return (int)ns;
+	}
+	int high = HighestBit(ns);
+	if (high >= LAT_MAX_BITS){
+		return LAT_BUCKETS - 1;
+	}
+	int shift = high - LAT_SUB_BITS;
+	int sub = (int)((ns >> shift) & (LAT_SUB_COUNT - 1));
+	return 2 * LAT_SUB_COUNT + (high - LAT_SUB_BITS - 1) * LAT_SUB_COUNT + sub;
+}
+
+
+//Largest value that lands in a bucket.
+static uint64_t BucketTop(int index){
+	if (index < 2 * LAT_SUB_COUNT){
+		return (uint64_t)index;
+	}
+	int high = (index - 2 * LAT_SUB_COUNT) / LAT_SUB_COUNT + LAT_SUB_BITS + 1;
+	int sub = (index - 2 * LAT_SUB_COUNT) % LAT_SUB_COUNT;
+	int shift = high - LAT_SUB_BITS;
+	return ((uint64_t)(LAT_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+
+void LatRecord(LatHistogram *h, uint64_t ns){
+	h->counts[BucketIndex(ns)]++;
+	h->count++;
+	h->totalNs += ns;
+	if (ns > h->maxNs){
+		h->maxNs = ns;
+	}
+}
+
+
+uint64_t LatPercentile(const LatHistogram *h, double p){
+
+	if (h->count == 0){
+		return 0;
+	}
+	uint64_t rank = (uint64_t)(p * (double)h->count + 0.5);
+	if (rank < 1){
+		rank = 1;
+	}
+
+	uint64_t seen = 0;
+	for (int i = 0; i < LAT_BUCKETS; i++){
+		seen += h->counts[i];
+		if (seen >= rank){
+			if (i == LAT_BUCKETS - 1){
+				return h->maxNs;
+			}
+			uint64_t top = BucketTop(i);
+			return top < h->maxNs ? top : h->maxNs;
+		}
+	}
+	return h->maxNs;
+}
+
+
+int LatencyInit(LatencyTable *table, int slotCount){
+	table->slots = calloc((size_t)slotCount, sizeof(LatHistogram *));
+	table->slotCount = table->slots ? slotCount : 0;
+	return table->slots != NULL;
+}
+
+
+void LatencyFree(LatencyTable *table){
+	for (int i = 0; i < table->slotCount; i++){
+		free(table->slots[i]);
+	}
+	free(table->slots);
+	table->slots = NULL;
+	table->slotCount = 0;
+}
+
+
+void LatencyAdd(LatencyTable *table, int key, uint64_t ns){
+
+	if (key < 0 || key >= table->slotCount){
+		return;
+	}
+	LatHistogram *h = table->slots[key];
+	if (!h){
+		h = calloc(1, sizeof(LatHistogram));
+		if (!h){
+			return;
+		}
+		table->slots[key] = h;
+	}
+	LatRecord(h, ns);
+}
+
+
+void LatencyReset(LatencyTable *table){
+	for (int i = 0; i < table->slotCount; i++){
+		if (table->slots[i]){
+			memset(table->slots[i], 0, sizeof(LatHistogram));
+		}
+	}
+}
+
+
+static const LatencyTable *g_sortTable;
+
+//Most total time first.
+static int CompareTotal(const void *a, const void *b){
+	uint64_t ta = g_sortTable->slots[*(const int *)a]->totalNs;
+	uint64_t tb = g_sortTable->slots[*(const int *)b]->totalNs;
+	return ta < tb ? 1 : ta > tb ? -1 : *(const int *)a - *(const int *)b;
+}
+
+
+int LatencyDump(const LatencyTable *table, const char *title, LatencyNameFn name, FILE *out){
+
+	int *keys = malloc(sizeof(int) * (size_t)(table->slotCount > 0 ? table->slotCount : 1));
+	int used = 0;
+	if (!keys){
+		return 0;
+	}
+	for (int i = 0; i < table->slotCount; i++){
+		if (table->slots[i] && table->slots[i]->count > 0){
+			keys[used++] = i;
+		}
+	}
+	g_sortTable = table;
+	qsort(keys, (size_t)used, sizeof(int), CompareTotal);
+
+	fprintf(out, "%s\n", title);
+	fprintf(out, "  %-28s %10s %10s %10s %10s %10s\n", "", "count", "p50 us", "p99 us", "max us", "mean us");
+	for (int i = 0; i < used; i++){
+		const LatHistogram *h = table->slots[keys[i]];
+		char label[64];
+		name(keys[i], label, sizeof(label));
+		fprintf(out, "  %-28s %10llu %10.2f %10.2f %10.2f %10.2f\n", label, (unsigned long long)h->count,
+			(double)LatPercentile(h, 0.5) / 1e3, (double)LatPercentile(h, 0.99) / 1e3, (double)h->maxNs / 1e3,
+			(double)h->totalNs / (double)h->count / 1e3);
+	}
+	free(keys);
+	return used;
+}
@@ -0,0 +1,86 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Latency histograms, one per key (a window message, a control ID, ...), for timing message handlers.
+ *
+ * A histogram has a fixed set of buckets that grow with the value like an HDR histogram: values below
+ * 2^LAT_SUB_BITS ns get a bucket each, above that every power of two is split into 2^LAT_SUB_BITS buckets,
+ * so a percentile is exact to about 6% anywhere between nanoseconds and minutes while adding a value is an
+ * index computation and an increment. The maximum is kept exactly.
+ *
+ * A LatencyTable holds the histograms of a set of keys 0 .. slotCount - 1 and allocates each one when its
+ * key is first seen, so a table for every window message only costs memory for the messages that arrive.
+ */
+
+
+#define LAT_SUB_BITS 4
+
+//Values at or above 2^LAT_MAX_BITS ns (about 18 minutes) land in the last bucket.
+#define LAT_MAX_BITS 40
+
+#define LAT_BUCKETS ((1 << (LAT_SUB_BITS + 1)) + (LAT_MAX_BITS - LAT_SUB_BITS - 1) * (1 << LAT_SUB_BITS))
+
+
+/* counts : values per bucket
+ * count / totalNs / maxNs : number, sum and largest of the values
+ */
+typedef struct LatHistogram {
+	uint32_t counts[LAT_BUCKETS];
+	uint64_t count;
+	uint64_t totalNs;
+	uint64_t maxNs;
+} LatHistogram;
+
+
+/* slots / slotCount : a histogram per key, NULL until the key is used
+ */
+typedef struct LatencyTable {
+	LatHistogram **slots;
+	int slotCount;
+} LatencyTable;
+
+
+/* Names a key for LatencyDump, e.g. with MsgName. Writes at most size bytes including the terminator.
+ */
+typedef void (*LatencyNameFn)(int key, char *out, size_t size);
+
+
+/* Adds one value to a histogram.
+ */
+void LatRecord(LatHistogram *h, uint64_t ns);
+
+
+/* The value below which p (0..1) of the values lie, as the upper end of its bucket (never above maxNs).
+ * 0 for an empty histogram.
+ */
+uint64_t LatPercentile(const LatHistogram *h, double p);
+
+
+/* Allocates the slot list of a table with slotCount keys. Returns 0 if memory ran out.
+ */
+int LatencyInit(LatencyTable *table, int slotCount);
+
+
+void LatencyFree(LatencyTable *table);
+
+
+/* Adds a value under key. Keys outside the table and a histogram that cannot be allocated are ignored.
+ */
+void LatencyAdd(LatencyTable *table, int key, uint64_t ns);
+
+
+/* Forgets every value, keeping the histograms allocated.
+ */
+void LatencyReset(LatencyTable *table);
+
+
+/* Writes a line per used key (count, p50, p99, max and mean in microseconds) under title, the keys with
+ * the most time spent first. Returns the number of keys written.
+ */
+int LatencyDump(const LatencyTable *table, const char *title, LatencyNameFn name, FILE *out);
+
+#endif
@@ -0,0 +1,44 @@
+/* log_decode: turns a binary log (main.c built with LOG_BINARY 1) back into text lines.
+ *
+ * 	log_decode <binary log> [out.txt]
+ *
+ * The file carries its own format and name tables (see log_format.h), so the decoder does not have to match
+ * the build that wrote the log. A log that is still being written ends in a partial record; everything
+ * before it is printed and the exit code is 0.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "log_format.h"
+
+
+int main(int argc, char **argv){
+
+	if (argc < 2 || argc > 3){
+		fprintf(stderr, "usage: log_decode <binary log> [out.txt]\n");
+		return 2;
+	}
+
+	FILE *in = fopen(argv[1], "rb");
+	if (!in){
+		fprintf(stderr, "could not open %s\n", argv[1]);
+		return 1;
+	}
+	FILE *out = argc == 3 ? fopen(argv[2], "w") : stdout;
+	if (!out){
+		fprintf(stderr, "could not create %s\n", argv[2]);
+		fclose(in);
+		return 1;
+	}
+
+	LogDecodeStats stats;
+	LogDecodeStatus status = LogDecodeFile(in, out, &stats);
+	fclose(in);
+	if (out != stdout){
+		fclose(out);
+	}
+
+	fprintf(stderr, "%llu records in %llu sessions, %llu lines dropped by the writer: %s\n", (unsigned long long)stats.records,
+		(unsigned long long)stats.sessions, (unsigned long long)stats.dropped, LogDecodeStatusName(status));
+	return status != LOG_DECODE_Ok && status != LOG_DECODE_Truncated;
+}
@@ -0,0 +1,449 @@
+#include <stdlib.h>	//malloc, realloc, free
+#include <string.h>	//memcpy, memcmp, strlen
+
+#include "log_format.h"
+
+
+//Longest rendered line of the decoder.
+#define LOG_LINE_MAX 4096
+
+
+static const char *g_statusNames[] = {
+	[LOG_DECODE_Ok]			= "ok",
+	[LOG_DECODE_NotLog]		= "not a binary log",
+	[LOG_DECODE_Truncated]		= "file ends inside a record",
+	[LOG_DECODE_Corrupt]		= "corrupt",
+	[LOG_DECODE_OutOfMemory]	= "out of memory"
+};
+
+
+const char *LogDecodeStatusName(LogDecodeStatus status){
+	if ((int)status < 0 || status > LOG_DECODE_OutOfMemory){
+		return "(unknown)";
+	}
+	return g_statusNames[status];
+}
+
+
+static const char *FindName(const LogSchema *schema, char table, uint64_t value){
+	for (int i = 0; i < schema->nameCount; i++){
+		if (schema->names[i].table == table && schema->names[i].value == value){
+			return schema->names[i].name;
+		}
+	}
+	return "(unknown)";
+}
+
+
+//Appends to out[*n], keeping room for the terminator.
+static void Append(char *out, size_t size, size_t *n, const char *text, size_t len){
+	if (*n + len >= size){
+		len = size - 1 - *n;
+	}
+	memcpy(out + *n, text, len);
+	*n += len;
+}
+
+
+size_t LogFormatRender(const LogSchema *schema, const char *text, const uint64_t *args, int argCount, char *out, size_t size){
+
+	size_t n = 0;
+	int next = 0;
+
+	if (size == 0){
+		return 0;
+	}
+
+	for (const char *p = text; *p; ){
+		const char *percent = strchr(p, '%');
+		if (!percent){
+			Append(out, size, &n, p, strlen(p));
+			break;
+		}
+		Append(out, size, &n, p, (size_t)(percent - p));
+		p = percent + 1;
+
+		if (*p == '%'){
+			Append(out, size, &n, "%", 1);
+			p++;
+			continue;
+		}
+		if (*p == 'T' && p[1]){
+			const char *name = next < argCount ? FindName(schema, p[1], args[next]) : "(missing)";
+			Append(out, size, &n, name, strlen(name));
+			p += 2;
+			continue;
+		}
+
+		//Copy flags, width and precision into a spec of our own, skip length modifiers.
+		char spec[32] = "%";
+		size_t specLen = 1;
+		while (*p && strchr("-+ #0123456789.", *p) && specLen < sizeof(spec) - 4){
+			spec[specLen++] = *p++;
+		}
+		while (*p && strchr("hlLqjzt", *p)){
+			p++;
+		}
+		char conversion = *p;
+		if (!conversion){
+			break;
+		}
+		p++;
+
+		char piece[128];
+		int len;
+		if (next >= argCount){
+			len = snprintf(piece, sizeof(piece), "(missing)");
+		}
+		else if (strchr("diuxXoc", conversion)){
+			uint64_t value = args[next++];
+			if (conversion == 'c'){
+				spec[specLen++] = 'c';
+				spec[specLen] = 0;
+				len = snprintf(piece, sizeof(piece), spec, (int)value);
+			}
+			else{
+				spec[specLen++] = 'l';
+				spec[specLen++] = 'l';
+				spec[specLen++] = conversion;
+				spec[specLen] = 0;
+				if (conversion == 'd' || conversion == 'i'){
+					len = snprintf(piece, sizeof(piece), spec, (long long)(int64_t)value);
+				}
+				else{
+					len = snprintf(piece, sizeof(piece), spec, (unsigned long long)value);
+				}
+			}
+		}
+		else if (conversion == 'p'){
+			len = snprintf(piece, sizeof(piece), "%016llX", (unsigned long long)args[next++]);
+		}
+		else{
+			next++;
+			len = snprintf(piece, sizeof(piece), "(%%%c?)", conversion);
+		}
+		if (len > 0){
+			Append(out, size, &n, piece, (size_t)len < sizeof(piece) ? (size_t)len : sizeof(piece) - 1);
+		}
+	}
+
+	out[n] = 0;
+	return n;
+}
+
+
+size_t LogRenderRecord(const LogSchema *schema, int format, const uint64_t *args, int argCount, const char *text,
+	size_t textBytes, char *out, size_t size){
+
+	if (format == LOG_FORMAT_TEXT){
+		size_t n = 0;
+		Append(out, size, &n, text, textBytes);
+		out[n] = 0;
+		return n;
+	}
+	if (format == LOG_FORMAT_DROPPED){
+		return LogFormatRender(schema, "[log] %llu lines dropped, ring full", args, argCount, out, size);
+	}
+	if (format < 0 || format >= schema->formatCount){
+		return LogFormatRender(schema, "(unknown format)", args, argCount, out, size);
+	}
+	return LogFormatRender(schema, schema->formats[format].text, args, argCount, out, size);
+}
+
+
+static void PutU16(unsigned char *p, uint32_t v){
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+}
+
+static void PutU32(unsigned char *p, uint32_t v){
+	PutU16(p, v);
+	PutU16(p + 2, v >> 16);
+}
+
+static void PutU64(unsigned char *p, uint64_t v){
+	PutU32(p, (uint32_t)v);
+	PutU32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t GetU16(const unsigned char *p){
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static uint32_t GetU32(const unsigned char *p){
+	return GetU16(p) | GetU16(p + 2) << 16;
+}
+
+static uint64_t GetU64(const unsigned char *p){
+	return (uint64_t)GetU32(p) | (uint64_t)GetU32(p + 4) << 32;
+}
+
+
+size_t LogWriteHeader(FILE *file, const LogSchema *schema, uint64_t startNs){
+
+	unsigned char head[32];
+	size_t total = 0;
+
+	memcpy(head, LOG_FILE_MAGIC, 8);
+	PutU32(head + 8, LOG_FILE_VERSION);
+	PutU32(head + 12, (uint32_t)schema->formatCount);
+	PutU32(head + 16, (uint32_t)schema->nameCount);
+	PutU32(head + 20, 0);
+	PutU64(head + 24, startNs);
+	if (fwrite(head, 1, 32, file) != 32){
+		return 0;
+	}
+	total += 32;
+
+	for (int i = 0; i < schema->formatCount; i++){
+		const LogFormat *format = &schema->formats[i];
+		size_t len = strlen(format->text);
+		PutU16(head, (uint32_t)format->id);
+		head[2] = (unsigned char)format->level;
+		head[3] = 0;
+		PutU32(head + 4, (uint32_t)len);
+		if (fwrite(head, 1, 8, file) != 8 || fwrite(format->text, 1, len, file) != len){
+			return 0;
+		}
+		total += 8 + len;
+	}
+
+	for (int i = 0; i < schema->nameCount; i++){
+		const LogName *name = &schema->names[i];
+		size_t len = strlen(name->name);
+		head[0] = (unsigned char)name->table;
+		head[1] = 0;
+		PutU16(head + 2, 0);
+		PutU32(head + 4, (uint32_t)len);
+		PutU64(head + 8, name->value);
+		if (fwrite(head, 1, 16, file) != 16 || fwrite(name->name, 1, len, file) != len){
+			return 0;
+		}
+		total += 16 + len;
+	}
+	return total;
+}
+
+
+size_t LogWriteRecord(FILE *file, int format, uint64_t timeNs, const uint64_t *args, int argCount, const char *text, size_t textBytes){
+
+	unsigned char record[16 + LOG_MAX_ARGS * 8];
+
+	if (argCount > LOG_MAX_ARGS){
+		argCount = LOG_MAX_ARGS;
+	}
+	PutU16(record, (uint32_t)format);
+	record[2] = (unsigned char)argCount;
+	record[3] = 0;
+	PutU32(record + 4, (uint32_t)textBytes);
+	PutU64(record + 8, timeNs);
+	for (int i = 0; i < argCount; i++){
+		PutU64(record + 16 + i * 8, args[i]);
+	}
+
+	size_t bytes = 16 + (size_t)argCount * 8;
+	if (fwrite(record, 1, bytes, file) != bytes || (textBytes && fwrite(text, 1, textBytes, file) != textBytes)){
+		return 0;
+	}
+	return bytes + textBytes;
+}
+
+
+/* The schema of one session as read back from a file. The strings are kept in a list of their own, as
+ * lines of earlier sessions are already written when the next session starts.
+ */
+typedef struct ReadSchema {
+	LogSchema schema;
+	LogFormat *formats;
+	LogName *names;
+	uint64_t startNs;
+} ReadSchema;
+
+
+static void ReadSchemaFree(ReadSchema *rs){
+	free(rs->formats);
+	free(rs->names);
+	memset(rs, 0, sizeof(*rs));
+}
+
+
+//Reads a string of len bytes. Returns NULL on a short read or no memory.
+static char *ReadString(FILE *in, size_t len){
+	char *s = malloc(len + 1);
+	if (!s){
+		return NULL;
+	}
+	if (fread(s, 1, len, in) != len){
+		free(s);
+		return NULL;
+	}
+	s[len] = 0;
+	return s;
+}
+
+
+/* Reads the rest of a session header. first holds its first 16 bytes (magic, version and format count),
+ * which were read as a record header. The strings are added to *strings.
+ */
+static LogDecodeStatus ReadHeader(FILE *in, const unsigned char *first, ReadSchema *rs, char ***strings, size_t *stringCount){
+
+	unsigned char head[24];
+	memcpy(head, first + 8, 8);
+	if (fread(head + 8, 1, 16, in) != 16){
+		return LOG_DECODE_Truncated;
+	}
+	if (GetU32(head) != LOG_FILE_VERSION){
+		return LOG_DECODE_Corrupt;
+	}
+	uint32_t formatCount = GetU32(head + 4);
+	uint32_t nameCount = GetU32(head + 8);
+	if (formatCount > LOG_FORMAT_LIMIT || nameCount > 1000000){
+		return LOG_DECODE_Corrupt;
+	}
+	rs->startNs = GetU64(head + 16);
+
+	char **list = realloc(*strings, sizeof(char *) * (*stringCount + formatCount + nameCount + 1));
+	if (!list){
+		return LOG_DECODE_OutOfMemory;
+	}
+	*strings = list;
+	rs->formats = calloc((size_t)formatCount + 1, sizeof(LogFormat));
+	rs->names = calloc((size_t)nameCount + 1, sizeof(LogName));
+	if (!rs->formats || !rs->names){
+		return LOG_DECODE_OutOfMemory;
+	}
+
+	for (uint32_t i = 0; i < formatCount; i++){
+		if (fread(head, 1, 8, in) != 8){
+			return LOG_DECODE_Truncated;
+		}
+		uint32_t id = GetU16(head);
+		char *text = ReadString(in, GetU32(head + 4));
+		if (!text){
+			return LOG_DECODE_Truncated;
+		}
+		(*strings)[(*stringCount)++] = text;
+		if (id != i){
+			return LOG_DECODE_Corrupt;
+		}
+		rs->formats[i].id = (int)id;
+		rs->formats[i].level = head[2];
+		rs->formats[i].text = text;
+	}
+	for (uint32_t i = 0; i < nameCount; i++){
+		unsigned char entry[16];
+		if (fread(entry, 1, 16, in) != 16){
+			return LOG_DECODE_Truncated;
+		}
+		char *name = ReadString(in, GetU32(entry + 4));
+		if (!name){
+			return LOG_DECODE_Truncated;
+		}
+		(*strings)[(*stringCount)++] = name;
+		rs->names[i].table = (char)entry[0];
+		rs->names[i].value = GetU64(entry + 8);
+		rs->names[i].name = name;
+	}
+
+	rs->schema.formats = rs->formats;
+	rs->schema.formatCount = (int)formatCount;
+	rs->schema.names = rs->names;
+	rs->schema.nameCount = (int)nameCount;
+	return LOG_DECODE_Ok;
+}
+
+
+LogDecodeStatus LogDecodeFile(FILE *in, FILE *out, LogDecodeStats *stats){
+
+	ReadSchema rs;
+	char **strings = NULL;
+	size_t stringCount = 0;
+	char *text = NULL;
+	size_t textCapacity = 0;
+	char line[LOG_LINE_MAX];
+	LogDecodeStatus status = LOG_DECODE_Ok;
+	int haveSchema = 0;
+
+	memset(&rs, 0, sizeof(rs));
+	memset(stats, 0, sizeof(*stats));
+
+	for (;;){
+		unsigned char head[16];
+		size_t got = fread(head, 1, 16, in);
+		if (got == 0){
+			break;
+		}
+
+		//A new session starts with the magic. Record format ids never look like it (LOG_FORMAT_LIMIT).
+		if (got >= 8 && memcmp(head, LOG_FILE_MAGIC, 8) == 0){
+			if (got != 16){
+				status = LOG_DECODE_Truncated;
+				break;
+			}
+			ReadSchemaFree(&rs);
+			status = ReadHeader(in, head, &rs, &strings, &stringCount);
+			if (status != LOG_DECODE_Ok){
+				break;
+			}
+			haveSchema = 1;
+			stats->sessions++;
+			continue;
+		}
+		if (!haveSchema){
+			status = LOG_DECODE_NotLog;
+			break;
+		}
+		if (got != 16){
+			status = LOG_DECODE_Truncated;
+			break;
+		}
+
+		int format = (int)GetU16(head);
+		int argCount = head[2];
+		uint32_t textBytes = GetU32(head + 4);
+		uint64_t timeNs = GetU64(head + 8);
+		if (argCount > LOG_MAX_ARGS || (format >= rs.schema.formatCount && format != LOG_FORMAT_TEXT && format != LOG_FORMAT_DROPPED)){
+			status = LOG_DECODE_Corrupt;
+			break;
+		}
+
+		unsigned char raw[LOG_MAX_ARGS * 8];
+		uint64_t args[LOG_MAX_ARGS];
+		if (fread(raw, 1, (size_t)argCount * 8, in) != (size_t)argCount * 8){
+			status = LOG_DECODE_Truncated;
+			break;
+		}
+		for (int i = 0; i < argCount; i++){
+			args[i] = GetU64(raw + i * 8);
+		}
+		if (textBytes > textCapacity){
+			char *grown = realloc(text, textBytes);
+			if (!grown){
+				status = LOG_DECODE_OutOfMemory;
+				break;
+			}
+			text = grown;
+			textCapacity = textBytes;
+		}
+		if (textBytes && fread(text, 1, textBytes, in) != textBytes){
+			status = LOG_DECODE_Truncated;
+			break;
+		}
+
+		if (format == LOG_FORMAT_DROPPED && argCount > 0){
+			stats->dropped += args[0];
+		}
+		LogRenderRecord(&rs.schema, format, args, argCount, text, textBytes, line, sizeof(line));
+		uint64_t since = timeNs > rs.startNs ? timeNs - rs.startNs : 0;
+		fprintf(out, "[%10.6f] %s\n", (double)since / 1e9, line);
+		stats->records++;
+	}
+
+	for (size_t i = 0; i < stringCount; i++){
+		free(strings[i]);
+	}
+	free(strings);
+	free(text);
+	ReadSchemaFree(&rs);
+	return status;
+}
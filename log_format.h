@@ -0,0 +1,151 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Log lines stored as a format id plus raw arguments, formatted only when somebody reads them.
+ *
+ * A program lists its log formats once in an X-macro table (see main.c). A log site then only stores the
+ * format id, a time stamp and up to LOG_MAX_ARGS 64 bit arguments; the text is produced later, either on
+ * the writer thread of async_log.c or offline by log_decode from a binary log file. Binary log files start
+ * with the format table and the name tables used by %T, so the decoder needs nothing from the program that
+ * wrote them.
+ *
+ * Format texts use printf conversions d i u x X o c p with the usual flags, width and precision (length
+ * modifiers are accepted and ignored, every argument is 64 bits), %% and one extension: "%T<key>" prints the
+ * name the next argument has in name table <key>, without using the argument up, so "%Tm (0x%04X)" prints a
+ * message name followed by its number. %p prints 16 hex digits like the Windows C library does.
+ *
+ * Binary file layout, all numbers little endian:
+ *   header : "ANNOBLOG", u32 version, u32 formatCount, u32 nameCount, u32 0, u64 startNs
+ *   format : u16 id, u8 level, u8 0, u32 textBytes, text
+ *   name   : u8 table, u8 0, u16 0, u32 nameBytes, u64 value, name
+ *   record : u16 format, u8 argCount, u8 0, u32 textBytes, u64 timeNs, argCount u64, text
+ * A file may hold several header + records sessions one after the other (the log is appended to).
+ */
+
+
+#define LOG_MAX_ARGS 8
+
+//Format ids at or above this are reserved for the records below.
+#define LOG_FORMAT_LIMIT 0x4000
+
+//A record holding a ready-made UTF-8 text instead of arguments.
+#define LOG_FORMAT_TEXT 0xFFFE
+
+//A record saying argument 0 lines were dropped because the ring was full.
+#define LOG_FORMAT_DROPPED 0xFFFF
+
+#define LOG_FILE_MAGIC "ANNOBLOG"
+#define LOG_FILE_VERSION 1
+
+
+/* Levels, as plain numbers so the preprocessor can compare them. Sites below LOG_COMPILED_LEVEL compile to
+ * nothing (see LOG_WRITE).
+ */
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+
+/* Log site: writes format id (an enum value from the program's table, with id##_LEVEL next to it) and its
+ * arguments through fn(context, id, args, count). The level test is a constant, so a site below
+ * LOG_COMPILED_LEVEL leaves no code behind, while its arguments are still checked by the compiler. Takes
+ * at least one argument; pointers go through LOG_PTR.
+ */
+#define LOG_WRITE(fn, context, id, ...) do { \
+	if ((id##_LEVEL) >= LOG_COMPILED_LEVEL){ \
+		const uint64_t logArgs_[] = { __VA_ARGS__ }; \
+		fn(context, id, logArgs_, (int)(sizeof(logArgs_) / sizeof(logArgs_[0]))); \
+	} \
+} while (0)
+
+#define LOG_PTR(p) ((uint64_t)(uintptr_t)(p))
+
+
+/* id : the format id (index into LogSchema.formats)
+ * level : LOG_LEVEL_*
+ * text : the format text
+ */
+typedef struct LogFormat {
+	int id;
+	int level;
+	const char *text;
+} LogFormat;
+
+
+/* One entry of a name table for %T.
+ *
+ * table : key character of the table
+ * value : the argument value
+ * name : what to print for it
+ */
+typedef struct LogName {
+	char table;
+	uint64_t value;
+	const char *name;
+} LogName;
+
+
+/* formats : indexed by format id
+ */
+typedef struct LogSchema {
+	const LogFormat *formats;
+	int formatCount;
+	const LogName *names;
+	int nameCount;
+} LogSchema;
+
+
+typedef enum LogDecodeStatus {
+	LOG_DECODE_Ok,
+	LOG_DECODE_NotLog,		//no header at the start
+	LOG_DECODE_Truncated,		//the file ends inside a record (usually a log still being written)
+	LOG_DECODE_Corrupt,		//a record with an unknown format id or a broken header
+	LOG_DECODE_OutOfMemory
+} LogDecodeStatus;
+
+
+/* records : records decoded
+ * sessions : headers seen
+ * dropped : lines the writer reported as dropped
+ */
+typedef struct LogDecodeStats {
+	uint64_t records;
+	uint64_t sessions;
+	uint64_t dropped;
+} LogDecodeStats;
+
+
+/* Formats text with args into out (UTF-8, always null terminated). Returns the length written.
+ */
+size_t LogFormatRender(const LogSchema *schema, const char *text, const uint64_t *args, int argCount, char *out, size_t size);
+
+
+/* Renders a record of any format id, including LOG_FORMAT_TEXT and LOG_FORMAT_DROPPED.
+ */
+size_t LogRenderRecord(const LogSchema *schema, int format, const uint64_t *args, int argCount, const char *text,
+	size_t textBytes, char *out, size_t size);
+
+
+/* Writes a session header / a record to a binary log file. Return the number of bytes written, 0 on error.
+ */
+size_t LogWriteHeader(FILE *file, const LogSchema *schema, uint64_t startNs);
+size_t LogWriteRecord(FILE *file, int format, uint64_t timeNs, const uint64_t *args, int argCount, const char *text, size_t textBytes);
+
+
+/* Reads a binary log file and writes it as text lines ("[seconds] text") to out.
+ */
+LogDecodeStatus LogDecodeFile(FILE *in, FILE *out, LogDecodeStats *stats);
+
+
+const char *LogDecodeStatusName(LogDecodeStatus status);
+
+#endif
@@ -1,22 +1,35 @@
 #define WIN32_LEAN_AND_MEAN 	//Tells windows.h to compile a smaller version of itself 
 #define SHOW_CONSOLE 0		//if '1' colsole printing code compiles in, '0' to ommit entirely
+#define LOG_BINARY 0		//if '1' the log file is binary (read it with log_decode), '0' for a text log
 
 #include <windows.h>	//Contains Win32 API declarations
 #include <stdio.h>	//Standard C I/O
 #include <stdarg.h>	//Contains 'Variadic functions' (functions containing '...' as a parameter)
 #include <strsafe.h>	//Microsoft 'Safe String' helpers.
 
+#include "msg_names.h"	//MsgName and NotifyCodeName
+#include "async_log.h"	//AsyncLog, the background log writer
+#include "log_format.h"	//LOG_WRITE, log lines stored as format id + arguments
+
 
 /*
  * Win32 controls usually have an integer ID, and when a control is activated (such as a button click).
  * windows will send a 'WM_COMMAND' with the ID in the message parameters. Forcing button ID's to start
  * at 1000 avoids conflicts with small common ID's
+ *
+ * The enum and the control names of the log (%Tc, see LOG_FORMAT_TABLE) are both generated from this list.
+ * X(name, id)
  */
+#define DEBUG_CONTROL_TABLE(X) \
+	X(ID_BTN_HELLO,	1001) \
+	X(ID_BTN_QUIT,	1002) \
+	X(ID_BTN_TEST,	1003)
+
+#define X_DEBUG_CONTROL_ENUM(name, id) name = id,
 enum {
-    ID_BTN_HELLO = 1001,
-    ID_BTN_QUIT = 1002,
-    ID_BTN_TEST = 1003
+	DEBUG_CONTROL_TABLE(X_DEBUG_CONTROL_ENUM)
 };
+#undef X_DEBUG_CONTROL_ENUM
 
 //initalizes a handle (Kernal pointer) for the OS that represents the program.
 static HINSTANCE g_hInstance = NULL;
@@ -35,6 +48,83 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
 
 
 
+/* Log output. Logfw only formats the line and queues it; the async_log.c writer thread appends it to
+ * g_logPath and passes it on to EchoLogLine, so the debugger and console output no longer hold up the
+ * message loop when messages come in storms (mouse moves, paints). If the log file cannot be opened,
+ * Logfw falls back to writing to the debugger directly.
+ */
+static const char *g_logPath = "Anno_1800_In_Game_Overlay_debug.log";
+static AsyncLog g_log;
+static int g_logOpen = 0;
+
+
+/* The log lines written on every message. A LOGB site only stores the format id, a time stamp and the raw
+ * arguments; the writer thread turns them into text (or stores them as they are with LOG_BINARY), so a
+ * message costs a few stores instead of a wide printf. Sites below LOG_COMPILED_LEVEL compile to nothing.
+ * %Tm / %Tn / %Tc print message, notify code and control names from g_logNames.
+ * X(id, level, text)
+ */
+#define LOG_FORMAT_TABLE(X) \
+	X(LOGF_Startup,	LOG_LEVEL_INFO,		"[startup] hInstance=%p nCmdShow=%d") \
+	X(LOGF_Msg,	LOG_LEVEL_DEBUG,	"[msg] hwnd=%p %Tm (0x%04X) wParam=0x%p lParam=0x%p") \
+	X(LOGF_Cmd,	LOG_LEVEL_DEBUG,	"[cmd] %Tc (controlId=%d) %Tn (notify=%d) controlHwnd=%p") \
+	X(LOGF_Quit,	LOG_LEVEL_INFO,		"[loop] WM_QUIT received, exit code %d. Exiting Message loop,") \
+	X(LOGF_Close,	LOG_LEVEL_INFO,		"[log] closing, %llu lines written so far, %llu dropped")
+
+#define X_LOG_FORMAT_ENUM(id, level, text) id,
+enum {
+	LOG_FORMAT_TABLE(X_LOG_FORMAT_ENUM)
+};
+#undef X_LOG_FORMAT_ENUM
+
+#define X_LOG_FORMAT_LEVEL(id, level, text) id##_LEVEL = level,
+enum {
+	LOG_FORMAT_TABLE(X_LOG_FORMAT_LEVEL)
+};
+#undef X_LOG_FORMAT_LEVEL
+
+#define X_LOG_FORMAT(id, level, text) {id, level, text},
+static const LogFormat g_logFormats[] = {
+	LOG_FORMAT_TABLE(X_LOG_FORMAT)
+};
+#undef X_LOG_FORMAT
+
+#define X_LOG_MSG_NAME(msg) {'m', msg, #msg},
+#define X_LOG_NOTIFY_NAME(code) {'n', code, #code},
+#define X_LOG_CONTROL_NAME(name, id) {'c', id, #name},
+static const LogName g_logNames[] = {
+	MSG_NAME_TABLE(X_LOG_MSG_NAME)
+	NOTIFY_CODE_TABLE(X_LOG_NOTIFY_NAME)
+	DEBUG_CONTROL_TABLE(X_LOG_CONTROL_NAME)
+};
+#undef X_LOG_MSG_NAME
+#undef X_LOG_NOTIFY_NAME
+#undef X_LOG_CONTROL_NAME
+
+static const LogSchema g_logSchema = {
+	g_logFormats, sizeof(g_logFormats) / sizeof(g_logFormats[0]),
+	g_logNames, sizeof(g_logNames) / sizeof(g_logNames[0])
+};
+
+static void LogArgs(void *context, int format, const uint64_t *args, int argCount);
+#define LOGB(id, ...) LOG_WRITE(LogArgs, NULL, id, __VA_ARGS__)
+
+
+//Runs on the log writer thread for every line written to the file.
+static void EchoLogLine(void *user, const wchar_t *line) {
+	(void)user;
+
+	OutputDebugStringW(line);//Sends the text to the debugger window if debugger is attached. (run program in IDE for easy debugger window).
+	OutputDebugStringW(L"\n");
+
+#if SHOW_CONSOLE
+	fputws(line, stdout);
+	fputws(L"\n", stdout);
+	fflush(stdout);
+#endif
+}
+
+
 //helper funtion for the logger, -Go Over Again-
 static void Logfw(const wchar_t *fmt, ...) {
 
@@ -48,14 +138,44 @@ static void Logfw(const wchar_t *fmt, ...) {
 	StringCchVPrintfW(buffer, 1024, fmt, args);	// -figure out-
 	va_end(args);					//cleans up va_list usage (required?)
 
-	OutputDebugStringW(buffer);//Sends the text to the debugger window if debugger is attached. (run program in IDE for easy debugger window).
-	OutputDebugStringW(L"\n");
+	if (g_logOpen) {
+		//Never waits: if the writer thread is behind, the line is dropped and counted.
+		AsyncLogWrite(&g_log, buffer, wcslen(buffer));
+		return;
+	}
+	EchoLogLine(NULL, buffer);
+}
 
-#if SHOW_CONSOLE
-	fputws(buffer, stdout);
-	fputws(L"\n", stdout);
-	fflush(stdout);
-#endif
+
+//LOGB target: queues the record, or formats it and writes it to the debugger directly while the log is closed.
+static void LogArgs(void *context, int format, const uint64_t *args, int argCount) {
+	(void)context;
+
+	if (g_logOpen) {
+		//Never waits either, see Logfw.
+		AsyncLogWriteArgs(&g_log, format, args, argCount);
+		return;
+	}
+
+	char text[1024];
+	wchar_t buffer[1024];
+	LogRenderRecord(&g_logSchema, format, args, argCount, NULL, 0, text, sizeof(text));
+	if (!MultiByteToWideChar(CP_UTF8, 0, text, -1, buffer, 1024)) {
+		buffer[0] = 0;
+	}
+	EchoLogLine(NULL, buffer);
+}
+
+
+//Writes the lines still queued and how many were dropped, then stops the writer thread.
+static void CloseLog(void) {
+	if (g_logOpen) {
+		AsyncLogStats stats;
+		AsyncLogGetStats(&g_log, &stats);
+		LOGB(LOGF_Close, stats.written, stats.dropped);
+		AsyncLogClose(&g_log);
+		g_logOpen = 0;
+	}
 }
 
 
@@ -121,61 +241,6 @@ static void ShowLastErrorBox(HWND owner, const wchar_t *context) {
 
 
 
-/*
- * Takes msg (the numeric message code) and returns a readable string. purely for debugging.
- */
-static const wchar_t *MsgName(UINT msg) {
-	//switch: chooses base on integer value.
-	switch (msg) {
-		case WM_CREATE: 	return L"WM_CREATE";
-		case WM_COMMAND:	return L"WM_COMMAND";
-		case WM_DESTROY:	return L"WM_DESTROY";
-		case WM_PAINT:		return L"WM_PAINT";
-		case WM_SIZE:		return L"WM_SIZE";
-		case WM_CLOSE:		return L"WM_CLOSE";
-		case WM_MOVE:		return L"WM_MOVE";
-		case WM_SETFOCUS:	return L"WM_SETFOCUS";
-		case WM_KILLFOCUS:	return L"WM_KILLFOCUS";
-		case WM_KEYDOWN:	return L"WM_KEYDOWN";
-		case WM_KEYUP:		return L"WM_KEYUP";
-		case WM_CHAR:		return L"WM_CHAR";
-		case WM_LBUTTONDOWN:	return L"WM_LBUTTONDOWN";
-		case WM_LBUTTONUP: 	return L"WM_LBUTTONUP";
-		default:		return L"(unknown msg)";
-	}
-}
-
-
-
-/*
- * Converts the numeric button ID's back into strings for logs.
- */
-static const wchar_t *ControlIdName(int id) {
-	switch(id) {
-		case ID_BTN_HELLO:	return L"ID_BTN_HELLO";
-		case ID_BTN_QUIT:	return L"ID_BTN_QUIT";
-		case ID_BTN_TEST:	return L"ID_BTN_TEST";
-		default:		return L"(unknown control id)";
-	}
-}
-
-
-
-/*
- * BN_* codes are the button notification codes delivered through WM_COMMAND.
- */
-static const wchar_t *NotifyCodeName(int code) {
-	switch (code) {
-		case BN_CLICKED:	return L"BN_CLICKED";
-		case BN_DOUBLECLICKED:	return L"BN_DOUBLECLICKED";
-		case BN_SETFOCUS:	return L"BN_SETFOCUS";
-		case BN_KILLFOCUS:	return L"BN_KILLFOCUS";
-		default:		return L"(unknown notify code)";
-	}
-}
-
-
-
 /*
  * struct CommandInfo {...}; defines a struct type with three fields.
  * typedef ... CommandInfo; creates and alias so i can write "CommmandInfo" instead of "struct CommmandInfo".
@@ -356,13 +421,12 @@ static HWND CreateMainWindow(HINSTANCE hInstance) {
 static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 
 	/*
-	 * %p : prints a pointer value.
-	 * hwnd : is a handle, cast to (void*) to match %p
-	 * msgName(msg) : prints the message code in hex (4 digits)
-	 * wParam/lParam : integer types the size of a pointer so the code casts:
-	 							(UINT_PTR)wParam then (void*) so %p is happy on 32/64 bit. -Elaborate-
+	 * Only the raw values are stored, LOGF_Msg in LOG_FORMAT_TABLE says how they are printed:
+	 * hwnd : is a handle, LOG_PTR stores its address as a 64 bit number
+	 * msg : printed by name (%Tm) and in hex (4 digits)
+	 * wParam/lParam : integer types the size of a pointer, stored widened to 64 bits
 	 */
-	Logfw(L"[msg] hwnd=%p %s (0x%04X) wParam=0x%p lParam=0x%p", (void*)hwnd, MsgName(msg), (unsigned)msg, (void*)(UINT_PTR)wParam, (void*)(UINT_PTR)lParam);
+	LOGB(LOGF_Msg, LOG_PTR(hwnd), msg, (uint64_t)(UINT_PTR)wParam, (uint64_t)(UINT_PTR)lParam);
 	
 	//Switch statment the depends on the message type.
 	switch(msg) {
@@ -435,7 +499,7 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
 
 			
 			//this funtion simply prints a decoded snapshot of the command for logging
-			Logfw(L"[cmd] controlId=%d (%s) notify=%d (%s) controlHwnd=%p", ci.controlId, ControlIdName(ci.controlId), ci.notifyCode, NotifyCodeName(ci.notifyCode), (void*)ci.controlHwnd);
+			LOGB(LOGF_Cmd, ci.controlId, ci.notifyCode, LOG_PTR(ci.controlHwnd));
 			
 			//Checks the notify code and returns true if its "BN_CLICKED"
 			if (ci.notifyCode == BN_CLICKED) {
@@ -511,14 +575,23 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	//this stores hInstance as a global variable
 	g_hInstance = hInstance;
 
+	//starts the log writer thread, until then (and if it fails) Logfw writes to the debugger directly
+	AsyncLogConfig logConfig;
+	AsyncLogDefaultConfig(&logConfig, g_logPath);
+	logConfig.echo = EchoLogLine;
+	logConfig.schema = &g_logSchema;
+	logConfig.binary = LOG_BINARY;
+	g_logOpen = AsyncLogOpen(&g_log, &logConfig);
+
 	//logging of startup info
-	Logfw(L"[startup] hInstance=%p nCmdShow=%d", (void*)hInstance, nCmdShow);
+	LOGB(LOGF_Startup, LOG_PTR(hInstance), nCmdShow);
 	
 	//registers the window class
 	if (!RegisterMainWindowClass(hInstance)) {
 		//if registration fails, shows the error box
 		ShowLastErrorBox(NULL, L"RegisterClassExW");
 		//exits the program
+		CloseLog();
 		return 0;
 	}
 
@@ -527,6 +600,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	//if creating the main window fails, print error and quit
 	if (!hwnd) {
 		ShowLastErrorBox(NULL, L"CreateWindowExW (Main Window)");
+		CloseLog();
 		return 0;
 	}
 
@@ -571,7 +645,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		}
 		//If ret is exactly 0 then the message was to quit and close the window
 		else if (ret == 0) {
-			Logfw(L"[loop] WM_QUIT received. Exiting Message loop,");
+			LOGB(LOGF_Quit, msg.wParam);
 			break;
 		}
 		//if not 0 or greater it generates an error message
@@ -580,5 +654,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 			break;
 		}
 	}
+
+	CloseLog();
 	return (int)msg.wParam;
 }
@@ -1,51 +1,231 @@
 #define WIN32_LEAN_AND_MEAN
-#define PUSHBUTTON (WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | BS_MULTILINE | BS_CENTER | BS_VCENTER)
-#define FRAMEBUTTON (WS_CHILD | WS_VISIBLE | BS_GROUPBOX)
-#define TEXTFIELD (WS_CHILD | WS_VISIBLE | WS_BORDER | ES_NUMBER | ES_AUTOHSCROLL)
-#define STATICLABEL (WS_CHILD | WS_VISIBLE)
-#define SPINNERBUTTON (WS_CHILD | WS_VISIBLE | UDS_SETBUDDYINT | UDS_ARROWKEYS | UDS_NOTHOUSANDS)
-#define DISPLAY (WS_CHILD | WS_VISIBLE | WS_BORDER | SS_SUNKEN)
-
-#define BUTTON (L"BUTTON")
-#define EDIT (L"EDIT")
-#define STATIC (L"STATIC")
-#define SPINNER (UPDOWN_CLASSW)
+#define MEASURE_LATENCY 0	//if '1' every message is timed (see latency.h), '0' compiles the timing out entirely
+#define OVERLAY_LAYER 1	//if '1' the requirement displays are also drawn in a click-through window on top of the game (overlay_layer.h)
+#define HUD_READ 0	//if '1' the displays show the demand of the population read off the game HUD (HUD_REGION_TABLE in hud_capture.h)
+#define GAME_MEMORY 0	//if '1' the displays show the demand of the farmers read out of the game's memory (GAME_NODE_TABLE in game_memory.h)
 
 #include <windows.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <limits.h>
+#include <string.h>
 #include <strsafe.h>
 #include <commctrl.h>
 
+#include "controls.h"
+#include "overlay.h"
+#include "overlay_ui.h"
+#include "demand_formula.h"
+#include "ui_win32.h"
+#include "overlay_layer.h"
+#include "hud_capture.h"
+#include "game_memory.h"
+#include "sampler.h"
+#include "event_loop.h"
+#include "msg_record.h"
+#include "latency.h"
+#include "msg_names.h"
+#include "sys_thread.h"
 
-enum {
-	ID_BTN_TEST = 1001,
-	ID_BTN_FarmerBlockInc = 1002,
-	ID_BTN_FarmerBlockDec = 1003,
 
-	ID_FRM_SetHousingFrame = 2001,
-	ID_FRM_AdjustHousingFrame = 2002,
-	ID_FRM_ResourceReqFrame = 2003,
+//Recordings and OverlayCommand use the Win32 numbers (overlay.h).
+_Static_assert(OVERLAY_WM_COMMAND == WM_COMMAND && OVERLAY_BN_CLICKED == BN_CLICKED && OVERLAY_EN_CHANGE == EN_CHANGE,
+	"overlay.h message values differ from windows.h");
 
-	ID_FLD_HousingWidth = 3001,
-	ID_FLD_HousingLength = 3002,
 
-	ID_LBL_HousingWidth = 4001,
-	ID_LBL_HousingLength = 4002,
+/* State of the housing calculator.
+ *
+ * g_win32 : the Win32 windowing calls (ui_win32.h)
+ * g_ui : the main window, its controls and the blocks and spinner values, see overlay_ui.h
+ * g_recorder : writes every message of MainWndProc to a file when started with "--record <file>"
+ * g_layer : the layered overlay window, redrawn with every display flush
+ * g_hud : the HUD capture, a source of g_sampler
+ * g_game : the game's memory, a source of g_sampler, open while g_gameOpen
+ * g_formulas : the user formulas of DEMAND_FORMULA_FILE, the displays show the demand through them
+ * g_loop : the message loop and its timers (event_loop.h)
+ * g_sampler : runs the HUD and game reads on g_samplerTimer, paused while the game is minimised
+ */
+static UiWin32 g_win32;
+static EventLoop g_loop;
+static OverlayUi g_ui;
+static DemandFormulas g_formulas;
+static MsgRecorder g_recorder;
+#if OVERLAY_LAYER
+static OverlayLayer g_layer;
+
+//Distance of the layer from the top right corner of the screen.
+#define LAYER_SCREEN_MARGIN 20
+#endif
+#if HUD_READ
+static HudCapture g_hud;
+static long g_hudResidents = -1;
+
+
+/* Shows the demand of the population read whenever it changes, the way ReadGame does, and sets the spinner
+ * of a HUD_USE_Spinner region to a number in its range; the spinner updates its text field, whose EN_CHANGE
+ * then goes through OverlayUiCommand like a typed value. A number out of range is misread and left alone
+ * rather than clamped. A SamplerFn: changed if a region reads differently from its last capture, failed if
+ * no region could be read.
+ */
+static SampleResult ReadHud(void *user){
+	(void)user;
+	int found = 0;
+	int changed = 0;
+	for (int r = 0; r < HUD_REGION_COUNT; r++){
+		HudReading reading;
+		long long lastValue = g_hud.last[r].value;
+		int lastFound = g_hud.lastFound[r];
+		int read = HudCaptureRead(&g_hud, (HudRegion)r, &reading);
+		changed |= read != lastFound || (read && reading.value != lastValue);
+		if (!read){
+			continue;
+		}
+		found = 1;
+		const HudRegionInfo *region = HudRegionGet((HudRegion)r);
+		if (region->use == HUD_USE_Residents){
+			Demand demand;
+			if (reading.value != g_hudResidents && reading.value <= LONG_MAX && CalcDemandResidents((long)reading.value, &demand)){
+				g_hudResidents = (long)reading.value;
+				OverlayUiShowDemand(&g_ui, &demand);
+			}
+			continue;
+		}
+		int index = ControlSpinnerIndex(region->spinner);
+		const SpinnerInfo *info = ControlSpinnerInfo(index);
+		if (!info || reading.value < info->minVal || reading.value > info->maxVal || reading.value == g_ui.state.spinnerPos[index]){
+			continue;
+		}
+		g_win32.backend.setSpinner(g_win32.backend.context, g_ui.controls[ControlIndexFromId(info->spinner)],
+			g_ui.controls[ControlIndexFromId(info->field)], info->minVal, info->maxVal, (int)reading.value);
+	}
+	return !found ? SAMPLE_Failed : changed ? SAMPLE_Changed : SAMPLE_Unchanged;
+}
+#endif
+
+
+#if GAME_MEMORY
+static GameMemory g_game;
+static int g_gameOpen = 0;
+static int32_t g_gameValues[GAME_FIELD_COUNT];
+static long g_gameFarmers = -1;
+
+
+/* Opens the game once it runs and shows the demand of its farmers whenever their number changes. A tick
+ * without values is normal while no session is loaded, so only then the open process is asked whether it
+ * exited, and the game is looked for again (a snapshot of all processes) only once it has. A SamplerFn:
+ * changed if any value read changed.
+ */
+static SampleResult ReadGame(void *user){
+	(void)user;
+	if (!g_gameOpen){
+		GameLayout layout;
+		GameLayoutDefault(&layout);
+		long pid = ProcMemFind(GAME_EXE_NAME);
+		g_gameOpen = pid && GameMemoryOpen(&g_game, pid, GAME_EXE_NAME, &layout);
+		if (!g_gameOpen){
+			return SAMPLE_Failed;
+		}
+	}
+	if (!GameMemoryTick(&g_game)){
+		if (ProcMemExited(&g_game.process)){
+			GameMemoryClose(&g_game);
+			g_gameOpen = 0;
+			g_gameFarmers = -1;
+		}
+		return SAMPLE_Failed;
+	}
+	long farmers = g_game.values[GAME_Farmers];
+	Demand demand;
+	if (farmers != g_gameFarmers && CalcDemandResidents(farmers, &demand)){
+		g_gameFarmers = farmers;
+		OverlayUiShowDemand(&g_ui, &demand);
+	}
+	if (memcmp(g_gameValues, g_game.values, sizeof(g_gameValues)) == 0){
+		return SAMPLE_Unchanged;
+	}
+	memcpy(g_gameValues, g_game.values, sizeof(g_gameValues));
+	return SAMPLE_Changed;
+}
+#endif
+
+
+#if HUD_READ || GAME_MEMORY
+static Sampler g_sampler;
+static Timer g_samplerTimer;
+static HWINEVENTHOOK g_minimizeHook;
+static const char *g_samplerPath = "Anno_1800_In_Game_Overlay_sampler.txt";
 
-	ID_SPN_HousingWidth = 5001,
-	ID_SPN_HousingLength = 5002,
 
-	ID_DSP_Fish = 6001,
-	ID_DSP_Clothes = 6002,
-	ID_DSP_Schnnaps = 6003
-};
+//Runs the sources that are due and sets the one-shot timer for the next, or stops it while paused. A TimerFn.
+static void RunSampler(void *user){
+	(void)user;
+	long waitMs = SamplerRun(&g_sampler);
+	if (waitMs < 0){
+		EventLoopCancel(&g_loop, &g_samplerTimer);
+		return;
+	}
+	EventLoopTimer(&g_loop, &g_samplerTimer, (uint64_t)waitMs, RunSampler, NULL);
+}
 
 
-static HINSTANCE g_hInstance = NULL;
+/* WinEventProc for the minimise events of every window: pauses the sampler while a window of the game is
+ * minimised, and samples at once when it comes back.
+ */
+static void CALLBACK GameMinimizeEvent(HWINEVENTHOOK hook, DWORD event, HWND hwnd, LONG idObject, LONG idChild, DWORD thread, DWORD time){
+	(void)hook;
+	(void)idChild;
+	(void)thread;
+	(void)time;
+	DWORD pid = 0;
+	if (idObject != OBJID_WINDOW || !GetWindowThreadProcessId(hwnd, &pid) || (long)pid != ProcMemFind(GAME_EXE_NAME)){
+		return;
+	}
+	SamplerPause(&g_sampler, event == EVENT_SYSTEM_MINIMIZESTART);
+	RunSampler(NULL);
+}
 
 
-static const wchar_t *g_mainClassName = L"Anno1800OverlayClass";
+//Appends the sampler's rates and budget use to g_samplerPath.
+static void DumpSampler(void){
+	FILE *f = fopen(g_samplerPath, "a");
+	if (!f){
+		return;
+	}
+	fprintf(f, "--- exit, %lu ms after start\n", (unsigned long)GetTickCount());
+#if HUD_READ
+	fprintf(f, "hud digits: %s\n", g_hud.fontTemplates ? "the built-in font, " HUD_DIGITS_FILE " did not load" : HUD_DIGITS_FILE);
+#endif
+	SamplerDump(&g_sampler, f);
+	fclose(f);
+}
+#endif
+
+
+#if MEASURE_LATENCY
+/* Time spent in MainWndProc, by message and by the control a WM_COMMAND / WM_NOTIFY came from. A handler
+ * that sends messages to the window itself includes their time. The
+ * tables are written to g_latencyPath on WM_DESTROY and whenever Ctrl+Shift+L is pressed.
+ *
+ * g_latencyByMsg : keys are message numbers below WM_USER, LATENCY_OTHER_MSG for everything above
+ * g_latencyByControl : keys are control indexes (CONTROL_TABLE order)
+ */
+#define LATENCY_OTHER_MSG WM_USER
+#define LATENCY_HOTKEY_ID 1
+
+static const char *g_latencyPath = "Anno_1800_In_Game_Overlay_latency.txt";
+static LatencyTable g_latencyByMsg;
+static LatencyTable g_latencyByControl;
+#endif
+
+
+//The display texts of the last commands are due (OverlayUiCommand schedules this on the event loop).
+static void FlushDisplays(void *user){
+	(void)user;
+	OverlayUiFlush(&g_ui);
+#if OVERLAY_LAYER
+	OverlayLayerUpdate(&g_layer, &g_ui.view);
+#endif
+}
 
 
 /* Forward Prototype for the main function, so that it can be referenced prior to initialization.
@@ -70,13 +250,6 @@ typedef struct CommandInfo{
 	HWND controlHwnd;
 } CommandInfo;
 
-typedef struct buddyInfo{
-	HWND buddyHWND;
-	int minVal;
-	int maxVal;
-	int initialVal;
-} BuddyInfo;
-
 /* When Windows creates/sends a command it stres the information for the command in WPARAM and LPARAM.
  * The DecodeWmCommand takes these two parameters, extracts the information and then stores it in the 
  * CommandInfo stuct.
@@ -102,350 +275,36 @@ static CommandInfo DecodeWmCommand(WPARAM wParam, LPARAM lParam){
 }
 
 
-/* Registers the main window with the Windows OS so that the OS knows how to create the window.
- *
- * BOOL : Win32's integer boolean type (TRUE/FALSE)
- * WNDCLASSEXW : the "extended window class" struct (wide version)
- * ZeroMemory(&wc, sizeof(wc)) : sets all bytes of the struct to 0 before setting fields to prevent "random uninitialized fields".
- * 
- * wc.cbSize : size of the struct; Windows uses this to know which version/size is being passed.
- * wc.lpfnWndProc : pointer to the window procedure function (must match the signature)
- * wc.hInstance : the module instance handle
- * wc.hCursor : the cursor used when mouse is inside the window space.
- * 		>LoadCursor(NULL, IDC_ARROW) : creates the actual cursor resource to be used.
- * 			NULL : a NULL instance here means "use the system cursor resources"
- * 			IDC_ARROW : the standard cursor identifier
- * wc.hbrBackground : stores the settings for how the OS actually displays the window on the screen.
- * 		>(HBRUSH)(COLOR_WINDOW + 1) : the settings themselves
- * 			(HBRUSH) : Win32 Handle type for a "brush" (how the window is drawn)
- * 			(COLOR_WINDOW + 1) : the "system color index" for the window background color
- * wc.lpszClassName : the class name to be used when actually created the main window.
+/* Appends the message to the recording (see msg_record.h): handles and pointers are replaced by what the
+ * handler reads through them.
  */
-static BOOL RegisterMainWindowClass(HINSTANCE hInstance){
-
-	WNDCLASSEXW wc;
-	ZeroMemory(&wc, sizeof(wc));
-
-	wc.cbSize	= sizeof(wc);
-	wc.lpfnWndProc	= MainWndProc;
-	wc.hInstance	= hInstance;
-	wc.hCursor	= LoadCursor(NULL, IDC_ARROW);
-	wc.hbrBackground= (HBRUSH)(COLOR_WINDOW + 1);
-	wc.lpszClassName= g_mainClassName;
-
-	if (RegisterClassExW(&wc) == 0){
-		return FALSE;
+static void RecordMessage(UINT msg, WPARAM wParam, LPARAM lParam){
+	MsgRecord record;
+	record.timeMs = (uint32_t)GetMessageTime();
+	record.message = msg;
+	record.wParam = (uint64_t)wParam;
+	record.lParam = (int64_t)lParam;
+	if (msg == WM_COMMAND){
+		record.lParam = OverlayUiCommandValue(&g_ui, (int)LOWORD(wParam));
+	}
+	else if (msg == WM_NOTIFY){
+		record.lParam = 0;
 	}
-	return TRUE;
+	MsgRecorderWrite(&g_recorder, &record);
 }
 
 
-/* The function that is used to create the buttons inside of the main window. Returns the handle to
- * the parent window (HWND) or NULL if button creation failed.
- *
- * HWND parent : the parent window to the button (usually main window)
- * int controlId : the numeric id to identify the button. (used with WM_COMMAND)
- * text : The label on the button itself
- * int x : the x-axis coordinate for the button origin (top left corner)
- * int y : the y-axis coordinate for the button origin (top left corner)
- * int width : the width of the button itself
- * int height : the height of the button itself
+/* The event handler for the main window. Whenever an action/event happens inside the window MainWndProc
+ * calls this function.
  */
-static HWND CreateButton(HWND parent, int controlId, const wchar_t *text, int x, int y, int width, int height, BuddyInfo *buddy){
-	
-	/* Int the CreateWindowExW function, the parameter HMENU is used differently depending on window type;
-	 * 	>For a top-level window, HMENU is its menu handle.
-	 * 	>for a child-level window, Win32 overloads the field to carry the control ID
-	 * Therefore, "int controlID" is converted into an HMENU-typed value.
-	 * INT_PTR : iteger type the size of a pointer (safe on 32/64-bit)
-	 */
-	HMENU idAsMenuHandle = (HMENU)(INT_PTR)controlId;
-
-	DWORD style = 0;
-	LPCWSTR class = NULL;
+static LRESULT HandleMainMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam){
 	
-	if (controlId < 2000){
-		style = PUSHBUTTON;
-		class = BUTTON;
-	}
-	else if (controlId < 3000){
-		style = FRAMEBUTTON;
-		class = BUTTON;
-	}
-	else if (controlId < 4000){
-		style = TEXTFIELD;
-		class = EDIT;
-	}
-	else if (controlId < 5000){
-		style = STATICLABEL;
-		class = STATIC;
-	}
-	else if (controlId < 6000){
-		style = SPINNERBUTTON;
-		class = SPINNER;
+	if (g_recorder.file){
+		RecordMessage(msg, wParam, lParam);
 	}
-	else if (controlId < 7000){
-		style = DISPLAY;
-		class = STATIC;
-	}
-
-	
-	HWND button = CreateWindowExW(
-	
-	/*"dwExStyle   = */ 0,					
-	/*"lpClassName = */ class, //macro
-	/*"lpWindowName= */ text,
-	/*"dwStyle     = */ style, //macro
-	/*"x           = */ x,
-	/*"y           = */ y,
-	/*"width       = */ width,
-	/*"height      = */ height,
-	/*"hwndParent  = */ parent,
-	/*"hMenu       = */ idAsMenuHandle,
-	/*"hInstance   = */ g_hInstance,
-	/*"lpParam     = */ NULL
-	);
-
-	if (buddy){
-		SendMessageW(button, UDM_SETBUDDY, (WPARAM)buddy->buddyHWND, 0);
-		SendMessageW(button, UDM_SETRANGE32, (WPARAM)buddy->minVal, (LPARAM)buddy->maxVal);
-		SendMessageW(button, UDM_SETPOS32, 0, (LPARAM)buddy->initialVal);
-	}
-
-	return button;
-}
-
-
-static HWND CreateMainWindow(HINSTANCE hInstance){
 
-	return CreateWindowExW(
-
-	/*"dwExStyle   =*/ 0,
-	/*"lpClassName =*/ g_mainClassName,
-	/*"lpWindowName=*/ L"Anno 1800 Ingame Overlay",
-	/*"dwStyle     =*/ WS_OVERLAPPEDWINDOW,
-	/*"x	       =*/ CW_USEDEFAULT,
-	/*"y	       =*/ CW_USEDEFAULT,
-	/*"width       =*/ 380,
-	/*"height      =*/ 430,
-	/*"hwndParent  =*/ NULL,
-	/*"hMenu       =*/ NULL,
-	/*"hInstance   =*/ hInstance,
-	/*"lpParam     =*/ NULL
-			);
-}
-
-
-/* The event handler for the main window. Whenever an action/event happens inside the window it calls this function.
- */
-static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam){
-	
 	switch(msg){
 
-		
-		//This msg indicates that a window needs to be created
-		case WM_CREATE:{
-			
-			/*HWND hwnd_ = CreateButton(*/
-                        /*"HWND parent        ="*/ 
-                        /*"int controlId      ="*/ 
-                        /*"const wchar_t *text="*/ 
-                        /*"int x              ="*/ 
-                        /*"int y              ="*/ 
-                        /*"int width          ="*/ 
-                        /*"int height         ="*/ 
-                        /*"BuddyInfo *buddy   ="*/
-
-			/* HWND parent : hwnd
-			 * int controlId : ID_BTN_TEST
-			 * const wchar_t *text : L"Test Button"
-			 * int x : 20
-			 * int y : 20
-			 * int width : 100
-			 * int height : 32
-			 */
-			//CreateButton(hwnd, ID_BTN_TEST, L"Test Button", 20, 20, 120, 32, NULL);
-			
-			HWND hwnd_SetHousingFrame = CreateButton(
-			/*"HWND parent        ="*/ hwnd, 
-			/*"int controlId      ="*/ ID_FRM_SetHousingFrame, 
-			/*"const wchar_t *text="*/ NULL, 
-			/*"int x 	      ="*/ 15, 
-			/*"int y 	      ="*/ 10, 
-			/*"int width 	      ="*/ 110, 
-			/*"int height 	      ="*/ 90,//100 
-			/*"BuddyInfo *buddy   ="*/ NULL);
-			
-			HWND hwnd_AdjustHousingFrame = CreateButton(
-                        /*"HWND parent        ="*/ hwnd,
-                        /*"int controlId      ="*/ ID_FRM_AdjustHousingFrame,
-                        /*"const wchar_t *text="*/ NULL,
-                        /*"int x              ="*/ 15,
-                        /*"int y              ="*/ 110,
-                        /*"int width          ="*/ 330,
-                        /*"int height         ="*/ 120,//230
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-			HWND hwnd_ResourceReqFrame = CreateButton(
-                        /*"HWND parent        ="*/ hwnd,
-                        /*"int controlId      ="*/ ID_FRM_ResourceReqFrame,
-                        /*"const wchar_t *text="*/ NULL,
-                        /*"int x              ="*/ 15,
-                        /*"int y              ="*/ 240,
-                        /*"int width          ="*/ 330,
-                        /*"int height         ="*/ 120,//360
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-
-
-
-
-			/*HWND hwnd_FarmerBlockInc = */CreateButton(
-                        /*"HWND parent        ="*/ hwnd_AdjustHousingFrame,
-                        /*"int controlId      ="*/ ID_BTN_FarmerBlockInc,
-                        /*"const wchar_t *text="*/ L"Farmer Block\r\n+1",
-                        /*"int x              ="*/ 10,
-                        /*"int y              ="*/ 20,
-                        /*"int width          ="*/ 100,
-                        /*"int height         ="*/ 40,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-			/*HWND hwnd_FarmerBlockDec = */CreateButton(
-                        /*"HWND parent        ="*/ hwnd_AdjustHousingFrame,
-                        /*"int controlId      ="*/ ID_BTN_FarmerBlockDec,
-                        /*"const wchar_t *text="*/ L"Farmer Block\r\n-1",
-                        /*"int x              ="*/ 10,
-                        /*"int y              ="*/ 60,
-                        /*"int width          ="*/ 100,
-                        /*"int height         ="*/ 40,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-			
-			
-			
-
-			HWND hwnd_HousingWidth = CreateButton(
-			/*"HWND parent        ="*/ hwnd_SetHousingFrame, 
-			/*"int controlId      ="*/ ID_FLD_HousingWidth,
-        		/*"const wchar_t *text="*/ L"Width",
-			/*"int x              ="*/ 15,
-                        /*"int y              ="*/ 40,
-                        /*"int width          ="*/ 30,
-                        /*"int height         ="*/ 20,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-
-			HWND hwnd_HousingLength = CreateButton(
-	      		/*"HWND parent        ="*/ hwnd_SetHousingFrame,
-                        /*"int controlId      ="*/ ID_FLD_HousingLength,
-                        /*"const wchar_t *text="*/ L"Length",
-                        /*"int x              ="*/ 65,
-                        /*"int y              ="*/ 40,
-                        /*"int width          ="*/ 30,
-                        /*"int height         ="*/ 20,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-
-
-
-
-                        BuddyInfo SPN_HousingWidth;
-
-			SPN_HousingWidth.buddyHWND = hwnd_HousingWidth;
-			SPN_HousingWidth.minVal = 1;
-			SPN_HousingWidth.maxVal = 2;
-			SPN_HousingWidth.initialVal = 1;
-	
-			/*HWND hwnd_HousingWidthSPN = */CreateButton(
-	                /*"HWND parent        ="*/ hwnd_SetHousingFrame,
-                        /*"int controlId      ="*/ ID_SPN_HousingWidth,
-                        /*"const wchar_t *text="*/ NULL,
-                        /*"int x              ="*/ 20,
-                        /*"int y              ="*/ 60,
-                        /*"int width          ="*/ 50,
-                        /*"int height         ="*/ 20,
-                        /*"BuddyInfo *buddy   ="*/ &SPN_HousingWidth);
-
-
-			BuddyInfo SPN_HousingLength;
-
-			SPN_HousingLength.buddyHWND = hwnd_HousingLength;
-			SPN_HousingLength.minVal = 1;
-			SPN_HousingLength.maxVal = 12;
-			SPN_HousingLength.initialVal = 8;
-
-			/*HWND hwnd_HousingLengthSPN = */CreateButton(
-                        /*"HWND parent        ="*/ hwnd_SetHousingFrame,
-                        /*"int controlId      ="*/ ID_SPN_HousingLength,
-                        /*"const wchar_t *text="*/ NULL,
-                        /*"int x              ="*/ 70,
-                        /*"int y              ="*/ 60,
-                        /*"int width          ="*/ 50,
-                        /*"int height         ="*/ 20,
-                        /*"BuddyInfo *buddy   ="*/ &SPN_HousingLength);
-
-
-
-
-			
-			/*HWND hwnd_HousingWidthLBL = */CreateButton(
-			/*"HWND parent        ="*/ hwnd_SetHousingFrame,
-                        /*"int controlId      ="*/ ID_LBL_HousingWidth,
-                        /*"const wchar_t *text="*/ L"Width",
-                        /*"int x              ="*/ 10,
-                        /*"int y              ="*/ 20,
-                        /*"int width          ="*/ 40,
-                        /*"int height         ="*/ 20,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-			
-			
-			/*HWND hwnd_HousingLengthLBL = */CreateButton(
-                        /*"HWND parent        ="*/ hwnd_SetHousingFrame,
-                        /*"int controlId      ="*/ ID_LBL_HousingLength,
-                        /*"const wchar_t *text="*/ L"Length",
-                        /*"int x              ="*/ 60,
-                        /*"int y              ="*/ 20,
-                        /*"int width          ="*/ 45,
-                        /*"int height         ="*/ 20,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-
-
-
-
-
- 		        /*HWND hwnd_Fish = */CreateButton(
-                        /*"HWND parent        ="*/ hwnd_ResourceReqFrame,
-                        /*"int controlId      ="*/ ID_DSP_Fish,
-                        /*"const wchar_t *text="*/ L"Required Fish:",
-                        /*"int x              ="*/ 10,
-                        /*"int y              ="*/ 20,
-                        /*"int width          ="*/ 100,//110
-                        /*"int height         ="*/ 40,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-			/*HWND hwnd_Clothes = */CreateButton(
-                        /*"HWND parent        ="*/ hwnd_ResourceReqFrame,
-                        /*"int controlId      ="*/ ID_DSP_Clothes,
-                        /*"const wchar_t *text="*/ L"Required Clothes:",
-                        /*"int x              ="*/ 115,
-                        /*"int y              ="*/ 20,
-                        /*"int width          ="*/ 100,//215
-                        /*"int height         ="*/ 40,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-			
-			/*HWND hwnd_Schnnaps = */CreateButton(
-                        /*"HWND parent        ="*/ hwnd_ResourceReqFrame,
-                        /*"int controlId      ="*/ ID_DSP_Schnnaps,
-                        /*"const wchar_t *text="*/ L"Required Fish:",
-                        /*"int x              ="*/ 220,
-                        /*"int y              ="*/ 20,
-                        /*"int width          ="*/ 100,//320
-                        /*"int height         ="*/ 40,
-                        /*"BuddyInfo *buddy   ="*/ NULL);
-
-			return 0;
-		}
-		
 
 		case WM_COMMAND:{
 			
@@ -454,18 +313,36 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
 			 * ci.controlHwnd = (HWND)lParam
 			 */
 			CommandInfo ci = DecodeWmCommand(wParam, lParam);
-			
-			if (ci.notifyCode == BN_CLICKED){
-	
-				if (ci.controlId == ID_BTN_TEST){
-					MessageBoxW(hwnd, L"Test Sucsessful", L"Test Notification", MB_OK | MB_ICONINFORMATION);
-					return 0;
-				}
-			}	
+
+			//What a click or a spinner change does lives in overlay.c, so a recording can replay it.
+			int effects = OverlayUiCommand(&g_ui, ci.controlId, ci.notifyCode);
+			if (effects){
+				return 0;
+			}
 			break;
 		}
 
 		case WM_DESTROY: {
+			EventLoopCancel(&g_loop, &g_win32.flushTimer);
+#if OVERLAY_LAYER
+			OverlayLayerClose(&g_layer);
+#endif
+#if HUD_READ || GAME_MEMORY
+			EventLoopCancel(&g_loop, &g_samplerTimer);
+			if (g_minimizeHook){
+				UnhookWinEvent(g_minimizeHook);
+			}
+			DumpSampler();
+#endif
+#if HUD_READ
+			HudCaptureClose(&g_hud);
+#endif
+#if GAME_MEMORY
+			GameMemoryClose(&g_game);
+#endif
+			OverlayUiFree(&g_ui);
+			DemandFormulasFree(&g_formulas);
+			MsgRecorderClose(&g_recorder);
 			PostQuitMessage(0);
 			return 0;
 		}
@@ -477,6 +354,91 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
 }
 
 
+#if MEASURE_LATENCY
+static void LatencyMsgName(int key, char *out, size_t size){
+	if (key == LATENCY_OTHER_MSG){
+		snprintf(out, size, "(WM_USER and above)");
+		return;
+	}
+	snprintf(out, size, "%ls (0x%04X)", MsgName((UINT)key), (unsigned)key);
+}
+
+
+static void LatencyControlName(int key, char *out, size_t size){
+	snprintf(out, size, "%ls", ControlIdName(ControlIdFromIndex(key)));
+}
+
+
+//Appends both tables to g_latencyPath.
+static void DumpLatency(const char *reason){
+	FILE *f = fopen(g_latencyPath, "a");
+	if (!f){
+		return;
+	}
+	fprintf(f, "--- %s, %lu ms after start\n", reason, (unsigned long)GetTickCount());
+	LatencyDump(&g_latencyByMsg, "MainWndProc by message:", LatencyMsgName, f);
+	LatencyDump(&g_latencyByControl, "WM_COMMAND / WM_NOTIFY by control:", LatencyControlName, f);
+	fclose(f);
+}
+#endif
+
+
+/* The window procedure registered for the main window. With MEASURE_LATENCY it times HandleMainMessage,
+ * otherwise it only passes the message on.
+ */
+static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam){
+
+#if MEASURE_LATENCY
+	if (msg == WM_HOTKEY && wParam == LATENCY_HOTKEY_ID){
+		DumpLatency("Ctrl+Shift+L");
+		return 0;
+	}
+
+	uint64_t start = SysNowNs();
+	LRESULT result = HandleMainMessage(hwnd, msg, wParam, lParam);
+	uint64_t elapsed = SysNowNs() - start;
+
+	LatencyAdd(&g_latencyByMsg, msg < LATENCY_OTHER_MSG ? (int)msg : LATENCY_OTHER_MSG, elapsed);
+	if (msg == WM_COMMAND){
+		LatencyAdd(&g_latencyByControl, ControlIndexFromId((int)LOWORD(wParam)), elapsed);
+	}
+	else if (msg == WM_NOTIFY && lParam){
+		LatencyAdd(&g_latencyByControl, ControlIndexFromId((int)((NMHDR *)lParam)->idFrom), elapsed);
+	}
+
+	if (msg == WM_DESTROY){
+		DumpLatency("WM_DESTROY");
+		LatencyFree(&g_latencyByMsg);
+		LatencyFree(&g_latencyByControl);
+	}
+	return result;
+#else
+	return HandleMainMessage(hwnd, msg, wParam, lParam);
+#endif
+}
+
+
+/* Tells the user why DEMAND_FORMULA_FILE did not compile; the overlay then runs without it.
+ */
+static void ShowFormulaError(void){
+	wchar_t error[FORMULA_ERROR_CHARS];
+	size_t i = 0;
+	for (; g_formulas.set.error[i] && i < FORMULA_ERROR_CHARS - 1; i++){
+		error[i] = (wchar_t)(unsigned char)g_formulas.set.error[i];
+	}
+	error[i] = L'\0';
+	wchar_t text[FORMULA_ERROR_CHARS + 128];
+	//Line 0 is an error of no line of the file (memory ran out).
+	if (g_formulas.set.errorLine){
+		swprintf(text, sizeof(text) / sizeof(text[0]), L"%ls, line %d column %d.\r\nThe displays show the demand without formulas.",
+			error, g_formulas.set.errorLine, g_formulas.set.errorColumn);
+	}else{
+		swprintf(text, sizeof(text) / sizeof(text[0]), L"%ls.\r\nThe displays show the demand without formulas.", error);
+	}
+	g_win32.backend.showMessage(g_win32.backend.context, L"" DEMAND_FORMULA_FILE, text);
+}
+
+
 /* "Main" function equivelent (GUI subsystem Windows aps traditionally use WinMain instead of main)
  *
  * HINSTANCE hInstance : The main windows instance handle
@@ -488,42 +450,63 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	
 	//intentionally use variables to silence unused parameter warnings.
 	(void)hPrevInstance;
-	(void)lpCmdLine;
 
-	//Stores hInstance as a global variable.
-	g_hInstance = hInstance;
-	
-	INITCOMMONCONTROLSEX icc;
-	ZeroMemory(&icc, sizeof(icc));
-	icc.dwSize = sizeof(icc);
-	icc.dwICC = ICC_UPDOWN_CLASS;
-	InitCommonControlsEx(&icc);
+	//"--record <file>" writes the session to file for anno_calc replay (msg_record.h).
+	if (lpCmdLine && strncmp(lpCmdLine, "--record ", 9) == 0){
+		MsgRecorderOpen(&g_recorder, lpCmdLine + 9);
+	}
+#if MEASURE_LATENCY
+	LatencyInit(&g_latencyByMsg, LATENCY_OTHER_MSG + 1);
+	LatencyInit(&g_latencyByControl, CONTROL_COUNT);
+#endif
 
-	if (!RegisterMainWindowClass(hInstance)){
+	if (!EventLoopInit(&g_loop) || !UiWin32Init(&g_win32, hInstance, MainWndProc, &g_loop, FlushDisplays, NULL)){
 		return 0;
 	}
-	
-	HWND hwnd = CreateMainWindow(hInstance);
+
+	//The window and its controls come from the layout table in overlay_ui.c.
+	OverlayUiInit(&g_ui, &g_win32.backend);
+	DemandFormulasInit(&g_formulas);
+	int formulas = DemandFormulasLoad(&g_formulas, DEMAND_FORMULA_FILE);
+	if (formulas == 1){
+		g_ui.state.formulas = &g_formulas;
+	}
+	if (!OverlayUiOpen(&g_ui)){
+		return 0;
+	}
+	if (formulas == 0){
+		ShowFormulaError();
+	}
+	HWND hwnd = (HWND)g_ui.root;
+#if OVERLAY_LAYER
+	OverlayLayerOpen(&g_layer, hInstance, GetSystemMetrics(SM_CXSCREEN) - OVERLAY_RENDER_WIDTH - LAYER_SCREEN_MARGIN, LAYER_SCREEN_MARGIN);
+	OverlayLayerUpdate(&g_layer, &g_ui.view);
+#endif
+#if HUD_READ || GAME_MEMORY
+	SamplerInit(&g_sampler, SAMPLER_BUDGET, NULL, NULL);
+#endif
+#if HUD_READ
+	if (HudCaptureOpen(&g_hud)){
+		SamplerAdd(&g_sampler, "hud", ReadHud, NULL, HUD_CAPTURE_MIN_INTERVAL_MS, HUD_CAPTURE_MAX_INTERVAL_MS);
+	}
+#endif
+#if GAME_MEMORY
+	SamplerAdd(&g_sampler, "game", ReadGame, NULL, GAME_MEMORY_MIN_INTERVAL_MS, GAME_MEMORY_MAX_INTERVAL_MS);
+#endif
+#if HUD_READ || GAME_MEMORY
+	g_minimizeHook = SetWinEventHook(EVENT_SYSTEM_MINIMIZESTART, EVENT_SYSTEM_MINIMIZEEND, NULL, GameMinimizeEvent, 0, 0,
+		WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+	RunSampler(NULL);
+#endif
+#if MEASURE_LATENCY
+	RegisterHotKey(hwnd, LATENCY_HOTKEY_ID, MOD_CONTROL | MOD_SHIFT, 'L');
+#endif
 
 	ShowWindow(hwnd, nCmdShow);
 	UpdateWindow(hwnd);
-	MSG msg;
-	
-	while(1){
 
-		int ret = GetMessage(&msg, NULL, 0, 0);
-
-		if (ret > 0){
-
-			TranslateMessage(&msg);
-			DispatchMessageW(&msg);
-
-		}
-		else{
-			break;
-		}
-	}
-	return (int)msg.wParam;
+	//Messages, the sampler's timer and the tasks of other threads, until WM_DESTROY posts WM_QUIT.
+	int exitCode = EventLoopRun(&g_loop);
+	EventLoopFree(&g_loop);
+	return exitCode;
 }
-
-
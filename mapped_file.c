@@ -0,0 +1,122 @@
+#include <string.h>	//memset
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+
+int MappedFileOpen(MappedFile *mf, const char *path, int sequential){
+
+	memset(mf, 0, sizeof(*mf));
+
+	DWORD flags = FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0);
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+	if (file == INVALID_HANDLE_VALUE){
+		return 0;
+	}
+
+	LARGE_INTEGER size;
+	FILETIME written;
+	if (!GetFileSizeEx(file, &size) || !GetFileTime(file, NULL, NULL, &written)){
+		CloseHandle(file);
+		return 0;
+	}
+	mf->handle = file;
+	mf->size = (size_t)size.QuadPart;
+	mf->modifiedTime = (long long)((((ULONGLONG)written.dwHighDateTime << 32) | written.dwLowDateTime) / 10000000ULL);
+
+	//CreateFileMapping refuses empty files, an empty file is simply data == NULL.
+	if (mf->size == 0){
+		return 1;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping){
+		MappedFileClose(mf);
+		return 0;
+	}
+	mf->mapping = mapping;
+
+	mf->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!mf->data){
+		MappedFileClose(mf);
+		return 0;
+	}
+	return 1;
+}
+
+
+void MappedFileClose(MappedFile *mf){
+	if (mf->data){
+		UnmapViewOfFile(mf->data);
+	}
+	if (mf->mapping){
+		CloseHandle(mf->mapping);
+	}
+	if (mf->handle){
+		CloseHandle(mf->handle);
+	}
+	memset(mf, 0, sizeof(*mf));
+}
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/* On POSIX there is no separate mapping handle, handle holds the file descriptor + 1 (so that 0 still
+ * means "nothing open") and mapping is unused.
+ */
+int MappedFileOpen(MappedFile *mf, const char *path, int sequential){
+
+	memset(mf, 0, sizeof(*mf));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0){
+		close(fd);
+		return 0;
+	}
+	mf->handle = (void *)(long)(fd + 1);
+	mf->size = (size_t)st.st_size;
+	mf->modifiedTime = (long long)st.st_mtime;
+
+	if (mf->size == 0){
+		return 1;
+	}
+
+	void *data = mmap(NULL, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED){
+		MappedFileClose(mf);
+		return 0;
+	}
+	mf->data = data;
+
+	if (sequential){
+		madvise(data, mf->size, MADV_SEQUENTIAL);
+	}
+	return 1;
+}
+
+
+void MappedFileClose(MappedFile *mf){
+	if (mf->data){
+		munmap((void *)mf->data, mf->size);
+	}
+	if (mf->handle){
+		close((int)(long)mf->handle - 1);
+	}
+	memset(mf, 0, sizeof(*mf));
+}
+
+#endif
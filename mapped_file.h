@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+/* Read-only memory mapping of a whole file. Uses CreateFileMapping/MapViewOfFile on Windows and mmap
+ * everywhere else, so the importers can scan files in place without copying them into the heap.
+ *
+ * data : first byte of the file (NULL for an empty file)
+ * size : size of the file in bytes
+ * modifiedTime : last write time of the file (seconds, only used to notice that a file changed)
+ * handle / mapping : platform handles, do not touch
+ */
+typedef struct MappedFile {
+	const unsigned char *data;
+	size_t size;
+	long long modifiedTime;
+	void *handle;
+	void *mapping;
+} MappedFile;
+
+
+/* Maps path into memory. sequential is a hint that the file will be read front to back once.
+ * Returns 1 on success, 0 if the file could not be opened or mapped.
+ */
+int MappedFileOpen(MappedFile *mf, const char *path, int sequential);
+
+
+void MappedFileClose(MappedFile *mf);
+
+#endif
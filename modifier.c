@@ -0,0 +1,248 @@
+#include <stdlib.h>	//malloc, free
+#include <string.h>	//memset, strcmp
+
+#include "modifier.h"
+
+
+/* Built-in buffs. Like chain_data.c these are approximate values to plan with, not the game's own.
+ */
+static const ModifierEffectDef g_fishMarket[] = {
+	{ "Fish",		MODIFIER_Consumption,	-20 },
+};
+static const ModifierEffectDef g_temperanceSociety[] = {
+	{ "Schnapps",		MODIFIER_Consumption,	-25 },
+	{ "Beer",		MODIFIER_Consumption,	-25 },
+};
+static const ModifierEffectDef g_clothier[] = {
+	{ "Work Clothes",	MODIFIER_Consumption,	-20 },
+};
+static const ModifierEffectDef g_coffeeHouse[] = {
+	{ "Coffee",		MODIFIER_Consumption,	-15 },
+	{ "Rum",		MODIFIER_Consumption,	-15 },
+};
+static const ModifierEffectDef g_fishingNets[] = {
+	{ "Fish",		MODIFIER_Productivity,	25 },
+	{ "Fish Oil",		MODIFIER_Supply,	0.5 },
+};
+static const ModifierEffectDef g_spinningJenny[] = {
+	{ "Wool",		MODIFIER_Productivity,	30 },
+	{ "Work Clothes",	MODIFIER_Productivity,	30 },
+};
+static const ModifierEffectDef g_steamStill[] = {
+	{ "Schnapps",		MODIFIER_Productivity,	50 },
+	{ "Potatoes",		MODIFIER_Productivity,	20 },
+};
+static const ModifierEffectDef g_bakersOven[] = {
+	{ "Bread",		MODIFIER_Productivity,	25 },
+	{ "Flour",		MODIFIER_Productivity,	25 },
+};
+static const ModifierEffectDef g_townFountain[] = {
+	{ "Fish",		MODIFIER_Consumption,	-5 },
+	{ "Schnapps",		MODIFIER_Consumption,	-5 },
+};
+static const ModifierEffectDef g_marketSquare[] = {
+	{ "Bread",		MODIFIER_Productivity,	5 },
+	{ "Sausages",		MODIFIER_Productivity,	5 },
+};
+
+#define EFFECTS(array) array, (int)(sizeof(array) / sizeof(array[0]))
+
+static const ModifierBuffDef g_buffs[] = {
+	{ "Fish Market",	MODIFIER_SOURCE_TownHall,	EFFECTS(g_fishMarket) },
+	{ "Temperance Society",	MODIFIER_SOURCE_TownHall,	EFFECTS(g_temperanceSociety) },
+	{ "Clothier",		MODIFIER_SOURCE_TownHall,	EFFECTS(g_clothier) },
+	{ "Coffee House",	MODIFIER_SOURCE_TownHall,	EFFECTS(g_coffeeHouse) },
+	{ "Fishing Nets",	MODIFIER_SOURCE_TradeUnion,	EFFECTS(g_fishingNets) },
+	{ "Spinning Jenny",	MODIFIER_SOURCE_TradeUnion,	EFFECTS(g_spinningJenny) },
+	{ "Steam Still",	MODIFIER_SOURCE_TradeUnion,	EFFECTS(g_steamStill) },
+	{ "Baker's Oven",	MODIFIER_SOURCE_TradeUnion,	EFFECTS(g_bakersOven) },
+	{ "Town Fountain",	MODIFIER_SOURCE_Ornament,	EFFECTS(g_townFountain) },
+	{ "Market Square",	MODIFIER_SOURCE_Ornament,	EFFECTS(g_marketSquare) },
+};
+
+#undef EFFECTS
+
+static const ModifierDefinition g_definition = {
+	g_buffs, (int)(sizeof(g_buffs) / sizeof(g_buffs[0]))
+};
+
+
+#define X_MODIFIER_SOURCE_NAME(source, name) [source] = name,
+static const char *g_sourceNames[MODIFIER_SOURCE_COUNT] = {
+	MODIFIER_SOURCE_TABLE(X_MODIFIER_SOURCE_NAME)
+};
+#undef X_MODIFIER_SOURCE_NAME
+
+
+const ModifierDefinition *ModifierBuiltinDefinition(void){
+	return &g_definition;
+}
+
+
+const char *ModifierSourceName(ModifierSource source){
+	if ((int)source < 0 || source >= MODIFIER_SOURCE_COUNT){
+		return NULL;
+	}
+	return g_sourceNames[source];
+}
+
+
+int ModifierFindBuff(const ModifierDefinition *def, const char *name){
+	for (int i = 0; i < def->buffCount; i++){
+		if (strcmp(def->buffs[i].name, name) == 0){
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+int ModifierLibraryBuild(ModifierLibrary *library, const ModifierDefinition *def, const ChainDefinition *chains,
+	const ChainPlan *plan){
+
+	memset(library, 0, sizeof(*library));
+	if (def->buffCount > MODIFIER_MAX_BUFFS){
+		return 0;
+	}
+
+	int effectCount = 0;
+	for (int b = 0; b < def->buffCount; b++){
+		effectCount += def->buffs[b].effectCount;
+	}
+	library->plan = plan;
+	library->buffCount = def->buffCount;
+	library->effectStart = malloc(sizeof(int) * ((size_t)def->buffCount + 1));
+	library->effects = malloc(sizeof(ModifierEffect) * (size_t)(effectCount ? effectCount : 1));
+	if (!library->effectStart || !library->effects){
+		ModifierLibraryFree(library);
+		return 0;
+	}
+
+	int k = 0;
+	for (int b = 0; b < def->buffCount; b++){
+		library->effectStart[b] = k;
+		for (int i = 0; i < def->buffs[b].effectCount; i++){
+			const ModifierEffectDef *effect = &def->buffs[b].effects[i];
+			int good = ChainFindGood(chains, effect->good);
+			if (good < 0 || good >= plan->goodCount){
+				ModifierLibraryFree(library);
+				return 0;
+			}
+			library->effects[k].slot = plan->goodSlot[good];
+			library->effects[k].kind = effect->kind;
+			library->effects[k].amount = effect->amount;
+			k++;
+		}
+	}
+	library->effectStart[def->buffCount] = k;
+	return 1;
+}
+
+
+void ModifierLibraryFree(ModifierLibrary *library){
+	free(library->effectStart);
+	free(library->effects);
+	memset(library, 0, sizeof(*library));
+}
+
+
+int ModifierSetInit(ModifierSet *set, const ModifierLibrary *library){
+	memset(set, 0, sizeof(*set));
+	set->library = library;
+	size_t n = (size_t)library->plan->goodCount + 1;
+	set->needScale = malloc(n * sizeof(double));
+	set->supply = malloc(n * sizeof(double));
+	set->outputPerMinute = malloc(n * sizeof(double));
+	if (!set->needScale || !set->supply || !set->outputPerMinute){
+		ModifierSetFree(set);
+		return 0;
+	}
+	set->modifiers.needScale = set->needScale;
+	set->modifiers.supply = set->supply;
+	set->modifiers.outputPerMinute = set->outputPerMinute;
+	set->dirty = 1;
+	return 1;
+}
+
+
+void ModifierSetFree(ModifierSet *set){
+	free(set->needScale);
+	free(set->supply);
+	free(set->outputPerMinute);
+	memset(set, 0, sizeof(*set));
+}
+
+
+int ModifierSetEnable(ModifierSet *set, int buff, int on){
+	if (buff < 0 || buff >= set->library->buffCount){
+		return 0;
+	}
+	uint64_t bit = 1ULL << (buff & 63);
+	uint64_t *word = &set->active[buff >> 6];
+	if (((*word & bit) != 0) == (on != 0)){
+		return 0;
+	}
+	*word ^= bit;
+	set->dirty = 1;
+	return 1;
+}
+
+
+int ModifierSetActive(const ModifierSet *set, int buff){
+	if (buff < 0 || buff >= set->library->buffCount){
+		return 0;
+	}
+	return (set->active[buff >> 6] >> (buff & 63)) & 1;
+}
+
+
+const ChainModifiers *ModifierSetCompile(ModifierSet *set){
+
+	if (!set->dirty){
+		return &set->modifiers;
+	}
+
+	const ModifierLibrary *library = set->library;
+	const ChainPlan *plan = library->plan;
+	int n = plan->goodCount;
+
+	//The percentages are summed up in the vectors first and turned into factors in one pass at the end.
+	memset(set->needScale, 0, sizeof(double) * (size_t)n);
+	memset(set->supply, 0, sizeof(double) * (size_t)n);
+	memset(set->outputPerMinute, 0, sizeof(double) * (size_t)n);
+
+	//Buffs in index order, so the same set always sums up the same way whatever order it was built in.
+	for (int w = 0; w < MODIFIER_MAX_BUFFS / 64; w++){
+		for (uint64_t bits = set->active[w]; bits; bits &= bits - 1){
+			int b = w * 64 + __builtin_ctzll(bits);
+			for (int k = library->effectStart[b]; k < library->effectStart[b + 1]; k++){
+				const ModifierEffect *effect = &library->effects[k];
+				switch (effect->kind){
+					case MODIFIER_Consumption:
+						set->needScale[effect->slot] += effect->amount;
+						break;
+					case MODIFIER_Productivity:
+						set->outputPerMinute[effect->slot] += effect->amount;
+						break;
+					case MODIFIER_Supply:
+						set->supply[effect->slot] += effect->amount;
+						break;
+				}
+			}
+		}
+	}
+
+	for (int s = 0; s < n; s++){
+		double scale = 1.0 + set->needScale[s] / 100.0;
+		double productivity = 100.0 + set->outputPerMinute[s];
+		set->needScale[s] = scale > 0.0 ? scale : 0.0;
+		set->supply[s] = set->supply[s] > 0.0 ? set->supply[s] : 0.0;
+		//Factor first: at 100 % it is exactly 1 and the output stays bit for bit that of the plan.
+		set->outputPerMinute[s] = plan->slotOutputPerMinute[s]
+			* ((productivity > MODIFIER_MIN_PRODUCTIVITY ? productivity : MODIFIER_MIN_PRODUCTIVITY) / 100.0);
+	}
+
+	set->dirty = 0;
+	set->compiles++;
+	return &set->modifiers;
+}
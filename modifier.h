@@ -0,0 +1,164 @@
+#ifndef MODIFIER_H
+#define MODIFIER_H
+
+#include <stdint.h>
+
+#include "chain.h"
+
+/* Items and buffs (town hall items, trade union items, ornaments) and what they do to the chains.
+ *
+ * A ModifierDefinition lists the buffs and their effects by good name. ModifierLibraryBuild resolves the
+ * names once into slots of a ChainPlan. Every island then has a ModifierSet: the buffs active on it and,
+ * compiled from them, one flat vector per kind of effect (ChainModifiers) that ChainSolveModified applies
+ * in a pass over the slots. A set only compiles again after its buffs changed, so the per-solve cost does
+ * not depend on how many buffs are active.
+ *
+ * Percentages of the same kind add up, as in the game (two +25 % items are +50 %, not +56.25 %).
+ */
+
+
+//Most buffs a definition may have (the bits of ModifierSet.active).
+#define MODIFIER_MAX_BUFFS 256
+
+//Lowest productivity a building can be brought down to, in percent of 100 %.
+#define MODIFIER_MIN_PRODUCTIVITY 10.0
+
+
+/* X(source, name) : where a buff comes from
+ */
+#define MODIFIER_SOURCE_TABLE(X) \
+	X(MODIFIER_SOURCE_TownHall,	"town hall") \
+	X(MODIFIER_SOURCE_TradeUnion,	"trade union") \
+	X(MODIFIER_SOURCE_Ornament,	"ornament")
+
+#define X_MODIFIER_SOURCE_ENUM(source, name) source,
+typedef enum ModifierSource {
+	MODIFIER_SOURCE_TABLE(X_MODIFIER_SOURCE_ENUM)
+	MODIFIER_SOURCE_COUNT
+} ModifierSource;
+#undef X_MODIFIER_SOURCE_ENUM
+
+
+/* What an effect changes.
+ */
+typedef enum ModifierKind {
+	MODIFIER_Consumption,	//percent more (or less, if negative) of the good the residents consume
+	MODIFIER_Productivity,	//percent more (or less) output of the good's building
+	MODIFIER_Supply		//tons per minute of the good made as an extra output, needing no buildings
+} ModifierKind;
+
+
+/* One effect of a buff.
+ *
+ * good : name of the good in the ChainDefinition
+ * kind / amount : what changes and by how much (percent, or tons per minute for MODIFIER_Supply)
+ */
+typedef struct ModifierEffectDef {
+	const char *good;
+	ModifierKind kind;
+	double amount;
+} ModifierEffectDef;
+
+
+typedef struct ModifierBuffDef {
+	const char *name;
+	ModifierSource source;
+	const ModifierEffectDef *effects;
+	int effectCount;
+} ModifierBuffDef;
+
+
+typedef struct ModifierDefinition {
+	const ModifierBuffDef *buffs;
+	int buffCount;
+} ModifierDefinition;
+
+
+/* An effect resolved to a slot of the plan.
+ */
+typedef struct ModifierEffect {
+	int slot;
+	ModifierKind kind;
+	double amount;
+} ModifierEffect;
+
+
+/* plan : the plan the slots belong to
+ * buffCount : buffs of the definition
+ * effectStart : effects of buff b are effects[effectStart[b]] .. effects[effectStart[b + 1] - 1]
+ */
+typedef struct ModifierLibrary {
+	const ChainPlan *plan;
+	int buffCount;
+	int *effectStart;
+	ModifierEffect *effects;
+} ModifierLibrary;
+
+
+/* library : the buffs the bits of active refer to
+ * active : bit b set if buff b is active
+ * dirty : active changed since the vectors were compiled
+ * compiles : how often the vectors were compiled
+ * needScale / supply / outputPerMinute : the compiled vectors, by slot (see ChainModifiers)
+ * modifiers : points at the three vectors
+ */
+typedef struct ModifierSet {
+	const ModifierLibrary *library;
+	uint64_t active[MODIFIER_MAX_BUFFS / 64];
+	int dirty;
+	uint64_t compiles;
+	double *needScale;
+	double *supply;
+	double *outputPerMinute;
+	ChainModifiers modifiers;
+} ModifierSet;
+
+
+/* The built-in buffs (modifier.c).
+ */
+const ModifierDefinition *ModifierBuiltinDefinition(void);
+
+
+/* Returns the name of a source, or NULL if it is out of range.
+ */
+const char *ModifierSourceName(ModifierSource source);
+
+
+/* Returns the index of the buff with the given name, or -1 if there is none.
+ */
+int ModifierFindBuff(const ModifierDefinition *def, const char *name);
+
+
+/* Resolves the good names of def against chains, the definition plan was built from. Returns 1 on success,
+ * 0 if memory ran out, a good is unknown or def has more than MODIFIER_MAX_BUFFS buffs. The library keeps
+ * a pointer to plan but not to the definitions.
+ */
+int ModifierLibraryBuild(ModifierLibrary *library, const ModifierDefinition *def, const ChainDefinition *chains,
+	const ChainPlan *plan);
+
+
+void ModifierLibraryFree(ModifierLibrary *library);
+
+
+/* Starts with no buff active. Returns 0 if memory ran out. The library has to outlive the set.
+ */
+int ModifierSetInit(ModifierSet *set, const ModifierLibrary *library);
+
+
+void ModifierSetFree(ModifierSet *set);
+
+
+/* Turns buff on or off. Returns 1 if that changed the set (and the vectors have to be compiled again),
+ * 0 if the buff already was in that state or is out of range.
+ */
+int ModifierSetEnable(ModifierSet *set, int buff, int on);
+
+
+int ModifierSetActive(const ModifierSet *set, int buff);
+
+
+/* The vectors of the active buffs for ChainSolveModified, compiled first if the buffs changed.
+ */
+const ChainModifiers *ModifierSetCompile(ModifierSet *set);
+
+#endif
@@ -0,0 +1,43 @@
+#include "msg_names.h"
+
+//A message listed twice (or two names for one value) is a compile error, see controls.c.
+#pragma GCC diagnostic error "-Woverride-init"
+
+
+#define X_MSG_CHECK(msg) _Static_assert((msg) < MSG_NAME_LIMIT, #msg " is above MSG_NAME_LIMIT");
+MSG_NAME_TABLE(X_MSG_CHECK)
+#undef X_MSG_CHECK
+
+#define X_NOTIFY_CHECK(code) _Static_assert((code) >= 0 && (code) < NOTIFY_NAME_LIMIT, #code " is outside NOTIFY_NAME_LIMIT");
+NOTIFY_CODE_TABLE(X_NOTIFY_CHECK)
+#undef X_NOTIFY_CHECK
+
+
+#define X_MSG_NAME(msg) [msg] = L"" #msg,
+static const wchar_t *const g_msgNames[MSG_NAME_LIMIT] = {
+	MSG_NAME_TABLE(X_MSG_NAME)
+};
+#undef X_MSG_NAME
+
+
+#define X_NOTIFY_NAME(code) [code] = L"" #code,
+static const wchar_t *const g_notifyNames[NOTIFY_NAME_LIMIT] = {
+	NOTIFY_CODE_TABLE(X_NOTIFY_NAME)
+};
+#undef X_NOTIFY_NAME
+
+
+const wchar_t *MsgName(UINT msg){
+	if (msg >= MSG_NAME_LIMIT || !g_msgNames[msg]){
+		return L"(unknown msg)";
+	}
+	return g_msgNames[msg];
+}
+
+
+const wchar_t *NotifyCodeName(int code){
+	if (code < 0 || code >= NOTIFY_NAME_LIMIT || !g_notifyNames[code]){
+		return L"(unknown notify code)";
+	}
+	return g_notifyNames[code];
+}
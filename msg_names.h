@@ -0,0 +1,62 @@
+#ifndef MSG_NAMES_H
+#define MSG_NAMES_H
+
+#include <windows.h>
+
+/* Readable names for window messages and button notification codes, purely for debugging and logs.
+ * Both lookups are generated from the lists below and index a dense array instead of walking a switch.
+ */
+
+
+//Messages at or above this value (WM_USER and up) are never named.
+#define MSG_NAME_LIMIT WM_USER
+
+//Notification codes at or above this value are never named.
+#define NOTIFY_NAME_LIMIT 8
+
+
+/* X(msg)
+ */
+#define MSG_NAME_TABLE(X) \
+	X(WM_CREATE) \
+	X(WM_DESTROY) \
+	X(WM_MOVE) \
+	X(WM_SIZE) \
+	X(WM_SETFOCUS) \
+	X(WM_KILLFOCUS) \
+	X(WM_PAINT) \
+	X(WM_CLOSE) \
+	X(WM_ERASEBKGND) \
+	X(WM_SETCURSOR) \
+	X(WM_NOTIFY) \
+	X(WM_NCHITTEST) \
+	X(WM_KEYDOWN) \
+	X(WM_KEYUP) \
+	X(WM_CHAR) \
+	X(WM_COMMAND) \
+	X(WM_TIMER) \
+	X(WM_MOUSEMOVE) \
+	X(WM_LBUTTONDOWN) \
+	X(WM_LBUTTONUP)
+
+
+/* X(code)
+ */
+#define NOTIFY_CODE_TABLE(X) \
+	X(BN_CLICKED) \
+	X(BN_DOUBLECLICKED) \
+	X(BN_SETFOCUS) \
+	X(BN_KILLFOCUS)
+
+
+/* Takes msg (the numeric message code) and returns a readable string, or L"(unknown msg)".
+ */
+const wchar_t *MsgName(UINT msg);
+
+
+/* BN_* codes are the button notification codes delivered through WM_COMMAND. Returns L"(unknown notify code)"
+ * for anything not in NOTIFY_CODE_TABLE.
+ */
+const wchar_t *NotifyCodeName(int code);
+
+#endif
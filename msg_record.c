@@ -0,0 +1,171 @@
+#include <stdlib.h>	//malloc, realloc, free
+#include <string.h>	//memcmp, memset
+
+#include "msg_record.h"
+
+
+static const char *g_statusNames[] = {
+	[MSG_RECORD_Ok]			= "ok",
+	[MSG_RECORD_OpenFailed]		= "cannot open the file",
+	[MSG_RECORD_NotRecording]	= "not a message recording",
+	[MSG_RECORD_Truncated]		= "file ends inside a record",
+	[MSG_RECORD_OutOfMemory]	= "out of memory"
+};
+
+
+const char *MsgRecordStatusName(MsgRecordStatus status){
+	if ((int)status < 0 || status > MSG_RECORD_OutOfMemory){
+		return "(unknown)";
+	}
+	return g_statusNames[status];
+}
+
+
+static uint64_t ZigZag(int64_t v){
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t UnZigZag(uint64_t v){
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+
+//Writes v as a LEB128 varint to out, returns the bytes used (at most 10).
+static int PutVarint(unsigned char *out, uint64_t v){
+	int n = 0;
+	while (v >= 0x80){
+		out[n++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	out[n++] = (unsigned char)v;
+	return n;
+}
+
+
+//Reads a varint from p (end is one past the data). Returns the bytes used, 0 if the data ends inside it.
+static int GetVarint(const unsigned char *p, const unsigned char *end, uint64_t *v){
+	uint64_t value = 0;
+	for (int i = 0; i < 10 && p + i < end; i++){
+		value |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+		if (!(p[i] & 0x80)){
+			*v = value;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+
+int MsgRecorderOpen(MsgRecorder *recorder, const char *path){
+
+	unsigned char head[16] = MSG_RECORD_MAGIC;
+
+	memset(recorder, 0, sizeof(*recorder));
+	recorder->file = fopen(path, "wb");
+	if (!recorder->file){
+		return 0;
+	}
+	head[8] = MSG_RECORD_VERSION;
+	if (fwrite(head, 1, 16, recorder->file) != 16){
+		MsgRecorderClose(recorder);
+		return 0;
+	}
+	return 1;
+}
+
+
+int MsgRecorderWrite(MsgRecorder *recorder, const MsgRecord *record){
+
+	unsigned char bytes[40];
+	int n = 0;
+
+	if (!recorder->file){
+		return 0;
+	}
+	n += PutVarint(bytes + n, ZigZag((int32_t)(record->timeMs - recorder->lastTimeMs)));
+	n += PutVarint(bytes + n, record->message);
+	n += PutVarint(bytes + n, record->wParam);
+	n += PutVarint(bytes + n, ZigZag(record->lParam));
+	recorder->lastTimeMs = record->timeMs;
+	recorder->count++;
+	return fwrite(bytes, 1, (size_t)n, recorder->file) == (size_t)n;
+}
+
+
+void MsgRecorderClose(MsgRecorder *recorder){
+	if (recorder->file){
+		fclose(recorder->file);
+		recorder->file = NULL;
+	}
+}
+
+
+MsgRecordStatus MsgRecordingLoad(MsgRecording *out, const char *path){
+
+	memset(out, 0, sizeof(*out));
+
+	FILE *f = fopen(path, "rb");
+	if (!f){
+		return MSG_RECORD_OpenFailed;
+	}
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	unsigned char *data = size > 0 ? malloc((size_t)size) : NULL;
+	if (size > 0 && !data){
+		fclose(f);
+		return MSG_RECORD_OutOfMemory;
+	}
+	size_t got = size > 0 ? fread(data, 1, (size_t)size, f) : 0;
+	fclose(f);
+
+	if (got < 16 || memcmp(data, MSG_RECORD_MAGIC, 8) != 0 || data[8] != MSG_RECORD_VERSION){
+		free(data);
+		return MSG_RECORD_NotRecording;
+	}
+
+	//Every record is at least 4 bytes, which bounds the count before anything is decoded.
+	size_t capacity = (got - 16) / 4 + 1;
+	out->records = malloc(capacity * sizeof(MsgRecord));
+	if (!out->records){
+		free(data);
+		return MSG_RECORD_OutOfMemory;
+	}
+
+	MsgRecordStatus status = MSG_RECORD_Ok;
+	const unsigned char *p = data + 16;
+	const unsigned char *end = data + got;
+	uint32_t timeMs = 0;
+	while (p < end){
+		uint64_t field[4];
+		const unsigned char *q = p;
+		int i;
+		for (i = 0; i < 4; i++){
+			int used = GetVarint(q, end, &field[i]);
+			if (!used){
+				break;
+			}
+			q += used;
+		}
+		if (i < 4){
+			status = MSG_RECORD_Truncated;
+			break;
+		}
+		MsgRecord *record = &out->records[out->count++];
+		timeMs += (uint32_t)UnZigZag(field[0]);
+		record->timeMs = timeMs;
+		record->message = (uint32_t)field[1];
+		record->wParam = field[2];
+		record->lParam = UnZigZag(field[3]);
+		p = q;
+	}
+
+	free(data);
+	return status;
+}
+
+
+void MsgRecordingFree(MsgRecording *recording){
+	free(recording->records);
+	memset(recording, 0, sizeof(*recording));
+}
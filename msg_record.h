@@ -0,0 +1,88 @@
+#ifndef MSG_RECORD_H
+#define MSG_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Recordings of the messages the main window handled, to replay a session without Windows.
+ *
+ * main_noDebug.c started with "--record <file>" writes every message MainWndProc receives (message, wParam,
+ * lParam and GetMessageTime). Handles and pointers mean nothing in another session, so the recorder stores
+ * what the handler would read through them instead: WM_COMMAND keeps the value of the control (the spinner
+ * position for an ID_FLD_* field, otherwise 0) in lParam, WM_NOTIFY keeps 0. anno_calc replay feeds a
+ * recording to the overlay logic (overlay.h); anno_calc gen-session makes synthetic ones.
+ *
+ * File layout: "ANNOMSGS", u32 version, u32 0 (little endian), then one record after the other, each as
+ * four LEB128 varints: time since the record before in ms (zigzag, message times can go backwards for sent
+ * messages), message, wParam, lParam (zigzag). A mouse move takes about 6 bytes.
+ */
+
+
+#define MSG_RECORD_MAGIC "ANNOMSGS"
+#define MSG_RECORD_VERSION 1
+
+
+typedef enum MsgRecordStatus {
+	MSG_RECORD_Ok,
+	MSG_RECORD_OpenFailed,
+	MSG_RECORD_NotRecording,	//no header at the start
+	MSG_RECORD_Truncated,		//the file ends inside a record (the records before it are kept)
+	MSG_RECORD_OutOfMemory
+} MsgRecordStatus;
+
+
+/* timeMs : GetMessageTime of the message
+ */
+typedef struct MsgRecord {
+	uint32_t timeMs;
+	uint32_t message;
+	uint64_t wParam;
+	int64_t lParam;
+} MsgRecord;
+
+
+/* file : NULL while not recording
+ * lastTimeMs : time of the record before, the next time is stored relative to it
+ * count : records written
+ */
+typedef struct MsgRecorder {
+	FILE *file;
+	uint32_t lastTimeMs;
+	uint64_t count;
+} MsgRecorder;
+
+
+/* records / count : everything a recording held, in order
+ */
+typedef struct MsgRecording {
+	MsgRecord *records;
+	size_t count;
+} MsgRecording;
+
+
+/* Creates the file and writes the header. Returns 0 if the file cannot be created.
+ */
+int MsgRecorderOpen(MsgRecorder *recorder, const char *path);
+
+
+/* Appends a record (to the stdio buffer, the file is written in blocks). Returns 0 on a write error.
+ */
+int MsgRecorderWrite(MsgRecorder *recorder, const MsgRecord *record);
+
+
+void MsgRecorderClose(MsgRecorder *recorder);
+
+
+/* Reads a whole recording into memory, so a replay only measures the handling. On MSG_RECORD_Truncated the
+ * complete records are still in out.
+ */
+MsgRecordStatus MsgRecordingLoad(MsgRecording *out, const char *path);
+
+
+void MsgRecordingFree(MsgRecording *recording);
+
+
+const char *MsgRecordStatusName(MsgRecordStatus status);
+
+#endif
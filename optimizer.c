@@ -0,0 +1,437 @@
+#include <limits.h>	//LONG_MAX
+#include <math.h>	//ceil
+#include <stdlib.h>	//malloc, calloc, free
+#include <string.h>	//memset, memcpy, memcmp, strcmp
+
+#include "optimizer.h"
+
+
+//Demand below this counts as none, and building counts are rounded up only past it (float noise).
+#define OPT_EPSILON 1e-9
+
+
+static const char *g_statusNames[] = {
+	[OPT_Ok]		= "ok",
+	[OPT_Infeasible]	= "infeasible with these limits"
+};
+
+
+const char *OptStatusName(OptStatus status){
+	if ((int)status < 0 || status > OPT_Infeasible){
+		return "(unknown)";
+	}
+	return g_statusNames[status];
+}
+
+
+//Whole buildings for an amount, or a bound in buildings rounded up.
+static long WholeUp(double value){
+	if (value <= OPT_EPSILON){
+		return 0;
+	}
+	return (long)ceil(value - OPT_EPSILON);
+}
+
+
+static void CacheFree(Optimizer *opt){
+	for (int i = 0; i < OPT_CACHE_SIZE; i++){
+		free(opt->cache[i].residents);
+		free(opt->cache[i].buildings);
+		free(opt->cache[i].produced);
+	}
+}
+
+
+void OptimizerFree(Optimizer *opt){
+	CacheFree(opt);
+	free(opt->recipes);
+	free(opt->recipeStart);
+	free(opt->slotUnitCost);
+	free(opt->levels);
+	free(opt->counts);
+	free(opt->amounts);
+	memset(opt, 0, sizeof(*opt));
+}
+
+
+static int CheckAlternative(const ChainAlternativeDef *alt, const ChainPlan *plan){
+	if (alt->good < 0 || alt->good >= plan->goodCount || alt->cycleSeconds <= 0.0 || alt->inputCount < 0 ||
+	    alt->inputCount > CHAIN_MAX_INPUTS){
+		return 0;
+	}
+	for (int i = 0; i < alt->inputCount; i++){
+		int input = alt->inputs[i].good;
+		if (input < 0 || input >= plan->goodCount || plan->goodSlot[input] <= plan->goodSlot[alt->good]){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+//Puts the recipes of every slot in order of unit cost, which needs the inputs' costs, so raw materials first.
+static void PriceRecipes(Optimizer *opt){
+	for (int s = opt->slotCount - 1; s >= 0; s--){
+		int first = opt->recipeStart[s];
+		int last = opt->recipeStart[s + 1];
+
+		for (int r = first; r < last; r++){
+			OptRecipe *recipe = &opt->recipes[r];
+			recipe->unitCost = 1.0 / recipe->outputPerMinute;
+			for (int i = 0; i < recipe->inputCount; i++){
+				recipe->unitCost += recipe->inputFactor[i] * opt->slotUnitCost[recipe->inputSlot[i]];
+			}
+		}
+		for (int r = first + 1; r < last; r++){
+			OptRecipe moved = opt->recipes[r];
+			int i = r;
+			while (i > first && opt->recipes[i - 1].unitCost > moved.unitCost){
+				opt->recipes[i] = opt->recipes[i - 1];
+				i--;
+			}
+			opt->recipes[i] = moved;
+		}
+		opt->slotUnitCost[s] = opt->recipes[first].unitCost;
+	}
+}
+
+
+int OptimizerInit(Optimizer *opt, const ChainDefinition *def, const ChainPlan *plan){
+
+	memset(opt, 0, sizeof(*opt));
+	opt->plan = plan;
+	opt->slotCount = plan->goodCount;
+
+	int n = plan->goodCount;
+	for (int a = 0; a < def->alternativeCount; a++){
+		if (!CheckAlternative(&def->alternatives[a], plan)){
+			return 0;
+		}
+	}
+
+	opt->recipeCount = n + def->alternativeCount;
+	opt->recipes = calloc((size_t)opt->recipeCount, sizeof(OptRecipe));
+	opt->recipeStart = calloc((size_t)n + 1, sizeof(int));
+	opt->slotUnitCost = calloc((size_t)n + 1, sizeof(double));
+	opt->levels = calloc((size_t)(n + 1) * (size_t)n + 1, sizeof(double));
+	opt->counts = calloc((size_t)opt->recipeCount, sizeof(long));
+	opt->amounts = calloc((size_t)opt->recipeCount, sizeof(double));
+	int *fill = calloc((size_t)n + 1, sizeof(int));
+	int cacheOk = 1;
+	for (int i = 0; i < OPT_CACHE_SIZE; i++){
+		opt->cache[i].residents = calloc((size_t)plan->tierCount + 1, sizeof(double));
+		opt->cache[i].buildings = calloc((size_t)opt->recipeCount, sizeof(long));
+		opt->cache[i].produced = calloc((size_t)opt->recipeCount, sizeof(double));
+		cacheOk = cacheOk && opt->cache[i].residents && opt->cache[i].buildings && opt->cache[i].produced;
+	}
+	if (!opt->recipes || !opt->recipeStart || !opt->slotUnitCost || !opt->levels || !opt->counts ||
+	    !opt->amounts || !fill || !cacheOk){
+		free(fill);
+		OptimizerFree(opt);
+		return 0;
+	}
+
+	//Every slot has its own building plus the alternatives for its good.
+	for (int s = 0; s < n; s++){
+		opt->recipeStart[s + 1] = 1;
+	}
+	for (int a = 0; a < def->alternativeCount; a++){
+		opt->recipeStart[plan->goodSlot[def->alternatives[a].good] + 1]++;
+	}
+	for (int s = 0; s < n; s++){
+		opt->recipeStart[s + 1] += opt->recipeStart[s];
+		fill[s] = opt->recipeStart[s];
+	}
+
+	for (int s = 0; s < n; s++){
+		int g = plan->slotGood[s];
+		OptRecipe *recipe = &opt->recipes[fill[s]++];
+		recipe->good = g;
+		recipe->buildingName = def->goods[g].buildingName;
+		recipe->outputPerMinute = plan->slotOutputPerMinute[s];
+		recipe->limit = OPT_UNLIMITED;
+		for (int e = plan->edgeStart[s]; e < plan->edgeStart[s + 1]; e++){
+			recipe->inputSlot[recipe->inputCount] = plan->edgeSlot[e];
+			recipe->inputFactor[recipe->inputCount] = plan->edgeFactor[e];
+			recipe->inputCount++;
+		}
+	}
+	for (int a = 0; a < def->alternativeCount; a++){
+		const ChainAlternativeDef *alt = &def->alternatives[a];
+		OptRecipe *recipe = &opt->recipes[fill[plan->goodSlot[alt->good]]++];
+		recipe->good = alt->good;
+		recipe->buildingName = alt->buildingName;
+		recipe->outputPerMinute = 60.0 / alt->cycleSeconds;
+		recipe->limit = OPT_UNLIMITED;
+		for (int i = 0; i < alt->inputCount; i++){
+			recipe->inputSlot[i] = plan->goodSlot[alt->inputs[i].good];
+			recipe->inputFactor[i] = alt->inputs[i].amount;
+		}
+		recipe->inputCount = alt->inputCount;
+	}
+	free(fill);
+
+	PriceRecipes(opt);
+	return 1;
+}
+
+
+int OptimizerFindRecipe(const Optimizer *opt, const char *buildingName){
+	for (int r = 0; r < opt->recipeCount; r++){
+		if (strcmp(opt->recipes[r].buildingName, buildingName) == 0){
+			return r;
+		}
+	}
+	return -1;
+}
+
+
+void OptimizerClearCache(Optimizer *opt){
+	for (int i = 0; i < OPT_CACHE_SIZE; i++){
+		opt->cache[i].used = 0;
+	}
+	opt->cacheNext = 0;
+}
+
+
+void OptimizerSetLimit(Optimizer *opt, int recipe, long limit){
+	opt->recipes[recipe].limit = limit < 0 ? OPT_UNLIMITED : limit;
+	OptimizerClearCache(opt);
+}
+
+
+int OptResultInit(OptResult *result, const Optimizer *opt){
+	memset(result, 0, sizeof(*result));
+	result->buildings = calloc((size_t)opt->recipeCount + 1, sizeof(long));
+	result->produced = calloc((size_t)opt->recipeCount + 1, sizeof(double));
+	if (!result->buildings || !result->produced){
+		OptResultFree(result);
+		return 0;
+	}
+	return 1;
+}
+
+
+void OptResultFree(OptResult *result){
+	free(result->buildings);
+	free(result->produced);
+	result->buildings = NULL;
+	result->produced = NULL;
+}
+
+
+static int WithinLimit(const OptRecipe *recipe, long count){
+	return recipe->limit == OPT_UNLIMITED || count <= recipe->limit;
+}
+
+
+static void Search(Optimizer *opt, int s, long cost, int depth);
+
+
+/* Splits the demand left of slot s between recipes r .. last of the slot, trying the most buildings of
+ * the cheaper recipe first. tail is the stored sub-chain cost of the demand already on the later slots.
+ */
+static void Branch(Optimizer *opt, int s, int r, double left, long cost, int depth, double tail){
+
+	int last = opt->recipeStart[s + 1] - 1;
+	const OptRecipe *recipe = &opt->recipes[r];
+
+	if (opt->nodes >= OPT_NODE_BUDGET){
+		return;
+	}
+	opt->nodes++;
+
+	if (r == last){
+		long count = WholeUp(left / recipe->outputPerMinute);
+		if (!WithinLimit(recipe, count)){
+			return;
+		}
+		opt->counts[r] = count;
+		opt->amounts[r] = left > OPT_EPSILON ? left : 0.0;
+		cost += count;
+
+		const double *required = opt->levels + (size_t)depth * (size_t)opt->slotCount;
+		double *next = opt->levels + (size_t)(depth + 1) * (size_t)opt->slotCount;
+		memcpy(next, required, sizeof(double) * (size_t)opt->slotCount);
+		for (int k = opt->recipeStart[s]; k <= last; k++){
+			const OptRecipe *used = &opt->recipes[k];
+			for (int i = 0; i < used->inputCount; i++){
+				next[used->inputSlot[i]] += opt->amounts[k] * used->inputFactor[i];
+			}
+		}
+
+		double bound = 0.0;
+		for (int t = s + 1; t < opt->slotCount; t++){
+			bound += next[t] * opt->slotUnitCost[t];
+		}
+		if (cost + WholeUp(bound) >= opt->best){
+			return;
+		}
+		Search(opt, s + 1, cost, depth + 1);
+		return;
+	}
+
+	long most = WholeUp(left / recipe->outputPerMinute);
+	if (!WithinLimit(recipe, most)){
+		most = recipe->limit;
+	}
+
+	double inputCost = recipe->unitCost - 1.0 / recipe->outputPerMinute;
+	double nextCost = opt->recipes[r + 1].unitCost;
+
+	for (long count = most; count >= 0; count--){
+		double made = (double)count * recipe->outputPerMinute;
+		if (made > left){
+			made = left;
+		}
+
+		/* Recipes are sorted by unit cost, so below the first (rounded up) count each building less only
+		 * moves demand to a recipe that is not cheaper and the bound can only grow.
+		 */
+		double bound = (double)(cost + count) + tail + made * inputCost + (left - made) * nextCost;
+		if (WholeUp(bound) >= opt->best){
+			if (count < most){
+				break;
+			}
+			continue;
+		}
+
+		opt->counts[r] = count;
+		opt->amounts[r] = made;
+		Branch(opt, s, r + 1, left - made, cost + count, depth, tail);
+	}
+}
+
+
+/* Walks the slots from s on with the demand row of the given depth. Slots without a choice are settled in
+ * place; the first slot with a choice hands over to Branch, which continues the walk one depth further down.
+ */
+static void Search(Optimizer *opt, int s, long cost, int depth){
+
+	double *required = opt->levels + (size_t)depth * (size_t)opt->slotCount;
+
+	for (; s < opt->slotCount; s++){
+		int first = opt->recipeStart[s];
+		int last = opt->recipeStart[s + 1];
+		double amount = required[s];
+
+		if (amount <= OPT_EPSILON){
+			for (int r = first; r < last; r++){
+				opt->counts[r] = 0;
+				opt->amounts[r] = 0.0;
+			}
+			continue;
+		}
+
+		if (last - first == 1){
+			const OptRecipe *recipe = &opt->recipes[first];
+			long count = WholeUp(amount / recipe->outputPerMinute);
+			if (!WithinLimit(recipe, count)){
+				return;
+			}
+			opt->counts[first] = count;
+			opt->amounts[first] = amount;
+			cost += count;
+			for (int i = 0; i < recipe->inputCount; i++){
+				required[recipe->inputSlot[i]] += amount * recipe->inputFactor[i];
+			}
+			continue;
+		}
+
+		double tail = 0.0;
+		for (int t = s + 1; t < opt->slotCount; t++){
+			tail += required[t] * opt->slotUnitCost[t];
+		}
+		Branch(opt, s, first, amount, cost, depth, tail);
+		return;
+	}
+
+	if (cost < opt->best){
+		opt->best = cost;
+		memcpy(opt->out->buildings, opt->counts, sizeof(long) * (size_t)opt->recipeCount);
+		memcpy(opt->out->produced, opt->amounts, sizeof(double) * (size_t)opt->recipeCount);
+	}
+}
+
+
+static const OptCacheEntry *CacheFind(const Optimizer *opt, const double *residents){
+	size_t bytes = sizeof(double) * (size_t)opt->plan->tierCount;
+	for (int i = 0; i < OPT_CACHE_SIZE; i++){
+		if (opt->cache[i].used && memcmp(opt->cache[i].residents, residents, bytes) == 0){
+			return &opt->cache[i];
+		}
+	}
+	return NULL;
+}
+
+
+static void CacheStore(Optimizer *opt, const double *residents, const OptResult *result){
+	OptCacheEntry *entry = &opt->cache[opt->cacheNext];
+	opt->cacheNext = (opt->cacheNext + 1) % OPT_CACHE_SIZE;
+
+	memcpy(entry->residents, residents, sizeof(double) * (size_t)opt->plan->tierCount);
+	memcpy(entry->buildings, result->buildings, sizeof(long) * (size_t)opt->recipeCount);
+	memcpy(entry->produced, result->produced, sizeof(double) * (size_t)opt->recipeCount);
+	entry->totalBuildings = result->totalBuildings;
+	entry->lowerBound = result->lowerBound;
+	entry->optimal = result->optimal;
+	entry->status = result->status;
+	entry->used = 1;
+}
+
+
+OptStatus OptimizerSolve(Optimizer *opt, const double *residents, OptResult *out){
+
+	const ChainPlan *plan = opt->plan;
+
+	const OptCacheEntry *hit = CacheFind(opt, residents);
+	if (hit){
+		memcpy(out->buildings, hit->buildings, sizeof(long) * (size_t)opt->recipeCount);
+		memcpy(out->produced, hit->produced, sizeof(double) * (size_t)opt->recipeCount);
+		out->totalBuildings = hit->totalBuildings;
+		out->lowerBound = hit->lowerBound;
+		out->optimal = hit->optimal;
+		out->status = hit->status;
+		out->nodes = 0;
+		out->cached = 1;
+		return out->status;
+	}
+
+	double *required = opt->levels;
+	memset(required, 0, sizeof(double) * (size_t)opt->slotCount);
+	for (int t = 0; t < plan->tierCount; t++){
+		for (int k = plan->needStart[t]; k < plan->needStart[t + 1]; k++){
+			required[plan->needSlot[k]] += residents[t] * plan->needRate[k];
+		}
+	}
+
+	double bound = 0.0;
+	for (int s = 0; s < opt->slotCount; s++){
+		bound += required[s] * opt->slotUnitCost[s];
+	}
+
+	memset(out->buildings, 0, sizeof(long) * (size_t)opt->recipeCount);
+	memset(out->produced, 0, sizeof(double) * (size_t)opt->recipeCount);
+	out->lowerBound = WholeUp(bound);
+	out->cached = 0;
+
+	opt->out = out;
+	opt->best = LONG_MAX;
+	opt->nodes = 0;
+	Search(opt, 0, 0, 0);
+	opt->out = NULL;
+
+	out->nodes = opt->nodes;
+	out->optimal = opt->nodes < OPT_NODE_BUDGET;
+	if (opt->best == LONG_MAX){
+		out->status = OPT_Infeasible;
+		out->totalBuildings = 0;
+	}
+	else{
+		out->status = OPT_Ok;
+		out->totalBuildings = opt->best;
+	}
+
+	CacheStore(opt, residents, out);
+	return out->status;
+}
@@ -0,0 +1,169 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stdint.h>
+
+#include "chain.h"
+
+/* Smallest whole number of production buildings that supplies a target population.
+ *
+ * ChainSolve answers with fractional buildings and one fixed building per good. The optimizer answers with
+ * whole buildings, picks between the buildings that make the same good (ChainDefinition.alternatives) and
+ * respects caps on how many of a building can be placed (deposits, coast line).
+ *
+ * Every good and building is a "recipe". Before any query the cheapest fractional cost of one ton per minute
+ * of every good, whole sub-chain included, is worked out once from the raw materials up and kept. A query
+ * walks the goods in ChainPlan order; goods made by a single uncapped building just get enough buildings for
+ * their demand, goods with a choice branch over how many of each building to use. A branch is dropped as soon
+ * as its buildings so far plus the stored sub-chain costs of the remaining demand cannot beat the best answer
+ * found, and the first branch tried is the cheapest-first split, so the best answer is usually found at once.
+ *
+ * The search stops after OPT_NODE_BUDGET branches, which keeps a query in the low milliseconds even for a
+ * population of every tier; OptResult.optimal says whether the answer was proven. The last OPT_CACHE_SIZE
+ * queries are kept, since a spinner going up and down asks the same questions again.
+ */
+
+
+//Branches a query may try before it returns the best answer so far.
+#define OPT_NODE_BUDGET 200000
+
+//Queries remembered per optimizer.
+#define OPT_CACHE_SIZE 8
+
+//Limit of a recipe that can be built any number of times.
+#define OPT_UNLIMITED (-1)
+
+
+typedef enum OptStatus {
+	OPT_Ok,
+	OPT_Infeasible		//the limits leave a good that cannot be made in the needed amount
+} OptStatus;
+
+
+/* One way of making a good.
+ *
+ * good : index of the good in ChainDefinition.goods
+ * buildingName : the building
+ * outputPerMinute : tons per minute one building makes
+ * unitCost : fractional buildings per ton per minute of the good, inputs included
+ * limit : most buildings that may be used, OPT_UNLIMITED for no limit
+ * inputSlot / inputFactor / inputCount : plan slot and tons per ton of output of each input
+ */
+typedef struct OptRecipe {
+	int good;
+	const char *buildingName;
+	double outputPerMinute;
+	double unitCost;
+	long limit;
+	int inputSlot[CHAIN_MAX_INPUTS];
+	double inputFactor[CHAIN_MAX_INPUTS];
+	int inputCount;
+} OptRecipe;
+
+
+/* An answer, arrays indexed like Optimizer.recipes.
+ *
+ * buildings : whole buildings of each recipe
+ * produced : tons per minute each recipe has to make (utilisation = produced / (buildings * output))
+ * totalBuildings : sum of buildings
+ * lowerBound : fractional buildings of the whole chain rounded up, no answer can be below this
+ * optimal : the search finished, no smaller answer exists
+ * nodes : branches tried (0 for an answer from the cache)
+ * cached : the answer was remembered from an earlier query
+ */
+typedef struct OptResult {
+	OptStatus status;
+	long *buildings;
+	double *produced;
+	long totalBuildings;
+	long lowerBound;
+	int optimal;
+	uint64_t nodes;
+	int cached;
+} OptResult;
+
+
+typedef struct OptCacheEntry {
+	double *residents;
+	long *buildings;
+	double *produced;
+	long totalBuildings;
+	long lowerBound;
+	int optimal;
+	OptStatus status;
+	int used;
+} OptCacheEntry;
+
+
+/* plan : the chains the recipes belong to, must outlive the optimizer
+ * recipes / recipeCount : all recipes, grouped by plan slot, cheapest first within a slot
+ * recipeStart : recipes of slot s are recipeStart[s] .. recipeStart[s + 1] - 1
+ * slotUnitCost : cheapest unitCost of each slot
+ * levels : one demand row per search depth
+ * counts / amounts : the recipe split of the branch being searched
+ * best / nodes / out : buildings of the best answer so far, branches tried and where answers go
+ * cache / cacheNext : remembered queries, replaced round robin
+ */
+typedef struct Optimizer {
+	const ChainPlan *plan;
+	int slotCount;
+
+	OptRecipe *recipes;
+	int recipeCount;
+	int *recipeStart;
+	double *slotUnitCost;
+
+	double *levels;
+	long *counts;
+	double *amounts;
+	long best;
+	uint64_t nodes;
+	OptResult *out;
+
+	OptCacheEntry cache[OPT_CACHE_SIZE];
+	int cacheNext;
+} Optimizer;
+
+
+/* Collects the recipes of def (whose flattened form is plan) and works out their sub-chain costs. Returns 0
+ * if memory ran out or an alternative building does not fit the plan's order (its inputs must come after
+ * the good it makes).
+ */
+int OptimizerInit(Optimizer *opt, const ChainDefinition *def, const ChainPlan *plan);
+
+
+void OptimizerFree(Optimizer *opt);
+
+
+/* Index of the recipe using the named building, or -1.
+ */
+int OptimizerFindRecipe(const Optimizer *opt, const char *buildingName);
+
+
+/* Caps a recipe at limit buildings (OPT_UNLIMITED to remove the cap). Forgets the remembered queries.
+ */
+void OptimizerSetLimit(Optimizer *opt, int recipe, long limit);
+
+
+/* Allocates the arrays of a result. Returns 0 if memory ran out.
+ */
+int OptResultInit(OptResult *result, const Optimizer *opt);
+
+
+void OptResultFree(OptResult *result);
+
+
+/* Finds the fewest buildings for the given residents of every tier (indexed like ChainDefinition.tiers).
+ * The answer is in out; its status is also returned.
+ */
+OptStatus OptimizerSolve(Optimizer *opt, const double *residents, OptResult *out);
+
+
+/* Forgets the remembered queries, so the next solve runs the search again.
+ */
+void OptimizerClearCache(Optimizer *opt);
+
+
+const char *OptStatusName(OptStatus status);
+
+#endif
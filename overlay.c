@@ -0,0 +1,110 @@
+#include <string.h>	//memset
+#include <wchar.h>	//swprintf
+
+#include "overlay.h"
+
+
+void OverlayInit(OverlayState *state){
+	memset(state, 0, sizeof(*state));
+	DemandAggInit(&state->farmerBlocks);
+	for (int i = 0; i < SPINNER_COUNT; i++){
+		state->spinnerPos[i] = ControlSpinnerInfo(i)->initialVal;
+	}
+}
+
+
+void OverlayFree(OverlayState *state){
+	DemandAggFree(&state->farmerBlocks);
+}
+
+
+HousingBlock OverlayNextBlock(const OverlayState *state){
+	HousingBlock block;
+	block.width  = state->spinnerPos[SPINNER_INDEX_ID_SPN_HousingWidth];
+	block.length = state->spinnerPos[SPINNER_INDEX_ID_SPN_HousingLength];
+	return block;
+}
+
+
+int OverlayCommand(OverlayState *state, int controlId, int notifyCode, long value){
+
+	if (notifyCode == OVERLAY_BN_CLICKED){
+
+		if (controlId == ID_BTN_TEST){
+			return OVERLAY_ShowTestMessage;
+		}
+		//Adds a block with the size currently set in the spinners.
+		else if (controlId == ID_BTN_FarmerBlockInc){
+			HousingBlock block = OverlayNextBlock(state);
+			DemandAggAdd(&state->farmerBlocks, &block);
+			return OVERLAY_RefreshDisplays;
+		}
+		//Removes the most recently added block.
+		else if (controlId == ID_BTN_FarmerBlockDec){
+			return DemandAggRemoveLast(&state->farmerBlocks) ? OVERLAY_RefreshDisplays : 0;
+		}
+	}
+	//The text field of a spinner changed, by the arrows or by typing.
+	else if (notifyCode == OVERLAY_EN_CHANGE){
+		int index = ControlSpinnerIndex(controlId);
+		if (index >= 0){
+			const SpinnerInfo *info = ControlSpinnerInfo(index);
+			state->spinnerPos[index] = value < info->minVal ? info->minVal : value > info->maxVal ? info->maxVal : (int)value;
+		}
+	}
+	return 0;
+}
+
+
+void OverlayDemand(const OverlayState *state, Demand *out){
+	DemandAggResult(&state->farmerBlocks, out);
+	if (state->formulas){
+		DemandFormulasApply(state->formulas, out);
+	}
+}
+
+
+size_t OverlayFormatDisplay(Good good, double buildings, wchar_t *out, size_t size){
+	int chars = swprintf(out, size, L"%ls\r\n%.2f buildings", ControlDisplayLabel(good), buildings);
+	return chars > 0 ? (size_t)chars : 0;
+}
+
+
+size_t OverlayDisplayText(const OverlayState *state, Good good, wchar_t *out, size_t size){
+
+	Demand demand;
+	OverlayDemand(state, &demand);
+	return OverlayFormatDisplay(good, demand.buildings[good], out, size);
+}
+
+
+void OverlayReplay(OverlayState *state, const MsgRecord *records, size_t count, OverlayReplayStats *stats){
+
+	uint32_t hash = stats->displayHash ? stats->displayHash : 2166136261u;
+
+	for (size_t i = 0; i < count; i++){
+		const MsgRecord *record = &records[i];
+		stats->messages++;
+		if (record->message != OVERLAY_WM_COMMAND){
+			continue;
+		}
+		stats->commands++;
+
+		int controlId = (int)(record->wParam & 0xFFFF);
+		int notifyCode = (int)((record->wParam >> 16) & 0xFFFF);
+		if (!(OverlayCommand(state, controlId, notifyCode, (long)record->lParam) & OVERLAY_RefreshDisplays)){
+			continue;
+		}
+
+		//What UpdateRequirementDisplays does, with the texts hashed (FNV-1a) instead of shown.
+		stats->refreshes++;
+		for (int g = 0; g < GOOD_COUNT; g++){
+			wchar_t text[OVERLAY_DISPLAY_CHARS];
+			size_t chars = OverlayDisplayText(state, (Good)g, text, OVERLAY_DISPLAY_CHARS);
+			for (size_t c = 0; c < chars; c++){
+				hash = (hash ^ (uint32_t)text[c]) * 16777619u;
+			}
+		}
+	}
+	stats->displayHash = hash;
+}
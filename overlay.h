@@ -0,0 +1,103 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "calc.h"
+#include "controls.h"
+#include "demand_agg.h"
+#include "demand_formula.h"
+#include "msg_record.h"
+
+/* The housing calculator behind the main window, without any Win32: what a click or a typed spinner value
+ * does to the blocks, and the text of the requirement displays. main_noDebug.c passes its WM_COMMAND
+ * messages to OverlayCommand and shows the result; OverlayReplay does the same with a recorded session
+ * (msg_record.h) on any platform, which makes a session a repeatable benchmark.
+ */
+
+
+/* Win32 values of the messages and notification codes the overlay handles, so recordings carry the real
+ * numbers. main_noDebug.c checks them against windows.h.
+ */
+#define OVERLAY_WM_COMMAND 0x0111
+#define OVERLAY_BN_CLICKED 0
+#define OVERLAY_EN_CHANGE 0x0300
+
+
+//Characters of a display text, terminator included.
+#define OVERLAY_DISPLAY_CHARS 64
+
+
+//What the window has to do after OverlayCommand, as bits.
+enum {
+	OVERLAY_RefreshDisplays	= 1,	//the demand changed, the displays need new text
+	OVERLAY_ShowTestMessage	= 2	//ID_BTN_TEST was clicked
+};
+
+
+/* farmerBlocks : the blocks added with ID_BTN_FarmerBlockInc/Dec and their running demand totals
+ * spinnerPos : the value of every spinner, by spinner index (SPINNER_TABLE)
+ * formulas : the user formulas the displays show the demand through, NULL for none (not owned)
+ */
+typedef struct OverlayState {
+	DemandAggregate farmerBlocks;
+	int spinnerPos[SPINNER_COUNT];
+	DemandFormulas *formulas;
+} OverlayState;
+
+
+/* messages : records replayed
+ * commands : WM_COMMAND records among them
+ * refreshes : times the display texts were rendered
+ * displayHash : hash of every display text rendered, equal for equal sessions on every platform
+ */
+typedef struct OverlayReplayStats {
+	uint64_t messages;
+	uint64_t commands;
+	uint64_t refreshes;
+	uint32_t displayHash;
+} OverlayReplayStats;
+
+
+/* Starts without blocks and with every spinner at its initial value.
+ */
+void OverlayInit(OverlayState *state);
+
+
+void OverlayFree(OverlayState *state);
+
+
+/* Handles a WM_COMMAND: controlId and notifyCode from wParam, value is the spinner position for EN_CHANGE
+ * of an ID_FLD_* field (clamped to the spinner's range here). Returns OVERLAY_* bits.
+ */
+int OverlayCommand(OverlayState *state, int controlId, int notifyCode, long value);
+
+
+/* The block that ID_BTN_FarmerBlockInc adds, from the spinner values.
+ */
+HousingBlock OverlayNextBlock(const OverlayState *state);
+
+
+/* The demand of the blocks as the displays show it, through the formulas if there are any.
+ */
+void OverlayDemand(const OverlayState *state, Demand *out);
+
+
+/* Writes the text of the display that shows good ("<label>\r\n<n> buildings"). Returns its length.
+ */
+size_t OverlayDisplayText(const OverlayState *state, Good good, wchar_t *out, size_t size);
+
+
+/* The same text for a given number of buildings, for callers that already have the demand.
+ */
+size_t OverlayFormatDisplay(Good good, double buildings, wchar_t *out, size_t size);
+
+
+
+/* Handles count recorded messages the way MainWndProc does, rendering every display after each command
+ * that changes them. stats is added to, so several calls can share it.
+ */
+void OverlayReplay(OverlayState *state, const MsgRecord *records, size_t count, OverlayReplayStats *stats);
+
+#endif
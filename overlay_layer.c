@@ -0,0 +1,150 @@
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+
+#include "overlay_layer.h"
+
+
+static const wchar_t *g_layerClassName = L"Anno1800OverlayLayerClass";
+
+
+/* The layer never takes input (WS_EX_TRANSPARENT sends clicks to the game below), so the default
+ * procedure is all it needs.
+ */
+static BOOL RegisterLayerClass(HINSTANCE instance){
+
+	WNDCLASSEXW wc;
+	ZeroMemory(&wc, sizeof(wc));
+
+	wc.cbSize	= sizeof(wc);
+	wc.lpfnWndProc	= DefWindowProcW;
+	wc.hInstance	= instance;
+	wc.lpszClassName= g_layerClassName;
+
+	return RegisterClassExW(&wc) != 0;
+}
+
+
+/* A top-down 32 bit DIB section, so row 0 is the top row like in raster.h and the pixels can be drawn
+ * into directly.
+ */
+static HBITMAP CreateLayerBitmap(HDC dc, uint32_t **pixels){
+
+	BITMAPINFO info;
+	ZeroMemory(&info, sizeof(info));
+	info.bmiHeader.biSize = sizeof(info.bmiHeader);
+	info.bmiHeader.biWidth = OVERLAY_RENDER_WIDTH;
+	info.bmiHeader.biHeight = -OVERLAY_RENDER_HEIGHT;
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+
+	void *bits = NULL;
+	HBITMAP bitmap = CreateDIBSection(dc, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+	*pixels = bits;
+	return bitmap;
+}
+
+
+int OverlayLayerOpen(OverlayLayer *layer, HINSTANCE instance, int x, int y){
+
+	ZeroMemory(layer, sizeof(*layer));
+	layer->position.x = x;
+	layer->position.y = y;
+
+	if (!RegisterLayerClass(instance)){
+		return 0;
+	}
+
+	layer->window = CreateWindowExW(
+
+	/*"dwExStyle   =*/ WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+	/*"lpClassName =*/ g_layerClassName,
+	/*"lpWindowName=*/ L"Anno 1800 Overlay",
+	/*"dwStyle     =*/ WS_POPUP,
+	/*"x	       =*/ x,
+	/*"y	       =*/ y,
+	/*"width       =*/ OVERLAY_RENDER_WIDTH,
+	/*"height      =*/ OVERLAY_RENDER_HEIGHT,
+	/*"hwndParent  =*/ NULL,
+	/*"hMenu       =*/ NULL,
+	/*"hInstance   =*/ instance,
+	/*"lpParam     =*/ NULL
+			);
+	if (!layer->window){
+		return 0;
+	}
+
+	uint32_t *pixels = NULL;
+	HDC screen = GetDC(NULL);
+	layer->memDc = CreateCompatibleDC(screen);
+	layer->bitmap = CreateLayerBitmap(screen, &pixels);
+	ReleaseDC(NULL, screen);
+	if (!layer->memDc || !layer->bitmap || !pixels){
+		OverlayLayerClose(layer);
+		return 0;
+	}
+	layer->oldBitmap = SelectObject(layer->memDc, layer->bitmap);
+	if (!OverlayRenderInit(&layer->render, pixels, OVERLAY_RENDER_WIDTH)){
+		OverlayLayerClose(layer);
+		return 0;
+	}
+
+	ShowWindow(layer->window, SW_SHOWNOACTIVATE);
+	return 1;
+}
+
+
+void OverlayLayerUpdate(OverlayLayer *layer, const OverlayView *view){
+
+	if (!layer->window || !layer->bitmap){
+		return;
+	}
+	if (!OverlayRenderUpdate(&layer->render, view->value)){
+		return;
+	}
+
+	//GDI must be done with the DIB before it is read again.
+	GdiFlush();
+
+	RasterRect b = layer->render.dirty.bounds;
+	RECT dirty = {b.x, b.y, b.x + b.width, b.y + b.height};
+	SIZE size = {OVERLAY_RENDER_WIDTH, OVERLAY_RENDER_HEIGHT};
+	POINT source = {0, 0};
+	BLENDFUNCTION blend = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
+
+	UPDATELAYEREDWINDOWINFO info;
+	ZeroMemory(&info, sizeof(info));
+	info.cbSize = sizeof(info);
+	info.pptDst = &layer->position;
+	info.psize = &size;
+	info.hdcSrc = layer->memDc;
+	info.pptSrc = &source;
+	info.pblend = &blend;
+	info.dwFlags = ULW_ALPHA;
+	info.prcDirty = &dirty;
+
+	if (UpdateLayeredWindowIndirect(layer->window, &info)){
+		layer->presents++;
+		layer->presentedPixels += (unsigned long long)b.width * (unsigned long long)b.height;
+	}
+	RasterDirtyClear(&layer->render.dirty);
+}
+
+
+void OverlayLayerClose(OverlayLayer *layer){
+	OverlayRenderFree(&layer->render);
+	if (layer->memDc){
+		if (layer->oldBitmap){
+			SelectObject(layer->memDc, layer->oldBitmap);
+		}
+		DeleteDC(layer->memDc);
+	}
+	if (layer->bitmap){
+		DeleteObject(layer->bitmap);
+	}
+	if (layer->window){
+		DestroyWindow(layer->window);
+	}
+	ZeroMemory(layer, sizeof(*layer));
+}
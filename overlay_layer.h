@@ -0,0 +1,46 @@
+#ifndef OVERLAY_LAYER_H
+#define OVERLAY_LAYER_H
+
+#include <windows.h>
+
+#include "overlay_render.h"
+#include "overlay_view.h"
+
+/* The overlay proper: a topmost, click-through layered window (WS_EX_LAYERED | WS_EX_TRANSPARENT) showing
+ * the requirement displays on top of the game. overlay_render.c draws into the pixels of a DIB section and
+ * UpdateLayeredWindowIndirect copies only the dirty rectangle to the screen, with per-pixel alpha.
+ */
+
+
+/* window : the layered window, NULL if it could not be created
+ * memDc / bitmap / oldBitmap : the DIB section selected into a memory DC, its pixels are render.surface
+ * render : what is drawn and what changed
+ * position : top left corner on the screen
+ * presents / presentedPixels : UpdateLayeredWindowIndirect calls and the pixels of their dirty rectangles
+ */
+typedef struct OverlayLayer {
+	HWND window;
+	HDC memDc;
+	HBITMAP bitmap;
+	HGDIOBJ oldBitmap;
+	OverlayRender render;
+	POINT position;
+	unsigned long presents;
+	unsigned long long presentedPixels;
+} OverlayLayer;
+
+
+/* Creates the window at (x, y) and shows it without taking the focus. Returns 0 if anything failed (the
+ * layer then stays closed and OverlayLayerUpdate does nothing).
+ */
+int OverlayLayerOpen(OverlayLayer *layer, HINSTANCE instance, int x, int y);
+
+
+/* Redraws the boxes whose value in view changed and puts them on the screen.
+ */
+void OverlayLayerUpdate(OverlayLayer *layer, const OverlayView *view);
+
+
+void OverlayLayerClose(OverlayLayer *layer);
+
+#endif
@@ -0,0 +1,126 @@
+#include <math.h>	//floor, isnan
+#include <wchar.h>	//wcschr
+
+#include "overlay.h"
+#include "overlay_render.h"
+
+
+//Colours, premultiplied (raster.h).
+#define COLOR_PANEL	RASTER_ARGB(0xB0, 0x10, 0x10, 0x18)
+#define COLOR_BORDER	RASTER_ARGB(0xFF, 0xC8, 0xA0, 0x50)
+#define COLOR_BOX	RASTER_ARGB(0x60, 0x30, 0x30, 0x30)
+#define COLOR_BOX_EDGE	RASTER_ARGB(0xC0, 0x90, 0x90, 0x90)
+#define COLOR_TRACK	RASTER_ARGB(0x80, 0x20, 0x20, 0x20)
+#define COLOR_GAUGE	RASTER_ARGB(0xE0, 0x40, 0xB0, 0x40)
+#define COLOR_LABEL	RASTER_ARGB(0xFF, 0xD8, 0xD8, 0xD8)
+#define COLOR_VALUE	RASTER_ARGB(0xFF, 0xF0, 0xC8, 0x60)
+
+//The gauge inside a box, the space above it is for the text.
+#define GAUGE_INSET 6
+#define GAUGE_Y 40
+#define GAUGE_HEIGHT 8
+
+//The display text above it: the label, then the buildings in bold, both at the font's own size.
+#define TEXT_INSET 6
+#define TEXT_Y 6
+#define TEXT_SIZE GLYPH_FONT_EM
+#define TEXT_LINE_Y 20
+
+
+int OverlayRenderInit(OverlayRender *render, uint32_t *pixels, int stride){
+	render->surface.pixels = pixels;
+	render->surface.width = OVERLAY_RENDER_WIDTH;
+	render->surface.height = OVERLAY_RENDER_HEIGHT;
+	render->surface.stride = stride;
+	render->valid = 0;
+	render->boxesDrawn = 0;
+	RasterDirtyClear(&render->dirty);
+
+	//The labels and numbers of three boxes, regular and bold, need a few dozen glyphs: 8 x 8 cells hold them.
+	return GlyphCacheInit(&render->glyphs, 8 * GLYPH_CELL_SIZE);
+}
+
+
+void OverlayRenderFree(OverlayRender *render){
+	GlyphCacheFree(&render->glyphs);
+}
+
+
+void OverlayRenderInvalidate(OverlayRender *render){
+	render->valid = 0;
+}
+
+
+RasterRect OverlayRenderBox(Good good){
+	RasterRect box = {OVERLAY_RENDER_MARGIN + (int)good * OVERLAY_RENDER_BOX_STEP, OVERLAY_RENDER_MARGIN,
+		OVERLAY_RENDER_BOX_WIDTH, OVERLAY_RENDER_BOX_HEIGHT};
+	return box;
+}
+
+
+/* How much of the last building is used: the fraction of the value, a full gauge for a whole number of
+ * buildings and an empty one for none.
+ */
+static double GaugeFill(double buildings){
+	if (buildings <= 0.0){
+		return 0.0;
+	}
+	double fraction = buildings - floor(buildings);
+	return fraction == 0.0 ? 1.0 : fraction;
+}
+
+
+/* Draws one box from the panel colour up, so a box drawn alone gives the same pixels as the whole panel.
+ */
+static void DrawBox(OverlayRender *render, Good good, double buildings){
+
+	RasterSurface *s = &render->surface;
+	RasterRect box = OverlayRenderBox(good);
+
+	RasterFill(s, box, COLOR_PANEL);
+	RasterBlendRect(s, box, COLOR_BOX);
+	RasterFrame(s, box, COLOR_BOX_EDGE);
+
+	RasterRect track = {box.x + GAUGE_INSET, box.y + GAUGE_Y, box.width - 2 * GAUGE_INSET, GAUGE_HEIGHT};
+	RasterBlendRect(s, track, COLOR_TRACK);
+	track.width = (int)(GaugeFill(buildings) * track.width + 0.5);
+	RasterBlendRect(s, track, COLOR_GAUGE);
+
+	//The same text as the display control, "<label>\r\n<n> buildings", a batch per line.
+	wchar_t text[OVERLAY_DISPLAY_CHARS];
+	OverlayFormatDisplay(good, buildings, text, OVERLAY_DISPLAY_CHARS);
+	wchar_t *value = wcschr(text, L'\r');
+	if (value){
+		*value++ = 0;
+		value += *value == L'\n';
+		GlyphCacheText(&render->glyphs, s, GLYPH_FONT_Bold, TEXT_SIZE, value, box.x + TEXT_INSET, box.y + TEXT_LINE_Y, COLOR_VALUE);
+	}
+	GlyphCacheText(&render->glyphs, s, GLYPH_FONT_Regular, TEXT_SIZE, text, box.x + TEXT_INSET, box.y + TEXT_Y, COLOR_LABEL);
+
+	render->drawn[good] = buildings;
+	render->boxesDrawn++;
+}
+
+
+int OverlayRenderUpdate(OverlayRender *render, const double buildings[GOOD_COUNT]){
+
+	int drawn = 0;
+	if (!render->valid){
+		RasterRect all = {0, 0, OVERLAY_RENDER_WIDTH, OVERLAY_RENDER_HEIGHT};
+		RasterFill(&render->surface, all, COLOR_PANEL);
+		RasterFrame(&render->surface, all, COLOR_BORDER);
+		RasterDirtyAdd(&render->dirty, all);
+	}
+
+	for (int g = 0; g < GOOD_COUNT; g++){
+		double value = isnan(buildings[g]) ? 0.0 : buildings[g];
+		if (render->valid && value == render->drawn[g]){
+			continue;
+		}
+		DrawBox(render, (Good)g, value);
+		RasterDirtyAdd(&render->dirty, OverlayRenderBox((Good)g));
+		drawn++;
+	}
+	render->valid = 1;
+	return drawn;
+}
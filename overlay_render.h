@@ -0,0 +1,67 @@
+#ifndef OVERLAY_RENDER_H
+#define OVERLAY_RENDER_H
+
+#include <stdint.h>
+
+#include "calc.h"
+#include "glyph_cache.h"
+#include "raster.h"
+
+/* Draws the requirement displays for the layered overlay window (overlay_layer.c) with raster.c: a
+ * translucent panel with a box per good, each with its display text (overlay.h) and a gauge of how far the
+ * last production building is used. Only the boxes whose value changed are redrawn, and the rectangles they
+ * cover are collected in dirty for the window update.
+ */
+
+
+#define OVERLAY_RENDER_BOX_WIDTH 120
+#define OVERLAY_RENDER_BOX_HEIGHT 56
+#define OVERLAY_RENDER_BOX_STEP 130
+#define OVERLAY_RENDER_MARGIN 10
+
+#define OVERLAY_RENDER_WIDTH (OVERLAY_RENDER_MARGIN + GOOD_COUNT * OVERLAY_RENDER_BOX_STEP)
+#define OVERLAY_RENDER_HEIGHT (2 * OVERLAY_RENDER_MARGIN + OVERLAY_RENDER_BOX_HEIGHT)
+
+
+/* surface : OVERLAY_RENDER_WIDTH x OVERLAY_RENDER_HEIGHT pixels, owned by the caller
+ * drawn : the value every box shows
+ * valid : the panel has been drawn since OverlayRenderInit / OverlayRenderInvalidate
+ * dirty : rectangles changed since the caller last cleared it
+ * boxesDrawn : boxes drawn so far, the panel counting as all of them
+ * glyphs : the atlas the text is drawn from
+ */
+typedef struct OverlayRender {
+	RasterSurface surface;
+	double drawn[GOOD_COUNT];
+	int valid;
+	RasterDirty dirty;
+	uint64_t boxesDrawn;
+	GlyphCache glyphs;
+} OverlayRender;
+
+
+/* Draws into pixels (stride in pixels) from the next OverlayRenderUpdate on. Returns 0 if the glyph atlas
+ * could not be allocated.
+ */
+int OverlayRenderInit(OverlayRender *render, uint32_t *pixels, int stride);
+
+
+void OverlayRenderFree(OverlayRender *render);
+
+
+/* Makes the next update draw the whole panel.
+ */
+void OverlayRenderInvalidate(OverlayRender *render);
+
+
+/* Redraws what differs from buildings (NaN counts as 0) and adds it to dirty. Returns the number of boxes
+ * drawn, 0 if nothing changed.
+ */
+int OverlayRenderUpdate(OverlayRender *render, const double buildings[GOOD_COUNT]);
+
+
+/* Where the box of good is on the surface.
+ */
+RasterRect OverlayRenderBox(Good good);
+
+#endif
@@ -0,0 +1,181 @@
+#include <string.h>	//memset
+
+#include "overlay_ui.h"
+
+
+/* Where every control goes. parent is the control ID of the frame it sits in, 0 for the main window;
+ * frames and text fields come before the controls that refer to them. ID_BTN_TEST is not placed.
+ * X(control, parent, text, x, y, width, height)
+ */
+#define LAYOUT_TABLE(X) \
+	X(ID_FRM_SetHousingFrame,	0,				NULL,				15,	10,	110,	90) \
+	X(ID_FRM_AdjustHousingFrame,	0,				NULL,				15,	110,	330,	120) \
+	X(ID_FRM_ResourceReqFrame,	0,				NULL,				15,	240,	330,	120) \
+	\
+	X(ID_BTN_FarmerBlockInc,	ID_FRM_AdjustHousingFrame,	L"Farmer Block\r\n+1",		10,	20,	100,	40) \
+	X(ID_BTN_FarmerBlockDec,	ID_FRM_AdjustHousingFrame,	L"Farmer Block\r\n-1",		10,	60,	100,	40) \
+	\
+	X(ID_FLD_HousingWidth,		ID_FRM_SetHousingFrame,		L"Width",			15,	40,	30,	20) \
+	X(ID_FLD_HousingLength,		ID_FRM_SetHousingFrame,		L"Length",			65,	40,	30,	20) \
+	X(ID_SPN_HousingWidth,		ID_FRM_SetHousingFrame,		NULL,				20,	60,	50,	20) \
+	X(ID_SPN_HousingLength,		ID_FRM_SetHousingFrame,		NULL,				70,	60,	50,	20) \
+	X(ID_LBL_HousingWidth,		ID_FRM_SetHousingFrame,		L"Width",			10,	20,	40,	20) \
+	X(ID_LBL_HousingLength,		ID_FRM_SetHousingFrame,		L"Length",			60,	20,	45,	20) \
+	\
+	X(ID_DSP_Fish,			ID_FRM_ResourceReqFrame,	L"Required Fish:",		10,	20,	100,	40) \
+	X(ID_DSP_Clothes,		ID_FRM_ResourceReqFrame,	L"Required Clothes:",		115,	20,	100,	40) \
+	X(ID_DSP_Schnnaps,		ID_FRM_ResourceReqFrame,	L"Required Schnapps:",		220,	20,	100,	40)
+
+
+typedef struct LayoutEntry {
+	int control;
+	int parent;
+	const wchar_t *text;
+	int x;
+	int y;
+	int width;
+	int height;
+} LayoutEntry;
+
+#define X_LAYOUT_ENTRY(control, parent, text, x, y, width, height) {control, parent, text, x, y, width, height},
+static const LayoutEntry g_layout[] = {
+	LAYOUT_TABLE(X_LAYOUT_ENTRY)
+};
+#undef X_LAYOUT_ENTRY
+
+
+//The display of every good, from DISPLAY_TABLE (controls.h).
+#define X_DISPLAY_CONTROL(control, good, label) [good] = control,
+static const int g_displayControls[GOOD_COUNT] = {
+	DISPLAY_TABLE(X_DISPLAY_CONTROL)
+};
+#undef X_DISPLAY_CONTROL
+
+
+void OverlayUiInit(OverlayUi *ui, const UiBackend *backend){
+	memset(ui, 0, sizeof(*ui));
+	ui->backend = backend;
+	ui->frameMs = OVERLAY_UI_FRAME_MS;
+	OverlayInit(&ui->state);
+	OverlayViewInit(&ui->view);
+}
+
+
+void OverlayUiFree(OverlayUi *ui){
+	OverlayFree(&ui->state);
+}
+
+
+static UiHandle Control(const OverlayUi *ui, int controlId){
+	int index = ControlIndexFromId(controlId);
+	return index < 0 ? NULL : ui->controls[index];
+}
+
+
+int OverlayUiOpen(OverlayUi *ui){
+
+	const UiBackend *b = ui->backend;
+
+	ui->root = b->createWindow(b->context, OVERLAY_UI_TITLE, OVERLAY_UI_WIDTH, OVERLAY_UI_HEIGHT);
+	if (!ui->root){
+		return 0;
+	}
+
+	for (size_t i = 0; i < sizeof(g_layout) / sizeof(g_layout[0]); i++){
+		const LayoutEntry *entry = &g_layout[i];
+		UiHandle parent = entry->parent ? Control(ui, entry->parent) : ui->root;
+		UiHandle control = b->createControl(b->context, parent, entry->control, entry->text, entry->x, entry->y, entry->width, entry->height);
+		if (!control){
+			return 0;
+		}
+		ui->controls[ControlIndexFromId(entry->control)] = control;
+
+		//Range and start value come from SPINNER_TABLE (controls.h).
+		if (ControlKindFromId(entry->control) == CONTROL_Spinner){
+			const SpinnerInfo *info = ControlSpinnerInfo(ControlSpinnerIndex(entry->control));
+			b->setSpinner(b->context, control, Control(ui, info->field), info->minVal, info->maxVal, info->initialVal);
+		}
+	}
+
+	OverlayUiRefreshDisplays(ui);
+	return 1;
+}
+
+
+long OverlayUiCommandValue(const OverlayUi *ui, int controlId){
+	int index = ControlSpinnerIndex(controlId);
+	if (index < 0){
+		return 0;
+	}
+	UiHandle spinner = Control(ui, ControlSpinnerInfo(index)->spinner);
+	if (!spinner){
+		return ui->state.spinnerPos[index];
+	}
+	return ui->backend->getSpinner(ui->backend->context, spinner);
+}
+
+
+//OverlayViewWriteFn of the displays.
+static void WriteDisplay(void *user, Good good, const wchar_t *text){
+	OverlayUi *ui = user;
+	UiHandle display = Control(ui, g_displayControls[good]);
+	if (display){
+		ui->backend->setText(ui->backend->context, display, text);
+	}
+}
+
+
+//Hands the current demand to the view, returns non-zero if a display is out of date.
+static uint32_t UpdateView(OverlayUi *ui){
+	Demand demand;
+	OverlayDemand(&ui->state, &demand);
+	return OverlayViewUpdate(&ui->view, &demand);
+}
+
+
+void OverlayUiFlush(OverlayUi *ui){
+	ui->flushPending = 0;
+	OverlayViewFlush(&ui->view, WriteDisplay, ui);
+}
+
+
+void OverlayUiRefreshDisplays(OverlayUi *ui){
+	UpdateView(ui);
+	OverlayUiFlush(ui);
+}
+
+
+//Flushes now without a frame interval, otherwise when the interval is over (unless a flush is pending).
+static void ScheduleFlush(OverlayUi *ui){
+	if (ui->frameMs <= 0){
+		OverlayUiFlush(ui);
+	}
+	else if (!ui->flushPending){
+		ui->flushPending = 1;
+		ui->backend->scheduleFlush(ui->backend->context, ui->frameMs);
+	}
+}
+
+
+int OverlayUiCommand(OverlayUi *ui, int controlId, int notifyCode){
+
+	int effects = OverlayCommand(&ui->state, controlId, notifyCode, OverlayUiCommandValue(ui, controlId));
+	if (effects & OVERLAY_ShowTestMessage){
+		ui->backend->showMessage(ui->backend->context, L"Test Notification", L"Test Sucsessful");
+	}
+	if ((effects & OVERLAY_RefreshDisplays) && UpdateView(ui)){
+		ScheduleFlush(ui);
+	}
+	return effects;
+}
+
+
+void OverlayUiShowDemand(OverlayUi *ui, const Demand *demand){
+	Demand shown = *demand;
+	if (ui->state.formulas){
+		DemandFormulasApply(ui->state.formulas, &shown);
+	}
+	if (OverlayViewUpdate(&ui->view, &shown)){
+		ScheduleFlush(ui);
+	}
+}
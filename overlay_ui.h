@@ -0,0 +1,86 @@
+#ifndef OVERLAY_UI_H
+#define OVERLAY_UI_H
+
+#include "controls.h"
+#include "overlay.h"
+#include "overlay_view.h"
+#include "ui_backend.h"
+
+/* The main window of the overlay on top of a UiBackend: creates the window and its controls from the layout
+ * table and turns commands into OverlayCommand calls and display updates. Everything Win32 specific is in
+ * the backend, so a headless backend runs exactly the same flow.
+ */
+
+
+#define OVERLAY_UI_TITLE L"Anno 1800 Ingame Overlay"
+#define OVERLAY_UI_WIDTH 380
+#define OVERLAY_UI_HEIGHT 430
+
+//Display changes within this many milliseconds are written together, 0 writes them after every command.
+#define OVERLAY_UI_FRAME_MS 16
+
+
+/* backend : the windowing calls, must outlive the UI
+ * state : blocks and spinner values
+ * view : what the displays show and which of them are out of date
+ * frameMs : the flush interval, OVERLAY_UI_FRAME_MS unless changed after OverlayUiInit
+ * flushPending : a scheduleFlush is outstanding
+ * root : the main window
+ * controls : handle of every control, by control index (NULL for controls not in the layout)
+ */
+typedef struct OverlayUi {
+	const UiBackend *backend;
+	OverlayState state;
+	OverlayView view;
+	int frameMs;
+	int flushPending;
+	UiHandle root;
+	UiHandle controls[CONTROL_COUNT];
+} OverlayUi;
+
+
+/* Starts with no controls and the initial overlay state.
+ */
+void OverlayUiInit(OverlayUi *ui, const UiBackend *backend);
+
+
+void OverlayUiFree(OverlayUi *ui);
+
+
+/* Creates the main window and every control of the layout inside it and fills the displays. Returns 0 if
+ * the window or a control could not be created (the ones before it stay).
+ */
+int OverlayUiOpen(OverlayUi *ui);
+
+
+/* The value OverlayCommand needs with a command of this control: the position of the spinner that belongs
+ * to an ID_FLD_* field, 0 for every other control. While the spinners are still being created the current
+ * value is kept.
+ */
+long OverlayUiCommandValue(const OverlayUi *ui, int controlId);
+
+
+/* Handles a WM_COMMAND of a control: updates the state and shows the test message. If the demand changed
+ * the displays are marked out of date and a flush is scheduled (unless one is pending), so a burst of
+ * commands rewrites each display at most once. Returns the OVERLAY_* bits of OverlayCommand.
+ */
+int OverlayUiCommand(OverlayUi *ui, int controlId, int notifyCode);
+
+
+/* Shows demand in the displays instead of the blocks' (the demand of the population read from the game),
+ * through the formulas of the state like the blocks', flushed like the displays of a command. The next
+ * command that changes the blocks shows theirs again.
+ */
+void OverlayUiShowDemand(OverlayUi *ui, const Demand *demand);
+
+
+/* Writes the displays marked out of date whose text changed. Called when the scheduled flush is due.
+ */
+void OverlayUiFlush(OverlayUi *ui);
+
+
+/* Writes the running demand totals into the ID_DSP_* displays now (only those whose text changed).
+ */
+void OverlayUiRefreshDisplays(OverlayUi *ui);
+
+#endif
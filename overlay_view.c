@@ -0,0 +1,70 @@
+#include <math.h>	//NAN
+#include <string.h>	//memset
+#include <wchar.h>	//wcscmp, wcscpy
+
+#include "overlay_view.h"
+
+
+_Static_assert(GOOD_COUNT <= 32, "OverlayView.dirty has one bit per good");
+
+
+void OverlayViewInit(OverlayView *view){
+	memset(view, 0, sizeof(*view));
+	for (int g = 0; g < GOOD_COUNT; g++){
+		view->value[g] = NAN;
+	}
+}
+
+
+uint32_t OverlayViewUpdate(OverlayView *view, const Demand *demand){
+
+	view->stats.updates++;
+	for (int g = 0; g < GOOD_COUNT; g++){
+		//NaN (nothing shown yet) never compares equal.
+		if (demand->buildings[g] == view->value[g]){
+			continue;
+		}
+		view->value[g] = demand->buildings[g];
+		view->stats.marked++;
+		if (view->dirty & 1u << g){
+			view->stats.coalesced++;
+		}
+		view->dirty |= 1u << g;
+	}
+	return view->dirty;
+}
+
+
+int OverlayViewFlush(OverlayView *view, OverlayViewWriteFn write, void *user){
+
+	if (!view->dirty){
+		return 0;
+	}
+	view->stats.flushes++;
+
+	int written = 0;
+	for (int g = 0; g < GOOD_COUNT; g++){
+		if (!(view->dirty & 1u << g)){
+			continue;
+		}
+		wchar_t text[OVERLAY_DISPLAY_CHARS];
+		OverlayFormatDisplay((Good)g, isnan(view->value[g]) ? 0.0 : view->value[g], text, OVERLAY_DISPLAY_CHARS);
+		view->stats.formatted++;
+		if (view->shown[g][0] && wcscmp(text, view->shown[g]) == 0){
+			view->stats.unchanged++;
+			continue;
+		}
+		wcscpy(view->shown[g], text);
+		write(user, (Good)g, text);
+		view->stats.writes++;
+		written++;
+	}
+	view->dirty = 0;
+	return written;
+}
+
+
+uint64_t OverlayViewSaved(const OverlayView *view){
+	uint64_t naive = view->stats.updates * GOOD_COUNT;
+	return naive > view->stats.writes ? naive - view->stats.writes : 0;
+}
@@ -0,0 +1,73 @@
+#ifndef OVERLAY_VIEW_H
+#define OVERLAY_VIEW_H
+
+#include <stdint.h>
+
+#include "calc.h"
+#include "overlay.h"
+
+/* What the requirement displays show, kept next to the demand so a display is only rewritten when its
+ * text really changes. Every SetWindowTextW invalidates and repaints the control, and a burst of clicks
+ * used to rewrite all of them after every single click.
+ *
+ * OverlayViewUpdate takes the new demand and marks the fields whose value changed as dirty. OverlayViewFlush
+ * formats the dirty fields and writes those whose text differs from what is shown. Between the two, any
+ * number of updates collapse into one write per field; overlay_ui.c flushes once per frame interval.
+ */
+
+
+/* updates : OverlayViewUpdate calls, each would have written every display before
+ * marked : fields whose value changed
+ * coalesced : of those, fields that were already waiting for a flush
+ * flushes : OverlayViewFlush calls that found dirty fields
+ * formatted : display texts formatted by a flush
+ * unchanged : formatted texts equal to the shown text (value changed below the shown precision)
+ * writes : texts handed to the write callback
+ */
+typedef struct OverlayViewStats {
+	uint64_t updates;
+	uint64_t marked;
+	uint64_t coalesced;
+	uint64_t flushes;
+	uint64_t formatted;
+	uint64_t unchanged;
+	uint64_t writes;
+} OverlayViewStats;
+
+
+/* value : the buildings of every good as last given to OverlayViewUpdate
+ * shown : the text last written to every display
+ * dirty : bit (1 << good) for every field whose value changed since its last flush
+ */
+typedef struct OverlayView {
+	double value[GOOD_COUNT];
+	wchar_t shown[GOOD_COUNT][OVERLAY_DISPLAY_CHARS];
+	uint32_t dirty;
+	OverlayViewStats stats;
+} OverlayView;
+
+
+//Receives the displays that need new text during OverlayViewFlush.
+typedef void (*OverlayViewWriteFn)(void *user, Good good, const wchar_t *text);
+
+
+/* Starts with nothing shown, so the first update marks every field and the next flush writes every display.
+ */
+void OverlayViewInit(OverlayView *view);
+
+
+/* Takes the demand after a command. Returns the dirty bits (non-zero if a flush has anything to do).
+ */
+uint32_t OverlayViewUpdate(OverlayView *view, const Demand *demand);
+
+
+/* Formats every dirty field and calls write for the ones whose text changed. Returns the number written.
+ */
+int OverlayViewFlush(OverlayView *view, OverlayViewWriteFn write, void *user);
+
+
+/* Calls OverlayViewUpdate would have made writing every display each time, minus the writes made.
+ */
+uint64_t OverlayViewSaved(const OverlayView *view);
+
+#endif
@@ -0,0 +1,254 @@
+#include <stdio.h>	//FILE
+#include <stdlib.h>	//malloc, realloc, free, abs
+#include <string.h>	//memcmp, memcpy, memset
+
+#include <zlib.h>
+
+#include "png_file.h"
+
+
+static const uint8_t g_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+
+static uint32_t ReadU32(const uint8_t *p){
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+
+static void WriteU32(uint8_t *p, uint32_t v){
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+
+//Channels of an IHDR colour type, 0 for the ones not supported (palette, grey with alpha).
+static int ChannelsOfColorType(int colorType){
+	switch (colorType){
+		case 0: return 1;
+		case 2: return 3;
+		case 6: return 4;
+	}
+	return 0;
+}
+
+
+static uint8_t Paeth(int a, int b, int c){
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+
+/* Undoes the filter of every row of the inflated data (a filter byte, then the row) into pixels.
+ */
+static int Unfilter(const uint8_t *data, uint8_t *pixels, int width, int height, int channels){
+
+	size_t rowBytes = (size_t)width * (size_t)channels;
+	for (int y = 0; y < height; y++){
+		const uint8_t *in = data + (size_t)y * (rowBytes + 1);
+		uint8_t *row = pixels + (size_t)y * rowBytes;
+		const uint8_t *up = y ? row - rowBytes : NULL;
+		int filter = *in++;
+
+		for (size_t i = 0; i < rowBytes; i++){
+			int a = i >= (size_t)channels ? row[i - channels] : 0;
+			int b = up ? up[i] : 0;
+			int c = up && i >= (size_t)channels ? up[i - channels] : 0;
+			switch (filter){
+				case 0: row[i] = in[i]; break;
+				case 1: row[i] = (uint8_t)(in[i] + a); break;
+				case 2: row[i] = (uint8_t)(in[i] + b); break;
+				case 3: row[i] = (uint8_t)(in[i] + (a + b) / 2); break;
+				case 4: row[i] = (uint8_t)(in[i] + Paeth(a, b, c)); break;
+				default: return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+
+static uint8_t *ReadWholeFile(const char *path, size_t *size){
+	FILE *f = fopen(path, "rb");
+	if (!f){
+		return NULL;
+	}
+	uint8_t *data = NULL;
+	size_t used = 0, capacity = 0;
+	for (;;){
+		if (used == capacity){
+			capacity = capacity ? capacity * 2 : 64 * 1024;
+			uint8_t *grown = realloc(data, capacity);
+			if (!grown){
+				free(data);
+				fclose(f);
+				return NULL;
+			}
+			data = grown;
+		}
+		size_t got = fread(data + used, 1, capacity - used, f);
+		used += got;
+		if (got == 0){
+			break;
+		}
+	}
+	fclose(f);
+	*size = used;
+	return data;
+}
+
+
+int PngRead(const char *path, PngImage *image, const char **error){
+
+	memset(image, 0, sizeof(*image));
+	const char *dummy;
+	error = error ? error : &dummy;
+
+	size_t size;
+	uint8_t *file = ReadWholeFile(path, &size);
+	if (!file){
+		*error = "cannot read the file";
+		return 0;
+	}
+
+	uint8_t *idat = NULL;
+	size_t idatBytes = 0;
+	int ok = 0;
+	int channels = 0;
+	*error = "not a PNG file";
+	if (size < 8 || memcmp(file, g_signature, 8) != 0){
+		goto done;
+	}
+
+	//Chunks: length, type, data, CRC. IHDR first, IDAT concatenated, IEND last.
+	size_t at = 8;
+	int seenHeader = 0;
+	while (at + 12 <= size){
+		uint32_t length = ReadU32(file + at);
+		const uint8_t *type = file + at + 4;
+		const uint8_t *data = file + at + 8;
+		if (length > size - at - 12){
+			*error = "chunk runs past the end of the file";
+			goto done;
+		}
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13){
+			image->width = (int)ReadU32(data);
+			image->height = (int)ReadU32(data + 4);
+			channels = ChannelsOfColorType(data[9]);
+			if (data[8] != 8 || !channels || data[12] != 0 || image->width <= 0 || image->height <= 0){
+				*error = "unsupported PNG format (only 8 bit grey, RGB and RGBA without interlacing)";
+				goto done;
+			}
+			seenHeader = 1;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0){
+			uint8_t *grown = realloc(idat, idatBytes + length);
+			if (!grown){
+				*error = "out of memory";
+				goto done;
+			}
+			idat = grown;
+			memcpy(idat + idatBytes, data, length);
+			idatBytes += length;
+		}
+		else if (memcmp(type, "IEND", 4) == 0){
+			break;
+		}
+		at += 12 + (size_t)length;
+	}
+	if (!seenHeader || !idat){
+		*error = "no image header or data";
+		goto done;
+	}
+
+	size_t rowBytes = (size_t)image->width * (size_t)channels;
+	uLongf inflatedBytes = (uLongf)((rowBytes + 1) * (size_t)image->height);
+	uint8_t *inflated = malloc(inflatedBytes);
+	image->pixels = malloc(rowBytes * (size_t)image->height);
+	if (!inflated || !image->pixels){
+		free(inflated);
+		*error = "out of memory";
+		goto done;
+	}
+	uLongf expected = inflatedBytes;
+	if (uncompress(inflated, &inflatedBytes, idat, (uLong)idatBytes) != Z_OK || inflatedBytes != expected){
+		*error = "broken image data";
+	}
+	else if (!Unfilter(inflated, image->pixels, image->width, image->height, channels)){
+		*error = "unknown row filter";
+	}
+	else{
+		image->channels = channels;
+		ok = 1;
+	}
+	free(inflated);
+
+done:
+	free(idat);
+	free(file);
+	if (!ok){
+		PngFree(image);
+	}
+	return ok;
+}
+
+
+void PngFree(PngImage *image){
+	free(image->pixels);
+	memset(image, 0, sizeof(*image));
+}
+
+
+static int WriteChunk(FILE *f, const char *type, const uint8_t *data, uint32_t length){
+	uint8_t header[8];
+	uint8_t crcBytes[4];
+	WriteU32(header, length);
+	memcpy(header + 4, type, 4);
+	uLong crc = crc32(0, header + 4, 4);
+	if (length){
+		crc = crc32(crc, data, length);
+	}
+	WriteU32(crcBytes, (uint32_t)crc);
+	return fwrite(header, 1, 8, f) == 8 && (!length || fwrite(data, 1, length, f) == length) && fwrite(crcBytes, 1, 4, f) == 4;
+}
+
+
+int PngWrite(const char *path, const PngImage *image){
+
+	static const int colorTypes[5] = {0, 0, 0, 2, 6};
+	if (image->channels < 1 || image->channels > 4 || image->channels == 2){
+		return 0;
+	}
+
+	//Every row gets filter 0 (none) in front of it.
+	size_t rowBytes = (size_t)image->width * (size_t)image->channels;
+	size_t rawBytes = (rowBytes + 1) * (size_t)image->height;
+	uint8_t *raw = malloc(rawBytes);
+	uLongf packedBytes = compressBound((uLong)rawBytes);
+	uint8_t *packed = malloc(packedBytes);
+	FILE *f = raw && packed ? fopen(path, "wb") : NULL;
+	int ok = 0;
+	if (f){
+		for (int y = 0; y < image->height; y++){
+			raw[(size_t)y * (rowBytes + 1)] = 0;
+			memcpy(raw + (size_t)y * (rowBytes + 1) + 1, image->pixels + (size_t)y * rowBytes, rowBytes);
+		}
+		uint8_t header[13] = {0};
+		WriteU32(header, (uint32_t)image->width);
+		WriteU32(header + 4, (uint32_t)image->height);
+		header[8] = 8;
+		header[9] = (uint8_t)colorTypes[image->channels];
+
+		ok = compress2(packed, &packedBytes, raw, (uLong)rawBytes, Z_BEST_COMPRESSION) == Z_OK &&
+			fwrite(g_signature, 1, 8, f) == 8 &&
+			WriteChunk(f, "IHDR", header, 13) &&
+			WriteChunk(f, "IDAT", packed, (uint32_t)packedBytes) &&
+			WriteChunk(f, "IEND", NULL, 0);
+		ok &= fclose(f) == 0;
+	}
+	free(raw);
+	free(packed);
+	return ok;
+}
@@ -0,0 +1,35 @@
+#ifndef PNG_FILE_H
+#define PNG_FILE_H
+
+#include <stdint.h>
+
+/* Just enough PNG for the HUD reader's fixture frames (hud_fixtures/): 8 bit grey, RGB and RGBA images
+ * without interlacing, read and written with zlib. Anything else is reported as unsupported.
+ */
+
+
+/* pixels : width * height * channels bytes, rows top to bottom without padding
+ * channels : 1 (grey), 3 (RGB) or 4 (RGBA)
+ */
+typedef struct PngImage {
+	uint8_t *pixels;
+	int width;
+	int height;
+	int channels;
+} PngImage;
+
+
+/* Reads the file into image (free it with PngFree). Returns 0 if it cannot be read, is not a PNG or uses
+ * a format listed above as unsupported; error then says why.
+ */
+int PngRead(const char *path, PngImage *image, const char **error);
+
+
+void PngFree(PngImage *image);
+
+
+/* Writes the image with the default compression and no filtering. Returns 0 on failure.
+ */
+int PngWrite(const char *path, const PngImage *image);
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef _WIN32
+#define _GNU_SOURCE	//process_vm_readv
+#endif
+
+#include <string.h>	//memset, strcmp, strrchr
+
+#include "proc_mem.h"
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <tlhelp32.h>
+
+
+long ProcMemFind(const char *exeName){
+
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE){
+		return 0;
+	}
+	long pid = 0;
+	PROCESSENTRY32 entry;
+	entry.dwSize = sizeof(entry);
+	for (BOOL more = Process32First(snapshot, &entry); more && !pid; more = Process32Next(snapshot, &entry)){
+		if (_stricmp(entry.szExeFile, exeName) == 0){
+			pid = (long)entry.th32ProcessID;
+		}
+	}
+	CloseHandle(snapshot);
+	return pid;
+}
+
+
+int ProcMemOpen(ProcMem *pm, long pid, const char *moduleName){
+
+	memset(pm, 0, sizeof(*pm));
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, (DWORD)pid);
+	if (snapshot == INVALID_HANDLE_VALUE){
+		return 0;
+	}
+	//The first module of the snapshot is the executable.
+	MODULEENTRY32 entry;
+	entry.dwSize = sizeof(entry);
+	for (BOOL more = Module32First(snapshot, &entry); more; more = Module32Next(snapshot, &entry)){
+		if (!moduleName || _stricmp(entry.szModule, moduleName) == 0){
+			pm->base = (uint64_t)(uintptr_t)entry.modBaseAddr;
+			break;
+		}
+	}
+	CloseHandle(snapshot);
+
+	pm->handle = pm->base ? OpenProcess(PROCESS_VM_READ | PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, (DWORD)pid) : NULL;
+	if (!pm->handle){
+		memset(pm, 0, sizeof(*pm));
+		return 0;
+	}
+	pm->pid = pid;
+	return 1;
+}
+
+
+int ProcMemRead(ProcMem *pm, const ProcMemSpan *spans, int count){
+	for (int i = 0; i < count; i++){
+		SIZE_T read = 0;
+		pm->calls++;
+		if (!ReadProcessMemory(pm->handle, (LPCVOID)(uintptr_t)spans[i].address, spans[i].out, spans[i].size, &read)
+			|| read != spans[i].size){
+			return 0;
+		}
+		pm->bytes += read;
+	}
+	return 1;
+}
+
+
+//The handle of a process is signaled when it exits.
+int ProcMemExited(const ProcMem *pm){
+	return WaitForSingleObject(pm->handle, 0) == WAIT_OBJECT_0;
+}
+
+
+void ProcMemClose(ProcMem *pm){
+	if (pm->handle){
+		CloseHandle(pm->handle);
+	}
+	memset(pm, 0, sizeof(*pm));
+}
+
+#else
+
+#include <stdio.h>	//fopen, fgets, snprintf, sscanf
+#include <stdlib.h>	//strtol
+#include <errno.h>
+#include <dirent.h>
+#include <signal.h>	//kill
+#include <unistd.h>
+#include <sys/uio.h>
+
+
+//comm holds at most 15 characters of the executable's name.
+#define PROC_MEM_COMM_CHARS 15
+
+
+long ProcMemFind(const char *exeName){
+
+	DIR *proc = opendir("/proc");
+	if (!proc){
+		return 0;
+	}
+	long pid = 0;
+	struct dirent *entry;
+	while (!pid && (entry = readdir(proc))){
+		char *end;
+		long candidate = strtol(entry->d_name, &end, 10);
+		if (candidate <= 0 || *end){
+			continue;
+		}
+		char path[64];
+		char comm[64] = "";
+		snprintf(path, sizeof(path), "/proc/%ld/comm", candidate);
+		FILE *f = fopen(path, "r");
+		if (!f){
+			continue;
+		}
+		if (fgets(comm, sizeof(comm), f)){
+			comm[strcspn(comm, "\n")] = 0;
+		}
+		fclose(f);
+		if (comm[0] && strncmp(comm, exeName, PROC_MEM_COMM_CHARS) == 0){
+			pid = candidate;
+		}
+	}
+	closedir(proc);
+	return pid;
+}
+
+
+/* The module base is the start of the first mapping of its file in /proc/<pid>/maps; the executable is
+ * the file /proc/<pid>/exe links to.
+ */
+int ProcMemOpen(ProcMem *pm, long pid, const char *moduleName){
+
+	memset(pm, 0, sizeof(*pm));
+	char path[64];
+	char exe[4096] = "";
+	if (!moduleName){
+		snprintf(path, sizeof(path), "/proc/%ld/exe", pid);
+		ssize_t length = readlink(path, exe, sizeof(exe) - 1);
+		if (length <= 0){
+			return 0;
+		}
+		exe[length] = 0;
+	}
+
+	snprintf(path, sizeof(path), "/proc/%ld/maps", pid);
+	FILE *maps = fopen(path, "r");
+	if (!maps){
+		return 0;
+	}
+	char line[4096 + 128];
+	while (!pm->base && fgets(line, sizeof(line), maps)){
+		unsigned long long start;
+		int pathAt = 0;
+		if (sscanf(line, "%llx-%*x %*s %*x %*s %*u %n", &start, &pathAt) < 1 || !pathAt){
+			continue;
+		}
+		char *file = line + pathAt;
+		file[strcspn(file, "\n")] = 0;
+		const char *name = strrchr(file, '/');
+		name = name ? name + 1 : file;
+		if (moduleName ? strcmp(name, moduleName) == 0 : strcmp(file, exe) == 0){
+			pm->base = start;
+		}
+	}
+	fclose(maps);
+	if (!pm->base){
+		return 0;
+	}
+	pm->pid = pid;
+	return 1;
+}
+
+
+int ProcMemRead(ProcMem *pm, const ProcMemSpan *spans, int count){
+	for (int first = 0; first < count; first += PROC_MEM_MAX_SPANS){
+		int n = count - first < PROC_MEM_MAX_SPANS ? count - first : PROC_MEM_MAX_SPANS;
+		struct iovec local[PROC_MEM_MAX_SPANS];
+		struct iovec remote[PROC_MEM_MAX_SPANS];
+		size_t total = 0;
+		for (int i = 0; i < n; i++){
+			local[i].iov_base = spans[first + i].out;
+			local[i].iov_len = spans[first + i].size;
+			remote[i].iov_base = (void *)(uintptr_t)spans[first + i].address;
+			remote[i].iov_len = spans[first + i].size;
+			total += spans[first + i].size;
+		}
+		pm->calls++;
+		ssize_t read = process_vm_readv((pid_t)pm->pid, local, (unsigned long)n, remote, (unsigned long)n, 0);
+		if (read < 0 || (size_t)read != total){
+			return 0;
+		}
+		pm->bytes += (uint64_t)read;
+	}
+	return 1;
+}
+
+
+/* Signal 0 only checks that the process is there. A zombie still counts as running until its parent reaps
+ * it, which for a process that is not ours happens right away.
+ */
+int ProcMemExited(const ProcMem *pm){
+	return kill((pid_t)pm->pid, 0) != 0 && errno == ESRCH;
+}
+
+
+//Nothing is held open on Linux.
+void ProcMemClose(ProcMem *pm){
+	memset(pm, 0, sizeof(*pm));
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef PROC_MEM_H
+#define PROC_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Reads the memory of another process. Uses ReadProcessMemory on Windows and process_vm_readv everywhere
+ * else. process_vm_readv takes a whole list of ranges, so a batch of spans is one system call there;
+ * Windows has no such call and reads span by span, which is why callers merge nearby values into one span.
+ *
+ * Reading a process needs the right to debug it: on Linux the reader must be its parent or be allowed by
+ * /proc/sys/kernel/yama/ptrace_scope, on Windows it needs PROCESS_VM_READ.
+ */
+
+
+//Most spans ProcMemRead hands to one process_vm_readv.
+#define PROC_MEM_MAX_SPANS 64
+
+
+/* address : where the bytes are in the other process
+ * out / size : where they go here and how many
+ */
+typedef struct ProcMemSpan {
+	uint64_t address;
+	void *out;
+	size_t size;
+} ProcMemSpan;
+
+
+/* handle : the process handle on Windows, do not touch
+ * pid : the process read
+ * base : address of the module given to ProcMemOpen in the process
+ * calls : system calls made to read, for the statistics
+ * bytes : bytes read
+ */
+typedef struct ProcMem {
+	void *handle;
+	long pid;
+	uint64_t base;
+	uint64_t calls;
+	uint64_t bytes;
+} ProcMem;
+
+
+/* The ID of a running process whose executable is named exeName (e.g. "Anno1800.exe"), 0 if there is none.
+ */
+long ProcMemFind(const char *exeName);
+
+
+/* Opens process pid for reading and finds where the module named moduleName (file name only, NULL for the
+ * executable itself) is loaded. Returns 0 if the process cannot be read or has no such module.
+ */
+int ProcMemOpen(ProcMem *pm, long pid, const char *moduleName);
+
+
+/* Reads every span. Returns 1 if all of them were read completely, 0 if any of them failed (the process
+ * exited or an address is not mapped), in which case the contents of the out buffers are undefined.
+ */
+int ProcMemRead(ProcMem *pm, const ProcMemSpan *spans, int count);
+
+
+/* 1 once the process read has exited. Asks about the open process only, so unlike ProcMemFind it is cheap
+ * enough to call on every failed read.
+ */
+int ProcMemExited(const ProcMem *pm);
+
+
+void ProcMemClose(ProcMem *pm);
+
+#endif
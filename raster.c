@@ -0,0 +1,428 @@
+#define RASTER_SIMD 1	//if '1' the SSE2 and AVX2 kernels are built for x86 (picked at run time), '0' only the scalar one
+
+#include "raster.h"
+
+#if RASTER_SIMD && (defined(__x86_64__) || defined(__i386__))
+#define RASTER_X86 1
+#include <immintrin.h>
+#else
+#define RASTER_X86 0
+#endif
+
+
+#define X_RASTER_BACKEND_NAME(backend, name) [backend] = name,
+static const char *g_backendNames[] = {
+	RASTER_BACKEND_TABLE(X_RASTER_BACKEND_NAME)
+};
+#undef X_RASTER_BACKEND_NAME
+
+
+const char *RasterBackendName(RasterBackend backend){
+	if ((int)backend < 0 || backend >= RASTER_BACKEND_COUNT){
+		return "(unknown)";
+	}
+	return g_backendNames[backend];
+}
+
+
+/* The two loops every drawing call ends in.
+ *
+ * blendColor : count pixels of dst get one colour source over
+ * blendSpan : count pixels of dst get the pixels of src source over
+ */
+typedef struct RasterKernels {
+	void (*blendColor)(uint32_t *dst, uint32_t color, int count);
+	void (*blendSpan)(uint32_t *dst, const uint32_t *src, int count);
+} RasterKernels;
+
+
+//x / 255 rounded to nearest for x up to 255 * 255, the same way in every kernel.
+static inline uint32_t Div255(uint32_t x){
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+
+static inline uint32_t BlendPixel(uint32_t d, uint32_t s){
+
+	uint32_t ia = 255 - (s >> 24);
+	if (ia == 0){
+		return s;
+	}
+	if (s == 0){
+		return d;
+	}
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8){
+		uint32_t c = Div255(((d >> shift) & 255) * ia) + ((s >> shift) & 255);
+		out |= (c > 255 ? 255 : c) << shift;
+	}
+	return out;
+}
+
+
+static void BlendColorScalar(uint32_t *dst, uint32_t color, int count){
+	for (int i = 0; i < count; i++){
+		dst[i] = BlendPixel(dst[i], color);
+	}
+}
+
+
+static void BlendSpanScalar(uint32_t *dst, const uint32_t *src, int count){
+	for (int i = 0; i < count; i++){
+		dst[i] = BlendPixel(dst[i], src[i]);
+	}
+}
+
+
+#if RASTER_X86
+
+/* The SIMD kernels widen the channels to 16 bit (unpack with zero), multiply by 255 - alpha, divide with
+ * the same rounding as Div255 and pack back; the source is added with saturation like BlendPixel's clamp.
+ * The tail that does not fill a register goes through the scalar loop.
+ */
+#define DIV255_SSE2(x) (t = _mm_add_epi16((x), bias), _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8))
+#define DIV255_AVX2(x) (t = _mm256_add_epi16((x), bias), _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8))
+
+
+__attribute__((target("sse2")))
+static void BlendColorSse2(uint32_t *dst, uint32_t color, int count){
+
+	if ((color >> 24) == 255){
+		for (int i = 0; i < count; i++){
+			dst[i] = color;
+		}
+		return;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i ia = _mm_set1_epi16((short)(255 - (color >> 24)));
+	const __m128i src = _mm_set1_epi32((int)color);
+	__m128i t;
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4){
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia);
+		__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia);
+		lo = DIV255_SSE2(lo);
+		hi = DIV255_SSE2(hi);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epu8(_mm_packus_epi16(lo, hi), src));
+	}
+	BlendColorScalar(dst + i, color, count - i);
+}
+
+
+__attribute__((target("sse2")))
+static void BlendSpanSse2(uint32_t *dst, const uint32_t *src, int count){
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i full = _mm_set1_epi16(255);
+	__m128i t;
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4){
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+
+		//255 - alpha of each pixel in all four of its channels.
+		__m128i slo = _mm_unpacklo_epi8(s, zero);
+		__m128i shi = _mm_unpackhi_epi8(s, zero);
+		__m128i ialo = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, 0xFF), 0xFF));
+		__m128i iahi = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, 0xFF), 0xFF));
+
+		__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ialo);
+		__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), iahi);
+		lo = DIV255_SSE2(lo);
+		hi = DIV255_SSE2(hi);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epu8(_mm_packus_epi16(lo, hi), s));
+	}
+	BlendSpanScalar(dst + i, src + i, count - i);
+}
+
+
+__attribute__((target("avx2")))
+static void BlendColorAvx2(uint32_t *dst, uint32_t color, int count){
+
+	if ((color >> 24) == 255){
+		for (int i = 0; i < count; i++){
+			dst[i] = color;
+		}
+		return;
+	}
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i bias = _mm256_set1_epi16(128);
+	const __m256i ia = _mm256_set1_epi16((short)(255 - (color >> 24)));
+	const __m256i src = _mm256_set1_epi32((int)color);
+	__m256i t;
+
+	//Unpack and pack work inside each 128 bit half, so the pixels come back in their order.
+	int i = 0;
+	for (; i + 8 <= count; i += 8){
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		__m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), ia);
+		__m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), ia);
+		lo = DIV255_AVX2(lo);
+		hi = DIV255_AVX2(hi);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), src));
+	}
+	BlendColorScalar(dst + i, color, count - i);
+}
+
+
+__attribute__((target("avx2")))
+static void BlendSpanAvx2(uint32_t *dst, const uint32_t *src, int count){
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i bias = _mm256_set1_epi16(128);
+	const __m256i full = _mm256_set1_epi16(255);
+	__m256i t;
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8){
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+
+		__m256i slo = _mm256_unpacklo_epi8(s, zero);
+		__m256i shi = _mm256_unpackhi_epi8(s, zero);
+		__m256i ialo = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(slo, 0xFF), 0xFF));
+		__m256i iahi = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(shi, 0xFF), 0xFF));
+
+		__m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), ialo);
+		__m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), iahi);
+		lo = DIV255_AVX2(lo);
+		hi = DIV255_AVX2(hi);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), s));
+	}
+	BlendSpanScalar(dst + i, src + i, count - i);
+}
+
+#endif
+
+
+static const RasterKernels g_kernels[RASTER_BACKEND_COUNT] = {
+	[RASTER_Scalar]	= { BlendColorScalar, BlendSpanScalar },
+#if RASTER_X86
+	[RASTER_SSE2]	= { BlendColorSse2, BlendSpanSse2 },
+	[RASTER_AVX2]	= { BlendColorAvx2, BlendSpanAvx2 },
+#endif
+};
+
+
+//The kernels in use, set by the first drawing call (or RasterUseBackend).
+static const RasterKernels *g_current = NULL;
+static RasterBackend g_currentBackend = RASTER_Scalar;
+
+
+int RasterBackendSupported(RasterBackend backend){
+
+	if ((int)backend < 0 || backend >= RASTER_BACKEND_COUNT || !g_kernels[backend].blendColor){
+		return 0;
+	}
+#if RASTER_X86
+	__builtin_cpu_init();
+	if (backend == RASTER_SSE2){
+		return __builtin_cpu_supports("sse2");
+	}
+	if (backend == RASTER_AVX2){
+		return __builtin_cpu_supports("avx2");
+	}
+#endif
+	return 1;
+}
+
+
+RasterBackend RasterBestBackend(void){
+	for (int b = RASTER_BACKEND_COUNT - 1; b > RASTER_Scalar; b--){
+		if (RasterBackendSupported((RasterBackend)b)){
+			return (RasterBackend)b;
+		}
+	}
+	return RASTER_Scalar;
+}
+
+
+int RasterUseBackend(RasterBackend backend){
+	if (!RasterBackendSupported(backend)){
+		return 0;
+	}
+	g_currentBackend = backend;
+	g_current = &g_kernels[backend];
+	return 1;
+}
+
+
+RasterBackend RasterCurrentBackend(void){
+	if (!g_current){
+		RasterUseBackend(RasterBestBackend());
+	}
+	return g_currentBackend;
+}
+
+
+static const RasterKernels *Kernels(void){
+	if (!g_current){
+		RasterUseBackend(RasterBestBackend());
+	}
+	return g_current;
+}
+
+
+int RasterClip(const RasterSurface *surface, RasterRect *rect){
+
+	int x0 = rect->x < 0 ? 0 : rect->x;
+	int y0 = rect->y < 0 ? 0 : rect->y;
+	int x1 = rect->x + rect->width > surface->width ? surface->width : rect->x + rect->width;
+	int y1 = rect->y + rect->height > surface->height ? surface->height : rect->y + rect->height;
+	if (x1 <= x0 || y1 <= y0){
+		return 0;
+	}
+	rect->x = x0;
+	rect->y = y0;
+	rect->width = x1 - x0;
+	rect->height = y1 - y0;
+	return 1;
+}
+
+
+void RasterFill(RasterSurface *surface, RasterRect rect, uint32_t color){
+	if (!RasterClip(surface, &rect)){
+		return;
+	}
+	for (int y = rect.y; y < rect.y + rect.height; y++){
+		uint32_t *row = surface->pixels + (size_t)y * surface->stride + rect.x;
+		for (int x = 0; x < rect.width; x++){
+			row[x] = color;
+		}
+	}
+}
+
+
+void RasterBlendRect(RasterSurface *surface, RasterRect rect, uint32_t color){
+	if (color == 0 || !RasterClip(surface, &rect)){
+		return;
+	}
+	const RasterKernels *k = Kernels();
+	for (int y = rect.y; y < rect.y + rect.height; y++){
+		k->blendColor(surface->pixels + (size_t)y * surface->stride + rect.x, color, rect.width);
+	}
+}
+
+
+void RasterBlendImage(RasterSurface *surface, int x, int y, const RasterSurface *image){
+	RasterRect rect = {x, y, image->width, image->height};
+	if (!RasterClip(surface, &rect)){
+		return;
+	}
+	const RasterKernels *k = Kernels();
+	for (int row = rect.y; row < rect.y + rect.height; row++){
+		const uint32_t *src = image->pixels + (size_t)(row - y) * image->stride + (rect.x - x);
+		k->blendSpan(surface->pixels + (size_t)row * surface->stride + rect.x, src, rect.width);
+	}
+}
+
+
+//Every channel of a premultiplied colour times coverage / 255.
+static inline uint32_t ScaleColor(uint32_t color, uint32_t coverage){
+	if (coverage == 255){
+		return color;
+	}
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8){
+		out |= Div255(((color >> shift) & 255) * coverage) << shift;
+	}
+	return out;
+}
+
+
+void RasterBlendMask(RasterSurface *surface, int x, int y, const uint8_t *mask, int maskStride, int width, int height, uint32_t color){
+
+	RasterRect rect = {x, y, width, height};
+	if (color == 0 || !RasterClip(surface, &rect)){
+		return;
+	}
+	const RasterKernels *k = Kernels();
+
+	/* The coverage turns the colour into a row of source pixels, which then goes through the same span kernel
+	 * as an image, a chunk at a time so the row fits on the stack.
+	 */
+	uint32_t src[256];
+	for (int row = rect.y; row < rect.y + rect.height; row++){
+		const uint8_t *coverage = mask + (size_t)(row - y) * maskStride + (rect.x - x);
+		uint32_t *dst = surface->pixels + (size_t)row * surface->stride + rect.x;
+		for (int done = 0; done < rect.width; done += 256){
+			int count = rect.width - done < 256 ? rect.width - done : 256;
+			for (int i = 0; i < count; i++){
+				src[i] = coverage[done + i] ? ScaleColor(color, coverage[done + i]) : 0;
+			}
+			k->blendSpan(dst + done, src, count);
+		}
+	}
+}
+
+
+void RasterFrame(RasterSurface *surface, RasterRect rect, uint32_t color){
+	if (rect.width <= 0 || rect.height <= 0){
+		return;
+	}
+	RasterBlendRect(surface, (RasterRect){rect.x, rect.y, rect.width, 1}, color);
+	if (rect.height > 1){
+		RasterBlendRect(surface, (RasterRect){rect.x, rect.y + rect.height - 1, rect.width, 1}, color);
+	}
+	RasterBlendRect(surface, (RasterRect){rect.x, rect.y + 1, 1, rect.height - 2}, color);
+	if (rect.width > 1){
+		RasterBlendRect(surface, (RasterRect){rect.x + rect.width - 1, rect.y + 1, 1, rect.height - 2}, color);
+	}
+}
+
+
+RasterRect RasterUnion(RasterRect a, RasterRect b){
+	if (a.width <= 0 || a.height <= 0){
+		return b;
+	}
+	if (b.width <= 0 || b.height <= 0){
+		return a;
+	}
+	int x0 = a.x < b.x ? a.x : b.x;
+	int y0 = a.y < b.y ? a.y : b.y;
+	int x1 = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+	int y1 = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+	return (RasterRect){x0, y0, x1 - x0, y1 - y0};
+}
+
+
+void RasterDirtyClear(RasterDirty *dirty){
+	dirty->count = 0;
+	dirty->bounds = (RasterRect){0, 0, 0, 0};
+}
+
+
+//Overlapping or sharing an edge.
+static int Touches(RasterRect a, RasterRect b){
+	return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+
+void RasterDirtyAdd(RasterDirty *dirty, RasterRect rect){
+
+	if (rect.width <= 0 || rect.height <= 0){
+		return;
+	}
+	dirty->bounds = RasterUnion(dirty->bounds, rect);
+
+	//A merged rectangle can reach others, so start over after every merge.
+	for (int i = 0; i < dirty->count; i++){
+		if (Touches(dirty->rects[i], rect)){
+			rect = RasterUnion(rect, dirty->rects[i]);
+			dirty->rects[i] = dirty->rects[--dirty->count];
+			i = -1;
+		}
+	}
+	if (dirty->count == RASTER_DIRTY_MAX){
+		dirty->rects[0] = dirty->bounds;
+		dirty->count = 1;
+		return;
+	}
+	dirty->rects[dirty->count++] = rect;
+}
@@ -0,0 +1,138 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Software rasterizer for the layered overlay window. Pixels are 32 bit premultiplied ARGB (0xAARRGGBB,
+ * bytes B G R A in memory), which is what UpdateLayeredWindow with AC_SRC_ALPHA takes from a DIB section.
+ *
+ * Drawing is "source over": dst = src + dst * (255 - srcAlpha) / 255 per channel, rounded exactly, so the
+ * scalar, SSE2 and AVX2 kernels produce identical pixels and one golden image fits all of them. The kernel
+ * is picked once at run time from what the CPU supports (RasterUseBackend to force one).
+ *
+ * A RasterDirty collects the rectangles changed since the last present, so only those are redrawn and
+ * handed to the window.
+ */
+
+
+//Rectangles in a dirty list before they are merged into one.
+#define RASTER_DIRTY_MAX 8
+
+
+//Opaque and translucent colours, premultiplied: every colour channel is at most the alpha.
+#define RASTER_ARGB(a, r, g, b) (((uint32_t)(a) << 24) | ((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | (uint32_t)(b))
+
+
+/* X(backend, name)
+ */
+#define RASTER_BACKEND_TABLE(X) \
+	X(RASTER_Scalar,	"scalar") \
+	X(RASTER_SSE2,		"sse2") \
+	X(RASTER_AVX2,		"avx2")
+
+#define X_RASTER_BACKEND_ENUM(backend, name) backend,
+typedef enum RasterBackend {
+	RASTER_BACKEND_TABLE(X_RASTER_BACKEND_ENUM)
+	RASTER_BACKEND_COUNT
+} RasterBackend;
+#undef X_RASTER_BACKEND_ENUM
+
+
+/* pixels : first pixel of the top row
+ * width / height : size in pixels
+ * stride : pixels from one row to the next (at least width)
+ */
+typedef struct RasterSurface {
+	uint32_t *pixels;
+	int width;
+	int height;
+	int stride;
+} RasterSurface;
+
+
+//Half open: covers x .. x + width - 1. Empty if width or height is 0 or less.
+typedef struct RasterRect {
+	int x;
+	int y;
+	int width;
+	int height;
+} RasterRect;
+
+
+/* rects / count : changed areas, merged into one once more than RASTER_DIRTY_MAX would be needed
+ * bounds : the union of all of them
+ */
+typedef struct RasterDirty {
+	RasterRect rects[RASTER_DIRTY_MAX];
+	int count;
+	RasterRect bounds;
+} RasterDirty;
+
+
+const char *RasterBackendName(RasterBackend backend);
+
+
+/* Returns 1 if the CPU (and the build) can run the backend.
+ */
+int RasterBackendSupported(RasterBackend backend);
+
+
+/* The fastest supported backend, used until RasterUseBackend picks another.
+ */
+RasterBackend RasterBestBackend(void);
+
+
+/* Switches every drawing call to backend. Returns 0 (and keeps the current one) if it is not supported.
+ */
+int RasterUseBackend(RasterBackend backend);
+
+
+RasterBackend RasterCurrentBackend(void);
+
+
+/* Clips rect to the surface. Returns 0 if nothing is left.
+ */
+int RasterClip(const RasterSurface *surface, RasterRect *rect);
+
+
+/* Sets every pixel of rect to color, without blending (clears to a translucent background).
+ */
+void RasterFill(RasterSurface *surface, RasterRect rect, uint32_t color);
+
+
+/* Draws color source over every pixel of rect.
+ */
+void RasterBlendRect(RasterSurface *surface, RasterRect rect, uint32_t color);
+
+
+/* Draws a premultiplied image source over the surface with its top left pixel at (x, y).
+ */
+void RasterBlendImage(RasterSurface *surface, int x, int y, const RasterSurface *image);
+
+
+/* Draws color source over a width x height area at (x, y), weighted by an 8 bit coverage mask (0 = none,
+ * 255 = all of color) whose rows are maskStride bytes apart. Text is drawn this way from the glyph atlas.
+ */
+void RasterBlendMask(RasterSurface *surface, int x, int y, const uint8_t *mask, int maskStride, int width, int height, uint32_t color);
+
+
+/* Draws a one pixel wide outline of rect source over the surface.
+ */
+void RasterFrame(RasterSurface *surface, RasterRect rect, uint32_t color);
+
+
+void RasterDirtyClear(RasterDirty *dirty);
+
+
+/* Adds a changed rectangle: merged into one it overlaps or touches, otherwise appended; when the list is full
+ * every rectangle becomes the bounds.
+ */
+void RasterDirtyAdd(RasterDirty *dirty, RasterRect rect);
+
+
+/* Smallest rectangle holding both (an empty one is ignored).
+ */
+RasterRect RasterUnion(RasterRect a, RasterRect b);
+
+#endif
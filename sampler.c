@@ -0,0 +1,198 @@
+#include <string.h>	//memset
+
+#include "sampler.h"
+#include "sys_thread.h"
+
+
+static uint64_t DefaultClock(void *user){
+	(void)user;
+	return SysNowNs();
+}
+
+
+void SamplerInit(Sampler *sampler, double budget, SamplerClockFn clock, void *clockUser){
+	memset(sampler, 0, sizeof(*sampler));
+	sampler->budget = budget;
+	sampler->clock = clock ? clock : DefaultClock;
+	sampler->clockUser = clockUser;
+	//Empty: sampling only ever spends budget that was earned while the sampler ran.
+	sampler->tokensNs = 0.0;
+	sampler->startNs = sampler->clock(sampler->clockUser);
+	sampler->lastNs = sampler->startNs;
+}
+
+
+int SamplerAdd(Sampler *sampler, const char *name, SamplerFn fn, void *user, uint32_t minMs, uint32_t maxMs){
+	if (sampler->count >= SAMPLER_MAX_SOURCES){
+		return -1;
+	}
+	SamplerSource *source = &sampler->sources[sampler->count];
+	memset(source, 0, sizeof(*source));
+	source->name = name;
+	source->fn = fn;
+	source->user = user;
+	source->minNs = (uint64_t)minMs * 1000000ULL;
+	source->maxNs = (uint64_t)(maxMs > minMs ? maxMs : minMs) * 1000000ULL;
+	source->intervalNs = source->minNs;
+	source->dueNs = sampler->clock(sampler->clockUser);
+	return sampler->count++;
+}
+
+
+void SamplerPause(Sampler *sampler, int paused){
+	uint64_t now = sampler->clock(sampler->clockUser);
+	if (paused && !sampler->paused){
+		sampler->pausedAt = now;
+	}
+	else if (!paused && sampler->paused){
+		sampler->pausedNs += now - sampler->pausedAt;
+		//Paused time earns nothing, as SamplerUsage does not count it either.
+		sampler->lastNs = now;
+		for (int i = 0; i < sampler->count; i++){
+			sampler->sources[i].dueNs = now;
+		}
+	}
+	sampler->paused = paused != 0;
+}
+
+
+/* What the bucket holds at most: SAMPLER_WINDOW_NS worth, or the expected cost of the most expensive source
+ * if that is more, so that such a source can save up for a sample instead of running on credit.
+ */
+static double BucketSize(const Sampler *sampler){
+	double full = sampler->budget * (double)SAMPLER_WINDOW_NS;
+	for (int i = 0; i < sampler->count; i++){
+		if (sampler->sources[i].costNs > full){
+			full = sampler->sources[i].costNs;
+		}
+	}
+	return full;
+}
+
+
+//Adds the budget earned since the last refill, up to BucketSize.
+static void Refill(Sampler *sampler, uint64_t now){
+	double full = BucketSize(sampler);
+	sampler->tokensNs += (double)(now - sampler->lastNs) * sampler->budget;
+	if (sampler->tokensNs > full){
+		sampler->tokensNs = full;
+	}
+	sampler->lastNs = now;
+}
+
+
+//A change halves the interval, no change lengthens it by a quarter, a failure waits the longest.
+static void Adapt(SamplerSource *source, SampleResult result){
+	if (result == SAMPLE_Changed){
+		source->intervalNs /= 2;
+	}
+	else if (result == SAMPLE_Unchanged){
+		source->intervalNs += source->intervalNs / 4 + 1;
+	}
+	else {
+		source->intervalNs = source->maxNs;
+	}
+	if (source->intervalNs < source->minNs){
+		source->intervalNs = source->minNs;
+	}
+	if (source->intervalNs > source->maxNs){
+		source->intervalNs = source->maxNs;
+	}
+}
+
+
+long SamplerRun(Sampler *sampler){
+
+	if (sampler->paused || sampler->count == 0){
+		return -1;
+	}
+	uint64_t now = sampler->clock(sampler->clockUser);
+	Refill(sampler, now);
+
+	int ran = 0;
+	for (int i = 0; i < sampler->count; i++){
+		SamplerSource *source = &sampler->sources[i];
+		if (source->dueNs > now){
+			continue;
+		}
+		/* Wait until the bucket covers the expected cost (a budget of 0 or less is no limit). The first sample
+		 * of a source has no cost yet and only waits until the bucket is out of debt.
+		 */
+		double needed = source->stats.samples ? source->costNs : 0.0;
+		if (sampler->budget > 0 && needed > sampler->tokensNs){
+			source->stats.deferred++;
+			source->dueNs = now + (uint64_t)((needed - sampler->tokensNs) / sampler->budget) + 1;
+			continue;
+		}
+
+		SampleResult result = source->fn(source->user);
+		uint64_t end = sampler->clock(sampler->clockUser);
+		uint64_t cost = end - now;
+		Refill(sampler, end);
+		sampler->tokensNs -= (double)cost;
+
+		SamplerSourceStats *s = &source->stats;
+		s->samples++;
+		s->changed += result == SAMPLE_Changed;
+		s->failed += result == SAMPLE_Failed;
+		s->busyNs += cost;
+		source->costNs = s->samples == 1 ? (double)cost : source->costNs + ((double)cost - source->costNs) * SAMPLER_COST_WEIGHT / 16.0;
+		Adapt(source, result);
+		source->dueNs = end + source->intervalNs;
+		now = end;
+		ran = 1;
+	}
+	sampler->runs += ran;
+
+	uint64_t next = UINT64_MAX;
+	for (int i = 0; i < sampler->count; i++){
+		if (sampler->sources[i].dueNs < next){
+			next = sampler->sources[i].dueNs;
+		}
+	}
+	now = sampler->clock(sampler->clockUser);
+	return next <= now ? 0 : (long)((next - now + 999999) / 1000000);
+}
+
+
+//Time not spent paused since SamplerInit.
+static uint64_t ActiveNs(const Sampler *sampler){
+	uint64_t now = sampler->clock(sampler->clockUser);
+	uint64_t paused = sampler->pausedNs + (sampler->paused ? now - sampler->pausedAt : 0);
+	uint64_t active = now - sampler->startNs - paused;
+	return active ? active : 1;
+}
+
+
+double SamplerRate(const Sampler *sampler, int source){
+	if (source < 0 || source >= sampler->count){
+		return 0.0;
+	}
+	return (double)sampler->sources[source].stats.samples * 1e9 / (double)ActiveNs(sampler);
+}
+
+
+double SamplerUsage(const Sampler *sampler){
+	uint64_t busy = 0;
+	for (int i = 0; i < sampler->count; i++){
+		busy += sampler->sources[i].stats.busyNs;
+	}
+	return sampler->budget > 0 ? (double)busy / (double)ActiveNs(sampler) / sampler->budget : 0.0;
+}
+
+
+int SamplerDump(const Sampler *sampler, FILE *out){
+	fprintf(out, "%-12s %10s %9s %12s %10s %10s %10s %10s\n", "source", "samples", "per s", "interval ms", "changed", "failed",
+		"deferred", "cost us");
+	for (int i = 0; i < sampler->count; i++){
+		const SamplerSource *source = &sampler->sources[i];
+		const SamplerSourceStats *s = &source->stats;
+		fprintf(out, "%-12s %10llu %9.2f %12.1f %10llu %10llu %10llu %10.1f\n", source->name, (unsigned long long)s->samples,
+			SamplerRate(sampler, i), (double)source->intervalNs / 1e6, (unsigned long long)s->changed, (unsigned long long)s->failed,
+			(unsigned long long)s->deferred, source->costNs / 1e3);
+	}
+	uint64_t active = ActiveNs(sampler);
+	uint64_t now = sampler->clock(sampler->clockUser);
+	return fprintf(out, "budget %.2f%% of a core, %.1f%% of it used over %.1f s active, %.1f s paused\n", sampler->budget * 100.0,
+		SamplerUsage(sampler) * 100.0, (double)active / 1e9, (double)(now - sampler->startNs - active) / 1e9) > 0;
+}
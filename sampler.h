@@ -0,0 +1,141 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Schedules the periodic reads of game data (the HUD capture, the game's memory) on the message loop.
+ *
+ * Every source samples as often as its values change: an interval that found a change is halved, one that
+ * found none grows by a quarter, within the source's range, and a failed sample (the game is not running)
+ * waits the longest interval. On top of that all sources share a CPU budget, a fraction of one core: time
+ * spent sampling is paid from a bucket that starts empty and refills at budget nanoseconds per nanosecond,
+ * holding SAMPLER_WINDOW_NS worth (more if a source costs more than that, so it can save up for a sample),
+ * and a source whose expected cost is not covered waits until it is. Only the first sample of a source, whose
+ * cost is not known yet, runs on credit, once the bucket is out of debt. While paused (the game is minimised)
+ * nothing runs, nothing is scheduled and nothing is earned.
+ *
+ * SamplerRun runs what is due and returns when to call it next, so the caller needs a single one-shot
+ * timer. Time comes from a clock function, so anno_calc bench-sampler can run a simulated day in a second.
+ */
+
+
+#define SAMPLER_MAX_SOURCES 8
+
+//Default budget: 1% of one core.
+#define SAMPLER_BUDGET 0.01
+
+//The budget bucket holds this much time's worth of budget.
+#define SAMPLER_WINDOW_NS 1000000000ULL
+
+//Weight of the newest sample in the expected cost of a source, in 1/16.
+#define SAMPLER_COST_WEIGHT 4
+
+
+typedef enum SampleResult {
+	SAMPLE_Unchanged,	//the values are the ones of the last sample
+	SAMPLE_Changed,		//a value changed
+	SAMPLE_Failed		//nothing could be read
+} SampleResult;
+
+
+typedef SampleResult (*SamplerFn)(void *user);
+
+typedef uint64_t (*SamplerClockFn)(void *user);
+
+
+/* samples / changed / failed : samples taken and their results
+ * deferred : times the source was due but had to wait for the budget
+ * busyNs : time spent in fn
+ */
+typedef struct SamplerSourceStats {
+	uint64_t samples;
+	uint64_t changed;
+	uint64_t failed;
+	uint64_t deferred;
+	uint64_t busyNs;
+} SamplerSourceStats;
+
+
+/* name / fn / user : what is sampled
+ * minNs / maxNs : range of the interval
+ * intervalNs : the current interval
+ * dueNs : when the source runs next
+ * costNs : expected time of a sample, a running average
+ */
+typedef struct SamplerSource {
+	const char *name;
+	SamplerFn fn;
+	void *user;
+	uint64_t minNs;
+	uint64_t maxNs;
+	uint64_t intervalNs;
+	uint64_t dueNs;
+	double costNs;
+	SamplerSourceStats stats;
+} SamplerSource;
+
+
+/* sources / count : the sources, in the order they were added
+ * budget : fraction of one core sampling may use
+ * tokensNs : sampling time left in the bucket, negative after a sample that cost more than expected
+ * clock / clockUser : the time
+ * paused : SamplerPause(1) is in effect
+ * lastNs : when the bucket was last refilled
+ * startNs / pausedNs : when the sampler started and the time spent paused since, for the rates
+ * pausedAt : when the current pause started
+ * runs : SamplerRun calls that ran at least one source
+ */
+typedef struct Sampler {
+	SamplerSource sources[SAMPLER_MAX_SOURCES];
+	int count;
+	double budget;
+	double tokensNs;
+	SamplerClockFn clock;
+	void *clockUser;
+	int paused;
+	uint64_t lastNs;
+	uint64_t startNs;
+	uint64_t pausedNs;
+	uint64_t pausedAt;
+	uint64_t runs;
+} Sampler;
+
+
+/* Starts without sources and an empty bucket. clock NULL uses SysNowNs.
+ */
+void SamplerInit(Sampler *sampler, double budget, SamplerClockFn clock, void *clockUser);
+
+
+/* Adds a source sampled every minMs to maxMs milliseconds, due at once. Returns its index, -1 if there
+ * are SAMPLER_MAX_SOURCES already.
+ */
+int SamplerAdd(Sampler *sampler, const char *name, SamplerFn fn, void *user, uint32_t minMs, uint32_t maxMs);
+
+
+/* Stops (paused 1) or resumes (0) sampling. On resuming every source is due at once.
+ */
+void SamplerPause(Sampler *sampler, int paused);
+
+
+/* Runs every source that is due and the budget allows. Returns the milliseconds until the next source is
+ * due (0 if one is due now), -1 while paused or without sources.
+ */
+long SamplerRun(Sampler *sampler);
+
+
+/* Samples per second a source achieved, not counting paused time.
+ */
+double SamplerRate(const Sampler *sampler, int source);
+
+
+/* Time spent sampling as a fraction of the budget (1.0 is all of it), not counting paused time.
+ */
+double SamplerUsage(const Sampler *sampler);
+
+
+/* Writes the rates, intervals and budget usage as a table. Returns 0 on a write error.
+ */
+int SamplerDump(const Sampler *sampler, FILE *out);
+
+#endif
@@ -0,0 +1,1428 @@
+#include <stdio.h>	//FILE
+#include <stdlib.h>	//malloc, free
+#include <string.h>	//memcpy, memcmp, memchr
+#include <time.h>	//time
+
+#include <zlib.h>
+
+#include "savegame.h"
+#include "mapped_file.h"
+#include "sys_thread.h"
+
+
+//Bytes inflated or read per step. Also the size of the reader and stage buffers.
+#define CHUNK_BYTES (64 * 1024)
+
+
+/* RDA v2.2 layout: an 18 byte magic, 766 unused bytes and the offset of the first block. Every block has a
+ * 32 byte header, its file directory lies right in front of the header.
+ */
+#define RDA_MAGIC "Resource File V2.2"
+#define RDA_MAGIC_BYTES 18
+#define RDA_FIRST_BLOCK_OFFSET 784
+#define RDA_HEADER_BYTES 792
+#define RDA_BLOCK_HEADER_BYTES 32
+
+//Directory entry: 260 UTF-16 characters of path, then offset, compressed size, size, timestamp, unused (u64).
+#define RDA_ENTRY_BYTES 560
+#define RDA_ENTRY_NAME_CHARS 260
+
+enum {
+	RDA_BLOCK_Compressed = 1,
+	RDA_BLOCK_Encrypted = 2,
+	RDA_BLOCK_MemoryResident = 4,
+	RDA_BLOCK_Deleted = 8
+};
+
+#define SAVE_DATA_ENTRY "data.a7s"
+
+
+/* Population tier residences of the base game and the three DLC sessions, named like the tiers in chain_data.c.
+ */
+static const SaveResidence g_defaultResidences[] = {
+	{1010343, "Farmers"},
+	{1010344, "Workers"},
+	{1010345, "Artisans"},
+	{1010346, "Engineers"},
+	{1010347, "Investors"},
+	{101254, "Jornaleros"},
+	{101255, "Obreros"},
+	{112091, "Explorers"},
+	{112652, "Technicians"},
+	{114445, "Shepherds"},
+	{114446, "Elders"}
+};
+
+_Static_assert(sizeof(g_defaultResidences) / sizeof(g_defaultResidences[0]) <= SAVE_MAX_TIERS, "too many default residences");
+
+
+static const char *g_statusNames[] = {
+	[SAVE_Ok]		= "ok",
+	[SAVE_NoFile]		= "could not open file",
+	[SAVE_NotArchive]	= "not an RDA v2.2 archive",
+	[SAVE_NoData]		= "no " SAVE_DATA_ENTRY " in archive",
+	[SAVE_Unsupported]	= "unsupported archive or data",
+	[SAVE_Corrupt]		= "corrupt",
+	[SAVE_OutOfMemory]	= "out of memory",
+	[SAVE_NoIsland]		= "no such island"
+};
+
+
+const char *SaveStatusName(SaveStatus status){
+	if ((int)status < 0 || status > SAVE_NoIsland){
+		return "(unknown)";
+	}
+	return g_statusNames[status];
+}
+
+
+void SaveDefaultQuery(SaveQuery *query){
+	query->listTag = "AreaManagerData";
+	query->guidAttrib = "guid";
+	query->residences = g_defaultResidences;
+	query->residenceCount = (int)(sizeof(g_defaultResidences) / sizeof(g_defaultResidences[0]));
+	query->threads = 0;
+}
+
+
+//Both formats are little endian.
+static uint32_t ReadU32(const unsigned char *p){
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t ReadU64(const unsigned char *p){
+	return (uint64_t)ReadU32(p) | (uint64_t)ReadU32(p + 4) << 32;
+}
+
+static void WriteU32(unsigned char *p, uint32_t v){
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+	p[2] = (unsigned char)(v >> 16);
+	p[3] = (unsigned char)(v >> 24);
+}
+
+static void WriteU64(unsigned char *p, uint64_t v){
+	WriteU32(p, (uint32_t)v);
+	WriteU32(p + 4, (uint32_t)(v >> 32));
+}
+
+
+/* ---------------------------------------------------------------------------------------------------------
+ * Archive
+ */
+
+
+/* Position of data.a7s inside the mapped archive.
+ *
+ * compressed : the archive block compresses its files
+ */
+typedef struct DataEntry {
+	const unsigned char *data;
+	size_t size;
+	uint64_t decompressedSize;
+	int compressed;
+} DataEntry;
+
+
+//Compares a UTF-16 directory path with SAVE_DATA_ENTRY, with or without leading directories.
+static int IsDataEntryName(const unsigned char *name){
+	char ascii[RDA_ENTRY_NAME_CHARS + 1];
+	int len = 0;
+
+	while (len < RDA_ENTRY_NAME_CHARS && (name[len * 2] != 0 || name[len * 2 + 1] != 0)){
+		ascii[len] = name[len * 2 + 1] == 0 ? (char)name[len * 2] : '?';
+		len++;
+	}
+	ascii[len] = '\0';
+
+	int want = (int)sizeof(SAVE_DATA_ENTRY) - 1;
+	if (len < want || memcmp(ascii + len - want, SAVE_DATA_ENTRY, (size_t)want) != 0){
+		return 0;
+	}
+	return len == want || ascii[len - want - 1] == '/' || ascii[len - want - 1] == '\\';
+}
+
+
+/* Walks the block chain of the archive and finds data.a7s. Directories are a few kilobytes and are
+ * inflated as a whole.
+ */
+static SaveStatus FindDataEntry(const MappedFile *mf, DataEntry *entry){
+
+	const unsigned char *file = mf->data;
+	size_t size = mf->size;
+	SaveStatus missing = SAVE_NoData;
+
+	if (size < RDA_HEADER_BYTES || memcmp(file, RDA_MAGIC, RDA_MAGIC_BYTES) != 0){
+		return SAVE_NotArchive;
+	}
+
+	uint64_t offset = ReadU64(file + RDA_FIRST_BLOCK_OFFSET);
+
+	//The chain ends at 0 or at the end of the file, where the last block's next points. Any other offset has to
+	//hold a block header, otherwise the archive is truncated.
+	while (offset != 0 && offset != size){
+
+		if (offset < RDA_HEADER_BYTES || offset > size || size - offset < RDA_BLOCK_HEADER_BYTES){
+			return SAVE_Corrupt;
+		}
+
+		const unsigned char *block = file + offset;
+		uint32_t flags = ReadU32(block);
+		uint32_t fileCount = ReadU32(block + 4);
+		uint64_t directorySize = ReadU64(block + 8);
+		uint64_t decompressedSize = ReadU64(block + 16);
+		uint64_t next = ReadU64(block + 24);
+
+		if (directorySize > offset - RDA_HEADER_BYTES || decompressedSize != (uint64_t)fileCount * RDA_ENTRY_BYTES){
+			return SAVE_Corrupt;
+		}
+
+		if (flags & (RDA_BLOCK_Encrypted | RDA_BLOCK_MemoryResident)){
+			missing = SAVE_Unsupported;
+		}
+		else if (!(flags & RDA_BLOCK_Deleted) && fileCount > 0){
+
+			const unsigned char *directory = file + offset - directorySize;
+			unsigned char *inflated = NULL;
+
+			if (flags & RDA_BLOCK_Compressed){
+				uLongf length = (uLongf)decompressedSize;
+				inflated = malloc((size_t)decompressedSize);
+				if (!inflated){
+					return SAVE_OutOfMemory;
+				}
+				if (uncompress(inflated, &length, directory, (uLong)directorySize) != Z_OK || length != decompressedSize){
+					free(inflated);
+					return SAVE_Corrupt;
+				}
+				directory = inflated;
+			}
+			else if (directorySize != decompressedSize){
+				return SAVE_Corrupt;
+			}
+
+			for (uint32_t i = 0; i < fileCount; i++){
+				const unsigned char *e = directory + (size_t)i * RDA_ENTRY_BYTES;
+				if (!IsDataEntryName(e)){
+					continue;
+				}
+				uint64_t dataOffset = ReadU64(e + RDA_ENTRY_NAME_CHARS * 2);
+				uint64_t compressedSize = ReadU64(e + RDA_ENTRY_NAME_CHARS * 2 + 8);
+				uint64_t dataSize = ReadU64(e + RDA_ENTRY_NAME_CHARS * 2 + 16);
+				free(inflated);
+				if (dataOffset > size || compressedSize > size - dataOffset){
+					return SAVE_Corrupt;
+				}
+				entry->data = file + dataOffset;
+				entry->size = (size_t)compressedSize;
+				entry->decompressedSize = dataSize;
+				entry->compressed = (flags & RDA_BLOCK_Compressed) != 0;
+				return SAVE_Ok;
+			}
+			free(inflated);
+		}
+
+		if (next <= offset){
+			break;
+		}
+		offset = next;
+	}
+	return missing;
+}
+
+
+/* ---------------------------------------------------------------------------------------------------------
+ * Streaming decompression
+ */
+
+
+/* One step of the decompression chain. Reads either straight from the mapped archive or from the stage
+ * before it, and either inflates or passes the bytes on as they are.
+ *
+ * memory / memoryLeft : input still to read from the mapping (no upstream)
+ * input : chunk buffer for the input from upstream
+ */
+typedef struct Stage {
+	int inflating;
+	struct Stage *upstream;
+	const unsigned char *memory;
+	size_t memoryLeft;
+	z_stream z;
+	int zReady;
+	int ended;
+	unsigned char *input;
+} Stage;
+
+
+/* Reads up to cap bytes into out. Returns the number of bytes, 0 at the end of the stream or -1 if the
+ * zlib data is broken or ends too early.
+ */
+static long StageRead(Stage *s, unsigned char *out, size_t cap){
+
+	if (!s->inflating){
+		size_t n = cap < s->memoryLeft ? cap : s->memoryLeft;
+		memcpy(out, s->memory, n);
+		s->memory += n;
+		s->memoryLeft -= n;
+		return (long)n;
+	}
+
+	if (s->ended){
+		return 0;
+	}
+
+	s->z.next_out = out;
+	s->z.avail_out = (uInt)cap;
+
+	while (s->z.avail_out == cap){
+
+		if (s->z.avail_in == 0){
+			if (s->upstream){
+				long got = StageRead(s->upstream, s->input, CHUNK_BYTES);
+				if (got < 0){
+					return -1;
+				}
+				s->z.next_in = s->input;
+				s->z.avail_in = (uInt)got;
+			}
+			else{
+				size_t n = s->memoryLeft < (1u << 30) ? s->memoryLeft : (1u << 30);
+				s->z.next_in = (Bytef *)s->memory;
+				s->z.avail_in = (uInt)n;
+				s->memory += n;
+				s->memoryLeft -= n;
+			}
+			if (s->z.avail_in == 0){
+				return -1;
+			}
+		}
+
+		int ret = inflate(&s->z, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END){
+			s->ended = 1;
+			break;
+		}
+		if (ret != Z_OK && ret != Z_BUF_ERROR){
+			return -1;
+		}
+	}
+	return (long)(cap - s->z.avail_out);
+}
+
+
+static int StageInflateInit(Stage *s){
+	memset(&s->z, 0, sizeof(s->z));
+	s->inflating = 1;
+	s->zReady = (inflateInit(&s->z) == Z_OK);
+	return s->zReady;
+}
+
+
+static int IsZlibHeader(const unsigned char *p){
+	return (p[0] & 0x0F) == Z_DEFLATED && ((p[0] << 8) | p[1]) % 31 == 0;
+}
+
+
+/* data.a7s from the archive to the FileDB bytes. The outer stage undoes the archive compression, the inner
+ * stage the zlib layer inside the entry if there is one; which one it is is decided on the first chunk.
+ *
+ * pending : first chunk of the outer stage, handed out first when there is no inner layer
+ */
+typedef struct Pipeline {
+	Stage outer;
+	Stage inner;
+	Stage *top;
+	unsigned char *pending;
+	size_t pendingPos;
+	size_t pendingLen;
+	int layers;
+} Pipeline;
+
+
+static void PipelineClose(Pipeline *p){
+	if (p->outer.zReady){
+		inflateEnd(&p->outer.z);
+	}
+	if (p->inner.zReady){
+		inflateEnd(&p->inner.z);
+	}
+	free(p->inner.input);
+	memset(p, 0, sizeof(*p));
+}
+
+
+static SaveStatus PipelineOpen(Pipeline *p, const DataEntry *entry){
+
+	memset(p, 0, sizeof(*p));
+	p->outer.memory = entry->data;
+	p->outer.memoryLeft = entry->size;
+	if (entry->compressed && !StageInflateInit(&p->outer)){
+		return SAVE_OutOfMemory;
+	}
+
+	p->inner.input = malloc(CHUNK_BYTES);
+	if (!p->inner.input){
+		PipelineClose(p);
+		return SAVE_OutOfMemory;
+	}
+
+	long got = StageRead(&p->outer, p->inner.input, CHUNK_BYTES);
+	if (got < 0){
+		PipelineClose(p);
+		return SAVE_Corrupt;
+	}
+
+	p->layers = entry->compressed;
+	if (got >= 2 && IsZlibHeader(p->inner.input)){
+		if (!StageInflateInit(&p->inner)){
+			PipelineClose(p);
+			return SAVE_OutOfMemory;
+		}
+		p->inner.upstream = &p->outer;
+		p->inner.z.next_in = p->inner.input;
+		p->inner.z.avail_in = (uInt)got;
+		p->top = &p->inner;
+		p->layers++;
+	}
+	else{
+		p->pending = p->inner.input;
+		p->pendingLen = (size_t)got;
+		p->top = &p->outer;
+	}
+	return SAVE_Ok;
+}
+
+
+static long PipelineRead(Pipeline *p, unsigned char *out, size_t cap){
+	if (p->pendingPos < p->pendingLen){
+		size_t n = p->pendingLen - p->pendingPos;
+		if (n > cap){
+			n = cap;
+		}
+		memcpy(out, p->pending + p->pendingPos, n);
+		p->pendingPos += n;
+		return (long)n;
+	}
+	return StageRead(p->top, out, cap);
+}
+
+
+/* Buffered reads from the pipeline for the tokenizer.
+ *
+ * offset : position in the FileDB stream of the next byte to read
+ * failed : the pipeline reported broken data
+ */
+typedef struct Reader {
+	Pipeline *pipeline;
+	unsigned char *buffer;
+	size_t pos;
+	size_t len;
+	uint64_t offset;
+	int failed;
+} Reader;
+
+
+static int ReaderFill(Reader *r){
+	long got = PipelineRead(r->pipeline, r->buffer, CHUNK_BYTES);
+	if (got <= 0){
+		r->failed |= (got < 0);
+		return 0;
+	}
+	r->pos = 0;
+	r->len = (size_t)got;
+	return 1;
+}
+
+
+//Copies n bytes to dst (dst may be NULL to skip them). Returns 0 if the stream ended first.
+static int ReaderRead(Reader *r, void *dst, uint64_t n){
+	unsigned char *d = dst;
+	while (n > 0){
+		if (r->pos == r->len && !ReaderFill(r)){
+			return 0;
+		}
+		size_t take = r->len - r->pos;
+		if (take > n){
+			take = (size_t)n;
+		}
+		if (d){
+			memcpy(d, r->buffer + r->pos, take);
+			d += take;
+		}
+		r->pos += take;
+		r->offset += take;
+		n -= take;
+	}
+	return 1;
+}
+
+
+/* ---------------------------------------------------------------------------------------------------------
+ * FileDB dictionaries
+ */
+
+
+/* The end of the FileDB stream as kept by the first pass.
+ *
+ * tail : the last tailLen bytes of the stream, which start at stream offset tailStart
+ * total : size of the stream
+ */
+typedef struct Dictionary {
+	unsigned char *tail;
+	size_t tailLen;
+	uint64_t tailStart;
+	uint64_t total;
+	uint64_t tagsOffset;
+	uint64_t attribsOffset;
+} Dictionary;
+
+
+/* First pass: inflates the whole entry, keeping only the last SAVE_DICTIONARY_MAX bytes in a ring buffer,
+ * then finds the dictionaries through the trailer.
+ */
+static SaveStatus ReadDictionary(const DataEntry *entry, Dictionary *dict, int *layers){
+
+	Pipeline pipeline;
+	SaveStatus status = PipelineOpen(&pipeline, entry);
+	if (status != SAVE_Ok){
+		return status;
+	}
+	*layers = pipeline.layers;
+
+	unsigned char *ring = malloc(SAVE_DICTIONARY_MAX);
+	unsigned char *chunk = malloc(CHUNK_BYTES);
+	if (!ring || !chunk){
+		free(ring);
+		free(chunk);
+		PipelineClose(&pipeline);
+		return SAVE_OutOfMemory;
+	}
+
+	uint64_t total = 0;
+	size_t write = 0;
+	long got;
+	while ((got = PipelineRead(&pipeline, chunk, CHUNK_BYTES)) > 0){
+		size_t n = (size_t)got;
+		size_t first = SAVE_DICTIONARY_MAX - write;
+		if (first > n){
+			first = n;
+		}
+		memcpy(ring + write, chunk, first);
+		memcpy(ring, chunk + first, n - first);
+		write = (write + n) % SAVE_DICTIONARY_MAX;
+		total += n;
+	}
+	PipelineClose(&pipeline);
+	free(chunk);
+
+	if (got < 0){
+		free(ring);
+		return SAVE_Corrupt;
+	}
+
+	//Unroll the ring so the tail is in stream order.
+	if (total > SAVE_DICTIONARY_MAX && write != 0){
+		unsigned char *tail = malloc(SAVE_DICTIONARY_MAX);
+		if (!tail){
+			free(ring);
+			return SAVE_OutOfMemory;
+		}
+		memcpy(tail, ring + write, SAVE_DICTIONARY_MAX - write);
+		memcpy(tail + SAVE_DICTIONARY_MAX - write, ring, write);
+		free(ring);
+		ring = tail;
+	}
+
+	dict->tail = ring;
+	dict->tailLen = total < SAVE_DICTIONARY_MAX ? (size_t)total : SAVE_DICTIONARY_MAX;
+	dict->tailStart = total - dict->tailLen;
+	dict->total = total;
+
+	const unsigned char *end = ring + dict->tailLen;
+	if (dict->tailLen < FILEDB_TRAILER_BYTES || memcmp(end - 8, FILEDB_MAGIC, 8) != 0){
+		return SAVE_Corrupt;
+	}
+	dict->tagsOffset = ReadU32(end - 16);
+	dict->attribsOffset = ReadU32(end - 12);
+	if (dict->tagsOffset > dict->attribsOffset || dict->attribsOffset > total - FILEDB_TRAILER_BYTES){
+		return SAVE_Corrupt;
+	}
+	if (dict->tagsOffset < dict->tailStart){
+		return SAVE_Unsupported;
+	}
+	return SAVE_Ok;
+}
+
+
+/* Looks name up in the dictionary section [start, end) of the stream: int32 count, count uint16 ids and
+ * count null terminated names. Returns the id or -1.
+ */
+static long DictionaryFind(const Dictionary *dict, uint64_t start, uint64_t end, const char *name){
+
+	const unsigned char *p = dict->tail + (start - dict->tailStart);
+	const unsigned char *limit = dict->tail + (end - dict->tailStart);
+	size_t nameLen = strlen(name);
+
+	if (limit - p < 4){
+		return -1;
+	}
+	uint32_t count = ReadU32(p);
+	if ((uint64_t)count * 2 > (uint64_t)(limit - p - 4)){
+		return -1;
+	}
+	const unsigned char *ids = p + 4;
+	const unsigned char *s = ids + (size_t)count * 2;
+
+	for (uint32_t i = 0; i < count && s < limit; i++){
+		const unsigned char *nul = memchr(s, 0, (size_t)(limit - s));
+		if (!nul){
+			break;
+		}
+		if ((size_t)(nul - s) == nameLen && memcmp(s, name, nameLen) == 0){
+			return (long)(ids[i * 2] | ids[i * 2 + 1] << 8);
+		}
+		s = nul + 1;
+	}
+	return -1;
+}
+
+
+/* ---------------------------------------------------------------------------------------------------------
+ * Islands
+ */
+
+
+/* One island subtree, without its own opening and closing node.
+ */
+typedef struct IslandJob {
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+	SaveIsland result;
+} IslandJob;
+
+
+/* What the workers count.
+ *
+ * guidId : attribute id of the GUID attribute, -1 if the save has none
+ */
+typedef struct Counter {
+	long guidId;
+	long guids[SAVE_MAX_TIERS];
+	int guidCount;
+} Counter;
+
+
+static void CountIsland(IslandJob *job, const Counter *counter){
+
+	const unsigned char *p = job->data;
+	const unsigned char *end = p + job->size;
+
+	job->result.bytes = job->size;
+
+	while (end - p >= 8){
+		uint32_t size = ReadU32(p);
+		uint32_t id = ReadU32(p + 4);
+		p += 8;
+		if (id < FILEDB_ATTRIB_FIRST){
+			continue;
+		}
+		if ((long)id == counter->guidId && size >= 4 && (uint64_t)(end - p) >= size){
+			long guid = (long)(int32_t)ReadU32(p);
+			job->result.objects++;
+			for (int i = 0; i < counter->guidCount; i++){
+				if (counter->guids[i] == guid){
+					job->result.residences[i]++;
+					break;
+				}
+			}
+		}
+		uint64_t padded = ((uint64_t)size + 7) & ~(uint64_t)7;
+		if (padded > (uint64_t)(end - p)){
+			break;
+		}
+		p += padded;
+	}
+}
+
+
+/* Bounded queue from the tokenizer to the workers.
+ *
+ * ready : signalled when a job was queued or the queue is closing
+ * space : signalled when a job was taken
+ * bufferedBytes : island bytes queued or being counted
+ */
+typedef struct WorkQueue {
+	SysMutex mutex;
+	SysCond ready;
+	SysCond space;
+	IslandJob **jobs;
+	int head;
+	int count;
+	int capacity;
+	int closing;
+	const Counter *counter;
+	uint64_t bufferedBytes;
+	uint64_t peakBufferedBytes;
+} WorkQueue;
+
+
+static void WorkerMain(void *arg){
+
+	WorkQueue *q = arg;
+
+	for (;;){
+		SysMutexLock(&q->mutex);
+		while (q->count == 0 && !q->closing){
+			SysCondWait(&q->ready, &q->mutex);
+		}
+		if (q->count == 0){
+			SysMutexUnlock(&q->mutex);
+			return;
+		}
+		IslandJob *job = q->jobs[q->head];
+		q->head = (q->head + 1) % q->capacity;
+		q->count--;
+		SysCondSignal(&q->space);
+		SysMutexUnlock(&q->mutex);
+
+		CountIsland(job, q->counter);
+		free(job->data);
+		job->data = NULL;
+
+		SysMutexLock(&q->mutex);
+		q->bufferedBytes -= job->size;
+		SysMutexUnlock(&q->mutex);
+	}
+}
+
+
+//Hands a finished island to the workers, waiting while the queue is full.
+static void QueuePush(WorkQueue *q, IslandJob *job){
+	SysMutexLock(&q->mutex);
+	while (q->count == q->capacity){
+		SysCondWait(&q->space, &q->mutex);
+	}
+	q->jobs[(q->head + q->count) % q->capacity] = job;
+	q->count++;
+	q->bufferedBytes += job->size;
+	if (q->bufferedBytes > q->peakBufferedBytes){
+		q->peakBufferedBytes = q->bufferedBytes;
+	}
+	SysCondSignal(&q->ready);
+	SysMutexUnlock(&q->mutex);
+}
+
+
+//Makes room for n more bytes in the island buffer.
+static int JobReserve(IslandJob *job, uint64_t n){
+	if (job->size + n <= job->capacity){
+		return 1;
+	}
+	size_t capacity = job->capacity ? job->capacity : CHUNK_BYTES;
+	while (capacity < job->size + n){
+		capacity *= 2;
+	}
+	unsigned char *data = realloc(job->data, capacity);
+	if (!data){
+		return 0;
+	}
+	job->data = data;
+	job->capacity = capacity;
+	return 1;
+}
+
+
+/* Everything the second pass keeps.
+ *
+ * jobs : every island in save order, owned here; the workers only fill in the result
+ * queue / threads : the workers, threadCount 0 when the islands are counted on this thread
+ */
+typedef struct Tokenizer {
+	Reader reader;
+	long listTagId;
+	uint64_t nodes;
+	IslandJob **jobs;
+	long jobCount;
+	long jobCapacity;
+	Counter counter;
+	WorkQueue queue;
+	SysThread *threads;
+	int threadCount;
+	uint64_t peakInlineBytes;
+} Tokenizer;
+
+
+static SaveStatus SubmitIsland(Tokenizer *t, IslandJob *job){
+
+	if (t->jobCount == t->jobCapacity){
+		long capacity = t->jobCapacity ? t->jobCapacity * 2 : 64;
+		IslandJob **jobs = realloc(t->jobs, (size_t)capacity * sizeof(*jobs));
+		if (!jobs){
+			return SAVE_OutOfMemory;
+		}
+		t->jobs = jobs;
+		t->jobCapacity = capacity;
+	}
+	job->result.index = t->jobCount;
+	t->jobs[t->jobCount++] = job;
+
+	if (t->threadCount == 0){
+		if (job->size > t->peakInlineBytes){
+			t->peakInlineBytes = job->size;
+		}
+		CountIsland(job, &t->counter);
+		free(job->data);
+		job->data = NULL;
+	}
+	else{
+		QueuePush(&t->queue, job);
+	}
+	return SAVE_Ok;
+}
+
+
+/* Second pass: walks the node stream up to the dictionaries. Islands are copied node by node into their
+ * own buffer, everything else is skipped without copying.
+ */
+static SaveStatus Tokenize(Tokenizer *t, uint64_t end){
+
+	Reader *r = &t->reader;
+	long depth = 0;
+	long listDepth = -1;
+	long captureDepth = -1;
+	IslandJob *capture = NULL;
+	SaveStatus status = SAVE_Ok;
+
+	while (r->offset < end){
+
+		unsigned char header[8];
+		if (!ReaderRead(r, header, 8)){
+			status = SAVE_Corrupt;
+			break;
+		}
+		uint32_t size = ReadU32(header);
+		uint32_t id = ReadU32(header + 4);
+		t->nodes++;
+
+		if (id == 0){
+			if (depth == 0){
+				status = SAVE_Corrupt;
+				break;
+			}
+			if (capture && depth == captureDepth){
+				status = SubmitIsland(t, capture);
+				capture = NULL;
+				if (status != SAVE_Ok){
+					break;
+				}
+			}
+			else if (capture){
+				if (!JobReserve(capture, 8)){
+					status = SAVE_OutOfMemory;
+					break;
+				}
+				memcpy(capture->data + capture->size, header, 8);
+				capture->size += 8;
+			}
+			if (depth == listDepth){
+				listDepth = -1;
+			}
+			depth--;
+		}
+		else if (id < FILEDB_ATTRIB_FIRST){
+			depth++;
+			if (capture){
+				if (!JobReserve(capture, 8)){
+					status = SAVE_OutOfMemory;
+					break;
+				}
+				memcpy(capture->data + capture->size, header, 8);
+				capture->size += 8;
+			}
+			else if (listDepth >= 0 && depth == listDepth + 1){
+				capture = calloc(1, sizeof(*capture));
+				if (!capture){
+					status = SAVE_OutOfMemory;
+					break;
+				}
+				captureDepth = depth;
+			}
+			else if (listDepth < 0 && (long)id == t->listTagId){
+				listDepth = depth;
+			}
+		}
+		else{
+			uint64_t padded = ((uint64_t)size + 7) & ~(uint64_t)7;
+			if (padded > end - r->offset){
+				status = SAVE_Corrupt;
+				break;
+			}
+			if (capture){
+				if (!JobReserve(capture, 8 + padded)){
+					status = SAVE_OutOfMemory;
+					break;
+				}
+				memcpy(capture->data + capture->size, header, 8);
+				if (!ReaderRead(r, capture->data + capture->size + 8, padded)){
+					status = SAVE_Corrupt;
+					break;
+				}
+				capture->size += 8 + padded;
+			}
+			else if (!ReaderRead(r, NULL, padded)){
+				status = SAVE_Corrupt;
+				break;
+			}
+		}
+	}
+
+	if (capture){
+		free(capture->data);
+		free(capture);
+		if (status == SAVE_Ok){
+			status = SAVE_Corrupt;
+		}
+	}
+	if (r->failed){
+		status = SAVE_Corrupt;
+	}
+	return status;
+}
+
+
+SaveStatus SaveReadIslands(const char *path, const SaveQuery *query, SaveIslandFn fn, void *user, SaveStats *stats){
+
+	if (stats){
+		memset(stats, 0, sizeof(*stats));
+	}
+	if (query->residenceCount < 0 || query->residenceCount > SAVE_MAX_TIERS){
+		return SAVE_Unsupported;
+	}
+
+	MappedFile mf;
+	if (!MappedFileOpen(&mf, path, 1)){
+		return SAVE_NoFile;
+	}
+
+	DataEntry entry;
+	SaveStatus status = FindDataEntry(&mf, &entry);
+	if (status != SAVE_Ok){
+		MappedFileClose(&mf);
+		return status;
+	}
+
+	Dictionary dict = {0};
+	int layers = 0;
+	status = ReadDictionary(&entry, &dict, &layers);
+	if (status != SAVE_Ok){
+		free(dict.tail);
+		MappedFileClose(&mf);
+		return status;
+	}
+
+	Tokenizer t;
+	memset(&t, 0, sizeof(t));
+	t.listTagId = DictionaryFind(&dict, dict.tagsOffset, dict.attribsOffset, query->listTag);
+	t.counter.guidId = DictionaryFind(&dict, dict.attribsOffset, dict.total - FILEDB_TRAILER_BYTES, query->guidAttrib);
+	t.counter.guidCount = query->residenceCount;
+	for (int i = 0; i < query->residenceCount; i++){
+		t.counter.guids[i] = query->residences[i].guid;
+	}
+	free(dict.tail);
+
+	int threads = query->threads > 0 ? query->threads : SysCpuCount();
+	if (threads > 1 && t.listTagId >= 0){
+		t.queue.capacity = threads * 2;
+		t.queue.counter = &t.counter;
+		t.queue.jobs = malloc((size_t)t.queue.capacity * sizeof(*t.queue.jobs));
+		t.threads = malloc((size_t)threads * sizeof(*t.threads));
+		if (!t.queue.jobs || !t.threads){
+			free(t.queue.jobs);
+			free(t.threads);
+			MappedFileClose(&mf);
+			return SAVE_OutOfMemory;
+		}
+		SysMutexInit(&t.queue.mutex);
+		SysCondInit(&t.queue.ready);
+		SysCondInit(&t.queue.space);
+		while (t.threadCount < threads && SysThreadStart(&t.threads[t.threadCount], WorkerMain, &t.queue)){
+			t.threadCount++;
+		}
+	}
+
+	//Without the list tag there are no islands and the second pass has nothing to find.
+	Pipeline pipeline;
+	if (t.listTagId >= 0){
+		status = PipelineOpen(&pipeline, &entry);
+		if (status == SAVE_Ok){
+			t.reader.pipeline = &pipeline;
+			t.reader.buffer = malloc(CHUNK_BYTES);
+			status = t.reader.buffer ? Tokenize(&t, dict.tagsOffset) : SAVE_OutOfMemory;
+			free(t.reader.buffer);
+			PipelineClose(&pipeline);
+		}
+	}
+
+	uint64_t peak = t.peakInlineBytes;
+	if (t.queue.capacity > 0){
+		SysMutexLock(&t.queue.mutex);
+		t.queue.closing = 1;
+		SysCondBroadcast(&t.queue.ready);
+		SysMutexUnlock(&t.queue.mutex);
+		for (int i = 0; i < t.threadCount; i++){
+			SysThreadJoin(&t.threads[i]);
+		}
+		peak = t.queue.peakBufferedBytes;
+		SysCondDestroy(&t.queue.space);
+		SysCondDestroy(&t.queue.ready);
+		SysMutexDestroy(&t.queue.mutex);
+		free(t.queue.jobs);
+		free(t.threads);
+	}
+
+	int calling = (status == SAVE_Ok && fn != NULL);
+	for (long i = 0; i < t.jobCount; i++){
+		if (calling && !fn(&t.jobs[i]->result, user)){
+			calling = 0;
+		}
+		free(t.jobs[i]);
+	}
+	free(t.jobs);
+
+	if (stats){
+		stats->fileBytes = mf.size;
+		stats->compressedBytes = entry.size;
+		stats->dataBytes = dict.total;
+		stats->layers = layers;
+		stats->nodes = t.nodes;
+		stats->islands = t.jobCount;
+		stats->threads = t.threadCount > 0 ? t.threadCount : 1;
+		stats->peakBufferedBytes = peak;
+	}
+
+	MappedFileClose(&mf);
+	return status;
+}
+
+
+SaveStatus SaveExtractData(const char *path, const char *outPath, SaveStats *stats){
+
+	if (stats){
+		memset(stats, 0, sizeof(*stats));
+	}
+
+	MappedFile mf;
+	if (!MappedFileOpen(&mf, path, 1)){
+		return SAVE_NoFile;
+	}
+
+	DataEntry entry;
+	Pipeline pipeline;
+	SaveStatus status = FindDataEntry(&mf, &entry);
+	if (status == SAVE_Ok){
+		status = PipelineOpen(&pipeline, &entry);
+	}
+	if (status != SAVE_Ok){
+		MappedFileClose(&mf);
+		return status;
+	}
+
+	FILE *f = fopen(outPath, "wb");
+	unsigned char *chunk = malloc(CHUNK_BYTES);
+	uint64_t total = 0;
+	long got = 0;
+
+	if (!f || !chunk){
+		status = f ? SAVE_OutOfMemory : SAVE_NoFile;
+	}
+	else{
+		while ((got = PipelineRead(&pipeline, chunk, CHUNK_BYTES)) > 0){
+			if (fwrite(chunk, 1, (size_t)got, f) != (size_t)got){
+				status = SAVE_NoFile;
+				break;
+			}
+			total += (uint64_t)got;
+		}
+		if (got < 0){
+			status = SAVE_Corrupt;
+		}
+	}
+	if (f && fclose(f) != 0 && status == SAVE_Ok){
+		status = SAVE_NoFile;
+	}
+	if (f && status != SAVE_Ok){
+		remove(outPath);
+	}
+
+	if (stats){
+		stats->fileBytes = mf.size;
+		stats->compressedBytes = entry.size;
+		stats->dataBytes = total;
+		stats->layers = pipeline.layers;
+		stats->threads = 1;
+	}
+
+	free(chunk);
+	PipelineClose(&pipeline);
+	MappedFileClose(&mf);
+	return status;
+}
+
+
+/* ---------------------------------------------------------------------------------------------------------
+ * Islands from a FileDB tree
+ */
+
+
+/* Search state of SaveTreeIsland.
+ *
+ * seen : islands passed so far
+ * found : the island, once reached
+ */
+typedef struct TreeSearch {
+	long index;
+	long seen;
+	FileDbNode *found;
+} TreeSearch;
+
+
+static int VisitIslandList(FileDb *db, FileDbNode *list, void *user){
+	TreeSearch *search = user;
+	for (FileDbNode *island = FileDbChildren(db, list); island; island = island->next){
+		if (FileDbIsAttrib(island)){
+			continue;
+		}
+		if (search->seen++ == search->index){
+			search->found = island;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+static void CountTree(FileDb *db, FileDbNode *node, const Counter *counter, SaveIsland *out){
+	for (FileDbNode *child = FileDbChildren(db, node); child; child = child->next){
+		if (!FileDbIsAttrib(child)){
+			CountTree(db, child, counter, out);
+			continue;
+		}
+		int64_t guid;
+		if ((long)child->id != counter->guidId || !FileDbInt(child, &guid)){
+			continue;
+		}
+		out->objects++;
+		for (int i = 0; i < counter->guidCount; i++){
+			if (counter->guids[i] == guid){
+				out->residences[i]++;
+				break;
+			}
+		}
+	}
+}
+
+
+SaveStatus SaveTreeIsland(FileDb *db, const SaveQuery *query, long index, SaveIsland *out){
+
+	memset(out, 0, sizeof(*out));
+	if (query->residenceCount < 0 || query->residenceCount > SAVE_MAX_TIERS){
+		return SAVE_Unsupported;
+	}
+
+	long listId = FileDbTagId(db, query->listTag);
+	if (listId < 0 || index < 0){
+		return SAVE_NoIsland;
+	}
+
+	TreeSearch search = {index, 0, NULL};
+	FileDbVisitTags(db, &db->root, listId, SAVE_LIST_MAX_DEPTH, VisitIslandList, &search);
+	if (db->failed){
+		return SAVE_Corrupt;
+	}
+	if (!search.found){
+		return SAVE_NoIsland;
+	}
+
+	Counter counter;
+	counter.guidId = FileDbAttribId(db, query->guidAttrib);
+	counter.guidCount = query->residenceCount;
+	for (int i = 0; i < query->residenceCount; i++){
+		counter.guids[i] = query->residences[i].guid;
+	}
+
+	out->index = index;
+	out->bytes = (uint64_t)(search.found->end - search.found->begin);
+	CountTree(db, search.found, &counter, out);
+	return db->failed ? SAVE_Corrupt : SAVE_Ok;
+}
+
+
+/* ---------------------------------------------------------------------------------------------------------
+ * Synthetic saves
+ */
+
+
+/* Output chain of the writer, the mirror of Stage: deflates into the next sink or writes to the file.
+ *
+ * bytesIn : bytes put into this sink
+ */
+typedef struct Sink {
+	int deflating;
+	z_stream z;
+	struct Sink *next;
+	FILE *file;
+	unsigned char *buffer;
+	uint64_t bytesIn;
+	int failed;
+} Sink;
+
+
+static void SinkPut(Sink *s, const void *data, size_t n, int flush){
+
+	s->bytesIn += n;
+
+	if (!s->deflating){
+		if (n > 0 && fwrite(data, 1, n, s->file) != n){
+			s->failed = 1;
+		}
+		return;
+	}
+
+	s->z.next_in = (Bytef *)data;
+	s->z.avail_in = (uInt)n;
+	int ret;
+	do{
+		s->z.next_out = s->buffer;
+		s->z.avail_out = CHUNK_BYTES;
+		ret = deflate(&s->z, flush);
+		if (ret == Z_STREAM_ERROR){
+			s->failed = 1;
+			return;
+		}
+		SinkPut(s->next, s->buffer, CHUNK_BYTES - s->z.avail_out, Z_NO_FLUSH);
+	} while (s->z.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+}
+
+
+static int SinkDeflateInit(Sink *s, Sink *next){
+	memset(s, 0, sizeof(*s));
+	s->deflating = 1;
+	s->next = next;
+	s->buffer = malloc(CHUNK_BYTES);
+	return s->buffer && deflateInit(&s->z, 6) == Z_OK;
+}
+
+
+/* Buffers the small FileDB nodes before they go to the sinks.
+ *
+ * offset : FileDB stream offset of the next node
+ */
+typedef struct DbWriter {
+	Sink *sink;
+	unsigned char buffer[CHUNK_BYTES];
+	size_t len;
+	uint64_t offset;
+} DbWriter;
+
+
+static void DbPut(DbWriter *w, const void *data, size_t n){
+	if (w->len + n > sizeof(w->buffer)){
+		SinkPut(w->sink, w->buffer, w->len, Z_NO_FLUSH);
+		w->len = 0;
+	}
+	memcpy(w->buffer + w->len, data, n);
+	w->len += n;
+	w->offset += n;
+}
+
+
+static void DbNode(DbWriter *w, uint32_t size, uint32_t id){
+	unsigned char header[8];
+	WriteU32(header, size);
+	WriteU32(header + 4, id);
+	DbPut(w, header, 8);
+}
+
+
+static void DbAttrib(DbWriter *w, uint32_t id, const void *content, uint32_t size){
+	static const unsigned char zeros[8];
+	DbNode(w, size, id);
+	DbPut(w, content, size);
+	DbPut(w, zeros, ((size + 7) & ~7u) - size);
+}
+
+
+static void DbInt(DbWriter *w, uint32_t id, long value){
+	unsigned char bytes[4];
+	WriteU32(bytes, (uint32_t)value);
+	DbAttrib(w, id, bytes, 4);
+}
+
+
+static void DbDictionary(DbWriter *w, const char *const *names, int count, uint32_t firstId){
+	static const unsigned char zeros[8];
+	unsigned char bytes[4];
+	uint64_t start = w->offset;
+
+	WriteU32(bytes, (uint32_t)count);
+	DbPut(w, bytes, 4);
+	for (int i = 0; i < count; i++){
+		WriteU32(bytes, firstId + (uint32_t)i);
+		DbPut(w, bytes, 2);
+	}
+	for (int i = 0; i < count; i++){
+		DbPut(w, names[i], strlen(names[i]) + 1);
+	}
+	DbPut(w, zeros, (size_t)((8 - (w->offset - start) % 8) % 8));
+}
+
+
+enum {
+	TAG_Root = 1,
+	TAG_Session,
+	TAG_List,
+	TAG_None,
+	TAG_Objects
+};
+
+enum {
+	ATTRIB_Guid = FILEDB_ATTRIB_FIRST,
+	ATTRIB_Id,
+	ATTRIB_Position
+};
+
+
+//Writes the FileDB stream of the synthetic save.
+static void WriteFileDb(DbWriter *w, const SaveQuery *query, long islands, long housesPerIsland, long expected[SAVE_MAX_TIERS]){
+
+	const char *tagNames[] = {"GameSessionManager", "SessionData", query->listTag, "None", "Objects"};
+	const char *attribNames[] = {query->guidAttrib, "ID", "Position"};
+	const int sessions = 4;
+	long objectId = 1;
+
+	DbNode(w, 0, TAG_Root);
+	for (int s = 0; s < sessions; s++){
+		DbNode(w, 0, TAG_Session);
+		DbInt(w, ATTRIB_Id, s);
+		DbNode(w, 0, TAG_List);
+		for (long i = s; i < islands; i += sessions){
+			DbNode(w, 0, TAG_None);
+			DbInt(w, ATTRIB_Id, i);
+			DbNode(w, 0, TAG_Objects);
+			for (long h = 0; h < housesPerIsland * 4; h++){
+				long guid;
+				if (h % 4 == 0 && query->residenceCount > 0){
+					int tier = (int)((h / 4 + i) % query->residenceCount);
+					guid = query->residences[tier].guid;
+					if (expected){
+						expected[tier]++;
+					}
+				}
+				else{
+					guid = 1000000 + h % 500;
+				}
+				float position[3] = {(float)(h % 200), 0.0f, (float)(h / 200)};
+				DbNode(w, 0, TAG_None);
+				DbInt(w, ATTRIB_Guid, guid);
+				DbInt(w, ATTRIB_Id, objectId++);
+				DbAttrib(w, ATTRIB_Position, position, sizeof(position));
+				DbNode(w, 0, 0);
+			}
+			DbNode(w, 0, 0);
+			DbNode(w, 0, 0);
+		}
+		DbNode(w, 0, 0);
+		DbNode(w, 0, 0);
+	}
+	DbNode(w, 0, 0);
+
+	unsigned char trailer[FILEDB_TRAILER_BYTES];
+	WriteU32(trailer, (uint32_t)w->offset);
+	DbDictionary(w, tagNames, (int)(sizeof(tagNames) / sizeof(tagNames[0])), TAG_Root);
+	WriteU32(trailer + 4, (uint32_t)w->offset);
+	DbDictionary(w, attribNames, (int)(sizeof(attribNames) / sizeof(attribNames[0])), ATTRIB_Guid);
+	memcpy(trailer + 8, FILEDB_MAGIC, 8);
+	DbPut(w, trailer, sizeof(trailer));
+}
+
+
+int SaveWriteSynthetic(const char *path, const SaveQuery *query, long islands, long housesPerIsland, int innerLayer,
+	long expected[SAVE_MAX_TIERS]){
+
+	if (expected){
+		memset(expected, 0, SAVE_MAX_TIERS * sizeof(long));
+	}
+
+	FILE *f = fopen(path, "wb");
+	if (!f){
+		return 0;
+	}
+
+	unsigned char header[RDA_HEADER_BYTES] = {0};
+	memcpy(header, RDA_MAGIC, RDA_MAGIC_BYTES);
+	int ok = fwrite(header, 1, sizeof(header), f) == sizeof(header);
+
+	Sink file = {0};
+	Sink outer, inner;
+	file.file = f;
+	ok = SinkDeflateInit(&outer, &file) && ok;
+	ok = SinkDeflateInit(&inner, &outer) && ok;
+
+	DbWriter *w = malloc(sizeof(*w));
+	if (ok && w){
+		w->sink = innerLayer ? &inner : &outer;
+		w->len = 0;
+		w->offset = 0;
+		WriteFileDb(w, query, islands, housesPerIsland, expected);
+		if (innerLayer){
+			SinkPut(&inner, w->buffer, w->len, Z_FINISH);
+		}
+		else{
+			SinkPut(&outer, w->buffer, w->len, Z_NO_FLUSH);
+		}
+		SinkPut(&outer, NULL, 0, Z_FINISH);
+	}
+	else{
+		ok = 0;
+	}
+	free(w);
+	ok = ok && !file.failed && !outer.failed && !inner.failed;
+
+	//One compressed block holding data.a7s, its directory right before the block header.
+	unsigned char entry[RDA_ENTRY_BYTES] = {0};
+	for (int i = 0; SAVE_DATA_ENTRY[i]; i++){
+		entry[i * 2] = (unsigned char)SAVE_DATA_ENTRY[i];
+	}
+	WriteU64(entry + RDA_ENTRY_NAME_CHARS * 2, RDA_HEADER_BYTES);
+	WriteU64(entry + RDA_ENTRY_NAME_CHARS * 2 + 8, file.bytesIn);
+	WriteU64(entry + RDA_ENTRY_NAME_CHARS * 2 + 16, outer.bytesIn);
+	WriteU64(entry + RDA_ENTRY_NAME_CHARS * 2 + 24, (uint64_t)time(NULL));
+
+	unsigned char directory[RDA_ENTRY_BYTES + 64];
+	uLongf directorySize = sizeof(directory);
+	ok = ok && compress(directory, &directorySize, entry, sizeof(entry)) == Z_OK;
+
+	uint64_t blockOffset = RDA_HEADER_BYTES + file.bytesIn + directorySize;
+	unsigned char block[RDA_BLOCK_HEADER_BYTES];
+	WriteU32(block, RDA_BLOCK_Compressed);
+	WriteU32(block + 4, 1);
+	WriteU64(block + 8, directorySize);
+	WriteU64(block + 16, RDA_ENTRY_BYTES);
+	WriteU64(block + 24, blockOffset + RDA_BLOCK_HEADER_BYTES);
+
+	unsigned char first[8];
+	WriteU64(first, blockOffset);
+	ok = ok && fwrite(directory, 1, directorySize, f) == directorySize;
+	ok = ok && fwrite(block, 1, sizeof(block), f) == sizeof(block);
+	ok = ok && fseek(f, RDA_FIRST_BLOCK_OFFSET, SEEK_SET) == 0 && fwrite(first, 1, sizeof(first), f) == sizeof(first);
+
+	deflateEnd(&inner.z);
+	deflateEnd(&outer.z);
+	free(inner.buffer);
+	free(outer.buffer);
+	if (fclose(f) != 0){
+		ok = 0;
+	}
+	return ok;
+}
@@ -0,0 +1,149 @@
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+
+#include <stdint.h>
+
+#include "filedb.h"
+
+/* Reads the number of residences on every island out of an Anno 1800 savegame (.a7s).
+ *
+ * A savegame is an RDA v2.2 archive. The island data is the archive entry data.a7s, which is zlib compressed
+ * (once by the archive block and, in current saves, once more inside the entry) and holds a FileDB v2 tree.
+ * The archive is memory mapped, the entry is inflated in small chunks and the tree is tokenized as the
+ * chunks arrive, so the decompressed save never has to fit into memory at once.
+ *
+ * FileDB keeps its tag and attribute names at the very end of the stream, so the entry is streamed twice:
+ * the first pass only inflates and keeps the last SAVE_DICTIONARY_MAX bytes, the second pass tokenizes.
+ *
+ * Every child of the tag named listTag is one island. The main thread copies each island subtree into a
+ * buffer and hands it to a worker thread, which counts the objects whose guidAttrib is a residence GUID.
+ * At most twice as many islands as there are workers are buffered at a time.
+ */
+
+
+//Most residence kinds a query can count.
+#define SAVE_MAX_TIERS 16
+
+//Most bytes of name dictionaries at the end of the FileDB stream.
+#define SAVE_DICTIONARY_MAX (4 * 1024 * 1024)
+
+//How deep below the root SaveTreeIsland looks for island lists.
+#define SAVE_LIST_MAX_DEPTH 6
+
+
+typedef enum SaveStatus {
+	SAVE_Ok,
+	SAVE_NoFile,		//the file could not be opened
+	SAVE_NotArchive,	//not an RDA v2.2 archive
+	SAVE_NoData,		//the archive has no data.a7s
+	SAVE_Unsupported,	//encrypted or memory resident archive block, or dictionaries bigger than SAVE_DICTIONARY_MAX
+	SAVE_Corrupt,		//broken zlib data or FileDB tree
+	SAVE_OutOfMemory,
+	SAVE_NoIsland		//SaveTreeIsland: the save has fewer islands
+} SaveStatus;
+
+
+/* A residence building GUID and the name of the population tier living in it (as in chain_data.c).
+ */
+typedef struct SaveResidence {
+	long guid;
+	const char *tier;
+} SaveResidence;
+
+
+/* What to look for.
+ *
+ * listTag : name of the tag whose children are the islands
+ * guidAttrib : name of the attribute holding the asset GUID of an object
+ * residences / residenceCount : residence GUIDs to count, at most SAVE_MAX_TIERS
+ * threads : worker threads for the islands, 0 for one per processor, 1 decodes on the calling thread
+ */
+typedef struct SaveQuery {
+	const char *listTag;
+	const char *guidAttrib;
+	const SaveResidence *residences;
+	int residenceCount;
+	int threads;
+} SaveQuery;
+
+
+/* Result for one island.
+ *
+ * index : position of the island in the save, from 0
+ * objects : objects with a GUID on the island
+ * residences : number of residences, by index into SaveQuery.residences
+ * bytes : size of the island subtree
+ */
+typedef struct SaveIsland {
+	long index;
+	long objects;
+	long residences[SAVE_MAX_TIERS];
+	uint64_t bytes;
+} SaveIsland;
+
+
+/* Return 0 from the callback to stop getting islands.
+ */
+typedef int (*SaveIslandFn)(const SaveIsland *island, void *user);
+
+
+/* Totals of a read.
+ *
+ * fileBytes : size of the savegame
+ * compressedBytes : size of data.a7s in the archive
+ * dataBytes : size of the decompressed FileDB stream
+ * layers : zlib layers that had to be inflated (0 to 2)
+ * nodes : FileDB nodes tokenized by the main thread
+ * islands : islands found
+ * threads : worker threads used (1 if the calling thread decoded)
+ * peakBufferedBytes : most island bytes buffered for the workers at the same time
+ */
+typedef struct SaveStats {
+	uint64_t fileBytes;
+	uint64_t compressedBytes;
+	uint64_t dataBytes;
+	int layers;
+	uint64_t nodes;
+	long islands;
+	int threads;
+	uint64_t peakBufferedBytes;
+} SaveStats;
+
+
+/* Fills query with the default tag names, the residences of all tiers and one thread per processor.
+ */
+void SaveDefaultQuery(SaveQuery *query);
+
+
+/* Reads the savegame at path and calls fn for every island, in the order of the save. stats may be NULL.
+ */
+SaveStatus SaveReadIslands(const char *path, const SaveQuery *query, SaveIslandFn fn, void *user, SaveStats *stats);
+
+
+/* Writes a synthetic savegame in the same format for benchmarks: islands islands, spread over four sessions,
+ * with housesPerIsland residences each (cycling through the query residences) and three other objects per
+ * residence. Returns 1 on success.
+ *
+ * innerLayer : non zero adds the second zlib layer inside data.a7s
+ * expected : if not NULL, receives the number of residences written, by index into query->residences
+ */
+int SaveWriteSynthetic(const char *path, const SaveQuery *query, long islands, long housesPerIsland, int innerLayer,
+	long expected[SAVE_MAX_TIERS]);
+
+
+/* Writes the decompressed data.a7s of the savegame at path to outPath, where FileDbOpenFile can map it.
+ * stats may be NULL; only the sizes and layers are filled in.
+ */
+SaveStatus SaveExtractData(const char *path, const char *outPath, SaveStats *stats);
+
+
+/* Counts the residences of island number index (in save order, as in SaveReadIslands) in an open FileDB
+ * tree. Only the levels above the island lists and the island itself are expanded. Returns SAVE_NoIsland if
+ * the save has no such island and SAVE_Corrupt if a subtree on the way is broken.
+ */
+SaveStatus SaveTreeIsland(FileDb *db, const SaveQuery *query, long index, SaveIsland *out);
+
+
+const char *SaveStatusName(SaveStatus status);
+
+#endif
@@ -0,0 +1,179 @@
+#include "sys_thread.h"
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+_Static_assert(sizeof(SRWLOCK) <= sizeof(((SysMutex *)0)->storage), "SysMutex too small for SRWLOCK");
+_Static_assert(sizeof(CONDITION_VARIABLE) <= sizeof(((SysCond *)0)->storage), "SysCond too small for CONDITION_VARIABLE");
+
+
+static DWORD WINAPI ThreadEntry(LPVOID param){
+	SysThread *thread = param;
+	thread->fn(thread->arg);
+	return 0;
+}
+
+
+int SysThreadStart(SysThread *thread, SysThreadFn fn, void *arg){
+	thread->fn = fn;
+	thread->arg = arg;
+	thread->handle = CreateThread(NULL, 0, ThreadEntry, thread, 0, NULL);
+	return thread->handle != NULL;
+}
+
+
+void SysThreadJoin(SysThread *thread){
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	thread->handle = NULL;
+}
+
+
+void SysMutexInit(SysMutex *mutex){
+	InitializeSRWLock((SRWLOCK *)&mutex->storage);
+}
+
+//SRW locks need no cleanup.
+void SysMutexDestroy(SysMutex *mutex){
+	(void)mutex;
+}
+
+void SysMutexLock(SysMutex *mutex){
+	AcquireSRWLockExclusive((SRWLOCK *)&mutex->storage);
+}
+
+void SysMutexUnlock(SysMutex *mutex){
+	ReleaseSRWLockExclusive((SRWLOCK *)&mutex->storage);
+}
+
+
+void SysCondInit(SysCond *cond){
+	InitializeConditionVariable((CONDITION_VARIABLE *)&cond->storage);
+}
+
+void SysCondDestroy(SysCond *cond){
+	(void)cond;
+}
+
+void SysCondWait(SysCond *cond, SysMutex *mutex){
+	SleepConditionVariableSRW((CONDITION_VARIABLE *)&cond->storage, (SRWLOCK *)&mutex->storage, INFINITE, 0);
+}
+
+void SysCondSignal(SysCond *cond){
+	WakeConditionVariable((CONDITION_VARIABLE *)&cond->storage);
+}
+
+void SysCondBroadcast(SysCond *cond){
+	WakeAllConditionVariable((CONDITION_VARIABLE *)&cond->storage);
+}
+
+
+int SysCpuCount(void){
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+
+uint64_t SysNowNs(void){
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER now;
+	if (frequency.QuadPart == 0){
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&now);
+	//Split so that counter * 1e9 cannot overflow for long uptimes.
+	uint64_t seconds = (uint64_t)now.QuadPart / (uint64_t)frequency.QuadPart;
+	uint64_t rest = (uint64_t)now.QuadPart % (uint64_t)frequency.QuadPart;
+	return seconds * 1000000000u + rest * 1000000000u / (uint64_t)frequency.QuadPart;
+}
+
+#else
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(pthread_mutex_t) <= sizeof(((SysMutex *)0)->storage), "SysMutex too small for pthread_mutex_t");
+_Static_assert(sizeof(pthread_cond_t) <= sizeof(((SysCond *)0)->storage), "SysCond too small for pthread_cond_t");
+
+
+static void *ThreadEntry(void *param){
+	SysThread *thread = param;
+	thread->fn(thread->arg);
+	return NULL;
+}
+
+
+int SysThreadStart(SysThread *thread, SysThreadFn fn, void *arg){
+	pthread_t id;
+	thread->fn = fn;
+	thread->arg = arg;
+	if (pthread_create(&id, NULL, ThreadEntry, thread) != 0){
+		thread->handle = NULL;
+		return 0;
+	}
+	thread->handle = (void *)id;
+	return 1;
+}
+
+
+void SysThreadJoin(SysThread *thread){
+	pthread_join((pthread_t)thread->handle, NULL);
+	thread->handle = NULL;
+}
+
+
+void SysMutexInit(SysMutex *mutex){
+	pthread_mutex_init((pthread_mutex_t *)&mutex->storage, NULL);
+}
+
+void SysMutexDestroy(SysMutex *mutex){
+	pthread_mutex_destroy((pthread_mutex_t *)&mutex->storage);
+}
+
+void SysMutexLock(SysMutex *mutex){
+	pthread_mutex_lock((pthread_mutex_t *)&mutex->storage);
+}
+
+void SysMutexUnlock(SysMutex *mutex){
+	pthread_mutex_unlock((pthread_mutex_t *)&mutex->storage);
+}
+
+
+void SysCondInit(SysCond *cond){
+	pthread_cond_init((pthread_cond_t *)&cond->storage, NULL);
+}
+
+void SysCondDestroy(SysCond *cond){
+	pthread_cond_destroy((pthread_cond_t *)&cond->storage);
+}
+
+void SysCondWait(SysCond *cond, SysMutex *mutex){
+	pthread_cond_wait((pthread_cond_t *)&cond->storage, (pthread_mutex_t *)&mutex->storage);
+}
+
+void SysCondSignal(SysCond *cond){
+	pthread_cond_signal((pthread_cond_t *)&cond->storage);
+}
+
+void SysCondBroadcast(SysCond *cond){
+	pthread_cond_broadcast((pthread_cond_t *)&cond->storage);
+}
+
+
+int SysCpuCount(void){
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
+
+uint64_t SysNowNs(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#endif
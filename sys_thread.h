@@ -0,0 +1,64 @@
+#ifndef SYS_THREAD_H
+#define SYS_THREAD_H
+
+#include <stdint.h>
+
+/* Minimal threads, mutexes and condition variables on top of Win32 or pthreads, so the platform-free code
+ * can run work in parallel on both. The structs only reserve storage; the real platform objects live
+ * inside them and are never touched directly.
+ */
+
+
+typedef void (*SysThreadFn)(void *arg);
+
+
+typedef struct SysThread {
+	void *handle;
+	SysThreadFn fn;
+	void *arg;
+} SysThread;
+
+
+//Large enough for a pthread_mutex_t/pthread_cond_t and for SRWLOCK/CONDITION_VARIABLE (checked in sys_thread.c).
+typedef struct SysMutex {
+	union { void *align; unsigned char bytes[64]; } storage;
+} SysMutex;
+
+typedef struct SysCond {
+	union { void *align; unsigned char bytes[64]; } storage;
+} SysCond;
+
+
+/* Starts fn(arg) on a new thread. The SysThread must stay valid until SysThreadJoin. Returns 0 on failure.
+ */
+int SysThreadStart(SysThread *thread, SysThreadFn fn, void *arg);
+
+
+void SysThreadJoin(SysThread *thread);
+
+
+void SysMutexInit(SysMutex *mutex);
+void SysMutexDestroy(SysMutex *mutex);
+void SysMutexLock(SysMutex *mutex);
+void SysMutexUnlock(SysMutex *mutex);
+
+
+void SysCondInit(SysCond *cond);
+void SysCondDestroy(SysCond *cond);
+
+//Releases mutex, waits for a signal and takes mutex again. Can wake up without a signal, so wait in a loop.
+void SysCondWait(SysCond *cond, SysMutex *mutex);
+void SysCondSignal(SysCond *cond);
+void SysCondBroadcast(SysCond *cond);
+
+
+/* Number of logical processors, at least 1.
+ */
+int SysCpuCount(void);
+
+
+/* Monotonic clock in nanoseconds, for time stamps and timings. The starting point is arbitrary.
+ */
+uint64_t SysNowNs(void);
+
+#endif
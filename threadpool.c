@@ -0,0 +1,265 @@
+#include <stdlib.h>	//calloc, free
+#include <string.h>	//memset
+
+#include "threadpool.h"
+
+
+//Rounds over all other deques an idle worker tries before it gives up on the current loop.
+#define POOL_STEAL_ROUNDS 4
+
+
+//Owner side. Returns 0 if the deque is full, the caller then runs the range without splitting it further.
+static int DequePush(PoolDeque *d, PoolRange range){
+	SysMutexLock(&d->mutex);
+	if (d->bottom == POOL_DEQUE_SIZE){
+		//Entries below top were already stolen, move the rest down before giving up.
+		if (d->top == 0){
+			SysMutexUnlock(&d->mutex);
+			return 0;
+		}
+		memmove(d->ranges, d->ranges + d->top, (size_t)(d->bottom - d->top) * sizeof(PoolRange));
+		d->bottom -= d->top;
+		d->top = 0;
+	}
+	d->ranges[d->bottom++] = range;
+	SysMutexUnlock(&d->mutex);
+	return 1;
+}
+
+
+static int DequePop(PoolDeque *d, PoolRange *range){
+	int found = 0;
+	SysMutexLock(&d->mutex);
+	if (d->bottom > d->top){
+		*range = d->ranges[--d->bottom];
+		found = 1;
+	}
+	if (d->bottom == d->top){
+		d->top = d->bottom = 0;
+	}
+	SysMutexUnlock(&d->mutex);
+	return found;
+}
+
+
+//Thief side: takes the oldest, biggest range.
+static int DequeSteal(PoolDeque *d, PoolRange *range){
+	int found = 0;
+	SysMutexLock(&d->mutex);
+	if (d->bottom > d->top){
+		*range = d->ranges[d->top++];
+		found = 1;
+	}
+	SysMutexUnlock(&d->mutex);
+	return found;
+}
+
+
+static int FindWork(ThreadPool *pool, int worker, PoolRange *range){
+	int workers = pool->threadCount + 1;
+
+	if (DequePop(&pool->deques[worker], range)){
+		return 1;
+	}
+	for (int round = 0; round < POOL_STEAL_ROUNDS; round++){
+		for (int i = 1; i < workers; i++){
+			if (DequeSteal(&pool->deques[(worker + i) % workers], range)){
+				pool->steals[worker]++;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+
+/* Runs ranges until there are none left to find. Returns when this worker's part of the loop is over, the
+ * loop itself may still be running on other workers.
+ */
+static void RunLoop(ThreadPool *pool, int worker){
+
+	PoolRange range;
+
+	while (FindWork(pool, worker, &range)){
+
+		//Keep the lower half, leave the upper half for this worker's next pop or for a thief.
+		while (range.end - range.begin > pool->grain){
+			long mid = range.begin + (range.end - range.begin) / 2;
+			PoolRange upper = {mid, range.end};
+			if (!DequePush(&pool->deques[worker], upper)){
+				break;
+			}
+			range.end = mid;
+		}
+
+		pool->fn(pool->user, range.begin, range.end, worker);
+		pool->ranges[worker]++;
+
+		SysMutexLock(&pool->mutex);
+		pool->remaining -= range.end - range.begin;
+		if (pool->remaining == 0){
+			SysCondBroadcast(&pool->done);
+		}
+		SysMutexUnlock(&pool->mutex);
+	}
+}
+
+
+typedef struct WorkerStart {
+	ThreadPool *pool;
+	int worker;
+} WorkerStart;
+
+
+static void WorkerMain(void *arg){
+
+	WorkerStart *start = arg;
+	ThreadPool *pool = start->pool;
+	int worker = start->worker;
+	long seen = 0;
+
+	free(start);
+
+	for (;;){
+		SysMutexLock(&pool->mutex);
+		while (pool->generation == seen && !pool->quit){
+			SysCondWait(&pool->wake, &pool->mutex);
+		}
+		if (pool->quit){
+			SysMutexUnlock(&pool->mutex);
+			return;
+		}
+		seen = pool->generation;
+		SysMutexUnlock(&pool->mutex);
+
+		RunLoop(pool, worker);
+
+		SysMutexLock(&pool->mutex);
+		pool->active--;
+		if (pool->active == 0){
+			SysCondBroadcast(&pool->done);
+		}
+		SysMutexUnlock(&pool->mutex);
+	}
+}
+
+
+int PoolInit(ThreadPool *pool, int threads){
+
+	memset(pool, 0, sizeof(*pool));
+	if (threads <= 0){
+		threads = SysCpuCount() - 1;
+	}
+
+	pool->threads = calloc((size_t)threads + 1, sizeof(*pool->threads));
+	pool->deques = calloc((size_t)threads + 1, sizeof(*pool->deques));
+	pool->steals = calloc((size_t)threads + 1, sizeof(*pool->steals));
+	pool->ranges = calloc((size_t)threads + 1, sizeof(*pool->ranges));
+	if (!pool->threads || !pool->deques || !pool->steals || !pool->ranges){
+		free(pool->threads);
+		free(pool->deques);
+		free(pool->steals);
+		free(pool->ranges);
+		memset(pool, 0, sizeof(*pool));
+		return 0;
+	}
+
+	SysMutexInit(&pool->mutex);
+	SysCondInit(&pool->wake);
+	SysCondInit(&pool->done);
+	for (int i = 0; i <= threads; i++){
+		SysMutexInit(&pool->deques[i].mutex);
+	}
+	pool->dequeCount = threads + 1;
+
+	while (pool->threadCount < threads){
+		WorkerStart *start = malloc(sizeof(*start));
+		if (!start){
+			break;
+		}
+		start->pool = pool;
+		start->worker = pool->threadCount + 1;
+		if (!SysThreadStart(&pool->threads[pool->threadCount], WorkerMain, start)){
+			free(start);
+			break;
+		}
+		pool->threadCount++;
+	}
+	return 1;
+}
+
+
+void PoolFree(ThreadPool *pool){
+
+	if (!pool->deques){
+		return;
+	}
+
+	SysMutexLock(&pool->mutex);
+	pool->quit = 1;
+	SysCondBroadcast(&pool->wake);
+	SysMutexUnlock(&pool->mutex);
+
+	for (int i = 0; i < pool->threadCount; i++){
+		SysThreadJoin(&pool->threads[i]);
+	}
+	for (int i = 0; i < pool->dequeCount; i++){
+		SysMutexDestroy(&pool->deques[i].mutex);
+	}
+	SysCondDestroy(&pool->done);
+	SysCondDestroy(&pool->wake);
+	SysMutexDestroy(&pool->mutex);
+
+	free(pool->threads);
+	free(pool->deques);
+	free(pool->steals);
+	free(pool->ranges);
+	memset(pool, 0, sizeof(*pool));
+}
+
+
+int PoolWorkers(const ThreadPool *pool){
+	return pool->threadCount + 1;
+}
+
+
+void PoolParallelFor(ThreadPool *pool, long count, long grain, PoolRangeFn fn, void *user){
+
+	if (count <= 0){
+		return;
+	}
+	if (grain < 1){
+		grain = 1;
+	}
+
+	pool->fn = fn;
+	pool->user = user;
+	pool->grain = grain;
+	pool->remaining = count;
+
+	//One contiguous piece per worker to start with, so every worker has something before stealing starts.
+	int workers = pool->threadCount + 1;
+	for (int i = 0; i < workers; i++){
+		PoolRange piece = {count * i / workers, count * (i + 1) / workers};
+		if (piece.end > piece.begin){
+			DequePush(&pool->deques[i], piece);
+		}
+	}
+
+	if (pool->threadCount > 0){
+		SysMutexLock(&pool->mutex);
+		pool->active = pool->threadCount;
+		pool->generation++;
+		SysCondBroadcast(&pool->wake);
+		SysMutexUnlock(&pool->mutex);
+	}
+
+	RunLoop(pool, 0);
+
+	//Wait for the last ranges and for every pool thread to leave the loop, before fn or user can change.
+	SysMutexLock(&pool->mutex);
+	while (pool->remaining > 0 || pool->active > 0){
+		SysCondWait(&pool->done, &pool->mutex);
+	}
+	SysMutexUnlock(&pool->mutex);
+}
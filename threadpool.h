@@ -0,0 +1,99 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdint.h>
+
+#include "sys_thread.h"
+
+/* Work-stealing pool for data parallel loops (sys_thread.c underneath).
+ *
+ * PoolParallelFor splits an index range into one piece per worker and puts each piece on that worker's
+ * deque. A worker takes ranges from the bottom of its own deque; before running a range it keeps halving it
+ * down to the grain size, pushing the upper halves back onto its deque. An idle worker steals from the top
+ * of the other deques, which is where the biggest pieces are. The calling thread is worker 0 and works along,
+ * so a pool with 0 threads simply runs the loop on the caller.
+ *
+ * Which worker runs which index is not fixed, so results have to be written per index and combined in index
+ * order afterwards if they must not depend on the number of threads.
+ */
+
+
+//Entries of a worker deque. Splitting pushes about log2(range / grain) entries, so this is never reached.
+#define POOL_DEQUE_SIZE 64
+
+
+/* fn runs the indices begin .. end - 1. worker is 0 for the calling thread and 1 .. threadCount for the
+ * pool threads, so per-worker scratch space can be indexed with it.
+ */
+typedef void (*PoolRangeFn)(void *user, long begin, long end, int worker);
+
+
+typedef struct PoolRange {
+	long begin;
+	long end;
+} PoolRange;
+
+
+/* Ranges of one worker. The owner pushes and pops at bottom, thieves take from top.
+ */
+typedef struct PoolDeque {
+	SysMutex mutex;
+	PoolRange ranges[POOL_DEQUE_SIZE];
+	int top;
+	int bottom;
+} PoolDeque;
+
+
+/* threads / threadCount : the pool threads (workers 1 .. threadCount)
+ * deques / dequeCount : a deque per worker, dequeCount of them initialised (threadCount + 1 unless a
+ * 	thread did not start)
+ * generation : counts PoolParallelFor calls, a changed value wakes the pool threads
+ * remaining : indices of the current loop not run yet
+ * active : pool threads still inside the current loop
+ * steals / ranges : per worker statistics, ranges stolen and ranges run
+ */
+typedef struct ThreadPool {
+	SysThread *threads;
+	int threadCount;
+	PoolDeque *deques;
+	int dequeCount;
+
+	SysMutex mutex;
+	SysCond wake;
+	SysCond done;
+	long generation;
+	int quit;
+
+	PoolRangeFn fn;
+	void *user;
+	long grain;
+	long remaining;
+	int active;
+
+	uint64_t *steals;
+	uint64_t *ranges;
+} ThreadPool;
+
+
+/* Starts threads pool threads (0: one less than the number of processors, as the caller works along).
+ * Returns 0 if memory ran out; if threads cannot be started the pool just has fewer.
+ */
+int PoolInit(ThreadPool *pool, int threads);
+
+
+/* Stops and joins the pool threads.
+ */
+void PoolFree(ThreadPool *pool);
+
+
+/* Number of workers including the caller, the size of per-worker arrays.
+ */
+int PoolWorkers(const ThreadPool *pool);
+
+
+/* Runs fn over 0 .. count - 1 in ranges of at most grain indices and returns when all are done. Only one
+ * thread may call this at a time.
+ */
+void PoolParallelFor(ThreadPool *pool, long count, long grain, PoolRangeFn fn, void *user);
+
+#endif
@@ -0,0 +1,205 @@
+#define TILE_HASH_SIMD 1	//if '1' the SSE2 and AVX2 hash kernels are built for x86 (picked at run time), '0' only the scalar one
+
+#include <stdlib.h>	//malloc, free
+#include <string.h>	//memcpy, memset
+
+#include "tile_hash.h"
+
+#if TILE_HASH_SIMD && (defined(__x86_64__) || defined(__i386__))
+#define TILE_HASH_X86 1
+#include <immintrin.h>
+#else
+#define TILE_HASH_X86 0
+#endif
+
+
+#define TILE_HASH_LANES 16
+#define TILE_HASH_BLOCK 64
+#define TILE_HASH_PRIME 0x9E3779B1u
+
+
+/* The kernel: count 64 byte blocks at p, each word into its lane. Tails shorter than a block are padded with
+ * zeros and go through the scalar kernel. Sixteen lanes are two AVX2 (four SSE2) registers whose multiplies do
+ * not wait for each other, and a block is a whole row of a tile.
+ */
+typedef void (*TileBlocksFn)(uint32_t lanes[TILE_HASH_LANES], const uint8_t *p, int count);
+
+
+static void BlocksScalar(uint32_t lanes[TILE_HASH_LANES], const uint8_t *p, int count){
+	for (int b = 0; b < count; b++, p += TILE_HASH_BLOCK){
+		for (int i = 0; i < TILE_HASH_LANES; i++){
+			uint32_t word;
+			memcpy(&word, p + i * 4, 4);
+			lanes[i] = (lanes[i] ^ word) * TILE_HASH_PRIME;
+		}
+	}
+}
+
+
+#if TILE_HASH_X86
+
+//32 bit multiply of every lane, which SSE2 only has for the even lanes (as 64 bit products).
+__attribute__((target("sse2")))
+static inline __m128i MulLanesSse2(__m128i a, __m128i b){
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08), _mm_shuffle_epi32(odd, 0x08));
+}
+
+
+__attribute__((target("sse2")))
+static void BlocksSse2(uint32_t lanes[TILE_HASH_LANES], const uint8_t *p, int count){
+	const __m128i prime = _mm_set1_epi32((int)TILE_HASH_PRIME);
+	__m128i v[4];
+	for (int i = 0; i < 4; i++){
+		v[i] = _mm_loadu_si128((const __m128i *)(lanes + 4 * i));
+	}
+	for (int b = 0; b < count; b++, p += TILE_HASH_BLOCK){
+		for (int i = 0; i < 4; i++){
+			v[i] = MulLanesSse2(_mm_xor_si128(v[i], _mm_loadu_si128((const __m128i *)(p + 16 * i))), prime);
+		}
+	}
+	for (int i = 0; i < 4; i++){
+		_mm_storeu_si128((__m128i *)(lanes + 4 * i), v[i]);
+	}
+}
+
+
+__attribute__((target("avx2")))
+static void BlocksAvx2(uint32_t lanes[TILE_HASH_LANES], const uint8_t *p, int count){
+	const __m256i prime = _mm256_set1_epi32((int)TILE_HASH_PRIME);
+	__m256i lo = _mm256_loadu_si256((const __m256i *)lanes);
+	__m256i hi = _mm256_loadu_si256((const __m256i *)(lanes + 8));
+	for (int b = 0; b < count; b++, p += TILE_HASH_BLOCK){
+		lo = _mm256_mullo_epi32(_mm256_xor_si256(lo, _mm256_loadu_si256((const __m256i *)p)), prime);
+		hi = _mm256_mullo_epi32(_mm256_xor_si256(hi, _mm256_loadu_si256((const __m256i *)(p + 32))), prime);
+	}
+	_mm256_storeu_si256((__m256i *)lanes, lo);
+	_mm256_storeu_si256((__m256i *)(lanes + 8), hi);
+}
+
+#endif
+
+
+static const TileBlocksFn g_blocksKernels[RASTER_BACKEND_COUNT] = {
+	[RASTER_Scalar]	= BlocksScalar,
+#if TILE_HASH_X86
+	[RASTER_SSE2]	= BlocksSse2,
+	[RASTER_AVX2]	= BlocksAvx2,
+#endif
+};
+
+//The kernel in use, set by the first hash (or TileHashUseBackend).
+static TileBlocksFn g_blocks = NULL;
+static RasterBackend g_blocksBackend = RASTER_Scalar;
+
+
+int TileHashUseBackend(RasterBackend backend){
+	if ((int)backend < 0 || backend >= RASTER_BACKEND_COUNT || !g_blocksKernels[backend] || !RasterBackendSupported(backend)){
+		return 0;
+	}
+	g_blocks = g_blocksKernels[backend];
+	g_blocksBackend = backend;
+	return 1;
+}
+
+
+RasterBackend TileHashCurrentBackend(void){
+	if (!g_blocks){
+		for (int b = RASTER_BACKEND_COUNT - 1; b >= RASTER_Scalar && !TileHashUseBackend((RasterBackend)b); b--);
+	}
+	return g_blocksBackend;
+}
+
+
+uint32_t TileHashArea(const uint8_t *pixels, int stride, int width, int height, int bytesPerPixel){
+
+	TileHashCurrentBackend();
+	uint32_t lanes[TILE_HASH_LANES];
+	for (int i = 0; i < TILE_HASH_LANES; i++){
+		lanes[i] = 0x85EBCA77u * (uint32_t)(i + 1);
+	}
+
+	int rowBytes = width * bytesPerPixel;
+	int blocks = rowBytes / TILE_HASH_BLOCK;
+	int tail = rowBytes % TILE_HASH_BLOCK;
+	for (int y = 0; y < height; y++){
+		const uint8_t *row = pixels + (size_t)y * stride;
+		g_blocks(lanes, row, blocks);
+		if (tail){
+			uint8_t padded[TILE_HASH_BLOCK] = {0};
+			memcpy(padded, row + blocks * TILE_HASH_BLOCK, (size_t)tail);
+			BlocksScalar(lanes, padded, 1);
+		}
+	}
+
+	//Fold the lanes and finish with the murmur3 mix, so every lane bit reaches every hash bit.
+	uint32_t h = (uint32_t)rowBytes * (uint32_t)height;
+	for (int i = 0; i < TILE_HASH_LANES; i++){
+		h = (h ^ lanes[i]) * TILE_HASH_PRIME;
+		h = h << 13 | h >> 19;
+	}
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return h;
+}
+
+
+int TileHashInit(TileHash *tiles, int width, int height, int bytesPerPixel){
+	memset(tiles, 0, sizeof(*tiles));
+	tiles->width = width;
+	tiles->height = height;
+	tiles->bytesPerPixel = bytesPerPixel;
+	tiles->columns = (width + TILE_HASH_SIZE - 1) / TILE_HASH_SIZE;
+	tiles->rows = (height + TILE_HASH_SIZE - 1) / TILE_HASH_SIZE;
+	tiles->hashes = malloc(sizeof(uint32_t) * (size_t)(tiles->columns * tiles->rows + 1));
+	return tiles->hashes != NULL;
+}
+
+
+void TileHashFree(TileHash *tiles){
+	free(tiles->hashes);
+	memset(tiles, 0, sizeof(*tiles));
+}
+
+
+void TileHashReset(TileHash *tiles){
+	tiles->valid = 0;
+}
+
+
+int TileHashUpdate(TileHash *tiles, const uint8_t *pixels, int stride, RasterDirty *changed){
+
+	int count = 0;
+	for (int row = 0; row < tiles->rows; row++){
+		int y = row * TILE_HASH_SIZE;
+		int height = tiles->height - y < TILE_HASH_SIZE ? tiles->height - y : TILE_HASH_SIZE;
+		for (int column = 0; column < tiles->columns; column++){
+			int x = column * TILE_HASH_SIZE;
+			int width = tiles->width - x < TILE_HASH_SIZE ? tiles->width - x : TILE_HASH_SIZE;
+
+			const uint8_t *tile = pixels + (size_t)y * stride + (size_t)x * tiles->bytesPerPixel;
+			uint32_t hash = TileHashArea(tile, stride, width, height, tiles->bytesPerPixel);
+			uint32_t *old = &tiles->hashes[row * tiles->columns + column];
+			if (!tiles->valid || *old != hash){
+				*old = hash;
+				count++;
+				if (changed){
+					RasterDirtyAdd(changed, (RasterRect){x, y, width, height});
+				}
+			}
+		}
+	}
+
+	TileHashStats *s = &tiles->stats;
+	s->frames++;
+	s->unchangedFrames += count == 0;
+	s->tiles += (uint64_t)tiles->columns * (uint64_t)tiles->rows;
+	s->changedTiles += (uint64_t)count;
+	s->bytesHashed += (uint64_t)tiles->width * (uint64_t)tiles->height * (uint64_t)tiles->bytesPerPixel;
+	tiles->valid = 1;
+	return count;
+}
@@ -0,0 +1,84 @@
+#ifndef TILE_HASH_H
+#define TILE_HASH_H
+
+#include <stdint.h>
+
+#include "raster.h"
+
+/* Change detection for sampled frames: a frame is cut into TILE_HASH_SIZE x TILE_HASH_SIZE pixel tiles, every
+ * tile is hashed and compared with its hash from the previous frame, and only the tiles that differ are passed
+ * on (as a RasterDirty). While the game is paused every tile hits and the work behind the sampler is skipped.
+ *
+ * The hash reads 64 bytes at a time into sixteen 32 bit lanes (lane = (lane ^ word) * odd constant, a bijection,
+ * so a change confined to one 64 byte block always changes the tile's lanes) and folds the lanes at the end.
+ * The scalar, SSE2 and AVX2 kernels compute the same lanes, so they give identical hashes.
+ */
+
+
+#define TILE_HASH_SIZE 16
+
+
+/* frames : frames compared
+ * unchangedFrames : frames without a changed tile
+ * tiles : tiles compared
+ * changedTiles : the ones whose hash differed (every tile of the first frame counts as changed)
+ * bytesHashed : bytes read by the hash
+ */
+typedef struct TileHashStats {
+	uint64_t frames;
+	uint64_t unchangedFrames;
+	uint64_t tiles;
+	uint64_t changedTiles;
+	uint64_t bytesHashed;
+} TileHashStats;
+
+
+/* width / height / bytesPerPixel : the frames compared
+ * columns / rows : tiles across and down, the last ones may be smaller
+ * hashes : hash of every tile of the previous frame, row by row
+ * valid : hashes holds a frame
+ */
+typedef struct TileHash {
+	int width;
+	int height;
+	int bytesPerPixel;
+	int columns;
+	int rows;
+	uint32_t *hashes;
+	int valid;
+	TileHashStats stats;
+} TileHash;
+
+
+/* Starts with no previous frame, so every tile of the first one is changed. Returns 0 if out of memory.
+ */
+int TileHashInit(TileHash *tiles, int width, int height, int bytesPerPixel);
+
+
+void TileHashFree(TileHash *tiles);
+
+
+/* Makes every tile of the next frame count as changed.
+ */
+void TileHashReset(TileHash *tiles);
+
+
+/* Hashes the tiles of a frame (rows stride bytes apart), adds the ones that changed since the last frame to
+ * changed (may be NULL) and remembers the hashes. Returns the number of changed tiles.
+ */
+int TileHashUpdate(TileHash *tiles, const uint8_t *pixels, int stride, RasterDirty *changed);
+
+
+/* Hash of one area of width x height pixels, the same one TileHashUpdate compares.
+ */
+uint32_t TileHashArea(const uint8_t *pixels, int stride, int width, int height, int bytesPerPixel);
+
+
+/* Switches the hash kernel, like RasterUseBackend. Returns 0 if the backend is not supported.
+ */
+int TileHashUseBackend(RasterBackend backend);
+
+
+RasterBackend TileHashCurrentBackend(void);
+
+#endif
@@ -0,0 +1,165 @@
+#include <string.h>	//memset
+
+#include "timer_wheel.h"
+
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+
+void TimerWheelInit(TimerWheel *wheel, uint64_t now){
+	memset(wheel, 0, sizeof(*wheel));
+	wheel->now = now;
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++){
+		for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++){
+			Timer *head = &wheel->slots[level][slot];
+			head->next = head;
+			head->prev = head;
+		}
+	}
+}
+
+
+/* Puts a timer into the slot for its expiry. Level l holds delays below 2^(BITS * (l + 1)) ticks, in slots
+ * of 2^(BITS * l) ticks; the slot of the current time was cascaded already, so a timer a whole turn ahead
+ * may share it.
+ */
+static void Place(TimerWheel *wheel, Timer *timer){
+	uint64_t delay = timer->expires - wheel->now;
+	int level = 0;
+	while (level < TIMER_WHEEL_LEVELS - 1 && delay >= (uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1))){
+		level++;
+	}
+	uint64_t expires = delay < TIMER_WHEEL_RANGE ? timer->expires : wheel->now + TIMER_WHEEL_RANGE - 1;
+	Timer *head = &wheel->slots[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+	timer->next = head;
+	timer->prev = head->prev;
+	head->prev->next = timer;
+	head->prev = timer;
+	timer->level = level;
+	wheel->levelCount[level]++;
+}
+
+
+static void Unlink(Timer *timer){
+	timer->prev->next = timer->next;
+	timer->next->prev = timer->prev;
+	timer->next = NULL;
+	timer->prev = NULL;
+}
+
+
+void TimerStart(TimerWheel *wheel, Timer *timer, uint64_t delay, TimerFn fn, void *user){
+	TimerCancel(wheel, timer);
+	timer->expires = wheel->now + (delay ? delay : 1);
+	timer->fn = fn;
+	timer->user = user;
+	Place(wheel, timer);
+	wheel->count++;
+	wheel->stats.started++;
+}
+
+
+void TimerCancel(TimerWheel *wheel, Timer *timer){
+	if (!timer->next){
+		return;
+	}
+	wheel->levelCount[timer->level]--;
+	Unlink(timer);
+	wheel->count--;
+	wheel->stats.cancelled++;
+}
+
+
+int TimerPending(const Timer *timer){
+	return timer->next != NULL;
+}
+
+
+//Places the timers of the slot of level that the current time has reached again, on finer wheels.
+static void Cascade(TimerWheel *wheel, int level){
+	Timer *head = &wheel->slots[level][(wheel->now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+	Timer *t = head->next;
+	head->next = head;
+	head->prev = head;
+	while (t != head){
+		Timer *next = t->next;
+		wheel->levelCount[level]--;
+		Place(wheel, t);
+		wheel->stats.cascaded++;
+		t = next;
+	}
+}
+
+
+//Runs the timers of the current tick, at most budget of them (budget 0 or less: all). Returns how many ran.
+static int FireSlot(TimerWheel *wheel, int budget){
+	Timer *head = &wheel->slots[0][wheel->now & TIMER_WHEEL_MASK];
+	int fired = 0;
+	while (head->next != head && (budget <= 0 || fired < budget)){
+		Timer *timer = head->next;
+		Unlink(timer);
+		wheel->levelCount[0]--;
+		wheel->count--;
+		wheel->stats.fired++;
+		fired++;
+		timer->fn(timer->user);
+	}
+	return fired;
+}
+
+
+int TimerWheelAdvance(TimerWheel *wheel, uint64_t now, int maxFire){
+
+	//Timers of the current tick left over by a limited call.
+	int fired = FireSlot(wheel, maxFire);
+	while (wheel->now < now && (maxFire <= 0 || fired < maxFire)){
+		//With the finer wheels empty, jump to where the next coarser slot is cascaded.
+		uint64_t next = wheel->now + 1;
+		for (int level = 0; level < TIMER_WHEEL_LEVELS - 1 && wheel->levelCount[level] == 0; level++){
+			uint64_t turn = (uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1));
+			next = (wheel->now | (turn - 1)) + 1;
+		}
+		wheel->now = next < now ? next : now;
+
+		//Coarsest first, so a timer cascaded down several wheels at once lands on level 0 in time.
+		int top = 0;
+		while (top < TIMER_WHEEL_LEVELS - 1 && (wheel->now & (((uint64_t)1 << (TIMER_WHEEL_BITS * (top + 1))) - 1)) == 0){
+			top++;
+		}
+		for (int level = top; level > 0; level--){
+			Cascade(wheel, level);
+		}
+		fired += FireSlot(wheel, maxFire > 0 ? maxFire - fired : 0);
+	}
+	return fired;
+}
+
+
+int64_t TimerWheelNextDelay(const TimerWheel *wheel){
+	if (wheel->count == 0){
+		return -1;
+	}
+	const Timer *current = &wheel->slots[0][wheel->now & TIMER_WHEEL_MASK];
+	if (current->next != current){
+		return 0;
+	}
+	//The first busy slot of every wheel: the exact tick on the finest, the cascade of the slot above it. A
+	//coarser wheel may cascade before the finer one's next timer, so take the earliest.
+	uint64_t best = UINT64_MAX;
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++){
+		if (wheel->levelCount[level] == 0){
+			continue;
+		}
+		int shift = TIMER_WHEEL_BITS * level;
+		uint64_t slot = wheel->now >> shift;
+		for (uint64_t i = 1; i <= TIMER_WHEEL_SLOTS; i++){
+			const Timer *head = &wheel->slots[level][(slot + i) & TIMER_WHEEL_MASK];
+			if (head->next != head){
+				uint64_t delay = ((slot + i) << shift) - wheel->now;
+				best = delay < best ? delay : best;
+				break;
+			}
+		}
+	}
+	return best == UINT64_MAX ? -1 : (int64_t)best;
+}
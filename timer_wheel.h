@@ -0,0 +1,99 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+/* A hierarchical timer wheel: TIMER_WHEEL_LEVELS wheels of TIMER_WHEEL_SLOTS slots each, the first one
+ * tick per slot, every further one TIMER_WHEEL_SLOTS times coarser. A timer goes into the slot of the
+ * finest wheel whose range covers its delay, as a node of that slot's doubly linked list, so starting and
+ * cancelling one is O(1) whatever the number of timers. When the finest wheel wraps, the next slot of the
+ * coarser wheel is cascaded (its timers are placed again, now closer).
+ *
+ * Ticks are whatever the caller counts in (event_loop.c: milliseconds). Delays beyond the range of the
+ * wheels wait in the last slot of the coarsest one and are placed again from there. Nothing is allocated:
+ * the Timer structs belong to the caller and must stay put while pending.
+ */
+
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+//Longest delay placed directly, in ticks (about 4.6 hours of milliseconds).
+#define TIMER_WHEEL_RANGE ((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+
+typedef void (*TimerFn)(void *user);
+
+
+/* next / prev : neighbours in the slot's list, NULL while not pending
+ * expires : the tick it fires at
+ * level : the wheel it is on
+ * fn / user : what it runs
+ */
+typedef struct Timer {
+	struct Timer *next;
+	struct Timer *prev;
+	uint64_t expires;
+	int level;
+	TimerFn fn;
+	void *user;
+} Timer;
+
+
+/* started / cancelled / fired / cascaded : TimerStart and TimerCancel calls, timers run, timers placed again
+ * by a cascade
+ */
+typedef struct TimerWheelStats {
+	uint64_t started;
+	uint64_t cancelled;
+	uint64_t fired;
+	uint64_t cascaded;
+} TimerWheelStats;
+
+
+/* slots : the list head of every slot (a Timer used only for its links)
+ * levelCount : pending timers per wheel, so empty wheels are skipped
+ * now : the last tick whose timers have been run
+ * count : pending timers
+ */
+typedef struct TimerWheel {
+	Timer slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	int levelCount[TIMER_WHEEL_LEVELS];
+	uint64_t now;
+	int count;
+	TimerWheelStats stats;
+} TimerWheel;
+
+
+/* Starts empty at tick now.
+ */
+void TimerWheelInit(TimerWheel *wheel, uint64_t now);
+
+
+/* Starts (or restarts) timer to call fn(user) delay ticks from now, at least 1. O(1).
+ */
+void TimerStart(TimerWheel *wheel, Timer *timer, uint64_t delay, TimerFn fn, void *user);
+
+
+/* Stops a pending timer, does nothing for one that is not. O(1).
+ */
+void TimerCancel(TimerWheel *wheel, Timer *timer);
+
+
+int TimerPending(const Timer *timer);
+
+
+/* Moves the time to tick now, running every timer that expires on the way in order of its tick. Stops
+ * early after maxFire timers (0 for no limit); the time then stays at the tick being run and the next call
+ * continues there. Returns the number of timers run. A timer may start or cancel timers, itself included.
+ */
+int TimerWheelAdvance(TimerWheel *wheel, uint64_t now, int maxFire);
+
+
+/* Ticks from now until TimerWheelAdvance has something to do: a timer to run or a cascade that places
+ * timers. 0 if timers are due now, -1 if there are none.
+ */
+int64_t TimerWheelNextDelay(const TimerWheel *wheel);
+
+#endif
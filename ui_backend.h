@@ -0,0 +1,45 @@
+#ifndef UI_BACKEND_H
+#define UI_BACKEND_H
+
+#include <stddef.h>	//wchar_t
+
+/* The few windowing calls the overlay makes, behind function pointers so the same UI code runs on Win32
+ * (ui_win32.c) and without any window system (ui_headless.c, for driving and timing UI flows on Linux).
+ *
+ * Controls are created by control ID (controls.h); the backend picks class and style from the ID's kind.
+ * Commands come back as OverlayUiCommand calls, from MainWndProc's WM_COMMAND on Win32 and from
+ * UiHeadlessPump headless, so postCommand queues a command the same way a click does.
+ */
+
+
+//A window or control of the backend (an HWND on Win32).
+typedef void *UiHandle;
+
+//Called when a flush from scheduleFlush is due: by the event loop on Win32, by UiHeadlessAdvance headless.
+typedef void (*UiFlushFn)(void *user);
+
+
+/* context : passed to every call, the backend's own state
+ *
+ * createWindow : the top level window, NULL on failure
+ * createControl : a child control of parent (a window or frame); text may be NULL. NULL on failure
+ * setSpinner : attaches a spinner to its text field (buddy) and sets its range and position
+ * setText : replaces the text of a control
+ * getSpinner : the spinner position, taken from the text field when it was typed into and clamped
+ * postCommand : queues a WM_COMMAND (controlId, notifyCode) for the main window
+ * showMessage : a modal message box (headless: only remembered)
+ * scheduleFlush : calls the backend's UiFlushFn (which calls OverlayUiFlush) once, delayMs from now
+ */
+typedef struct UiBackend {
+	void *context;
+	UiHandle (*createWindow)(void *context, const wchar_t *title, int width, int height);
+	UiHandle (*createControl)(void *context, UiHandle parent, int controlId, const wchar_t *text, int x, int y, int width, int height);
+	void (*setSpinner)(void *context, UiHandle spinner, UiHandle buddy, int minVal, int maxVal, int pos);
+	void (*setText)(void *context, UiHandle control, const wchar_t *text);
+	int (*getSpinner)(void *context, UiHandle spinner);
+	int (*postCommand)(void *context, int controlId, int notifyCode);
+	void (*showMessage)(void *context, const wchar_t *title, const wchar_t *text);
+	void (*scheduleFlush)(void *context, int delayMs);
+} UiBackend;
+
+#endif
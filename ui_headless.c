@@ -0,0 +1,239 @@
+#include <string.h>	//memset
+#include <wchar.h>	//wcsncpy, wcslen, wcstol, swprintf
+
+#include "controls.h"
+#include "overlay.h"
+#include "ui_headless.h"
+
+
+//Handles are control index + 1, so the first control is not NULL.
+static UiHandle ToHandle(int index){
+	return (UiHandle)(uintptr_t)(index + 1);
+}
+
+static UiHeadlessControl *FromHandle(UiHeadless *headless, UiHandle handle){
+	int index = (int)(uintptr_t)handle - 1;
+	if (index < 0 || index >= headless->controlCount){
+		return NULL;
+	}
+	return &headless->controls[index];
+}
+
+
+static void CopyText(wchar_t *dest, const wchar_t *text){
+	wcsncpy(dest, text ? text : L"", UI_HEADLESS_TEXT_CHARS - 1);
+	dest[UI_HEADLESS_TEXT_CHARS - 1] = 0;
+}
+
+
+static UiHandle AddControl(UiHeadless *headless, int parent, int id, const wchar_t *text, int x, int y, int width, int height){
+
+	if (headless->controlCount >= UI_HEADLESS_MAX_CONTROLS){
+		return NULL;
+	}
+	int index = headless->controlCount++;
+	UiHeadlessControl *control = &headless->controls[index];
+	memset(control, 0, sizeof(*control));
+	control->id = id;
+	control->parent = parent;
+	CopyText(control->text, text);
+	control->x = x;
+	control->y = y;
+	control->width = width;
+	control->height = height;
+	control->buddy = -1;
+	headless->stats.creates++;
+	return ToHandle(index);
+}
+
+
+static UiHandle CreateWindowHeadless(void *context, const wchar_t *title, int width, int height){
+	return AddControl(context, -1, 0, title, 0, 0, width, height);
+}
+
+
+static UiHandle CreateControlHeadless(void *context, UiHandle parent, int controlId, const wchar_t *text, int x, int y, int width, int height){
+	UiHeadless *headless = context;
+	if (ControlKindFromId(controlId) == CONTROL_None || !FromHandle(headless, parent)){
+		return NULL;
+	}
+	return AddControl(headless, (int)(uintptr_t)parent - 1, controlId, text, x, y, width, height);
+}
+
+
+//Writes the spinner position into its text field, as UDS_SETBUDDYINT does.
+static void WriteBuddy(UiHeadless *headless, UiHeadlessControl *spinner){
+	if (spinner->buddy >= 0){
+		swprintf(headless->controls[spinner->buddy].text, UI_HEADLESS_TEXT_CHARS, L"%d", spinner->pos);
+	}
+}
+
+
+static void SetSpinnerHeadless(void *context, UiHandle spinner, UiHandle buddy, int minVal, int maxVal, int pos){
+	UiHeadless *headless = context;
+	UiHeadlessControl *control = FromHandle(headless, spinner);
+	if (!control){
+		return;
+	}
+	control->buddy = FromHandle(headless, buddy) ? (int)(uintptr_t)buddy - 1 : -1;
+	control->minVal = minVal;
+	control->maxVal = maxVal;
+	control->pos = pos < minVal ? minVal : pos > maxVal ? maxVal : pos;
+	WriteBuddy(headless, control);
+}
+
+
+static void SetTextHeadless(void *context, UiHandle handle, const wchar_t *text){
+	UiHeadless *headless = context;
+	UiHeadlessControl *control = FromHandle(headless, handle);
+	if (control){
+		CopyText(control->text, text);
+		headless->stats.setTexts++;
+		headless->stats.textChars += wcslen(control->text);
+	}
+}
+
+
+/* Like UDM_GETPOS32 with a buddy: a number typed into the field becomes the position (clamped), anything
+ * else leaves the position as it was.
+ */
+static int GetSpinnerHeadless(void *context, UiHandle handle){
+	UiHeadless *headless = context;
+	UiHeadlessControl *control = FromHandle(headless, handle);
+	if (!control){
+		return 0;
+	}
+	headless->stats.spinnerReads++;
+	if (control->buddy >= 0){
+		wchar_t *end;
+		const wchar_t *text = headless->controls[control->buddy].text;
+		long value = wcstol(text, &end, 10);
+		if (end != text && *end == 0){
+			control->pos = value < control->minVal ? control->minVal : value > control->maxVal ? control->maxVal : (int)value;
+		}
+	}
+	return control->pos;
+}
+
+
+static int PostCommandHeadless(void *context, int controlId, int notifyCode){
+	UiHeadless *headless = context;
+	if (headless->head - headless->tail >= UI_HEADLESS_QUEUE){
+		headless->stats.dropped++;
+		return 0;
+	}
+	UiHeadlessCommand *command = &headless->queue[headless->head++ % UI_HEADLESS_QUEUE];
+	command->controlId = controlId;
+	command->notifyCode = notifyCode;
+	headless->stats.posted++;
+	return 1;
+}
+
+
+static void ShowMessageHeadless(void *context, const wchar_t *title, const wchar_t *text){
+	UiHeadless *headless = context;
+	(void)title;
+	CopyText(headless->lastMessage, text);
+	headless->stats.messages++;
+}
+
+
+//Like SetTimer with the same ID: a flush that is already scheduled is moved.
+static void ScheduleFlushHeadless(void *context, int delayMs){
+	UiHeadless *headless = context;
+	headless->flushDueMs = headless->nowMs + (uint64_t)(delayMs > 0 ? delayMs : 0);
+	headless->flushPending = 1;
+	headless->stats.flushesScheduled++;
+}
+
+
+void UiHeadlessInit(UiHeadless *headless, UiCommandFn onCommand, UiFlushFn onFlush, void *user){
+	memset(headless, 0, sizeof(*headless));
+	headless->onCommand = onCommand;
+	headless->onFlush = onFlush;
+	headless->user = user;
+
+	UiBackend *b = &headless->backend;
+	b->context = headless;
+	b->createWindow = CreateWindowHeadless;
+	b->createControl = CreateControlHeadless;
+	b->setSpinner = SetSpinnerHeadless;
+	b->setText = SetTextHeadless;
+	b->getSpinner = GetSpinnerHeadless;
+	b->postCommand = PostCommandHeadless;
+	b->showMessage = ShowMessageHeadless;
+	b->scheduleFlush = ScheduleFlushHeadless;
+}
+
+
+UiHeadlessControl *UiHeadlessFind(UiHeadless *headless, int controlId){
+	for (int i = 0; i < headless->controlCount; i++){
+		if (headless->controls[i].id == controlId){
+			return &headless->controls[i];
+		}
+	}
+	return NULL;
+}
+
+
+int UiHeadlessClick(UiHeadless *headless, int controlId){
+	if (!UiHeadlessFind(headless, controlId)){
+		return 0;
+	}
+	return PostCommandHeadless(headless, controlId, OVERLAY_BN_CLICKED);
+}
+
+
+int UiHeadlessSpin(UiHeadless *headless, int spinnerId, int delta){
+
+	UiHeadlessControl *spinner = UiHeadlessFind(headless, spinnerId);
+	if (!spinner || spinner->buddy < 0){
+		return 0;
+	}
+	int pos = GetSpinnerHeadless(headless, ToHandle((int)(spinner - headless->controls))) + delta;
+	pos = pos < spinner->minVal ? spinner->minVal : pos > spinner->maxVal ? spinner->maxVal : pos;
+	if (pos == spinner->pos){
+		return 1;
+	}
+	spinner->pos = pos;
+	WriteBuddy(headless, spinner);
+	return PostCommandHeadless(headless, headless->controls[spinner->buddy].id, OVERLAY_EN_CHANGE);
+}
+
+
+int UiHeadlessType(UiHeadless *headless, int fieldId, const wchar_t *text){
+	UiHeadlessControl *field = UiHeadlessFind(headless, fieldId);
+	if (!field){
+		return 0;
+	}
+	CopyText(field->text, text);
+	return PostCommandHeadless(headless, fieldId, OVERLAY_EN_CHANGE);
+}
+
+
+int UiHeadlessPump(UiHeadless *headless){
+	int dispatched = 0;
+	while (headless->tail != headless->head){
+		UiHeadlessCommand command = headless->queue[headless->tail++ % UI_HEADLESS_QUEUE];
+		headless->stats.dispatched++;
+		dispatched++;
+		if (headless->onCommand){
+			headless->onCommand(headless->user, command.controlId, command.notifyCode);
+		}
+	}
+	return dispatched;
+}
+
+
+int UiHeadlessAdvance(UiHeadless *headless, uint32_t ms){
+	headless->nowMs += ms;
+	if (!headless->flushPending || headless->flushDueMs > headless->nowMs){
+		return 0;
+	}
+	headless->flushPending = 0;
+	headless->stats.flushesFired++;
+	if (headless->onFlush){
+		headless->onFlush(headless->user);
+	}
+	return 1;
+}
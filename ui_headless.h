@@ -0,0 +1,140 @@
+#ifndef UI_HEADLESS_H
+#define UI_HEADLESS_H
+
+#include <stdint.h>
+
+#include "ui_backend.h"
+
+/* A UiBackend without a window system: controls are entries in an array holding their text, position and
+ * spinner state, and commands go into a queue that UiHeadlessPump hands to a callback (like the message loop
+ * dispatching WM_COMMAND to MainWndProc). The Click / Spin / Type calls do what the user's input would do to
+ * the Win32 controls, and the counters show how many windowing calls a flow made.
+ *
+ * Time only moves with UiHeadlessAdvance, which fires a scheduled flush once it is due, so a flow runs
+ * the same on every machine.
+ */
+
+
+#define UI_HEADLESS_MAX_CONTROLS 64
+#define UI_HEADLESS_TEXT_CHARS 128
+
+//Commands that can wait in the queue, more are dropped and counted.
+#define UI_HEADLESS_QUEUE 1024
+
+
+//Receives every command UiHeadlessPump takes from the queue.
+typedef void (*UiCommandFn)(void *user, int controlId, int notifyCode);
+
+/* id : control ID, 0 for the main window
+ * parent : index of the parent control, -1 for the main window
+ * text : the window text (for a text field, what was typed)
+ * minVal / maxVal / pos / buddy : spinner range, position and the index of its text field (-1 if none)
+ */
+typedef struct UiHeadlessControl {
+	int id;
+	int parent;
+	wchar_t text[UI_HEADLESS_TEXT_CHARS];
+	int x;
+	int y;
+	int width;
+	int height;
+	int minVal;
+	int maxVal;
+	int pos;
+	int buddy;
+} UiHeadlessControl;
+
+
+/* Calls made through the backend.
+ *
+ * creates : windows and controls created
+ * setTexts / textChars : setText calls and the characters they copied
+ * spinnerReads : getSpinner calls
+ * posted / dispatched / dropped : commands queued, handed to the callback and lost to a full queue
+ * messages : showMessage calls
+ * flushesScheduled / flushesFired : scheduleFlush calls and flushes handed to the callback
+ */
+typedef struct UiHeadlessStats {
+	uint64_t creates;
+	uint64_t setTexts;
+	uint64_t textChars;
+	uint64_t spinnerReads;
+	uint64_t posted;
+	uint64_t dispatched;
+	uint64_t dropped;
+	uint64_t messages;
+	uint64_t flushesScheduled;
+	uint64_t flushesFired;
+} UiHeadlessStats;
+
+
+typedef struct UiHeadlessCommand {
+	int controlId;
+	int notifyCode;
+} UiHeadlessCommand;
+
+
+/* backend : pass &headless->backend to OverlayUiInit
+ * controls / controlCount : every window and control, the main window first
+ * queue / head / tail : posted commands not yet pumped
+ * nowMs / flushDueMs / flushPending : the clock of UiHeadlessAdvance and the scheduled flush
+ * lastMessage : text of the last showMessage
+ */
+typedef struct UiHeadless {
+	UiBackend backend;
+	UiHeadlessControl controls[UI_HEADLESS_MAX_CONTROLS];
+	int controlCount;
+
+	UiHeadlessCommand queue[UI_HEADLESS_QUEUE];
+	uint32_t head;
+	uint32_t tail;
+	UiCommandFn onCommand;
+	UiFlushFn onFlush;
+	void *user;
+
+	uint64_t nowMs;
+	uint64_t flushDueMs;
+	int flushPending;
+
+	wchar_t lastMessage[UI_HEADLESS_TEXT_CHARS];
+	UiHeadlessStats stats;
+} UiHeadless;
+
+
+/* Sets up an empty backend whose commands go to onCommand(user, ...) and whose flushes go to onFlush(user).
+ */
+void UiHeadlessInit(UiHeadless *headless, UiCommandFn onCommand, UiFlushFn onFlush, void *user);
+
+
+/* The control with this ID, or NULL.
+ */
+UiHeadlessControl *UiHeadlessFind(UiHeadless *headless, int controlId);
+
+
+/* A click on a push button: queues BN_CLICKED. Returns 0 if there is no such control or the queue is full.
+ */
+int UiHeadlessClick(UiHeadless *headless, int controlId);
+
+
+/* A click on a spinner arrow: moves the spinner by delta within its range, writes the new value into its
+ * text field and queues the field's EN_CHANGE (only if the value changed, like the real control).
+ */
+int UiHeadlessSpin(UiHeadless *headless, int spinnerId, int delta);
+
+
+/* Typing into a text field: replaces its text and queues EN_CHANGE.
+ */
+int UiHeadlessType(UiHeadless *headless, int fieldId, const wchar_t *text);
+
+
+/* Hands every queued command to the callback, including commands the callback queues itself. Returns the
+ * number dispatched.
+ */
+int UiHeadlessPump(UiHeadless *headless);
+
+
+/* Moves the clock forward by ms and fires the scheduled flush if it is due by then. Returns 1 if it fired.
+ */
+int UiHeadlessAdvance(UiHeadless *headless, uint32_t ms);
+
+#endif
@@ -0,0 +1,253 @@
+#define WIN32_LEAN_AND_MEAN
+#define PUSHBUTTON (WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | BS_MULTILINE | BS_CENTER | BS_VCENTER)
+#define FRAMEBUTTON (WS_CHILD | WS_VISIBLE | BS_GROUPBOX)
+#define TEXTFIELD (WS_CHILD | WS_VISIBLE | WS_BORDER | ES_NUMBER | ES_AUTOHSCROLL)
+#define STATICLABEL (WS_CHILD | WS_VISIBLE)
+#define SPINNERBUTTON (WS_CHILD | WS_VISIBLE | UDS_SETBUDDYINT | UDS_ARROWKEYS | UDS_NOTHOUSANDS)
+#define DISPLAY (WS_CHILD | WS_VISIBLE | WS_BORDER | SS_SUNKEN)
+
+#define BUTTON (L"BUTTON")
+#define EDIT (L"EDIT")
+#define STATIC (L"STATIC")
+#define SPINNER (UPDOWN_CLASSW)
+
+#include <windows.h>
+#include <commctrl.h>
+
+#include "controls.h"
+#include "ui_win32.h"
+
+
+/* Window class and style of every control kind, generated from CONTROL_KIND_TABLE (controls.h) and indexed
+ * by ControlKind.
+ */
+typedef struct ControlKindInfo{
+	LPCWSTR className;
+	DWORD style;
+} ControlKindInfo;
+
+#define X_CONTROL_KIND_INFO(kind, number, className, style) [kind] = { className, style },
+static const ControlKindInfo g_controlKindInfo[CONTROL_KIND_COUNT] = {
+	CONTROL_KIND_TABLE(X_CONTROL_KIND_INFO)
+};
+#undef X_CONTROL_KIND_INFO
+
+
+static const wchar_t *g_mainClassName = L"Anno1800OverlayClass";
+
+
+//The original BUTTON window procedure of the group box frames (see FrameProc).
+static WNDPROC g_frameDefProc = NULL;
+
+
+/* Registers the main window with the Windows OS so that the OS knows how to create the window.
+ *
+ * BOOL : Win32's integer boolean type (TRUE/FALSE)
+ * WNDCLASSEXW : the "extended window class" struct (wide version)
+ * ZeroMemory(&wc, sizeof(wc)) : sets all bytes of the struct to 0 before setting fields to prevent "random uninitialized fields".
+ *
+ * wc.cbSize : size of the struct; Windows uses this to know which version/size is being passed.
+ * wc.lpfnWndProc : pointer to the window procedure function (must match the signature)
+ * wc.hInstance : the module instance handle
+ * wc.hCursor : the cursor used when mouse is inside the window space.
+ * 		>LoadCursor(NULL, IDC_ARROW) : creates the actual cursor resource to be used.
+ * 			NULL : a NULL instance here means "use the system cursor resources"
+ * 			IDC_ARROW : the standard cursor identifier
+ * wc.hbrBackground : stores the settings for how the OS actually displays the window on the screen.
+ * 		>(HBRUSH)(COLOR_WINDOW + 1) : the settings themselves
+ * 			(HBRUSH) : Win32 Handle type for a "brush" (how the window is drawn)
+ * 			(COLOR_WINDOW + 1) : the "system color index" for the window background color
+ * wc.lpszClassName : the class name to be used when actually created the main window.
+ */
+static BOOL RegisterMainWindowClass(HINSTANCE hInstance, WNDPROC wndProc){
+
+	WNDCLASSEXW wc;
+	ZeroMemory(&wc, sizeof(wc));
+
+	wc.cbSize	= sizeof(wc);
+	wc.lpfnWndProc	= wndProc;
+	wc.hInstance	= hInstance;
+	wc.hCursor	= LoadCursor(NULL, IDC_ARROW);
+	wc.hbrBackground= (HBRUSH)(COLOR_WINDOW + 1);
+	wc.lpszClassName= g_mainClassName;
+
+	if (RegisterClassExW(&wc) == 0){
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+/* Controls inside a group box frame send their WM_COMMAND notifications to the frame, and the stock BUTTON
+ * window procedure drops them. Every frame is subclassed with this procedure so that the notifications
+ * are passed on to the main window where MainWndProc can handle them.
+ */
+static LRESULT CALLBACK FrameProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam){
+
+	if (msg == WM_COMMAND || msg == WM_NOTIFY){
+		return SendMessageW(GetParent(hwnd), msg, wParam, lParam);
+	}
+	return CallWindowProcW(g_frameDefProc, hwnd, msg, wParam, lParam);
+}
+
+
+static void SubclassFrame(HWND frame){
+	WNDPROC previous = (WNDPROC)SetWindowLongPtrW(frame, GWLP_WNDPROC, (LONG_PTR)FrameProc);
+	if (!g_frameDefProc){
+		g_frameDefProc = previous;
+	}
+}
+
+
+static UiHandle CreateMainWindow(void *context, const wchar_t *title, int width, int height){
+
+	UiWin32 *win32 = context;
+
+	win32->mainWindow = CreateWindowExW(
+
+	/*"dwExStyle   =*/ 0,
+	/*"lpClassName =*/ g_mainClassName,
+	/*"lpWindowName=*/ title,
+	/*"dwStyle     =*/ WS_OVERLAPPEDWINDOW,
+	/*"x	       =*/ CW_USEDEFAULT,
+	/*"y	       =*/ CW_USEDEFAULT,
+	/*"width       =*/ width,
+	/*"height      =*/ height,
+	/*"hwndParent  =*/ NULL,
+	/*"hMenu       =*/ NULL,
+	/*"hInstance   =*/ win32->instance,
+	/*"lpParam     =*/ NULL
+			);
+	return win32->mainWindow;
+}
+
+
+/* The function that is used to create the controls inside of the main window. Returns the handle to
+ * the control (HWND) or NULL if creation failed.
+ *
+ * UiHandle parent : the parent window to the control (main window or a frame)
+ * int controlId : the numeric id to identify the control. (used with WM_COMMAND)
+ * text : The label on the control itself
+ * int x : the x-axis coordinate for the control origin (top left corner)
+ * int y : the y-axis coordinate for the control origin (top left corner)
+ * int width : the width of the control itself
+ * int height : the height of the control itself
+ */
+static UiHandle CreateButton(void *context, UiHandle parent, int controlId, const wchar_t *text, int x, int y, int width, int height){
+
+	UiWin32 *win32 = context;
+
+	/* Int the CreateWindowExW function, the parameter HMENU is used differently depending on window type;
+	 * 	>For a top-level window, HMENU is its menu handle.
+	 * 	>for a child-level window, Win32 overloads the field to carry the control ID
+	 * Therefore, "int controlID" is converted into an HMENU-typed value.
+	 * INT_PTR : iteger type the size of a pointer (safe on 32/64-bit)
+	 */
+	HMENU idAsMenuHandle = (HMENU)(INT_PTR)controlId;
+
+	/* The kind of a control comes from the thousands digit of its ID (see controls.h). IDs that are not
+	 * in CONTROL_TABLE get CONTROL_None, which has no class and makes CreateWindowExW fail.
+	 */
+	ControlKind kind = ControlKindFromId(controlId);
+	DWORD style = g_controlKindInfo[kind].style;
+	LPCWSTR class = g_controlKindInfo[kind].className;
+
+
+	HWND button = CreateWindowExW(
+
+	/*"dwExStyle   = */ 0,
+	/*"lpClassName = */ class, //macro
+	/*"lpWindowName= */ text,
+	/*"dwStyle     = */ style, //macro
+	/*"x           = */ x,
+	/*"y           = */ y,
+	/*"width       = */ width,
+	/*"height      = */ height,
+	/*"hwndParent  = */ (HWND)parent,
+	/*"hMenu       = */ idAsMenuHandle,
+	/*"hInstance   = */ win32->instance,
+	/*"lpParam     = */ NULL
+	);
+
+	if (button && kind == CONTROL_Frame){
+		SubclassFrame(button);
+	}
+	return button;
+}
+
+
+static void SetSpinner(void *context, UiHandle spinner, UiHandle buddy, int minVal, int maxVal, int pos){
+	(void)context;
+	SendMessageW((HWND)spinner, UDM_SETBUDDY, (WPARAM)buddy, 0);
+	SendMessageW((HWND)spinner, UDM_SETRANGE32, (WPARAM)minVal, (LPARAM)maxVal);
+	SendMessageW((HWND)spinner, UDM_SETPOS32, 0, (LPARAM)pos);
+}
+
+
+static void SetText(void *context, UiHandle control, const wchar_t *text){
+	(void)context;
+	SetWindowTextW((HWND)control, text);
+}
+
+
+//The up-down control reads and clamps the typed text of its buddy itself.
+static int GetSpinner(void *context, UiHandle spinner){
+	(void)context;
+	return (int)SendMessageW((HWND)spinner, UDM_GETPOS32, 0, 0);
+}
+
+
+static int PostCommand(void *context, int controlId, int notifyCode){
+	UiWin32 *win32 = context;
+	return PostMessageW(win32->mainWindow, WM_COMMAND, MAKEWPARAM(controlId, notifyCode), 0) != 0;
+}
+
+
+static void ShowMessage(void *context, const wchar_t *title, const wchar_t *text){
+	UiWin32 *win32 = context;
+	MessageBoxW(win32->mainWindow, text, title, MB_OK | MB_ICONINFORMATION);
+}
+
+
+//The flush timer's TimerFn.
+static void FlushDue(void *user){
+	UiWin32 *win32 = user;
+	win32->onFlush(win32->user);
+}
+
+
+//A flush that is already scheduled is moved, like SetTimer with the same ID.
+static void ScheduleFlush(void *context, int delayMs){
+	UiWin32 *win32 = context;
+	EventLoopTimer(win32->loop, &win32->flushTimer, (uint64_t)(delayMs > 0 ? delayMs : 0), FlushDue, win32);
+}
+
+
+int UiWin32Init(UiWin32 *win32, HINSTANCE instance, WNDPROC wndProc, EventLoop *loop, UiFlushFn onFlush, void *user){
+
+	ZeroMemory(win32, sizeof(*win32));
+	win32->instance = instance;
+	win32->wndProc = wndProc;
+	win32->loop = loop;
+	win32->onFlush = onFlush;
+	win32->user = user;
+
+	UiBackend *b = &win32->backend;
+	b->context = win32;
+	b->createWindow = CreateMainWindow;
+	b->createControl = CreateButton;
+	b->setSpinner = SetSpinner;
+	b->setText = SetText;
+	b->getSpinner = GetSpinner;
+	b->postCommand = PostCommand;
+	b->showMessage = ShowMessage;
+	b->scheduleFlush = ScheduleFlush;
+
+	INITCOMMONCONTROLSEX icc;
+	ZeroMemory(&icc, sizeof(icc));
+	icc.dwSize = sizeof(icc);
+	icc.dwICC = ICC_UPDOWN_CLASS;
+	InitCommonControlsEx(&icc);
+
+	return RegisterMainWindowClass(instance, wndProc);
+}
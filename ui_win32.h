@@ -0,0 +1,37 @@
+#ifndef UI_WIN32_H
+#define UI_WIN32_H
+
+#include <windows.h>
+
+#include "ui_backend.h"
+#include "event_loop.h"
+
+/* The UiBackend of the real overlay: the main window and the common controls of CONTROL_KIND_TABLE
+ * (controls.h), created with CreateWindowExW. Handles are HWNDs.
+ */
+
+
+/* backend : pass &win32->backend to OverlayUiInit
+ * instance : module instance handle from WinMain
+ * wndProc : the window procedure of the main window
+ * mainWindow : set by createWindow, receives postCommand
+ * loop / flushTimer : scheduleFlush runs onFlush(user) on flushTimer of the loop
+ */
+typedef struct UiWin32 {
+	UiBackend backend;
+	HINSTANCE instance;
+	WNDPROC wndProc;
+	HWND mainWindow;
+	EventLoop *loop;
+	Timer flushTimer;
+	UiFlushFn onFlush;
+	void *user;
+} UiWin32;
+
+
+/* Fills in the backend and registers the main window class. Returns 0 if the class could not be registered.
+ * The loop has to outlive the backend.
+ */
+int UiWin32Init(UiWin32 *win32, HINSTANCE instance, WNDPROC wndProc, EventLoop *loop, UiFlushFn onFlush, void *user);
+
+#endif